@@ -0,0 +1,71 @@
+// Copyright 2016 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+
+#include "camera_aravis/clock_estimator.h"
+
+// Accuracy of the camera -> host clock mapping on a simulated stream: the camera clock
+// drifts at a fixed rate, and every frame reaches the host after an exponentially
+// distributed transport delay.  Prints the largest and RMS error of the stamps against
+// true host time once the fit is locked, and fails (exit 1) if the largest is over the
+// bound.  It needs no camera.
+//   clock_estimator_bench [hours] [fps] [drift ppm] [mean delay us] [bound us]
+
+int main(int argc, char * argv[])
+{
+	double	hours = argc > 1 ? atof(argv[1]) : 3.0;
+	double	fps = argc > 2 ? atof(argv[2]) : 30.0;
+	double	ppm = argc > 3 ? atof(argv[3]) : 20.0;
+	double	usDelay = argc > 4 ? atof(argv[4]) : 200.0;
+	double	usBound = argc > 5 ? atof(argv[5]) : 20.0;
+
+	camera_aravis::ClockEstimator			clock;	// Default window and block, as the node's.
+	std::mt19937_64							random(1);
+	std::exponential_distribution<double>	delay(1.0 / (usDelay * 1e3));
+	const int64_t							nsHostStart = 1700000000LL * 1000000000LL;
+	const int64_t							nsCameraStart = 12345678901LL;
+	long									nFrames = (long)(hours * 3600.0 * fps);
+	long									nLocked = 0;
+	double									nsErrorMax = 0.0;
+	double									sumSquares = 0.0;
+
+	for (long i=0; i<nFrames; i++)
+	{
+		double	nsTrue = i * 1e9 / fps;
+		int64_t	nsHost = nsHostStart + (int64_t)llround(nsTrue);
+		int64_t	nsCamera = nsCameraStart + (int64_t)llround(nsTrue * (1.0 + ppm * 1e-6));
+
+		clock.AddSample(nsCamera, nsHost + (int64_t)llround(delay(random)));
+		if (!clock.IsLocked())
+			continue;
+
+		double nsError = fabs((double)(clock.ToHost(nsCamera) - nsHost));
+		nsErrorMax = std::max(nsErrorMax, nsError);
+		sumSquares += nsError * nsError;
+		nLocked++;
+	}
+
+	printf("{\"hours\": %.2f, \"fps\": %.1f, \"drift_ppm\": %.1f, \"delay_us_mean\": %.1f, \"frames\": %ld, \"frames_locked\": %ld, "
+	       "\"error_us_max\": %.1f, \"error_us_rms\": %.2f, \"drift_ppm_estimated\": %.3f}\n",
+		hours, fps, ppm, usDelay, nFrames, nLocked, nsErrorMax / 1e3, nLocked ? sqrt(sumSquares / nLocked) / 1e3 : 0.0,
+		clock.GetDriftPpm());
+
+	return nLocked > 0 && nsErrorMax <= usBound * 1e3 ? 0 : 1;
+}
@@ -0,0 +1,306 @@
+// Copyright 2016 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include <sys/resource.h>
+#include <time.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <new>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <arv.h>
+
+#include "rclcpp/rclcpp.hpp"
+#include "sensor_msgs/msg/image.hpp"
+#include "diagnostic_msgs/msg/diagnostic_array.hpp"
+
+#include "camera_aravis/camera_node.h"
+
+// The whole frame path of CameraNode, CreateStream -> acquisition -> publish -> subscriber,
+// against the Aravis fake camera, so it runs on any Linux box.  Sweeps every combination of
+//   fake_camera_bench [seconds=3] [sizes=640x480,1280x1024,1920x1080] [formats=Mono8,Mono16,BayerRG8]
+//                     [fps=30,120] [buffers=4,16] [modes=thread,glib] [out=results.jsonl]
+// and prints one JSON object per point, also appended to "out" if given, so runs can be
+// diffed for regressions.  CPU time is the whole process's, fake camera included.
+
+// Every operator new in the process, to catch allocations creeping into the frame path.
+static std::atomic<uint64_t> g_nHeapAllocations(0);
+
+void *operator new(size_t nbytes)
+{
+	g_nHeapAllocations.fetch_add(1, std::memory_order_relaxed);
+	void *p = malloc(nbytes ? nbytes : 1);
+	if (!p)
+		throw std::bad_alloc();
+	return p;
+}
+
+void operator delete(void *p) noexcept
+{
+	free(p);
+}
+
+void operator delete(void *p, size_t) noexcept
+{
+	free(p);
+}
+
+struct Point
+{
+	int			width;
+	int			height;
+	std::string	stFormat;
+	double		fps;
+	int			nBuffers;
+	bool		bGlib;
+};
+
+// Frame path measurements over one point's window.
+struct Result
+{
+	uint64_t				nFrames;
+	uint64_t				nBytes;
+	std::string				stEncoding;
+	int						width;
+	int						height;
+	std::vector<int64_t>	latencies;	// Camera timestamp on the host clock -> subscriber, ns.
+	double					nDropped;	// Integrated from the diagnostics rates.
+	double					nFailures;
+	double					nUnderruns;
+	long					nPoolAllocationsFirst;
+	long					nPoolAllocationsLast;
+};
+
+static double CpuSeconds(void)
+{
+	struct rusage	usage;
+
+	getrusage(RUSAGE_SELF, &usage);
+	return usage.ru_utime.tv_sec + usage.ru_stime.tv_sec + (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) * 1e-6;
+}
+
+static int64_t RealtimeNs(void)
+{
+	struct timespec	ts;
+
+	clock_gettime(CLOCK_REALTIME, &ts);
+	return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static std::vector<std::string> Split(const std::string &st)
+{
+	std::vector<std::string>	items;
+	std::stringstream			ss(st);
+	std::string					stItem;
+
+	while (std::getline(ss, stItem, ','))
+		if (!stItem.empty())
+			items.push_back(stItem);
+	return items;
+}
+
+static double Percentile(std::vector<int64_t> &samples, double p)
+{
+	if (samples.empty())
+		return 0.0;
+	size_t i = std::min(samples.size() - 1, (size_t)(p * samples.size()));
+	std::nth_element(samples.begin(), samples.begin() + i, samples.end());
+	return samples[i] / 1e3;
+}
+
+// The fake camera's device id, once its interface is enabled.
+static std::string FindFakeCamera(void)
+{
+	arv_enable_interface("Fake");
+	arv_update_device_list();
+	for (unsigned i=0; i<arv_get_n_devices(); i++)
+		if (strstr(arv_get_device_id(i), "Fake"))
+			return arv_get_device_id(i);
+	return "";
+}
+
+static double Value(const diagnostic_msgs::msg::DiagnosticStatus &status, const char *szKey)
+{
+	for (auto &kv : status.values)
+		if (kv.key == szKey)
+			return atof(kv.value.c_str());
+	return 0.0;
+}
+
+static void RunPoint(const std::string &stGuid, const Point &point, int nSeconds, FILE *pOut)
+{
+	Result				result;
+	std::atomic<bool>	bMeasuring(false);
+	int64_t				nsDiagnosticsPrev = 0;
+	rclcpp::NodeOptions	options;
+
+	result.nFrames = result.nBytes = 0;
+	result.width = result.height = 0;
+	result.nDropped = result.nFailures = result.nUnderruns = 0.0;
+	result.nPoolAllocationsFirst = result.nPoolAllocationsLast = -1;
+	result.latencies.reserve(1 << 20);
+
+	options.use_intra_process_comms(true);
+	options.append_parameter_override("guid", stGuid);
+	options.append_parameter_override("pixel_format", point.stFormat);
+	options.append_parameter_override("roi.width", point.width);
+	options.append_parameter_override("roi.height", point.height);
+	options.append_parameter_override("frame_rate", point.fps);
+	options.append_parameter_override("pool_min", point.nBuffers);
+	options.append_parameter_override("pool_max", point.nBuffers);
+	options.append_parameter_override("pool_adaptive", false);
+	options.append_parameter_override("use_glib_loop", point.bGlib);
+
+	auto camera = std::make_shared<camera_aravis::CameraNode>(options);
+	auto listener = std::make_shared<rclcpp::Node>("listener", rclcpp::NodeOptions().use_intra_process_comms(true));
+	auto subImage = listener->create_subscription<sensor_msgs::msg::Image>("image", rclcpp::QoS(10),
+		[&](sensor_msgs::msg::Image::UniquePtr pMsg)
+		{
+			if (!bMeasuring)
+				return;
+			int64_t nsStamp = (int64_t)pMsg->header.stamp.sec * 1000000000LL + pMsg->header.stamp.nanosec;
+			result.latencies.push_back(RealtimeNs() - nsStamp);
+			result.nFrames++;
+			result.nBytes += pMsg->data.size();
+			result.stEncoding = pMsg->encoding;
+			result.width = pMsg->width;
+			result.height = pMsg->height;
+		});
+	auto subDiagnostics = listener->create_subscription<diagnostic_msgs::msg::DiagnosticArray>("diagnostics", rclcpp::QoS(10),
+		[&](diagnostic_msgs::msg::DiagnosticArray::UniquePtr pMsg)
+		{
+			int64_t nsNow = RealtimeNs();
+			double seconds = nsDiagnosticsPrev ? (nsNow - nsDiagnosticsPrev) / 1e9 : 0.0;
+
+			nsDiagnosticsPrev = nsNow;
+			if (!bMeasuring || pMsg->status.empty())
+				return;
+			const diagnostic_msgs::msg::DiagnosticStatus &status = pMsg->status[0];
+			result.nDropped += Value(status, "dropped_hz") * seconds;
+			result.nFailures += Value(status, "failures_hz") * seconds;
+			result.nUnderruns += Value(status, "underruns_hz") * seconds;
+			result.nPoolAllocationsLast = (long)Value(status, "pool_allocations");
+			if (result.nPoolAllocationsFirst < 0)
+				result.nPoolAllocationsFirst = result.nPoolAllocationsLast;
+		});
+
+	rclcpp::executors::SingleThreadedExecutor executor;
+	executor.add_node(camera);
+	executor.add_node(listener);
+
+	// Warm up: the clock fit, the pool and the caches settle.
+	auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(1);
+	while (std::chrono::steady_clock::now() < deadline)
+		executor.spin_some(std::chrono::milliseconds(10));
+
+	double cpuStart = CpuSeconds();
+	uint64_t nHeapStart = g_nHeapAllocations.load();
+	auto start = std::chrono::steady_clock::now();
+	bMeasuring = true;
+	deadline = start + std::chrono::seconds(nSeconds);
+	while (std::chrono::steady_clock::now() < deadline)
+		executor.spin_some(std::chrono::milliseconds(10));
+	bMeasuring = false;
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	double cpu = CpuSeconds() - cpuStart;
+	uint64_t nHeap = g_nHeapAllocations.load() - nHeapStart;
+
+	double p50 = Percentile(result.latencies, 0.50);
+	double p90 = Percentile(result.latencies, 0.90);
+	double p99 = Percentile(result.latencies, 0.99);
+	double pMax = result.latencies.empty() ? 0.0 : *std::max_element(result.latencies.begin(), result.latencies.end()) / 1e3;
+	char sz[1024];
+	snprintf(sz, sizeof(sz),
+		"{\"mode\": \"%s\", \"width\": %d, \"height\": %d, \"pixel_format\": \"%s\", \"fps_set\": %.1f, \"buffers\": %d, "
+		"\"actual_width\": %d, \"actual_height\": %d, \"encoding\": \"%s\", \"seconds\": %.2f, \"frames\": %lu, \"fps\": %.2f, \"MBps\": %.1f, "
+		"\"cpu_ms_per_frame\": %.3f, \"latency_us\": {\"p50\": %.1f, \"p90\": %.1f, \"p99\": %.1f, \"max\": %.1f}, "
+		"\"dropped\": %.0f, \"failures\": %.0f, \"underruns\": %.0f, \"pool_allocations\": %ld, \"heap_allocations_per_frame\": %.2f}\n",
+		point.bGlib ? "glib" : "thread", point.width, point.height, point.stFormat.c_str(), point.fps, point.nBuffers,
+		result.width, result.height, result.stEncoding.c_str(), seconds, (unsigned long)result.nFrames,
+		result.nFrames / seconds, result.nBytes / seconds / 1e6,
+		result.nFrames ? cpu * 1e3 / result.nFrames : 0.0, p50, p90, p99, pMax,
+		result.nDropped, result.nFailures, result.nUnderruns,
+		result.nPoolAllocationsFirst < 0 ? 0L : result.nPoolAllocationsLast - result.nPoolAllocationsFirst,
+		result.nFrames ? (double)nHeap / result.nFrames : 0.0);
+	fputs(sz, stdout);
+	fflush(stdout);
+	if (pOut)
+	{
+		fputs(sz, pOut);
+		fflush(pOut);
+	}
+}
+
+int main(int argc, char * argv[])
+{
+	rclcpp::init(argc, argv);
+
+	std::map<std::string, std::string> args = {
+		{"seconds", "3"},
+		{"sizes", "640x480,1280x1024,1920x1080"},
+		{"formats", "Mono8,Mono16,BayerRG8"},
+		{"fps", "30,120"},
+		{"buffers", "4,16"},
+		{"modes", "thread"},
+		{"out", ""}};
+	for (auto &stArg : rclcpp::remove_ros_arguments(argc, argv))
+	{
+		size_t i = stArg.find('=');
+		if (i != std::string::npos)
+			args[stArg.substr(0, i)] = stArg.substr(i + 1);
+	}
+
+	std::string stGuid = FindFakeCamera();
+	if (stGuid.empty())
+	{
+		fprintf(stderr, "No Aravis fake camera.\n");
+		rclcpp::shutdown();
+		return 1;
+	}
+
+	FILE *pOut = args["out"].empty() ? NULL : fopen(args["out"].c_str(), "a");
+	int nSeconds = atoi(args["seconds"].c_str());
+
+	for (auto &stMode : Split(args["modes"]))
+		for (auto &stSize : Split(args["sizes"]))
+			for (auto &stFormat : Split(args["formats"]))
+				for (auto &stFps : Split(args["fps"]))
+					for (auto &stBuffers : Split(args["buffers"]))
+					{
+						Point point;
+						if (sscanf(stSize.c_str(), "%dx%d", &point.width, &point.height) != 2)
+							continue;
+						point.stFormat = stFormat;
+						point.fps = atof(stFps.c_str());
+						point.nBuffers = atoi(stBuffers.c_str());
+						point.bGlib = stMode == "glib";
+						RunPoint(stGuid, point, nSeconds, pOut);
+					}
+
+	if (pOut)
+		fclose(pOut);
+	rclcpp::shutdown();
+
+	return 0;
+}
@@ -0,0 +1,70 @@
+// Copyright 2016 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <thread>
+
+#include "camera_aravis/frame_pool.h"
+
+// Cost of FramePool::Detach() on the publish thread, with and without spare messages.
+// A pool without a stream hands out its buffers; each is detached, as for intra-process
+// publishing, at the frame interval.  Fails (exit 1) if, with spares, a Detach() had to
+// make its message on the spot.
+//   frame_pool_bench [payload MB] [frames] [interval ms]
+
+static void RunOnce(size_t nbytesPayload, int nFrames, int msInterval, unsigned nSpares)
+{
+	camera_aravis::FramePool	pool;
+	double						usSum = 0.0;
+	double						usMax = 0.0;
+
+	pool.Create(NULL, nbytesPayload, 4);
+	pool.KeepSpares(nSpares);
+	std::this_thread::sleep_for(std::chrono::milliseconds(100));	// Spares made.
+
+	for (int i=0; i<nFrames; i++)
+	{
+		ArvBuffer *pBuffer = pool.Acquire();
+		auto start = std::chrono::steady_clock::now();
+		std::unique_ptr<sensor_msgs::msg::Image> pMsg = pool.Detach(pBuffer);
+		double us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+
+		usSum += us;
+		usMax = std::max(usMax, us);
+		pMsg.reset();	// As the subscriber would, later.
+		std::this_thread::sleep_for(std::chrono::milliseconds(msInterval));
+	}
+
+	printf("{\"spares\": %u, \"payload_MB\": %.1f, \"frames\": %d, \"detach_us_mean\": %.1f, \"detach_us_max\": %.1f, \"spare_misses\": %lu}\n",
+		nSpares, nbytesPayload / 1048576.0, nFrames, usSum / nFrames, usMax, (unsigned long)pool.nSpareMisses());
+	if (nSpares > 0 && pool.nSpareMisses() > 0)
+		exit(1);
+}
+
+int main(int argc, char * argv[])
+{
+	size_t	nbytesPayload = (size_t)((argc > 1 ? atof(argv[1]) : 5.0) * 1048576);
+	int		nFrames = argc > 2 ? atoi(argv[2]) : 200;
+	int		msInterval = argc > 3 ? atoi(argv[3]) : 8;
+
+	RunOnce(nbytesPayload, nFrames, msInterval, 0);
+	RunOnce(nbytesPayload, nFrames, msInterval, 2);
+
+	return 0;
+}
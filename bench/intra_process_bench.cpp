@@ -0,0 +1,96 @@
+// Copyright 2016 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include <sys/resource.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <future>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "rclcpp/rclcpp.hpp"
+#include "sensor_msgs/msg/image.hpp"
+
+#include "camera_aravis/camera_node.h"
+
+// Throughput of the CameraNode component with an image subscriber in the same process.
+//   intra_process_bench [VendorName-Serial] [seconds]
+//
+// Runs twice: once with intra-process comms (unique_ptr hand-off, what a component
+// container gives you) and once without (every frame serialized through the middleware,
+// which is what the standalone camnode executable costs its subscribers).
+
+static double CpuSeconds(void)
+{
+	struct rusage	usage;
+
+	getrusage(RUSAGE_SELF, &usage);
+	return usage.ru_utime.tv_sec + usage.ru_stime.tv_sec + (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) * 1e-6;
+}
+
+static void RunOnce(const std::string &stGuid, bool bIntraProcess, int nSeconds)
+{
+	std::atomic<uint64_t>	nFrames(0);
+	std::atomic<uint64_t>	nBytes(0);
+	rclcpp::NodeOptions		options;
+
+	options.use_intra_process_comms(bIntraProcess);
+	if (!stGuid.empty())
+		options.append_parameter_override("guid", stGuid);
+
+	auto camera = std::make_shared<camera_aravis::CameraNode>(options);
+	auto listener = std::make_shared<rclcpp::Node>("listener", rclcpp::NodeOptions().use_intra_process_comms(bIntraProcess));
+	auto subscription = listener->create_subscription<sensor_msgs::msg::Image>("image", rclcpp::QoS(10),
+		[&](sensor_msgs::msg::Image::UniquePtr pMsg)
+		{
+			nFrames++;
+			nBytes += pMsg->data.size();
+		});
+
+	rclcpp::executors::SingleThreadedExecutor executor;
+	executor.add_node(camera);
+	executor.add_node(listener);
+
+	double cpuStart = CpuSeconds();
+	executor.spin_until_future_complete(std::promise<void>().get_future(), std::chrono::seconds(nSeconds));
+	double cpu = CpuSeconds() - cpuStart;
+
+	printf("{\"mode\": \"%s\", \"seconds\": %d, \"frames\": %lu, \"fps\": %.2f, \"MBps\": %.1f, \"cpu_ms_per_frame\": %.3f}\n",
+		bIntraProcess ? "intra_process" : "inter_process",
+		nSeconds,
+		(unsigned long)nFrames.load(),
+		(double)nFrames / nSeconds,
+		(double)nBytes / nSeconds / 1e6,
+		nFrames ? cpu * 1e3 / nFrames : 0.0);
+}
+
+int main(int argc, char * argv[])
+{
+	rclcpp::init(argc, argv);
+
+	std::vector<std::string> args = rclcpp::remove_ros_arguments(argc, argv);
+	std::string stGuid = args.size() > 1 ? args[1] : "";
+	int nSeconds = args.size() > 2 ? std::stoi(args[2]) : 10;
+
+	RunOnce(stGuid, false, nSeconds);
+	RunOnce(stGuid, true, nSeconds);
+
+	rclcpp::shutdown();
+
+	return 0;
+}
@@ -0,0 +1,146 @@
+// Copyright 2016 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "camera_aravis/pixel_convert.h"
+#include "camera_aravis/stripe_pool.h"
+
+using camera_aravis::PixelConversion;
+
+// Pixel format conversion: vectorized kernel, striped over threads, against the
+// scalar reference.  Fails (exit 1) if any output differs by a single bit, or if the
+// stripe pool, stopped and started again between runs as reconfiguration does, misses
+// or repeats a row.
+//   pixel_convert_bench [iterations] [threads]
+
+struct Case
+{
+	const char				*szName;
+	camera_aravis::ConversionKind kind;
+	camera_aravis::BayerPattern pattern;
+	int						 nBits;
+};
+
+static double MsPerFrame(const std::function<void ()> &fn, int nIterations)
+{
+	auto start = std::chrono::steady_clock::now();
+
+	for (int i=0; i<nIterations; i++)
+		fn();
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / nIterations;
+}
+
+int main(int argc, char * argv[])
+{
+	int nIterations = argc > 1 ? atoi(argv[1]) : 20;
+	int nThreads = argc > 2 ? atoi(argv[2]) : (int)std::thread::hardware_concurrency();
+	int sizes[][2] = {{640, 480}, {1920, 1200}, {2448, 2048}};
+	Case cases[] = {
+		{"BayerRG8",      camera_aravis::CONVERSION_BAYER8,        camera_aravis::BAYER_RG, 8},
+		{"BayerBG8",      camera_aravis::CONVERSION_BAYER8,        camera_aravis::BAYER_BG, 8},
+		{"BayerGR8",      camera_aravis::CONVERSION_BAYER8,        camera_aravis::BAYER_GR, 8},
+		{"BayerGB8",      camera_aravis::CONVERSION_BAYER8,        camera_aravis::BAYER_GB, 8},
+		{"BayerRG12",     camera_aravis::CONVERSION_BAYER16,       camera_aravis::BAYER_RG, 12},
+		{"BayerGB10",     camera_aravis::CONVERSION_BAYER16,       camera_aravis::BAYER_GB, 10},
+		{"Mono12",        camera_aravis::CONVERSION_MONO16,        camera_aravis::BAYER_RG, 12},
+		{"Mono10Packed",  camera_aravis::CONVERSION_MONO10_PACKED, camera_aravis::BAYER_RG, 10},
+		{"Mono12Packed",  camera_aravis::CONVERSION_MONO12_PACKED, camera_aravis::BAYER_RG, 12},
+	};
+	camera_aravis::StripePool	stripes(nThreads);
+	std::mt19937				random(1);
+	int							nMismatches = 0;
+
+	for (auto &size : sizes)
+	{
+		int width = size[0];
+		int height = size[1];
+
+		for (auto &c : cases)
+		{
+			PixelConversion conv;
+			conv.kind = c.kind;
+			conv.pattern = c.pattern;
+			conv.nBitsIn = c.nBits;
+			conv.bBgr = false;
+
+			std::vector<uint8_t> src(conv.SrcStep(width) * height);
+			std::vector<uint8_t> dstReference(conv.DstStep(width) * height);
+			std::vector<uint8_t> dst(dstReference.size());
+
+			for (auto &b : src)
+				b = (uint8_t)random();
+			if (c.kind == camera_aravis::CONVERSION_BAYER16 || c.kind == camera_aravis::CONVERSION_MONO16)
+				for (size_t i=0; i<src.size()/2; i++)
+					((uint16_t *)src.data())[i] &= (uint16_t)((1 << c.nBits) - 1);
+
+			double msReference = MsPerFrame([&] {
+				camera_aravis::ConvertRowsReference(conv, src.data(), dstReference.data(), width, height, 0, height); }, 1);
+			double msVector = MsPerFrame([&] {
+				camera_aravis::ConvertRows(conv, src.data(), dst.data(), width, height, 0, height); }, nIterations);
+			bool bExact = dst == dstReference;
+
+			std::fill(dst.begin(), dst.end(), 0);
+			double msStriped = MsPerFrame([&] {
+				stripes.Run(height, [&](int yBegin, int yEnd) {
+					camera_aravis::ConvertRows(conv, src.data(), dst.data(), width, height, yBegin, yEnd); }); }, nIterations);
+			bExact = bExact && dst == dstReference;
+
+			if (!bExact)
+				nMismatches++;
+			printf("{\"format\": \"%s\", \"width\": %d, \"height\": %d, \"reference_ms\": %.3f, \"vector_ms\": %.3f, "
+			       "\"striped_ms\": %.3f, \"threads\": %d, \"speedup\": %.1f, \"bit_exact\": %s}\n",
+				c.szName, width, height, msReference, msVector, msStriped, stripes.nThreads(),
+				msStriped > 0.0 ? msReference / msStriped : 0.0, bExact ? "true" : "false");
+		}
+	}
+
+	// Restarted workers must wait for the next Run(), not replay the last one.
+	{
+		const int						nRuns = 2000;
+		const int						height = 480;
+		std::vector<std::atomic<int>>	covered(height);
+		int								nBad = 0;
+
+		for (int iRun=0; iRun<nRuns; iRun++)
+		{
+			if (iRun % 7 == 0)
+				stripes.Start(1 + iRun / 7 % std::max(nThreads, 2));
+			for (auto &n : covered)
+				n = 0;
+			stripes.Run(height, [&](int yBegin, int yEnd) {
+				for (int y=yBegin; y<yEnd; y++)
+					covered[y]++; });
+			for (auto &n : covered)
+				if (n != 1)
+					nBad++;
+		}
+		if (nBad)
+			nMismatches++;
+		printf("{\"check\": \"stripe_restart\", \"runs\": %d, \"restarts\": %d, \"rows_wrong\": %d}\n",
+			nRuns, (nRuns + 6) / 7, nBad);
+	}
+
+	return nMismatches ? 1 : 0;
+}
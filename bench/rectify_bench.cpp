@@ -0,0 +1,194 @@
+// Copyright 2016 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <random>
+#include <thread>
+#include <vector>
+
+#ifdef CAMERA_ARAVIS_HAVE_OPENCV
+#include <opencv2/calib3d.hpp>
+#include <opencv2/core.hpp>
+#include <opencv2/imgproc.hpp>
+#endif
+
+#include "camera_aravis/rectify.h"
+#include "camera_aravis/stripe_pool.h"
+
+using camera_aravis::RectifyMap;
+
+// Rectification: the tiled fixed-point map, vectorized and striped over threads, against
+// the scalar reference, and when built with OpenCV against cv::remap() on its own
+// fixed-point (CV_16SC2) maps.  Fails (exit 1) if the kernel differs from the reference
+// by a single bit; the OpenCV output is compared, not required to match.
+//   rectify_bench [iterations] [threads]
+
+struct Case
+{
+	const char					*szEncoding;
+	camera_aravis::RectifySource source;
+	int							nbytesPixel;
+};
+
+static double MsPerFrame(const std::function<void ()> &fn, int nIterations)
+{
+	auto start = std::chrono::steady_clock::now();
+
+	for (int i=0; i<nIterations; i++)
+		fn();
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / nIterations;
+}
+
+// A wide-angle lens with barrel distortion, rectified to a slightly narrower view.
+static camera_aravis::Calibration CalibrationFor(int width, int height)
+{
+	camera_aravis::Calibration calibration;
+	double f = 0.8 * width;
+
+	calibration.width = width;
+	calibration.height = height;
+	calibration.stModel = "plumb_bob";
+	calibration.D = {-0.28, 0.09, 0.0005, -0.0004, -0.01};
+	double K[9] = {f, 0, width / 2.0 - 3.5, 0, f, height / 2.0 + 2.5, 0, 0, 1};
+	double R[9] = {1, 0, 0, 0, 1, 0, 0, 0, 1};
+	double P[12] = {0.9 * f, 0, width / 2.0, 0, 0, 0.9 * f, height / 2.0, 0, 0, 0, 1, 0};
+	memcpy(calibration.K, K, sizeof(K));
+	memcpy(calibration.R, R, sizeof(R));
+	memcpy(calibration.P, P, sizeof(P));
+	return calibration;
+}
+
+int main(int argc, char * argv[])
+{
+	int nIterations = argc > 1 ? atoi(argv[1]) : 20;
+	int nThreads = argc > 2 ? atoi(argv[2]) : (int)std::thread::hardware_concurrency();
+	int sizes[][2] = {{640, 480}, {1920, 1200}, {2448, 2048}};
+	Case cases[] = {
+		{"mono8",  camera_aravis::RECTIFY_MONO8,  1},
+		{"mono16", camera_aravis::RECTIFY_MONO16, 2},
+		{"rgb8",   camera_aravis::RECTIFY_COLOR8, 3},
+	};
+	camera_aravis::StripePool	stripes(nThreads);
+	std::mt19937				random(1);
+	int							nMismatches = 0;
+
+#ifdef CAMERA_ARAVIS_HAVE_OPENCV
+	cv::setNumThreads(stripes.nThreads());
+#endif
+	for (auto &size : sizes)
+	{
+		int									width = size[0];
+		int									height = size[1];
+		camera_aravis::Calibration			calibration = CalibrationFor(width, height);
+		camera_aravis::ImageWindow			window = {0, 0, 1, 1, width, height};
+		RectifyMap							map;
+		std::string							stError;
+
+		double msBuild = MsPerFrame([&] { map.Build(calibration, window, stError); }, 1);
+		if (map.IsEmpty())
+		{
+			fprintf(stderr, "%dx%d: %s\n", width, height, stError.c_str());
+			return 1;
+		}
+
+#ifdef CAMERA_ARAVIS_HAVE_OPENCV
+		cv::Mat	K(3, 3, CV_64F, calibration.K);
+		cv::Mat	R(3, 3, CV_64F, calibration.R);
+		cv::Mat	P(3, 4, CV_64F, calibration.P);
+		cv::Mat	D(1, (int)calibration.D.size(), CV_64F, calibration.D.data());
+		cv::Mat	map1, map2;
+
+		double msBuildOpenCV = MsPerFrame([&] {
+			cv::initUndistortRectifyMap(K, D, R, P(cv::Rect(0, 0, 3, 3)), cv::Size(width, height), CV_16SC2, map1, map2); }, 1);
+#endif
+
+		for (auto &c : cases)
+		{
+			size_t step = (size_t)width * c.nbytesPixel;
+			std::vector<uint8_t> src(step * height);
+			std::vector<uint8_t> dstReference(src.size());
+			std::vector<uint8_t> dst(src.size());
+
+			// Smooth content, so the comparison with OpenCV is about geometry rather than noise.
+			for (int y=0; y<height; y++)
+				for (size_t i=0; i<step; i++)
+					src[y * step + i] = (uint8_t)(((i / c.nbytesPixel) * 7 + y * 3 + (random() & 7)) >> 2);
+
+			double msReference = MsPerFrame([&] {
+				map.RemapReference(c.source, src.data(), step, dstReference.data(), step, 0, height); }, 1);
+			double msVector = MsPerFrame([&] {
+				map.Remap(c.source, src.data(), step, dst.data(), step, 0, height); }, nIterations);
+			bool bExact = dst == dstReference;
+
+			std::fill(dst.begin(), dst.end(), 0);
+			double msStriped = MsPerFrame([&] {
+				stripes.Run(height, [&](int yBegin, int yEnd) {
+					map.Remap(c.source, src.data(), step, dst.data(), step, yBegin, yEnd); }, RectifyMap::nTileHeight); }, nIterations);
+			bExact = bExact && dst == dstReference;
+			if (!bExact)
+				nMismatches++;
+
+			printf("{\"encoding\": \"%s\", \"width\": %d, \"height\": %d, \"map_build_ms\": %.1f, \"map_mb\": %.1f, "
+			       "\"reference_ms\": %.3f, \"vector_ms\": %.3f, \"striped_ms\": %.3f, \"threads\": %d, \"bit_exact\": %s",
+				c.szEncoding, width, height, msBuild, map.nbytes() / 1e6,
+				msReference, msVector, msStriped, stripes.nThreads(), bExact ? "true" : "false");
+
+#ifdef CAMERA_ARAVIS_HAVE_OPENCV
+			int			type = c.source == camera_aravis::RECTIFY_MONO16 ? CV_16UC1 : (c.source == camera_aravis::RECTIFY_COLOR8 ? CV_8UC3 : CV_8UC1);
+			cv::Mat		matSrc(height, width, type, src.data(), step);
+			cv::Mat		matDst;
+
+			double msOpenCV = MsPerFrame([&] {
+				cv::remap(matSrc, matDst, map1, map2, cv::INTER_LINEAR, cv::BORDER_CONSTANT); }, nIterations);
+
+			// Largest difference, ignoring the border where the two disagree on what is inside.
+			int nDiffMax = 0;
+			for (int y=2; y<height - 2; y++)
+				for (size_t i=2 * c.nbytesPixel; i<step - 2 * c.nbytesPixel; i+=(c.nbytesPixel == 2 ? 2 : 1))
+				{
+					int a, b;
+
+					if (c.nbytesPixel == 2)
+					{
+						uint16_t p, q;
+
+						memcpy(&p, dst.data() + y * step + i, 2);
+						memcpy(&q, matDst.ptr(y) + i, 2);
+						a = p >> 8;
+						b = q >> 8;
+					}
+					else
+					{
+						a = dst[y * step + i];
+						b = matDst.ptr(y)[i];
+					}
+					if (a && b)
+						nDiffMax = std::max(nDiffMax, std::abs(a - b));
+				}
+			printf(", \"opencv_map_build_ms\": %.1f, \"opencv_ms\": %.3f, \"speedup_vs_opencv\": %.2f, \"opencv_max_diff\": %d",
+				msBuildOpenCV, msOpenCV, msStriped > 0.0 ? msOpenCV / msStriped : 0.0, nDiffMax);
+#endif
+			printf("}\n");
+		}
+	}
+
+	return nMismatches ? 1 : 0;
+}
@@ -0,0 +1,161 @@
+// Copyright 2016 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "rclcpp/rclcpp.hpp"
+#include "sensor_msgs/msg/image.hpp"
+
+#include "camera_aravis/latency_histogram.h"
+#include "camera_aravis/msg/shm_frame.hpp"
+#include "camera_aravis/shm_ring.h"
+
+// Publish -> consume latency of the shared-memory ring against plain DDS, from another
+// process, with a driver running shm_slots > 0:
+//   camnode --ros-args -p shm_slots:=8 &
+//   shm_latency_bench [topic=image] [seconds=10]
+// Both paths are timed from the instant the frame was complete in the ring, just before
+// the image is published, to the moment the consumer has read every cache line of the
+// frame; images are matched to their descriptors by header.stamp.  Prints one JSON
+// object per path.
+
+using camera_aravis::LatencyHistogram;
+
+static int64_t NowNs(void)
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static int64_t StampNs(const std_msgs::msg::Header &header)
+{
+	return (int64_t)header.stamp.sec * 1000000000LL + header.stamp.nanosec;
+}
+
+// What a consumer does at the least: look at the whole frame.
+static uint64_t Touch(const uint8_t *pData, size_t nbytes)
+{
+	uint64_t sum = 0;
+
+	for (size_t i=0; i<nbytes; i+=64)
+		sum += pData[i];
+	return sum;
+}
+
+static void Print(const char *szPath, LatencyHistogram &hist, int nSeconds, const std::string &stExtra)
+{
+	LatencyHistogram::Snapshot	snapshot;
+
+	hist.Collect(snapshot);
+	printf("{\"path\": \"%s\", \"seconds\": %d, \"frames\": %lu, \"mean_us\": %.1f, \"p50_us\": %.1f, \"p99_us\": %.1f, \"max_us\": %.1f%s}\n",
+		szPath, nSeconds, (unsigned long)snapshot.n, snapshot.Mean() / 1e3,
+		snapshot.Percentile(0.5) / 1e3, snapshot.Percentile(0.99) / 1e3, snapshot.nsMax / 1e3, stExtra.c_str());
+}
+
+int main(int argc, char * argv[])
+{
+	rclcpp::init(argc, argv);
+
+	std::vector<std::string> args = rclcpp::remove_ros_arguments(argc, argv);
+	std::string stTopic = args.size() > 1 ? args[1] : "image";
+	int nSeconds = args.size() > 2 ? std::stoi(args[2]) : 10;
+
+	LatencyHistogram					histShm;
+	LatencyHistogram					histDds;
+	camera_aravis::ShmRingReader		reader;
+	std::mutex							mutex;
+	std::map<int64_t, int64_t>			nsWrittenByStamp;	// Descriptors seen, for the images still to come.
+	std::map<int64_t, int64_t>			nsConsumedByStamp;	// Images seen before their descriptor.
+	std::atomic<uint64_t>				sum(0);
+
+	// Match an image to its descriptor, whichever arrives first.
+	auto match = [&](int64_t nsStamp, int64_t nsWritten, int64_t nsConsumed)
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		if (nsWritten)
+		{
+			auto it = nsConsumedByStamp.find(nsStamp);
+			if (it == nsConsumedByStamp.end())
+				nsWrittenByStamp[nsStamp] = nsWritten;
+			else
+			{
+				histDds.Record(it->second - nsWritten);
+				nsConsumedByStamp.erase(it);
+			}
+		}
+		else
+		{
+			auto it = nsWrittenByStamp.find(nsStamp);
+			if (it == nsWrittenByStamp.end())
+				nsConsumedByStamp[nsStamp] = nsConsumed;
+			else
+			{
+				histDds.Record(nsConsumed - it->second);
+				nsWrittenByStamp.erase(it);
+			}
+		}
+		while (nsWrittenByStamp.size() > 64)
+			nsWrittenByStamp.erase(nsWrittenByStamp.begin());
+		while (nsConsumedByStamp.size() > 64)
+			nsConsumedByStamp.erase(nsConsumedByStamp.begin());
+	};
+
+	auto node = std::make_shared<rclcpp::Node>("shm_latency_bench");
+	rclcpp::SubscriptionOptions optionsShm;
+	rclcpp::SubscriptionOptions optionsDds;
+	optionsShm.callback_group = node->create_callback_group(rclcpp::CallbackGroupType::MutuallyExclusive);
+	optionsDds.callback_group = node->create_callback_group(rclcpp::CallbackGroupType::MutuallyExclusive);
+
+	auto subShm = node->create_subscription<camera_aravis::msg::ShmFrame>(stTopic + "/shm", rclcpp::QoS(4),
+		[&](camera_aravis::msg::ShmFrame::ConstSharedPtr pDesc)
+		{
+			camera_aravis::ShmRingReader::View	view;
+
+			if (!reader.Read(*pDesc, view))
+				return;
+			sum += Touch(view.pData, view.nbytes);
+			if (!reader.Valid(view))
+				return;
+			histShm.Record(NowNs() - pDesc->written_ns);
+			match(StampNs(pDesc->header), pDesc->written_ns, 0);
+		}, optionsShm);
+	auto subDds = node->create_subscription<sensor_msgs::msg::Image>(stTopic, rclcpp::QoS(10),
+		[&](sensor_msgs::msg::Image::ConstSharedPtr pMsg)
+		{
+			sum += Touch(pMsg->data.data(), pMsg->data.size());
+			match(StampNs(pMsg->header), 0, NowNs());
+		}, optionsDds);
+
+	rclcpp::executors::MultiThreadedExecutor executor(rclcpp::ExecutorOptions(), 2);
+	executor.add_node(node);
+	executor.spin_until_future_complete(std::promise<void>().get_future(), std::chrono::seconds(nSeconds));
+
+	char sz[128];
+	snprintf(sz, sizeof(sz), ", \"overwritten\": %lu, \"torn\": %lu, \"reopened\": %lu",
+		(unsigned long)reader.nOverwritten, (unsigned long)reader.nTorn, (unsigned long)reader.nReopened);
+	Print("shm", histShm, nSeconds, sz);
+	Print("dds", histDds, nSeconds, "");
+
+	rclcpp::shutdown();
+
+	return 0;
+}
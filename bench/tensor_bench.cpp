@@ -0,0 +1,264 @@
+// Copyright 2016 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "camera_aravis/stripe_pool.h"
+#include "camera_aravis/tensor.h"
+
+using camera_aravis::TensorConverter;
+using camera_aravis::TensorInput;
+using camera_aravis::TensorSpec;
+
+// Tensor output: the fused converter, on one thread and striped over threads, against
+// the way a consumer would do it, a pass over the whole image for each step: colour,
+// crop, resize, normalize, HWC to CHW and fp16.  Fails (exit 1) if the two differ by
+// more than float rounding, or an fp16 rounding step.
+//   tensor_bench [iterations] [threads]
+
+struct Case
+{
+	const char	*szEncoding;
+	int			nBits;
+	int			width;
+	int			height;
+	int			xCrop;
+	int			yCrop;
+	int			widthCrop;		// 0 = all.
+	int			heightCrop;
+	int			widthTensor;
+	int			heightTensor;
+	bool		bHalf;
+};
+
+static double MsPerFrame(const std::function<void ()> &fn, int nIterations)
+{
+	auto start = std::chrono::steady_clock::now();
+
+	for (int i=0; i<nIterations; i++)
+		fn();
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / nIterations;
+}
+
+static float HalfToFloat(uint16_t h)
+{
+	int		exponent = (h >> 10) & 0x1F;
+	float	mantissa = (float)(h & 0x3FF);
+	float	f = exponent == 0 ? std::ldexp(mantissa, -24) : std::ldexp(mantissa + 1024.0f, exponent - 25);
+
+	return h & 0x8000 ? -f : f;
+}
+
+static float Sample(const std::vector<uint8_t> &src, size_t i, int nbytesSample)
+{
+	if (nbytesSample == 1)
+		return src[i];
+
+	uint16_t a;
+	memcpy(&a, &src[2 * i], 2);
+	return a;
+}
+
+// Naive()
+// One pass per step, each over a whole image in memory, as the detectors did it.
+static void Naive(const TensorInput &input, const Case &c, const std::vector<uint8_t> &src, const TensorSpec &spec,
+	std::vector<float> &hwc, std::vector<float> &resized, std::vector<float> &chw, std::vector<uint8_t> &out)
+{
+	const bool	bBayer = input.source == camera_aravis::TENSOR_BAYER;
+	const int	nQuad = bBayer ? 2 : 1;
+	const int	nIn = input.source == camera_aravis::TENSOR_MONO ? 1 : 3;
+	const int	nSamplesRow = c.width * (input.source == camera_aravis::TENSOR_COLOR ? 3 : 1);
+	const int	widthIn = (c.widthCrop ? c.widthCrop : c.width) / nQuad;
+	const int	heightIn = (c.heightCrop ? c.heightCrop : c.height) / nQuad;
+	const int	width = c.widthTensor;
+	const int	height = c.heightTensor;
+	const float	sampleMax = input.nbytesSample == 1 ? 255.0f : (float)((1 << input.nBits) - 1);
+
+	// Colour, cropped: r, g, b per pixel.
+	hwc.resize((size_t)widthIn * heightIn * nIn);
+	for (int y=0; y<heightIn; y++)
+		for (int x=0; x<widthIn; x++)
+		{
+			float *p = &hwc[((size_t)y * widthIn + x) * nIn];
+			if (bBayer)
+			{
+				size_t i = (size_t)(c.yCrop + 2 * y) * nSamplesRow + c.xCrop + 2 * x;	// rggb
+				p[0] = Sample(src, i, input.nbytesSample);
+				p[1] = 0.5f * (Sample(src, i + 1, input.nbytesSample) + Sample(src, i + nSamplesRow, input.nbytesSample));
+				p[2] = Sample(src, i + nSamplesRow + 1, input.nbytesSample);
+			}
+			else
+				for (int k=0; k<nIn; k++)
+				{
+					int kIn = input.bBgr ? 2 - k : k;
+					p[k] = Sample(src, (size_t)(c.yCrop + y) * nSamplesRow + (size_t)(c.xCrop + x) * nIn + kIn, input.nbytesSample);
+				}
+		}
+
+	// Resized, bilinear, centres aligned.
+	resized.resize((size_t)width * height * nIn);
+	for (int y=0; y<height; y++)
+	{
+		double	sy = std::max((y + 0.5) * heightIn / height - 0.5, 0.0);
+		int		y0 = std::min((int)sy, heightIn - 1);
+		int		y1 = std::min(y0 + 1, heightIn - 1);
+		float	wy = (float)(sy - y0);
+		for (int x=0; x<width; x++)
+		{
+			double	sx = std::max((x + 0.5) * widthIn / width - 0.5, 0.0);
+			int		x0 = std::min((int)sx, widthIn - 1);
+			int		x1 = std::min(x0 + 1, widthIn - 1);
+			float	wx = (float)(sx - x0);
+			for (int k=0; k<nIn; k++)
+			{
+				float a = hwc[((size_t)y0 * widthIn + x0) * nIn + k], b = hwc[((size_t)y0 * widthIn + x1) * nIn + k];
+				float d = hwc[((size_t)y1 * widthIn + x0) * nIn + k], e = hwc[((size_t)y1 * widthIn + x1) * nIn + k];
+				resized[((size_t)y * width + x) * nIn + k] = (1 - wy) * ((1 - wx) * a + wx * b) + wy * ((1 - wx) * d + wx * e);
+			}
+		}
+	}
+
+	// Normalized.
+	for (size_t i=0; i<resized.size(); i++)
+		resized[i] = (resized[i] / sampleMax - spec.mean[i % nIn]) / spec.std[i % nIn];
+
+	// Planar.
+	chw.resize(resized.size());
+	for (int k=0; k<nIn; k++)
+		for (size_t i=0; i<(size_t)width * height; i++)
+			chw[k * (size_t)width * height + i] = resized[i * nIn + k];
+
+	// fp16.
+	if (spec.bHalf)
+	{
+		out.resize(chw.size() * 2);
+		for (size_t i=0; i<chw.size(); i++)
+		{
+			uint16_t h = camera_aravis::FloatToHalf(chw[i]);
+			memcpy(&out[2 * i], &h, 2);
+		}
+	}
+	else
+	{
+		out.resize(chw.size() * 4);
+		memcpy(out.data(), chw.data(), out.size());
+	}
+} // Naive()
+
+static double DifferenceMax(const std::vector<uint8_t> &a, const std::vector<uint8_t> &b, bool bHalf)
+{
+	double difference = 0.0;
+
+	for (size_t i=0; i<a.size(); i+=(bHalf ? 2 : 4))
+	{
+		float fa, fb;
+
+		if (bHalf)
+		{
+			uint16_t ha, hb;
+			memcpy(&ha, &a[i], 2);
+			memcpy(&hb, &b[i], 2);
+			fa = HalfToFloat(ha);
+			fb = HalfToFloat(hb);
+		}
+		else
+		{
+			memcpy(&fa, &a[i], 4);
+			memcpy(&fb, &b[i], 4);
+		}
+		difference = std::max(difference, (double)std::fabs(fa - fb));
+	}
+	return difference;
+}
+
+int main(int argc, char * argv[])
+{
+	int nIterations = argc > 1 ? atoi(argv[1]) : 20;
+	int nThreads = argc > 2 ? atoi(argv[2]) : (int)std::thread::hardware_concurrency();
+	Case cases[] = {
+		{"bayer_rggb8",  8, 2448, 2048,   0,   0,    0,    0, 640, 640, false},
+		{"bayer_rggb8",  8, 2448, 2048,   0,   0,    0,    0, 640, 640, true},
+		{"bayer_rggb16", 12, 2448, 2048,  0,   0,    0,    0, 640, 640, true},
+		{"rgb8",         8, 1920, 1080, 420,   0, 1080, 1080, 640, 640, false},
+		{"bgr8",         8, 1920, 1080,   0,   0,    0,    0, 640, 384, true},
+		{"mono8",        8, 1280, 1024,   0,   0,    0,    0, 416, 416, false},
+		{"mono16",      12, 2048, 1536,   0,   0,    0,    0, 512, 384, true},
+		{"rgb8",         8,  640,  480,   0,   0,    0,    0, 1280, 960, false},
+	};
+	camera_aravis::StripePool	stripes(nThreads);
+	std::mt19937				random(1);
+	int							nMismatches = 0;
+
+	for (const Case &c : cases)
+	{
+		TensorInput					input = camera_aravis::TensorInputFor(c.szEncoding, c.nBits);
+		TensorSpec					spec = {c.widthTensor, c.heightTensor, c.xCrop, c.yCrop, c.widthCrop, c.heightCrop, 0, false, c.bHalf,
+			{0.485f, 0.456f, 0.406f}, {0.229f, 0.224f, 0.225f}};
+		TensorConverter				converter;
+		std::string					stError;
+		size_t						nSamples = (size_t)c.width * c.height * (input.source == camera_aravis::TENSOR_COLOR ? 3 : 1);
+		std::vector<uint8_t>		src(nSamples * input.nbytesSample);
+		std::vector<float>			hwc, resized, chw;
+		std::vector<uint8_t>		naive;
+
+		if (!converter.Configure(input, c.width, c.height, spec, stError))
+		{
+			fprintf(stderr, "%s: %s\n", c.szEncoding, stError.c_str());
+			return 1;
+		}
+		for (size_t i=0; i<nSamples; i++)
+		{
+			uint16_t a = (uint16_t)(random() & ((1u << c.nBits) - 1));
+			if (input.nbytesSample == 2)
+				memcpy(&src[2 * i], &a, 2);
+			else
+				src[i] = (uint8_t)a;
+		}
+		std::vector<uint8_t> fused(converter.nbytes());
+		size_t step = src.size() / c.height;
+
+		double msNaive = MsPerFrame([&] { Naive(input, c, src, spec, hwc, resized, chw, naive); }, std::max(nIterations / 4, 1));
+		double msFused = MsPerFrame([&] {
+			converter.ConvertRows(src.data(), step, fused.data(), 0, converter.height()); }, nIterations);
+		double difference = DifferenceMax(fused, naive, c.bHalf);
+
+		std::fill(fused.begin(), fused.end(), 0);
+		double msStriped = MsPerFrame([&] {
+			stripes.Run(converter.height(), [&](int yBegin, int yEnd) {
+				converter.ConvertRows(src.data(), step, fused.data(), yBegin, yEnd); }, 1); }, nIterations);
+		difference = std::max(difference, DifferenceMax(fused, naive, c.bHalf));
+
+		bool bMatch = difference <= (c.bHalf ? 4e-3 : 1e-4);
+		if (!bMatch)
+			nMismatches++;
+		printf("{\"encoding\": \"%s\", \"width\": %d, \"height\": %d, \"tensor\": \"%dx%dx%d %s\", \"naive_ms\": %.3f, "
+		       "\"fused_ms\": %.3f, \"speedup\": %.1f, \"striped_ms\": %.3f, \"threads\": %d, \"max_diff\": %.2g, \"match\": %s}\n",
+			c.szEncoding, c.width, c.height, converter.nChannels(), converter.height(), converter.width(), c.bHalf ? "fp16" : "float32",
+			msNaive, msFused, msFused > 0.0 ? msNaive / msFused : 0.0, msStriped, stripes.nThreads(), difference, bMatch ? "true" : "false");
+	}
+
+	return nMismatches ? 1 : 0;
+}
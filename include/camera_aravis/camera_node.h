@@ -0,0 +1,581 @@
+// Copyright 2016 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef CAMERA_ARAVIS__CAMERA_NODE_H_
+#define CAMERA_ARAVIS__CAMERA_NODE_H_
+
+#include <arv.h>
+#include <glib.h>
+#include <semaphore.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "camera_aravis/msg/changed_tiles.hpp"
+#include "camera_aravis/msg/frame_set.hpp"
+#include "camera_aravis/msg/shm_frame.hpp"
+#include "camera_aravis/msg/tensor.hpp"
+#include "camera_info_manager/camera_info_manager.hpp"
+#include "diagnostic_msgs/msg/diagnostic_array.hpp"
+#include "rclcpp/rclcpp.hpp"
+#include "sensor_msgs/msg/camera_info.hpp"
+#include "sensor_msgs/msg/compressed_image.hpp"
+#include "sensor_msgs/msg/image.hpp"
+
+#include "camera_aravis/change_gate.h"
+#include "camera_aravis/clock_estimator.h"
+#include "camera_aravis/compress_pool.h"
+#include "camera_aravis/exposure_control.h"
+#include "camera_aravis/feature_cache.h"
+#include "camera_aravis/frame_player.h"
+#include "camera_aravis/frame_pool.h"
+#include "camera_aravis/frame_recorder.h"
+#include "camera_aravis/frame_sync.h"
+#include "camera_aravis/latency_histogram.h"
+#include "camera_aravis/pixel_convert.h"
+#include "camera_aravis/pyramid.h"
+#include "camera_aravis/rectify.h"
+#include "camera_aravis/shm_ring.h"
+#include "camera_aravis/spsc_ring.h"
+#include "camera_aravis/stripe_pool.h"
+#include "camera_aravis/tensor.h"
+#include "camera_aravis/thread_placement.h"
+#include "camera_aravis/trigger_scheduler.h"
+
+namespace camera_aravis
+{
+
+class CameraNode;
+
+// Number of ArvBufferStatus values, SUCCESS through ABORTED.
+static const int nBufferStatuses = 8;
+
+// How the images go out to subscribers that cannot keep up.
+enum QosPolicy
+{
+	QOS_RELIABLE,		// Every frame, queued up to qos_depth per subscriber.
+	QOS_BEST_EFFORT,	// The same queue, without retransmission.
+	QOS_LATEST,			// Best effort, depth 1, and only the newest frame waiting is published.
+	nQosPolicies
+};
+extern const char *szQosPolicyName[nQosPolicies];	// As in the "qos" parameter.
+
+// Where the time goes between constructing the node and streaming.
+enum StartupPhase
+{
+	STARTUP_OPEN,		// Device open, GenICam XML download, identity.
+	STARTUP_FEATURES,	// Probing which features are implemented, or reading them from the cache.
+	STARTUP_CONFIGURE,	// Setting the configured features and reading back the geometry.
+	STARTUP_PRINT,		// The configuration dump.
+	STARTUP_STREAM,		// Stream and buffer pool.
+	STARTUP_OUTPUTS,	// Publishers, encoders, recorder.
+	nStartupPhases
+};
+
+// Cumulative counters behind the diagnostics rates.
+struct StreamCounters
+{
+	uint64_t	nCompleted;
+	uint64_t	nFailures;
+	uint64_t	nUnderruns;
+	uint64_t	nResent;
+	uint64_t	nMissing;
+	uint64_t	nDropped;
+	uint64_t	nPublished;
+	uint64_t	nStatus[nBufferStatuses];
+	uint64_t	nCompressSubmitted;
+	uint64_t	nCompressDropped;
+	uint64_t	nbytesCompressed;
+	uint64_t	nRecorded;
+	uint64_t	nRecordDropped;
+	uint64_t	nbytesRecorded;
+	uint64_t	nTriggered;
+	uint64_t	nTriggersSkipped;
+	uint64_t	nShmWritten;
+	uint64_t	nShmTooLarge;
+	uint64_t	nRectified;
+	uint64_t	nRectifySkipped;
+	uint64_t	nGated;
+	uint64_t	nbytesGated;
+	uint64_t	nKeepalives;
+	uint64_t	nExposureWrites;
+	uint64_t	nTensors;
+	uint64_t	nSkipped;
+	uint64_t	nCoalesced;
+};
+
+// A popped buffer on its way from the acquisition thread to the publish thread.
+struct FrameHandoff
+{
+	ArvBuffer	*pBuffer;
+	int64_t		 nsPop;		// Steady clock when the buffer left the stream.
+	int64_t		 nsCamera;	// Camera timestamp, 0 if the camera has none.
+	int64_t		 nsHost;	// Host wall clock when the frame started arriving.
+};
+
+// One extra output at 1/2, 1/4, ... of the published resolution.
+struct PyramidLevel
+{
+	rclcpp::Publisher<sensor_msgs::msg::Image>::SharedPtr publisher;
+	std::unique_ptr<sensor_msgs::msg::Image>   pMsg;	// Reused when not handed off intra-process.
+};
+
+// Camera settings applied when it is opened, and again whenever their parameters change;
+// zero or empty (negative for the controls) keeps what the camera has.
+struct CameraConfig
+{
+	int			x;
+	int			y;
+	int			width;
+	int			height;
+	int			dxBinning;
+	int			dyBinning;
+	std::string	stPixelformat;	// GenICam name, e.g. "BayerRG8".
+	double		fps;
+	double		usExposure;
+	double		gain;
+	int			focus;
+};
+
+// CameraState
+// Everything that belongs to one opened device: the Aravis handles, the
+// detected features, the current geometry, the buffer pool and the publisher.
+struct CameraState
+{
+	CameraNode                                *pNode;
+	int                                        iCamera;	// Index within the node.
+	std::string                                stGuid;
+	std::string                                stName;	// Topic namespace when there are several cameras.
+	std::string                                stVendor;
+	std::string                                stModel;
+	std::string                                stFirmware;
+	FeatureCache                               features;	// Implemented features of this model, saved across starts.
+	int64_t                                    nsStartup[nStartupPhases];
+	std::string                                stOpenId;	// Device id to reopen: as given, or vendor-serial.
+
+	rclcpp::Publisher<sensor_msgs::msg::Image>::SharedPtr publisher;
+
+	int                                        isImplementedAcquisitionFrameRate;
+	int                                        isImplementedAcquisitionFrameRateEnable;
+	int                                        isImplementedGain;
+	int                                        isImplementedExposureTimeAbs;
+	int                                        isImplementedExposureAuto;
+	int                                        isImplementedGainAuto;
+	int                                        isImplementedFocusPos;
+	int                                        isImplementedTriggerSelector;
+	int                                        isImplementedTriggerSource;
+	int                                        isImplementedTriggerMode;
+	int                                        isImplementedAcquisitionMode;
+	int                                        isImplementedMtu;
+	int                                        isImplementedPtp;
+	int                                        isImplementedBinning;
+
+	int                                        xRoi;
+	int                                        yRoi;
+	int                                        widthRoi;
+	int                                        widthRoiMin;
+	int                                        widthRoiMax;
+	int                                        heightRoi;
+	int                                        heightRoiMin;
+	int                                        heightRoiMax;
+
+	int                                        widthSensor;
+	int                                        heightSensor;
+	int                                        dxBinning;
+	int                                        dyBinning;
+
+	std::string                                stPixelformat;
+	guint32                                    pixelformat;
+	unsigned                                   nBytesPixel;
+	unsigned                                   nBitsPixel;
+	std::string                                stEncoding;	// ROS encoding of the published image.
+	PixelConversion                            conversion;	// Demosaic / unpack before publishing, if any.
+	StripePool                                 stripes;	// Converts one frame on several cores.
+	std::unique_ptr<sensor_msgs::msg::Image>   pConverted;	// Reused output when not publishing intra-process.
+	PyramidSource                              pyramidSource;
+	std::vector<PyramidLevel>                  pyramid;	// Computed only down to the deepest level with subscribers.
+	rclcpp::Publisher<sensor_msgs::msg::CompressedImage>::SharedPtr pubCompressed[nCodecs];	// NULL for codecs not asked for.
+	CompressPool                               compress;
+
+	// Frames for other processes on this host: pixels in a shared-memory ring, descriptors on "<image>/shm".
+	ShmRingWriter                              shm;
+	rclcpp::Publisher<camera_aravis::msg::ShmFrame>::SharedPtr pubShm;	// NULL without "shm_slots".
+	std::atomic<uint64_t>                      nShmWritten;
+	std::atomic<uint64_t>                      nShmTooLarge;	// Frames that outgrew the slots.
+	LatencyHistogram                           histShmWrite;	// Copying one frame into the ring.
+
+	// Calibration: camera_info with each frame, and the image rectified on "image_rect".
+	rclcpp::Node::SharedPtr                    pNodeCalibration;	// Namespace of set_camera_info with several cameras.
+	std::shared_ptr<camera_info_manager::CameraInfoManager> pInfoManager;
+	rclcpp::Publisher<sensor_msgs::msg::CameraInfo>::SharedPtr pubInfo;
+	rclcpp::Publisher<sensor_msgs::msg::Image>::SharedPtr pubRect;	// NULL without "rectify".
+	sensor_msgs::msg::CameraInfo               infoCalibration;	// As loaded, for spotting changes.
+	ImageWindow                                windowCalibration;	// Of the calibrated image; width 0 = does not fit.
+	std::shared_ptr<const sensor_msgs::msg::CameraInfo> pCameraInfo;	// As published; swapped atomically.
+	std::shared_ptr<const RectifyMap>          pRectifyMap;	// NULL while uncalibrated; swapped atomically.
+	std::unique_ptr<sensor_msgs::msg::Image>   pRectified;	// Reused when not handed off intra-process.
+	std::atomic<uint64_t>                      nRectified;
+	std::atomic<uint64_t>                      nRectifySkipped;	// Subscribed, but no map for the image.
+	LatencyHistogram                           histRectify;
+
+	// Change gate: frames too like the last one published are not published.
+	ChangeGate                                 gate;
+	rclcpp::Publisher<camera_aravis::msg::ChangedTiles>::SharedPtr pubTiles;	// NULL without "gate_publish_tiles".
+	int64_t                                    nsGatePassed;	// When a frame last got through.
+	std::atomic<uint64_t>                      nGated;
+	std::atomic<uint64_t>                      nbytesGated;	// What they would have published.
+	std::atomic<uint64_t>                      nKeepalives;	// Unchanged, but published for the keepalive rate.
+	LatencyHistogram                           histGate;
+
+	// Auto exposure in the driver: each frame metered, exposure and gain written back.
+	ExposureControl                            exposure;
+	ExposureRange                              exposureRange;	// As read by StartExposureControl(), for the publish thread.
+	std::atomic<bool>                          bExposureRestart;	// exposureRange is new.
+	std::atomic<bool>                          bExposureControl;	// The exposure can be set.
+	std::atomic<uint64_t>                      nExposureWrites;
+	std::thread                                threadExposure;	// Writes them, off the publish thread.
+	std::mutex                                 mutexExposure;
+	std::condition_variable                    cvExposure;
+	bool                                       bExposureStop;
+	bool                                       bExposureAsked;	// usExposureAsked and gainAsked are to be written.
+	double                                     usExposureAsked;	// Set by the publish thread while not bExposureBusy.
+	double                                     gainAsked;
+	std::atomic<bool>                          bExposureBusy;	// Asked for, and not yet written or given up.
+	std::atomic<int64_t>                       nsExposureWritten;	// When the values asked for were written; 0 = not yet.
+	LatencyHistogram                           histMeter;
+	LatencyHistogram                           histExposureWrite;
+	LatencyHistogram                           histConvergence;	// From out of the tolerance back into it.
+
+	// Tensor output: the frame as acquired, cropped, resized and normalized for inference.
+	TensorConverter                            tensor;
+	TensorConverter                            tensorSet;	// Of the published image, on the frame set matcher's thread.
+	rclcpp::Publisher<camera_aravis::msg::Tensor>::SharedPtr pubTensor;	// NULL without "tensor".
+	std::unique_ptr<camera_aravis::msg::Tensor> pTensor;	// The batch being filled.
+	std::atomic<uint64_t>                      nTensors;	// Images converted.
+	LatencyHistogram                           histTensor;
+
+	// Raw recording of the acquired frames, or, instead of a camera, the recording played back.
+	std::unique_ptr<FrameRecorder>             pRecorder;
+	std::unique_ptr<FramePlayer>               pPlayer;
+
+	ArvCamera                                 *pCamera;
+	ArvDevice                                 *pDevice;
+	ArvGvStream                               *pStream;
+	int                                        mtu;	// Stream packet size, as set or negotiated.
+	const char                                *keyAcquisitionFrameRate;
+	const char                                *keyPtpEnable;	// PtpEnable, or GevIEEE1588 on older cameras.
+	const char                                *keyPtpStatus;
+	FramePool                                  framepool;
+
+	// GigE Vision transport.
+	std::string                                stInterface;	// Host interface address; cameras on one share a link.
+	int64_t                                    nsPacketDelay;	// GevSCPD, spacing the packets to the camera's share of the link.
+	double                                     bpsShare;
+	size_t                                     nbytesSocketBuffer;	// 0: Aravis' default.
+	unsigned                                   usPacketTimeout;	// Before a missing packet is asked for again.
+	unsigned                                   usFrameRetention;	// Before an incomplete frame is given up.
+	guint64                                    nResentPrev;
+	guint64                                    nMissingPrev;
+	int                                        nTransportQuietPeriods;	// Reports in a row without missing packets.
+
+	// Software trigger, when "trigger_rate" is set.
+	TriggerScheduler                           trigger;
+
+	// Image timestamps.
+	std::string                                stFrameId;
+	ClockEstimator                             clock;	// Camera clock -> host clock.
+	std::atomic<bool>                          bPtpLocked;	// PTP slave agreeing with the host clock; stamp its time directly.
+
+	std::atomic<int>                           nBuffers;	// Counter for Hz calculation.
+	uint64_t                                   nAllocationsPrev;	// Pool allocations at the previous report.
+	uint32_t                                   iFrame;	// Frame counter.
+
+	// Acquisition thread -> publish thread.
+	SpscRing<FrameHandoff>                     ring;
+	sem_t                                      semRing;
+	std::atomic<bool>                          bRun;
+	std::thread                                threadAcquire;
+	std::thread                                threadPublish;
+
+	// Thread placement: the cores asked for, and what the threads actually got.
+	CpuList                                    cpusReceive;	// Aravis' stream receive thread.
+	CpuList                                    cpusAcquire;
+	CpuList                                    cpusPublish;	// The GMainLoop thread with "use_glib_loop".
+	int                                        iNumaNode;	// Of the receive core, for the buffers; -1 = anywhere.
+	std::string                                stPlacementReceive;
+	std::string                                stPlacement;	// As logged; under mutexDevice once streaming.
+
+	// Reconnecting after control loss, keeping the publishers and the buffer pool.
+	std::string                                stTriggerMode;	// FrameStart trigger, restored on reconnect.
+	std::string                                stTriggerSource;
+	double                                     fps;	// Acquisition frame rate, restored on reconnect; 0 if not settable.
+	std::atomic<bool>                          bIdle;	// Running at idle_fps for want of subscribers.
+	int64_t                                    nsUnsubscribed;	// Since when nobody has subscribed; 0 while someone does.
+	std::mutex                                 mutexDevice;	// Held while the device and stream are replaced.
+	std::atomic<bool>                          bControlLost;
+	std::atomic<bool>                          bReconnecting;
+	std::atomic<bool>                          bReconnectStop;
+	std::thread                                threadReconnect;
+	int64_t                                    nsControlLost;
+	std::atomic<uint32_t>                      nReconnects;
+	std::atomic<uint32_t>                      nStreams;	// Streams replaced, by reconnects or reconfigurations.
+	uint32_t                                   nStreamsPrev;	// At the previous diagnostics report.
+	std::atomic<int64_t>                       nsAwaitFirstFrame;	// When acquisition (re)started; 0 once a frame is out.
+	std::atomic<int64_t>                       nsFirstFrame;	// Latest start -> first published frame.
+	std::atomic<int64_t>                       nsReconnect;	// Latest control lost -> first published frame.
+
+	// Changing the region, binning or pixel format while streaming.
+	std::atomic<uint32_t>                      nReconfigures;
+	std::atomic<int64_t>                       nsReconfigureStop;	// When acquisition stopped for the latest one; 0 once a frame is out.
+	uint64_t                                   nReconfigureDiscarded;	// Frames of the old format put back unpublished.
+	std::atomic<int64_t>                       nsReconfigure;	// Latest acquisition stop -> first published frame.
+	std::atomic<uint64_t>                      nReconfigureLost;	// Frames lost by the latest one.
+	std::atomic<uint64_t>                      nReconfigureLostTotal;
+
+	// Per-stage timing and queue statistics since the last report.
+	std::atomic<uint64_t>                      nDropped;	// Frames dropped because the ring was full.
+	std::atomic<uint64_t>                      nDroppedTotal;
+	std::atomic<uint64_t>                      nSkipped;	// Frames nobody subscribed to, released unpublished.
+	std::atomic<uint64_t>                      nCoalesced;	// Frames passed over for a newer one, under QOS_LATEST.
+	std::atomic<uint64_t>                      nsQueueWait;	// Sum of pop -> dequeue.
+	std::atomic<uint64_t>                      nsPublish;	// Sum of dequeue -> publish returned.
+	std::atomic<uint64_t>                      nsPublishMax;
+	std::atomic<size_t>                        depthMax;
+
+	// Diagnostics: buffers popped by status, and latency histograms.
+	std::atomic<uint64_t>                      nStatus[nBufferStatuses];
+	std::atomic<uint64_t>                      nPublished;
+	LatencyHistogram                           histReceiveToPop;	// First packet received -> buffer popped.
+	LatencyHistogram                           histPopToPublish;	// Buffer popped -> publish() returned.
+	LatencyHistogram                           histCameraToPublish;	// Camera timestamp -> publish() called.
+	LatencyHistogram                           histConvert;	// Pixel conversion of one frame.
+	LatencyHistogram                           histTriggerToFrame;	// Software trigger -> first packet of the frame.
+	StreamCounters                             countersPrev;
+
+	// Buffer pool adaptation.
+	unsigned                                   nPoolBaseline;	// Size computed from frame rate, payload and latency budget.
+	guint64                                    nUnderrunsPrev;
+	int                                        nPoolQuietPeriods;	// Reports in a row without underruns.
+
+	CameraState();
+	~CameraState();
+};
+
+// CameraNode
+// The camera_aravis driver as a composable node.  Opens the camera named by the
+// "guid" parameter (the first one found if empty) and publishes its frames on "image",
+// or every camera in "guids", each on "<name>/image".  With "replay" it plays back
+// recordings instead of opening cameras.
+// A dedicated thread pops buffers from the stream and hands them through a ring to
+// the publish thread; "use_glib_loop" restores the old signal + GMainLoop delivery.
+class CameraNode : public rclcpp::Node
+{
+public:
+	explicit CameraNode(const rclcpp::NodeOptions &options);
+	~CameraNode() override;
+
+private:
+	static std::string CameraName(const std::string &stGuid);
+
+	bool OpenCamera(CameraState &cam, const char *pszGuid);
+	bool OpenReplay(CameraState &cam, const std::string &stDir);
+	int ProbeFeature(CameraState &cam, const char *szFeature);
+	int64_t ProbeInteger(CameraState &cam, const char *szFeature);
+	void DetectFeatures(CameraState &cam);
+	void PrintConfiguration(CameraState &cam);
+	ArvGvStream *CreateStream(CameraState &cam, bool bKeepPool = false);
+	void RestoreConfiguration(CameraState &cam);
+	bool ApplyFormat(CameraState &cam, const CameraConfig &config);
+	void ApplyControls(CameraState &cam, const CameraConfig &config);
+	void ReadFormat(CameraState &cam);
+	bool Reconfigure(CameraState &cam, const CameraConfig &config, std::string &stError);
+	rcl_interfaces::msg::SetParametersResult Parameters_callback(const std::vector<rclcpp::Parameter> &parameters);
+	int ConvertThreads(int nCameras);
+	void ChoosePlacement(CameraState &cam, int nCameras);
+	static std::vector<pid_t> ReceiveThreads(void);
+	void PlaceReceiveThread(CameraState &cam, const std::vector<pid_t> &tidsBefore);
+	void PlaceThreads(CameraState &cam);
+	void StartAcquisition(CameraState &cam);
+	void StopAcquisition(CameraState &cam);
+	unsigned StopThreads(CameraState &cam);
+	bool SleepBackoff(CameraState &cam, int &msBackoff);
+	void ReconnectThread(CameraState &cam);
+	void NoteFirstFrame(CameraState &cam);
+	void ConfigurePacketSize(CameraState &cam);
+	void ConfigureStreamTransport(CameraState &cam, ArvGvStream *pStream, size_t nbytesPayload);
+	void SharePacketDelays(void);
+	void AdaptTransport(CameraState &cam);
+	unsigned PoolSizeFor(CameraState &cam, size_t nbytesPayload);
+	void AdaptPool(CameraState &cam);
+	void CountBuffer(CameraState &cam, ArvBuffer *pBuffer);
+	int64_t StampFrame(CameraState &cam, const FrameHandoff &frame);
+	void UpdatePtpStatus(CameraState &cam);
+	void ChooseConversion(CameraState &cam, guint32 pixelformat);
+	sensor_msgs::msg::Image *ConvertFrame(CameraState &cam, ArvBuffer *pBuffer, std::unique_ptr<sensor_msgs::msg::Image> &pOut);
+	void CreatePyramid(CameraState &cam, const std::string &stTopic, int nLevels);
+	void PublishPyramid(CameraState &cam, const sensor_msgs::msg::Image &msg);
+	void CreateCompression(CameraState &cam, const std::string &stTopic, const std::vector<std::string> &codecs);
+	void CreateShm(CameraState &cam, const std::string &stTopic);
+	void SizeShm(CameraState &cam);
+	void PublishShm(CameraState &cam, const sensor_msgs::msg::Image &msg);
+	void CreateCalibration(CameraState &cam, const std::string &stTopic, const std::string &stUrl, bool bRectify);
+	void UpdateCalibration(CameraState &cam);
+	void PublishCalibration(CameraState &cam, const sensor_msgs::msg::Image &msg);
+	rclcpp::QoS ImageQoS(void) const;
+	bool HasSubscribers(CameraState &cam);
+	void AdaptIdleRate(CameraState &cam);
+	unsigned CodecsWanted(CameraState &cam);
+	void CreateGate(CameraState &cam, const std::string &stTopic, bool bPublishTiles);
+	bool GateFrame(CameraState &cam, ArvBuffer *pBuffer, int64_t nsStamp);
+	void StartExposureControl(CameraState &cam);
+	void MeterExposure(CameraState &cam, ArvBuffer *pBuffer);
+	void ExposureThread(CameraState &cam);
+	void StartSync(double usTolerance, double msTimeout, int nWindow, bool bIncomplete);
+	void PublishFrameSet(const FrameSync::FrameSet &set, int64_t nsSkew, bool bComplete);
+	void CreateTensor(CameraState &cam, const std::string &stTopic);
+	void PublishTensor(CameraState &cam, ArvBuffer *pBuffer, int64_t nsStamp);
+	void PublishSetTensor(const FrameSync::FrameSet &set);
+	void PublishDiagnostics(void);
+
+	void RecordFrame(CameraState &cam, const FrameHandoff &frame);
+	void PublishFrame(CameraState &cam, const FrameHandoff &frame);
+	void PeriodicTask_callback(void);
+
+	void AcquireThread(CameraState &cam);
+	void PublishThread(CameraState &cam);
+	void ReplayThread(CameraState &cam);
+
+	static void NewBuffer_callback(ArvStream *pStream, CameraState *pCam);
+	static void ControlLost_callback(ArvGvDevice *pGvDevice, CameraState *pCam);
+	void StartTriggers(void);
+
+	std::vector<std::unique_ptr<CameraState>> m_cameras;
+	bool                           m_bIntraProcess;
+	bool                           m_bUseGlibLoop;	// Compatibility: deliver frames from the new-buffer signal.
+	rclcpp::TimerBase::SharedPtr   m_timerPeriodic;
+
+	rclcpp::Publisher<diagnostic_msgs::msg::DiagnosticArray>::SharedPtr m_pubDiagnostics;
+	int64_t                        m_nsDiagnosticsPrev;
+	LatencyHistogram::Snapshot     m_snapshot;
+
+	CameraConfig                   m_config;	// As last set; reapplied on reconnect.
+	rclcpp::node_interfaces::OnSetParametersCallbackHandle::SharedPtr m_hParameters;
+	std::string                    m_stFeatureCacheDir;	// Empty: probe every time.
+
+	// Retrying to open a camera, at start and after control loss.
+	bool                           m_bReconnect;
+	int                            m_msRetryMin;
+	int                            m_msRetryMax;	// The wait doubles up to this.
+
+	// GigE Vision transport.
+	int                            m_nPacketSize;	// Bytes; 0 negotiates the largest that gets through, < 0 keeps the camera's.
+	double                         m_dLinkMbps;	// Bandwidth shared by the cameras on one host interface; 0 leaves GevSCPD alone.
+	double                         m_dSocketBufferFrames;	// Socket receive buffer, in frames; 0 leaves it to Aravis.
+	unsigned                       m_usPacketTimeout;
+	unsigned                       m_usFrameRetention;
+	bool                           m_bTransportAdaptive;	// Adjust the two timeouts to the missing packets.
+
+	// Buffer pool sizing.
+	double                         m_msPoolLatency;	// Frames the pool must absorb, as time at the current frame rate.
+	int                            m_nPoolMin;
+	int                            m_nPoolMax;
+	size_t                         m_nbytesPoolMax;	// Per camera.
+	bool                           m_bPoolAdaptive;
+	bool                           m_bPoolHugePages;
+	bool                           m_bPoolLock;
+
+	// Timestamps.
+	bool                           m_bPtp;	// Use PTP when the camera has it.
+	int64_t                        m_nsPtpOffset;	// Added to PTP camera time, e.g. -37 s for TAI -> UTC.
+
+	// Pixel conversion.
+	bool                           m_bConvert;	// Demosaic Bayer and unpack 10/12 bit mono before publishing.
+	bool                           m_bConvertBgr;	// Colour output as bgr8 rather than rgb8.
+	int                            m_nConvertThreads;	// Per camera, including the publish thread; 0 = automatic.
+
+	// Thread placement: per-camera cores (index = camera, -1 = leave it), SCHED_FIFO priorities.
+	std::vector<int64_t>           m_cpuReceive;
+	std::vector<int64_t>           m_cpuAcquire;
+	std::vector<int64_t>           m_cpuPublish;
+	CpuList                        m_cpusConvert;	// Shared by every camera's conversion workers.
+	int                            m_nPriorityReceive;	// 0 = normal.
+	int                            m_nPriority;	// Acquire, publish and conversion threads; 0 = normal.
+	bool                           m_bNumaBuffers;	// Buffers on the receive core's NUMA node.
+
+	// Compressed output.
+	int                            m_nJpegQuality;
+	int                            m_nCompressThreads;	// Per camera.
+	int                            m_nCompressQueue;	// Frames waiting for or being encoded, per camera.
+
+	// Image QoS, and what to do while nobody listens.
+	QosPolicy                      m_qosPolicy;
+	int                            m_nQosDepth;
+	double                         m_dIdleFps;	// Frame rate while unsubscribed; 0 = unchanged.
+	int64_t                        m_nsIdleAfter;	// Unsubscribed this long before slowing down.
+
+	// Shared-memory output.
+	int                            m_nShmSlots;	// Frames in each camera's ring; 0 = none.
+
+	// Change gate: publish a frame only if it differs from the last one published, or for the keepalive.
+	bool                           m_bGate;
+	double                         m_dGateThreshold;	// Mean absolute difference of a tile, in 8-bit levels.
+	int                            m_nGateTiles;	// Changed tiles that make a frame changed.
+	int                            m_nGateTileSize;	// Pixels, square.
+	int                            m_nGateRowStep;	// Compare every this many rows.
+	int64_t                        m_nsGateKeepalive;	// 0 = none.
+
+	// Auto exposure in the driver, instead of the camera's own.
+	bool                           m_bAutoExposure;
+	double                         m_dAeTarget;	// Mean level, 8 bits.
+	double                         m_dAeTolerance;
+	MeterRegion                    m_aeRegion;	// Fractions of the frame.
+	double                         m_dAeOutsideWeight;	// Of the samples outside the region; 0 = the region alone.
+	int                            m_nAeStep;	// Meter every this many pixels and rows.
+	double                         m_usAeExposureMax;	// 0 = the camera's maximum, or the frame period.
+	double                         m_dAeGainMax;	// < 0 = the camera's maximum.
+
+	// Tensor output: each frame as a normalized NCHW tensor, on "<image>/tensor".
+	bool                           m_bTensor;
+	TensorSpec                     m_tensorSpec;
+	int                            m_nTensorBatch;	// Frames in each message.
+
+	// Frame sets: the cameras' frames matched by stamp, on "frame_set".
+	FrameSync                      m_sync;
+	rclcpp::Publisher<camera_aravis::msg::FrameSet>::SharedPtr m_pubFrameSet;	// NULL without "sync".
+	rclcpp::Publisher<camera_aravis::msg::Tensor>::SharedPtr m_pubSetTensor;	// Each set as one batch; NULL without "sync" and "tensor".
+	FrameSync::Counters            m_syncCountersPrev;
+
+	// Software trigger.
+	double                         m_dTriggerRate;	// Hz; 0 = free running.
+	int                            m_nTriggerPriority;	// SCHED_FIFO priority of the trigger threads; 0 = normal.
+	int64_t                        m_nsTriggerSpin;	// Busy-wait this long before each trigger.
+
+	// Replay.
+	double                         m_dReplayRate;	// 1 = as recorded, 2 = twice as fast, 0 = as fast as possible.
+	bool                           m_bReplayLoop;
+
+	GMainLoop                     *m_pMainLoop;
+	std::thread                    m_threadMainLoop;
+};
+
+} // namespace camera_aravis
+
+#endif // CAMERA_ARAVIS__CAMERA_NODE_H_
@@ -0,0 +1,80 @@
+// Copyright 2016 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+
+#ifndef CAMERA_ARAVIS__CHANGE_GATE_H_
+#define CAMERA_ARAVIS__CHANGE_GATE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace camera_aravis
+{
+
+// ChangeGate
+// How much a frame differs from a reference frame, tile by tile: the mean absolute
+// difference of each tile's samples, in 8-bit levels, over every nRowStep-th row of each
+// row of tiles.  Only those rows of the reference are kept, narrowed to 8 bits, so
+// comparing reads a fraction of the frame and remembering it writes even less.  A frame is compared as
+// rows of samples; 16-bit samples are shifted down to 8 bits first.
+class ChangeGate
+{
+public:
+	ChangeGate();
+
+	// A row is nSamples samples of nbytesSample (1, or 2 little endian, then >> nShift)
+	// bytes; a tile nTileSamples samples by nTileRows rows.  nRowStep is at most
+	// nTileRows.  Forgets the reference if anything changed.
+	void Configure(int nSamples, int height, int nbytesSample, int nShift, int nTileSamples, int nTileRows, int nRowStep);
+
+	// Compare a frame with the reference; the tiles that differ by more than threshold
+	// are in ChangedTiles().  Without a reference, every tile has changed, and so has
+	// any tile none of whose rows is sampled.
+	int Compare(const uint8_t *pData, size_t step, double threshold);
+
+	// The frame last compared becomes the reference.
+	void Accept(void);
+	void Forget(void)					{ m_bReference = false; }
+
+	const std::vector<uint32_t> &ChangedTiles(void) const	{ return m_changed; }
+	double DifferenceMax(void) const	{ return m_differenceMax; }	// Of any tile, in 8-bit levels.
+	int nTilesX(void) const				{ return m_nTilesX; }
+	int nTilesY(void) const				{ return m_nTilesY; }
+
+private:
+	int NextRow(int y) const;
+
+	int						m_nSamples;
+	int						m_height;
+	int						m_nbytesSample;
+	int						m_nShift;
+	int						m_nTileSamples;
+	int						m_nTileRows;
+	int						m_nRowStep;
+	int						m_nTilesX;
+	int						m_nTilesY;
+	std::vector<uint8_t>	m_reference;	// The sampled rows, 8 bits a sample.
+	std::vector<uint8_t>	m_candidate;	// Those of the frame last compared.
+	bool					m_bReference;
+	std::vector<uint32_t>	m_sums;			// Per tile.
+	std::vector<uint32_t>	m_counts;		// Samples compared per tile.
+	std::vector<uint32_t>	m_changed;
+	double					m_differenceMax;
+};
+
+} // namespace camera_aravis
+
+#endif // CAMERA_ARAVIS__CHANGE_GATE_H_
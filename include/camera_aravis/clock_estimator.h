@@ -0,0 +1,95 @@
+// Copyright 2016 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef CAMERA_ARAVIS__CLOCK_ESTIMATOR_H_
+#define CAMERA_ARAVIS__CLOCK_ESTIMATOR_H_
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+namespace camera_aravis
+{
+
+// ClockEstimator
+// Maps camera timestamps onto the host clock.  Each frame gives a pair (camera time,
+// host receive time) whose difference is the clock offset plus a positive, jittery
+// transport delay.  The smallest difference in each block of frames is the best
+// estimate of the offset at that point; a least-squares line through the last
+// nWindow of those minima gives offset and drift, and the mapping follows the line,
+// so the transport jitter does not reach the stamps.
+//
+// AddSample() and ToHost() belong to one thread; the Get*() accessors may be read
+// from any other.
+class ClockEstimator
+{
+public:
+	explicit ClockEstimator(int nWindow = 64, int nBlock = 32);
+
+	// Window of nWindow block minima, each the smallest of nBlock samples.  Resets.
+	void Configure(int nWindow, int nBlock);
+	void Reset(void);
+
+	// A frame with camera timestamp nsCamera was received at host time nsHost.
+	void AddSample(int64_t nsCamera, int64_t nsHost);
+
+	// Host time of camera time nsCamera.  Until the first block is complete this
+	// uses the first sample's offset, and until the fit is locked the smallest
+	// offset of the last block, i.e. plain receive time.
+	int64_t ToHost(int64_t nsCamera) const;
+
+	// True once there are enough minima for a fit.
+	bool IsLocked(void) const			{ return m_bLocked.load(std::memory_order_relaxed); }
+
+	double GetOffsetNs(void) const		{ return m_offsetNs.load(std::memory_order_relaxed); }	// host - camera, now.
+	double GetDriftPpm(void) const		{ return m_driftPpm.load(std::memory_order_relaxed); }	// Camera clock rate error.
+	double GetJitterNs(void) const		{ return m_jitterNs.load(std::memory_order_relaxed); }	// RMS of the minima about the line.
+	double GetResidualMaxNs(void) const	{ return m_residualMaxNs.load(std::memory_order_relaxed); }	// Largest of them.
+
+private:
+	struct Point
+	{
+		double	x;		// Camera time since the origin, ns.
+		double	y;		// Offset minus the origin offset, ns.
+	};
+
+	void Fit(void);
+
+	int					m_nWindow;
+	int					m_nBlock;
+
+	bool				m_bHaveOrigin;
+	int64_t				m_nsCameraOrigin;
+	int64_t				m_offsetOrigin;
+
+	int					m_iBlock;		// Samples so far in the current block.
+	Point				m_pointBlock;	// Smallest offset in the current block.
+	std::vector<Point>	m_points;		// Ring of block minima.
+	int					m_iPoint;
+	int					m_nPoints;
+
+	double				m_a;			// Fit: y = m_a + m_b * x.
+	double				m_b;
+
+	std::atomic<bool>	m_bLocked;
+	std::atomic<double>	m_offsetNs;
+	std::atomic<double>	m_driftPpm;
+	std::atomic<double>	m_jitterNs;
+	std::atomic<double>	m_residualMaxNs;
+};
+
+} // namespace camera_aravis
+
+#endif // CAMERA_ARAVIS__CLOCK_ESTIMATOR_H_
@@ -0,0 +1,100 @@
+// Copyright 2016 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef CAMERA_ARAVIS__COMPRESS_POOL_H_
+#define CAMERA_ARAVIS__COMPRESS_POOL_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "camera_aravis/image_codec.h"
+#include "camera_aravis/latency_histogram.h"
+
+namespace camera_aravis
+{
+
+// CompressPool
+// Encodes frames on a few worker threads and hands the results back in the order the
+// frames were submitted.  A frame is held, through its shared_ptr, until every codec
+// asked for has finished with it, so the encoders can read the acquired buffer in place.
+class CompressPool
+{
+public:
+	typedef std::function<void (ImageCodec codec, std::unique_ptr<sensor_msgs::msg::CompressedImage> pMsg)> PublishFn;
+
+	CompressPool();
+	~CompressPool();
+
+	CompressPool(const CompressPool &) = delete;
+	CompressPool &operator=(const CompressPool &) = delete;
+
+	void Start(int nThreads, int nQueue, int quality, const PublishFn &fnPublish);
+	void Stop(void);
+
+	// Wait until every frame submitted so far is encoded and published, and its buffer let go.
+	void Flush(void);
+
+	// Queue pImage for the codecs in maskCodecs (bit i = ImageCodec i).  False, and the
+	// frame let go, when the queue is full.
+	bool Submit(std::shared_ptr<const sensor_msgs::msg::Image> pImage, unsigned maskCodecs);
+
+	bool IsRunning(void) const			{ return !m_threads.empty(); }
+	size_t Depth(void);					// Frames queued, being encoded or waiting for their turn.
+	size_t TakeDepthMax(void)			{ return m_depthMax.exchange(0, std::memory_order_relaxed); }
+
+	std::atomic<uint64_t>	nSubmitted;
+	std::atomic<uint64_t>	nDropped;		// Submit() found the queue full.
+	std::atomic<uint64_t>	nFailed;		// Encodings not supported or failed.
+	std::atomic<uint64_t>	nbytesOut;
+	LatencyHistogram		histEncode;		// One codec on one frame.
+	LatencyHistogram		histSubmitToPublish;
+
+private:
+	struct Job
+	{
+		std::shared_ptr<const sensor_msgs::msg::Image>			pImage;
+		unsigned												maskCodecs;
+		int64_t													nsSubmit;
+		bool													bDone;
+		std::unique_ptr<sensor_msgs::msg::CompressedImage>		pOut[nCodecs];
+	};
+
+	void Worker(void);
+	void PublishReady(std::unique_lock<std::mutex> &lock);
+
+	std::vector<std::thread>			m_threads;
+	std::mutex							m_mutex;
+	std::condition_variable				m_cvWork;
+	std::condition_variable				m_cvIdle;		// m_jobs became empty.
+	std::deque<std::unique_ptr<Job>>	m_jobs;			// In submit order.
+	size_t								m_nClaimed;		// Jobs at the front of m_jobs taken by a worker.
+	size_t								m_nQueue;
+	int									m_quality;
+	PublishFn							m_fnPublish;
+	bool								m_bPublishing;	// One worker at a time publishes, in order.
+	bool								m_bStop;
+	std::atomic<size_t>					m_depthMax;
+};
+
+} // namespace camera_aravis
+
+#endif // CAMERA_ARAVIS__COMPRESS_POOL_H_
@@ -0,0 +1,123 @@
+// Copyright 2016 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+
+#ifndef CAMERA_ARAVIS__EXPOSURE_CONTROL_H_
+#define CAMERA_ARAVIS__EXPOSURE_CONTROL_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace camera_aravis
+{
+
+// Where the metered samples are in a row: one every nbytesUnit bytes from iOffset, each
+// standing for nPixelsUnit pixels.  A sample is 1 byte, or 2 little endian >> nShift,
+// saturated to 8 bits.  E.g. the green of RGB8 is {1, 0, 3, 1, 1}; the first, most
+// significant byte of each pair of Mono12Packed pixels {1, 0, 3, 2, 0}.
+struct MeterLayout
+{
+	int		nbytesSample;
+	int		nShift;
+	int		nbytesUnit;
+	int		nPixelsUnit;
+	int		iOffset;
+};
+
+// Region of the frame, as fractions of its width and height.
+struct MeterRegion
+{
+	double	x;
+	double	y;
+	double	width;
+	double	height;
+};
+
+// The camera's exposure and gain: the limits, and the values in effect.
+struct ExposureRange
+{
+	double	usMin;
+	double	usMax;
+	double	gainMin;
+	double	gainMax;
+	double	usExposure;
+	double	gain;
+};
+
+// MeterFrame()
+// 256-bin histograms of every nStep-th sample of every nStep-th row: pInside those in the
+// region, pOutside the rest, or none of the rest if pOutside is NULL.  Returns the
+// samples counted.
+uint32_t MeterFrame(const uint8_t *pData, size_t step, int width, int height, const MeterLayout &layout, int nStep,
+	const MeterRegion &region, uint32_t *pInside, uint32_t *pOutside);
+
+
+// ExposureControl
+// Drives the mean level of the metered histogram to a target: the exposure first, up to
+// its maximum, then the gain, in dB.  A change is made only out of the tolerance, once
+// nSettleFrames frames have gone by since the last one, and no more often than
+// nsWriteInterval.  Each change covers only part of the way, since the level is not quite
+// linear in the exposure.  A change takes effect once Written(), with the values that went
+// to the camera, which may be some frames later; until then each frame asks for it afresh.
+// Level, exposure and gain can be read from another thread.
+class ExposureControl
+{
+public:
+	ExposureControl();
+
+	void Configure(double target, double tolerance, int nSettleFrames, int64_t nsWriteInterval);
+	void Reset(const ExposureRange &range);
+
+	// Weighs the histograms of a frame; true if NextExposure() and NextGain() should be written.
+	bool Update(const uint32_t *pInside, const uint32_t *pOutside, double weightOutside, int64_t nsNow);
+	void Written(double usExposure, double gain, int64_t nsNow);
+	double NextExposure(void) const			{ return m_usNext; }
+	double NextGain(void) const				{ return m_gainNext; }
+
+	double Level(void) const				{ return m_level.load(std::memory_order_relaxed); }
+	double Exposure(void) const				{ return m_usExposure.load(std::memory_order_relaxed); }
+	double Gain(void) const					{ return m_gain.load(std::memory_order_relaxed); }
+	bool IsConverged(void) const			{ return m_bConverged.load(std::memory_order_relaxed); }
+
+	// How long it took to get back within the tolerance, the last time it did; 0 while
+	// out of it.
+	int64_t nsConvergence(void) const		{ return m_nsConvergence; }
+
+private:
+	double					m_target;
+	double					m_tolerance;
+	int						m_nSettleFrames;
+	int64_t					m_nsWriteInterval;
+	double					m_usMin;
+	double					m_usMax;
+	double					m_gainMin;
+	double					m_gainMax;
+
+	int						m_nSettle;		// Frames still to skip.
+	int64_t					m_nsWrite;		// When last written.
+	int64_t					m_nsDiverged;	// When it went out of the tolerance; 0 = within it.
+	int64_t					m_nsConvergence;
+	double					m_usNext;
+	double					m_gainNext;
+	std::atomic<double>		m_level;
+	std::atomic<double>		m_usExposure;
+	std::atomic<double>		m_gain;
+	std::atomic<bool>		m_bConverged;
+};
+
+} // namespace camera_aravis
+
+#endif // CAMERA_ARAVIS__EXPOSURE_CONTROL_H_
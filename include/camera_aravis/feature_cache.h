@@ -0,0 +1,69 @@
+// Copyright 2016 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef CAMERA_ARAVIS__FEATURE_CACHE_H_
+#define CAMERA_ARAVIS__FEATURE_CACHE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <string>
+
+namespace camera_aravis
+{
+
+// FeatureCache
+// What one camera model offers, as found by probing its GenICam features: which
+// features are implemented, plus a few fixed values such as the sensor size.
+// Saved per vendor, model and firmware, next to a copy of the GenICam XML, so the
+// next start or reconnect with the same camera reads it instead of probing the
+// device again.  An entry whose XML no longer matches the device's is ignored.
+class FeatureCache
+{
+public:
+	FeatureCache();
+
+	// Use the entry for stKey in stDir, if it was made from the same XML.
+	bool Load(const std::string &stDir, const std::string &stKey, const char *pXml, size_t nbytesXml);
+
+	// Write the entry, and the XML beside it, if anything was added since Load().
+	bool Save(std::string &stError);
+
+	bool Lookup(const std::string &stName, int64_t &value) const;
+	void Store(const std::string &stName, int64_t value);
+
+	bool IsLoaded(void) const		{ return m_bLoaded; }
+	size_t nEntries(void) const		{ return m_values.size(); }
+	const std::string &Path(void) const	{ return m_stPath; }
+
+	// A file-name-safe key, e.g. "Basler_acA1300_60gc_V3_8_1".
+	static std::string Key(const std::string &stVendor, const std::string &stModel, const std::string &stFirmware);
+
+private:
+	static uint64_t Hash(const char *p, size_t nbytes);
+
+	std::string						m_stDir;
+	std::string						m_stPath;
+	uint64_t						m_hashXml;
+	const char					   *m_pXml;
+	size_t							m_nbytesXml;
+	std::map<std::string, int64_t>	m_values;
+	bool							m_bLoaded;
+	bool							m_bDirty;
+};
+
+} // namespace camera_aravis
+
+#endif // CAMERA_ARAVIS__FEATURE_CACHE_H_
@@ -0,0 +1,76 @@
+// Copyright 2016 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef CAMERA_ARAVIS__FRAME_PLAYER_H_
+#define CAMERA_ARAVIS__FRAME_PLAYER_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "camera_aravis/recording_format.h"
+
+namespace camera_aravis
+{
+
+// FramePlayer
+// Read access to a recording made by FrameRecorder: every segment's index and data
+// are mmap()ed, so frames are read in place.
+class FramePlayer
+{
+public:
+	FramePlayer();
+	~FramePlayer();
+
+	FramePlayer(const FramePlayer &) = delete;
+	FramePlayer &operator=(const FramePlayer &) = delete;
+
+	// Map the recording in stDir.  False, and stError set, if there is none or it is damaged.
+	bool Open(const std::string &stDir, std::string &stError);
+	void Close(void);
+
+	// Whether stDir holds a recording, as opposed to e.g. one directory per camera.
+	static bool IsRecording(const std::string &stDir);
+
+	size_t nFrames(void) const						{ return m_frames.size(); }
+	const RecordingEntry &Entry(size_t i) const		{ return *m_frames[i].pEntry; }
+	const uint8_t *Data(size_t i) const				{ return m_frames[i].pData; }
+
+	const std::string &Guid(void) const				{ return m_stGuid; }
+	const std::string &Pixelformat(void) const		{ return m_stPixelformat; }
+
+private:
+	struct Mapping
+	{
+		void	*p;
+		size_t	 nbytes;
+	};
+	struct Frame
+	{
+		const RecordingEntry	*pEntry;
+		const uint8_t			*pData;
+	};
+
+	bool Map(const std::string &stPath, Mapping &mapping);
+
+	std::vector<Mapping>	m_mappings;
+	std::vector<Frame>		m_frames;
+	std::string				m_stGuid;
+	std::string				m_stPixelformat;
+};
+
+} // namespace camera_aravis
+
+#endif // CAMERA_ARAVIS__FRAME_PLAYER_H_
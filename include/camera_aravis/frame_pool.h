@@ -0,0 +1,161 @@
+// Copyright 2016 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef CAMERA_ARAVIS__FRAME_POOL_H_
+#define CAMERA_ARAVIS__FRAME_POOL_H_
+
+#include <arv.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "sensor_msgs/msg/image.hpp"
+
+namespace camera_aravis
+{
+
+// FramePool
+// A set of preallocated image messages whose data vectors are handed to Aravis
+// as the stream buffers, so the camera writes each frame directly into the
+// message that gets published.  The pool copies nothing and, but for the
+// messages that Detach() gives away, allocates nothing per frame.
+// The set can be resized while streaming; shrinking retires buffers as they
+// come back from the publisher.
+class FramePool
+{
+public:
+	FramePool();
+	~FramePool();
+
+	FramePool(const FramePool &) = delete;
+	FramePool &operator=(const FramePool &) = delete;
+
+	// How the frame memory is backed.  Takes effect for buffers allocated afterwards.
+	//   bHugePages: ask for transparent huge pages, to keep TLB misses off the receive path.
+	//               Only the 2 MiB-aligned interior of each payload can have them.
+	//   bLock:      mlock() the frames, so the receive path never page-faults.
+	//   iNumaNode:  keep the frames on this NUMA node, the one the receive thread runs on; -1 for anywhere.
+	void SetMemoryOptions(bool bHugePages, bool bLock, int iNumaNode = -1);
+
+	// Allocate nBuffers messages of nbytesPayload bytes each and push them to pStream.
+	// Without a stream (pStream NULL, e.g. for replay) the buffers wait in the pool for Acquire().
+	void Create(ArvStream *pStream, size_t nbytesPayload, unsigned nBuffers);
+
+	// Grow to nBuffers now, or shrink to it as buffers are released.
+	void Resize(unsigned nBuffers);
+
+	// Drop all messages.  The stream must already be stopped and unreferenced.
+	void Destroy(void);
+
+	// Move the pool, messages and all, to a new stream with the same payload size, e.g.
+	// after reconnecting.  Every buffer must have been in the old stream when it was
+	// unreferenced, which freed them; each message gets a new buffer in pStream.
+	void Rebind(ArvStream *pStream);
+
+	// The message whose data backs pBuffer, or NULL if pBuffer is not ours.
+	sensor_msgs::msg::Image *MessageFromBuffer(ArvBuffer *pBuffer) const;
+
+	// Give pBuffer back to the stream once its message has been released.
+	void Release(ArvBuffer *pBuffer);
+
+	// A free buffer of a pool without a stream, or NULL if all are in use.
+	ArvBuffer *Acquire(void);
+
+	// Take ownership of the message behind pBuffer, e.g. to publish it as a unique_ptr.
+	// A spare message and a new buffer replace it in the stream; only without a spare is
+	// a message made on the spot, payload zeroed, bound and locked on the caller's thread.
+	std::unique_ptr<sensor_msgs::msg::Image> Detach(ArvBuffer *pBuffer);
+
+	// Keep nSpares messages ready for Detach(), made on a thread of the pool's own.
+	void KeepSpares(unsigned nSpares);
+
+	// Buffers currently owned by the pool, wherever they are (stream, ring or publisher).
+	unsigned nBuffers(void) const		{ return m_nActive.load(std::memory_order_relaxed); }
+	size_t nbytesPayload(void) const	{ return m_nbytesPayload; }
+
+	// Buffers for which mlock() failed, e.g. for lack of RLIMIT_MEMLOCK.
+	unsigned nLockFailures(void) const	{ return m_nLockFailures.load(std::memory_order_relaxed); }
+
+	// Buffers whose aligned interior did not get huge pages, e.g. for lack of free ones or
+	// with transparent huge pages "never".
+	unsigned nHugePageMisses(void) const	{ return m_nHugePageMisses.load(std::memory_order_relaxed); }
+
+	// Buffers that could not be moved to the NUMA node asked for.
+	unsigned nNumaFailures(void) const	{ return m_nNumaFailures.load(std::memory_order_relaxed); }
+	int iNumaNode(void) const			{ return m_iNumaNode; }
+
+	// Detach() calls that found no spare ready.
+	uint64_t nSpareMisses(void) const	{ return m_nSpareMisses.load(std::memory_order_relaxed); }
+
+	// Messages and slots the pool has allocated since start-up.  Only the pool's own: not
+	// publish(), the header strings or the encoders; fake_camera_bench counts every
+	// operator new in the process.
+	uint64_t nAllocations(void) const	{ return m_nAllocations.load(std::memory_order_relaxed); }
+
+private:
+	struct Slot
+	{
+		std::unique_ptr<sensor_msgs::msg::Image>	pMsg;
+		ArvBuffer								   *pBuffer;
+		std::atomic<bool>							bRetired;	// Free for Resize() to refill.
+
+		Slot() : pBuffer(NULL), bRetired(false) {}
+	};
+
+	std::unique_ptr<sensor_msgs::msg::Image> NewMessage(size_t nbytes, bool bHugePages, bool bLock, int iNumaNode);
+	void Fill(Slot &slot, std::unique_ptr<sensor_msgs::msg::Image> pMsg = nullptr);
+	bool Retire(Slot &slot);
+	void Push(ArvBuffer *pBuffer);
+	std::unique_ptr<sensor_msgs::msg::Image> TakeSpare(void);
+	void SpareThread(void);
+
+	ArvStream				   *m_pStream;
+	size_t						m_nbytesPayload;
+	bool						m_bHugePages;
+	bool						m_bLock;
+	int							m_iNumaNode;
+
+	// Slots never move once created, since their buffers point back at them.
+	std::mutex					m_mutexSlots;
+	std::vector<std::unique_ptr<Slot>> m_slots;
+	std::atomic<unsigned>		m_nActive;
+	std::atomic<int>			m_nRetire;	// Buffers still to drop on their way back.
+	std::atomic<uint64_t>		m_nAllocations;
+	std::atomic<unsigned>		m_nLockFailures;
+	std::atomic<unsigned>		m_nNumaFailures;
+	std::atomic<unsigned>		m_nHugePageMisses;
+
+	// Buffers not in use, when there is no stream to hold them.
+	std::mutex					m_mutexFree;
+	std::vector<ArvBuffer *>	m_free;
+
+	// Messages ready for Detach(), of m_nbytesPayload and the memory options; both are
+	// changed under m_mutexSpare, which drops the spares made for the old ones.
+	std::mutex					m_mutexSpare;
+	std::condition_variable		m_cvSpare;
+	std::vector<std::unique_ptr<sensor_msgs::msg::Image>> m_spares;
+	unsigned					m_nSparesWanted;
+	bool						m_bSpareStop;
+	std::thread					m_threadSpare;
+	std::atomic<uint64_t>		m_nSpareMisses;
+};
+
+} // namespace camera_aravis
+
+#endif // CAMERA_ARAVIS__FRAME_POOL_H_
@@ -0,0 +1,107 @@
+// Copyright 2016 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef CAMERA_ARAVIS__FRAME_RECORDER_H_
+#define CAMERA_ARAVIS__FRAME_RECORDER_H_
+
+#include <semaphore.h>
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <thread>
+
+#include "camera_aravis/latency_histogram.h"
+#include "camera_aravis/recording_format.h"
+#include "camera_aravis/spsc_ring.h"
+
+namespace camera_aravis
+{
+
+// FrameRecorder
+// Writes raw frames to a recording (see recording_format.h) from its own thread.
+// Record() only copies the frame into a block-aligned staging ring; the writer thread
+// drains it with large O_DIRECT writes into preallocated segment files.  When the disk
+// falls behind, the ring fills and Record() drops frames instead of blocking the caller.
+class FrameRecorder
+{
+public:
+	FrameRecorder();
+	~FrameRecorder();
+
+	FrameRecorder(const FrameRecorder &) = delete;
+	FrameRecorder &operator=(const FrameRecorder &) = delete;
+
+	// Start recording into stDir, which is created if need be.  bDirect asks for O_DIRECT,
+	// falling back to buffered writes on file systems without it.  False, and stError set, on failure.
+	bool Open(const std::string &stDir, const std::string &stGuid, const std::string &stPixelformat,
+	          size_t nbytesSegment, size_t nbytesQueue, bool bDirect, std::string &stError);
+
+	// Write what is queued, finish the last segment and stop the writer.
+	void Close(void);
+
+	bool IsOpen(void) const				{ return m_thread.joinable(); }
+	bool IsDirect(void) const			{ return m_bDirect; }
+
+	// Queue a copy of one frame.  entry.offset is filled in by the writer.  Called from one thread.
+	bool Record(const uint8_t *pData, const RecordingEntry &entry);
+
+	std::atomic<uint64_t>	nRecorded;
+	std::atomic<uint64_t>	nDropped;		// Staging ring full.
+	std::atomic<uint64_t>	nbytesWritten;
+	std::atomic<uint64_t>	nErrors;		// Failed writes; the frames in them are lost.
+	LatencyHistogram		histWrite;		// One batched write.
+
+private:
+	struct Staged
+	{
+		uint64_t		pos;				// Of the frame in the staging ring, unwrapped.
+		uint64_t		nbytesPadded;
+		RecordingEntry	entry;
+	};
+
+	void Writer(void);
+	bool OpenSegment(void);
+	void CloseSegment(void);
+	void WriteBatch(Staged *pBatch, size_t nBatch);
+
+	std::string				m_stDir;
+	std::string				m_stGuid;
+	std::string				m_stPixelformat;
+	size_t					m_nbytesSegment;
+	bool					m_bDirect;
+
+	// Staging: frames at block-aligned positions of one big buffer, in the order they are written.
+	uint8_t					*m_pStaging;
+	size_t					m_nbytesStaging;
+	uint64_t				m_posHead;		// Producer only.
+	alignas(64) std::atomic<uint64_t>	m_posTail;	// Released by the writer.
+	SpscRing<Staged>		m_ring;
+	sem_t					m_sem;
+
+	// Writer only.
+	std::thread				m_thread;
+	std::atomic<bool>		m_bRun;
+	unsigned				m_iSegment;
+	int						m_fdData;
+	int						m_fdIndex;
+	RecordingIndexHeader	*m_pIndex;
+	size_t					m_nbytesIndex;
+	uint64_t				m_offsetData;
+};
+
+} // namespace camera_aravis
+
+#endif // CAMERA_ARAVIS__FRAME_RECORDER_H_
@@ -0,0 +1,121 @@
+// Copyright 2016 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+
+#ifndef CAMERA_ARAVIS__FRAME_SYNC_H_
+#define CAMERA_ARAVIS__FRAME_SYNC_H_
+
+#include <semaphore.h>
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "sensor_msgs/msg/image.hpp"
+
+#include "camera_aravis/latency_histogram.h"
+#include "camera_aravis/spsc_ring.h"
+
+namespace camera_aravis
+{
+
+// FrameSync
+// Groups the frames of several cameras into sets taken at the same time: stamps within
+// a tolerance of each other, one frame per camera.  Each camera's publish thread pushes
+// into a window of its own, a lock-free ring of a few frames, and one thread matches the
+// oldest frames of the windows.  Frames are held through their shared_ptr until their
+// set is published or they are given up.
+class FrameSync
+{
+public:
+	// One frame per camera, in camera order; NULL for a camera missing from the set.
+	typedef std::vector<std::shared_ptr<const sensor_msgs::msg::Image>> FrameSet;
+	typedef std::function<void (const FrameSet &set, int64_t nsSkew, bool bComplete)> PublishFn;
+
+	struct Counters
+	{
+		uint64_t	nPushed;		// Frames, all cameras together.
+		uint64_t	nSets;			// Complete sets published.
+		uint64_t	nIncomplete;	// Sets published without some cameras.
+		uint64_t	nUnmatched;		// Frames given up without a set.
+		uint64_t	nOverflows;		// Frames not taken because their window was full.
+	};
+
+	FrameSync();
+	~FrameSync();
+
+	FrameSync(const FrameSync &) = delete;
+	FrameSync &operator=(const FrameSync &) = delete;
+
+	// A frame waits nsTimeout at most for the other cameras' frames.  Then, and whenever it
+	// can no longer be matched, it goes out in an incomplete set with bIncomplete, or is
+	// dropped without.
+	void Start(int nCameras, int nWindow, int64_t nsTolerance, int64_t nsTimeout, bool bIncomplete, const PublishFn &fnPublish);
+	void Stop(void);
+	bool IsRunning(void) const			{ return m_thread.joinable(); }
+
+	// From camera iCamera's publish thread only, with stamps in increasing order.  False,
+	// and the frame let go, when its window is full.
+	bool Push(int iCamera, std::shared_ptr<const sensor_msgs::msg::Image> pImage, int64_t nsStamp);
+
+	// Lets go of camera iCamera's waiting frames, so that their buffers go back to its pool
+	// before the pool is rebound or destroyed.  With its publish thread stopped.
+	void Flush(int iCamera);
+
+	Counters Read(void) const;
+	int nCameras(void) const			{ return (int)m_windows.size(); }
+	int64_t nsTolerance(void) const		{ return m_nsTolerance; }
+
+	LatencyHistogram		histSkew;		// Latest minus earliest stamp of each set.
+	LatencyHistogram		histWait;		// First frame of a set pushed -> set published.
+
+private:
+	struct Pending
+	{
+		std::shared_ptr<const sensor_msgs::msg::Image>	pImage;
+		int64_t											nsStamp;
+		int64_t											nsPushed;
+	};
+
+	void MatchThread(void);
+	bool MatchOnce(void);
+	void Emit(const std::vector<int> &cameras);
+
+	std::vector<std::unique_ptr<SpscRing<Pending>>>	m_windows;
+	int64_t							m_nsTolerance;
+	int64_t							m_nsTimeout;
+	bool							m_bIncomplete;
+	PublishFn						m_fnPublish;
+	FrameSet						m_set;
+	std::vector<int>				m_group;	// Cameras of the set being matched.
+	sem_t							m_sem;		// Posted for each frame pushed.
+	std::mutex						m_mutexMatch;	// Held while matching, so that Flush() can pop too.
+	std::atomic<bool>				m_bRun;
+	std::thread						m_thread;
+
+	std::atomic<uint64_t>			m_nPushed;
+	std::atomic<uint64_t>			m_nSets;
+	std::atomic<uint64_t>			m_nIncomplete;
+	std::atomic<uint64_t>			m_nUnmatched;
+	std::atomic<uint64_t>			m_nOverflows;
+};
+
+} // namespace camera_aravis
+
+#endif // CAMERA_ARAVIS__FRAME_SYNC_H_
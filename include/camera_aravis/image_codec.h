@@ -0,0 +1,63 @@
+// Copyright 2016 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef CAMERA_ARAVIS__IMAGE_CODEC_H_
+#define CAMERA_ARAVIS__IMAGE_CODEC_H_
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "sensor_msgs/msg/compressed_image.hpp"
+#include "sensor_msgs/msg/image.hpp"
+
+namespace camera_aravis
+{
+
+enum ImageCodec
+{
+	CODEC_JPEG,		// libjpeg-turbo, on topic image/compressed.
+	CODEC_QOI,		// "Quite OK Image" lossless, on topic image/qoi.
+	nCodecs
+};
+
+// ImageEncoder
+// Compresses mono8, rgb8 and bgr8 images.  Holds the codec state of one thread.
+class ImageEncoder
+{
+public:
+	ImageEncoder();
+	~ImageEncoder();
+
+	ImageEncoder(const ImageEncoder &) = delete;
+	ImageEncoder &operator=(const ImageEncoder &) = delete;
+
+	static bool IsSupported(const std::string &stEncoding);
+
+	// Encode image into msg.data and set msg.format; false if the encoding is not supported.
+	bool Encode(ImageCodec codec, const sensor_msgs::msg::Image &image, int quality, sensor_msgs::msg::CompressedImage &msg);
+
+private:
+	bool EncodeJpeg(const sensor_msgs::msg::Image &image, int quality, sensor_msgs::msg::CompressedImage &msg);
+	bool EncodeQoi(const sensor_msgs::msg::Image &image, sensor_msgs::msg::CompressedImage &msg);
+
+	struct JpegState;
+	std::unique_ptr<JpegState>	m_pJpeg;
+	std::vector<uint8_t>		m_qoi;
+};
+
+} // namespace camera_aravis
+
+#endif // CAMERA_ARAVIS__IMAGE_CODEC_H_
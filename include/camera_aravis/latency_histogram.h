@@ -0,0 +1,79 @@
+// Copyright 2016 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef CAMERA_ARAVIS__LATENCY_HISTOGRAM_H_
+#define CAMERA_ARAVIS__LATENCY_HISTOGRAM_H_
+
+#include <atomic>
+#include <cstdint>
+
+namespace camera_aravis
+{
+
+// LatencyHistogram
+// Log-linear histogram of durations in nanoseconds: four buckets per power of two,
+// so any recorded value is known to within 25%.  Record() is a couple of relaxed
+// atomic adds, with no locks and no allocation, and may be called from any thread.
+class LatencyHistogram
+{
+public:
+	static const int nSubBuckets = 4;
+	static const int nOctaves = 40;		// Up to 2^40 ns, about 18 minutes.
+	static const int nBuckets = nSubBuckets * nOctaves;
+
+	// A copy of the counts, taken and cleared by Collect().
+	struct Snapshot
+	{
+		uint64_t	counts[nBuckets];
+		uint64_t	n;
+		uint64_t	nsSum;
+		uint64_t	nsMax;
+
+		// Upper bound of the bucket holding the p-th fraction of the samples, p in [0,1].
+		uint64_t Percentile(double p) const;
+		double Mean(void) const		{ return n ? (double)nsSum / n : 0.0; }
+	};
+
+	LatencyHistogram();
+
+	LatencyHistogram(const LatencyHistogram &) = delete;
+	LatencyHistogram &operator=(const LatencyHistogram &) = delete;
+
+	void Record(int64_t ns)
+	{
+		uint64_t nsSample = ns > 0 ? (uint64_t)ns : 0;
+		uint64_t nsMax = m_nsMax.load(std::memory_order_relaxed);
+
+		m_counts[Bucket(nsSample)].fetch_add(1, std::memory_order_relaxed);
+		m_nsSum.fetch_add(nsSample, std::memory_order_relaxed);
+		while (nsSample > nsMax && !m_nsMax.compare_exchange_weak(nsMax, nsSample, std::memory_order_relaxed))
+			;
+	}
+
+	// Move the counts into snapshot and start over.
+	void Collect(Snapshot &snapshot);
+
+	static int Bucket(uint64_t ns);
+	static uint64_t BucketUpperNs(int iBucket);
+
+private:
+	std::atomic<uint64_t>	m_counts[nBuckets];
+	std::atomic<uint64_t>	m_nsSum;
+	std::atomic<uint64_t>	m_nsMax;
+};
+
+} // namespace camera_aravis
+
+#endif // CAMERA_ARAVIS__LATENCY_HISTOGRAM_H_
@@ -0,0 +1,73 @@
+// Copyright 2016 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef CAMERA_ARAVIS__PIXEL_CONVERT_H_
+#define CAMERA_ARAVIS__PIXEL_CONVERT_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace camera_aravis
+{
+
+// Colour of the top-left pixel of a Bayer mosaic, and of the one to its right.
+enum BayerPattern
+{
+	BAYER_RG,
+	BAYER_BG,
+	BAYER_GR,
+	BAYER_GB
+};
+
+enum ConversionKind
+{
+	CONVERSION_NONE,
+	CONVERSION_BAYER8,			// Bayer 8 bit -> rgb8/bgr8, bilinear.
+	CONVERSION_BAYER16,			// Bayer 10/12/16 bit in 16 bit words -> rgb8/bgr8, bilinear on the top 8 bits.
+	CONVERSION_MONO16,			// Mono 10/12 bit in 16 bit words -> mono16, MSB aligned.
+	CONVERSION_MONO10_PACKED,	// GigE Vision Mono10Packed -> mono16, MSB aligned.
+	CONVERSION_MONO12_PACKED	// GigE Vision Mono12Packed -> mono16, MSB aligned.
+};
+
+// PixelConversion
+// What to do with one camera's frames, and the resulting geometry.
+struct PixelConversion
+{
+	ConversionKind	kind;
+	BayerPattern	pattern;
+	int				nBitsIn;		// Significant bits per input pixel.
+	bool			bBgr;			// Colour output in bgr8 rather than rgb8.
+
+	PixelConversion() : kind(CONVERSION_NONE), pattern(BAYER_RG), nBitsIn(8), bBgr(false) {}
+
+	const char *Encoding(void) const;	// Output encoding, e.g. "rgb8".
+	size_t SrcStep(int width) const;	// Bytes per input row.
+	size_t DstStep(int width) const;	// Bytes per output row.
+};
+
+// Convert rows [yBegin, yEnd) of a width x height frame.  Rows are independent, so
+// stripes of one frame may be converted on different threads.  The vectorized and the
+// reference implementation produce bit-identical output.
+void ConvertRows(const PixelConversion &conv, const uint8_t *pSrc, uint8_t *pDst, int width, int height, int yBegin, int yEnd);
+void ConvertRowsReference(const PixelConversion &conv, const uint8_t *pSrc, uint8_t *pDst, int width, int height, int yBegin, int yEnd);
+
+// Significant bits of a sample from the GenICam name, e.g. 12 for "Mono12" or
+// "BayerRG12Packed"; nDefault if it has no number.
+int SignificantBits(const std::string &stPixelformat, int nDefault);
+
+} // namespace camera_aravis
+
+#endif // CAMERA_ARAVIS__PIXEL_CONVERT_H_
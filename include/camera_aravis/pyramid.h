@@ -0,0 +1,50 @@
+// Copyright 2016 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef CAMERA_ARAVIS__PYRAMID_H_
+#define CAMERA_ARAVIS__PYRAMID_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "camera_aravis/pixel_convert.h"
+
+namespace camera_aravis
+{
+
+// Layout of the image a pyramid level is computed from.
+enum PyramidSource
+{
+	PYRAMID_NONE,		// Not supported, e.g. yuv422.
+	PYRAMID_MONO8,
+	PYRAMID_MONO16,
+	PYRAMID_COLOR8,		// rgb8 or bgr8.
+	PYRAMID_BAYER8		// Raw Bayer; the first level is one rgb8/bgr8 pixel per 2x2 quad.
+};
+
+// The source layout for images of a ROS encoding; PYRAMID_NONE if there is no pyramid for it.
+PyramidSource PyramidSourceFor(const std::string &stEncoding);
+
+// Halve rows [yBegin, yEnd) of the output: each output pixel is the rounded mean of a
+// 2x2 block of the source.  widthDst = widthSrc / 2; an odd last column or row is dropped.
+void HalveRows(PyramidSource source, const uint8_t *pSrc, size_t srcStep, uint8_t *pDst, size_t dstStep, int widthDst, int yBegin, int yEnd);
+
+// Bayer 2x2 quads -> colour pixels: R and B as they are, G the mean of the two greens.
+void HalveBayerRows(BayerPattern pattern, bool bBgr, const uint8_t *pSrc, size_t srcStep, uint8_t *pDst, size_t dstStep, int widthDst, int yBegin, int yEnd);
+
+} // namespace camera_aravis
+
+#endif // CAMERA_ARAVIS__PYRAMID_H_
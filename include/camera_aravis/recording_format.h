@@ -0,0 +1,75 @@
+// Copyright 2016 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef CAMERA_ARAVIS__RECORDING_FORMAT_H_
+#define CAMERA_ARAVIS__RECORDING_FORMAT_H_
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+namespace camera_aravis
+{
+
+// A recording is a directory of segments, each a pair of files:
+//   segment_NNNNN.dat  the raw frame payloads, each starting on a block boundary;
+//   segment_NNNNN.idx  a RecordingIndexHeader followed by one RecordingEntry per frame.
+// Both are plain structs in host byte order, so a reader can mmap() the index and use it
+// as is.  The writer fills in an entry before counting it in nEntries.
+
+static const char		szRecordingMagic[8] = {'C', 'A', 'R', 'A', 'V', 'R', 'E', 'C'};
+static const uint32_t	nRecordingVersion = 1;
+static const size_t		nbytesRecordingBlock = 4096;	// O_DIRECT alignment of offsets, sizes and memory.
+
+struct RecordingIndexHeader
+{
+	char		magic[8];
+	uint32_t	version;
+	uint32_t	nbytesEntry;			// sizeof(RecordingEntry), for readers built against another version.
+	uint32_t	iSegment;
+	uint32_t	nEntriesMax;			// Room in this index file.
+	uint64_t	nEntries;				// Entries written so far.
+	uint64_t	nbytesData;				// Bytes of the .dat file in use.
+	char		szGuid[64];				// Camera the frames came from.
+	char		szPixelformat[32];		// GenICam name of the pixel format, e.g. "BayerRG8".
+	uint8_t		reserved[nbytesRecordingBlock - 136];
+};
+
+struct RecordingEntry
+{
+	uint64_t	offset;					// Of the payload in the .dat file.
+	uint32_t	nbytes;					// Payload size, before padding to the block size.
+	uint32_t	pixelformat;			// ArvPixelFormat.
+	uint64_t	nsCamera;				// arv_buffer_get_timestamp().
+	uint64_t	nsHost;					// arv_buffer_get_system_timestamp().
+	uint32_t	width;
+	uint32_t	height;
+	uint64_t	iFrame;					// Frame counter of the recording camera.
+};
+
+static_assert(sizeof(RecordingIndexHeader) == nbytesRecordingBlock, "RecordingIndexHeader must fill one block");
+static_assert(sizeof(RecordingEntry) == 48, "RecordingEntry layout is part of the file format");
+
+inline std::string RecordingSegmentPath(const std::string &stDir, unsigned iSegment, const char *szExtension)
+{
+	char sz[32];
+
+	snprintf(sz, sizeof(sz), "/segment_%05u.%s", iSegment, szExtension);
+	return stDir + sz;
+}
+
+} // namespace camera_aravis
+
+#endif // CAMERA_ARAVIS__RECORDING_FORMAT_H_
@@ -0,0 +1,114 @@
+// Copyright 2016 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef CAMERA_ARAVIS__RECTIFY_H_
+#define CAMERA_ARAVIS__RECTIFY_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace camera_aravis
+{
+
+// Layout of the images a rectification map applies to.
+enum RectifySource
+{
+	RECTIFY_NONE,		// Not supported, e.g. raw Bayer or yuv422.
+	RECTIFY_MONO8,
+	RECTIFY_MONO16,
+	RECTIFY_COLOR8		// rgb8 or bgr8.
+};
+
+// The source layout for images of a ROS encoding; RECTIFY_NONE if they cannot be rectified.
+RectifySource RectifySourceFor(const std::string &stEncoding);
+
+// A camera calibration, as in sensor_msgs/CameraInfo: distortion model and coefficients,
+// intrinsics K, rectifying rotation R and projection P, for an image of width x height.
+struct Calibration
+{
+	int					width;
+	int					height;
+	std::string			stModel;	// "plumb_bob", "rational_polynomial" or "equidistant".
+	std::vector<double>	D;
+	double				K[9];
+	double				R[9];
+	double				P[12];
+};
+
+// The part of the calibrated image a camera delivers, per REP 104: a region of
+// width x height pixels, each dx x dy calibrated pixels, from (x, y) calibrated pixels.
+struct ImageWindow
+{
+	int		x;
+	int		y;
+	int		dx;
+	int		dy;
+	int		width;
+	int		height;
+};
+
+// RectifyMap
+// For each pixel of the rectified image, where it comes from in the raw one, as computed
+// once per calibration and window: 16-bit integer coordinates plus 5-bit fractions, six
+// bytes a pixel, stored tile by tile so that a tile's entries, and the source pixels
+// they read, stay together in the cache.  The remap is bilinear, with 16 pixels at a
+// time in vector registers; pixels from outside the raw image come out black.
+class RectifyMap
+{
+public:
+	static constexpr int nTileWidth = 64;
+	static constexpr int nTileHeight = 16;	// Stripes of rows should be multiples of this.
+	static constexpr int nFractionBits = 5;
+
+	RectifyMap();
+
+	// False, with the reason in stError, for a distortion model it does not know or a
+	// window it cannot address.
+	bool Build(const Calibration &calibration, const ImageWindow &window, std::string &stError);
+	void Clear(void);
+
+	// Rectify rows [yBegin, yEnd) of a width() x height() image.  The vectorized and the
+	// reference implementation produce bit-identical output.
+	void Remap(RectifySource source, const uint8_t *pSrc, size_t srcStep, uint8_t *pDst, size_t dstStep, int yBegin, int yEnd) const;
+	void RemapReference(RectifySource source, const uint8_t *pSrc, size_t srcStep, uint8_t *pDst, size_t dstStep, int yBegin, int yEnd) const;
+
+	bool IsEmpty(void) const	{ return m_xy.empty(); }
+	int width(void) const		{ return m_width; }
+	int height(void) const		{ return m_height; }
+	size_t nbytes(void) const	{ return m_xy.size() * sizeof(m_xy[0]) + m_weights.size() * sizeof(m_weights[0]); }
+
+	// Entry of an output pixel: source x | y << 16, and x fraction | y fraction << 8, or
+	// nInvalid for pixels from outside the source.
+	static constexpr uint16_t nInvalid = 0xFFFF;
+
+private:
+	size_t Entry(int x, int y) const
+	{
+		return ((size_t)(y / nTileHeight) * m_nTilesX + x / nTileWidth) * (nTileWidth * nTileHeight) +
+			(y % nTileHeight) * nTileWidth + x % nTileWidth;
+	}
+
+	int						m_width;
+	int						m_height;
+	int						m_nTilesX;
+	std::vector<uint32_t>	m_xy;
+	std::vector<uint16_t>	m_weights;
+};
+
+} // namespace camera_aravis
+
+#endif // CAMERA_ARAVIS__RECTIFY_H_
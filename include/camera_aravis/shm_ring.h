@@ -0,0 +1,192 @@
+// Copyright 2016 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef CAMERA_ARAVIS__SHM_RING_H_
+#define CAMERA_ARAVIS__SHM_RING_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace camera_aravis
+{
+
+// A shared-memory frame ring is one POSIX shared memory object, /dev/shm/<name>:
+// a ShmRingHeader in the first nbytesShmRingHeader bytes, then nSlots slots every
+// nbytesStride bytes, each a ShmSlotHeader followed by room for nbytesSlot bytes of
+// pixels.  The writer fills the slots round robin and announces each frame elsewhere
+// (on a ROS topic) by slot, sequence number and generation.
+//
+// Each slot is a seqlock: its lock is 2*sequence - 1 while frame `sequence` is being
+// written into it and 2*sequence once it is complete.  A reader checks the lock
+// before and after using the pixels, so it can tell when the writer came round again.
+
+static const char		szShmRingMagic[8] = {'C', 'A', 'R', 'A', 'V', 'S', 'H', 'M'};
+static const uint32_t	nShmRingVersion = 1;
+static const size_t		nbytesShmRingHeader = 4096;
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "The ring's atomics must work across processes");
+
+struct ShmRingHeader
+{
+	char					magic[8];	// Written last, once the rest is in place.
+	uint32_t				version;
+	uint32_t				nSlots;
+	uint64_t				nbytesSlot;	// Room for pixels in each slot.
+	uint64_t				nbytesStride;	// From one slot to the next.
+	uint64_t				generation;	// Different for every ring created under the name.
+	std::atomic<uint64_t>	sequence;	// Of the latest complete frame; 0 before the first.
+};
+
+struct ShmSlotHeader
+{
+	std::atomic<uint64_t>	lock;		// 2*sequence once complete, odd while being written.
+	int64_t					nsStamp;	// header.stamp of the frame.
+	int64_t					nsWritten;	// CLOCK_MONOTONIC when the frame was complete, for latency measurement.
+	uint32_t				width;
+	uint32_t				height;
+	uint32_t				step;
+	uint32_t				nbytes;
+	char					szEncoding[16];
+	uint8_t					reserved[8];
+};
+
+static_assert(sizeof(ShmRingHeader) <= nbytesShmRingHeader, "ShmRingHeader must fit its page");
+static_assert(sizeof(ShmSlotHeader) == 64, "ShmSlotHeader layout is part of the ring format");
+
+// Geometry of a frame, as published in the image message.
+struct ShmFrameInfo
+{
+	int64_t		nsStamp;
+	uint32_t	width;
+	uint32_t	height;
+	uint32_t	step;
+	const char *szEncoding;
+};
+
+// ShmRingWriter
+// Creates the ring and copies frames into it.  One writer thread.
+class ShmRingWriter
+{
+public:
+	ShmRingWriter();
+	~ShmRingWriter();
+
+	ShmRingWriter(const ShmRingWriter &) = delete;
+	ShmRingWriter &operator=(const ShmRingWriter &) = delete;
+
+	// Create the ring as /dev/shm/<stName>, replacing any ring of that name; readers still
+	// mapping the old one see a new generation on the next frame.  False, with the reason
+	// in stError, if it could not be created.
+	bool Create(const std::string &stName, size_t nbytesSlot, unsigned nSlots, std::string &stError);
+	void Destroy(void);
+
+	// Copy a frame into the next slot, overwriting the oldest frame.  The frame's sequence
+	// number, with its slot in iSlot, or 0 if it does not fit in a slot.
+	uint64_t Write(const void *pData, size_t nbytes, const ShmFrameInfo &info, uint32_t &iSlot);
+
+	bool IsOpen(void) const				{ return m_pHeader != NULL; }
+	const std::string &Name(void) const	{ return m_stName; }
+	size_t nbytesSlot(void) const		{ return m_pHeader ? m_pHeader->nbytesSlot : 0; }
+	unsigned nSlots(void) const			{ return m_pHeader ? m_pHeader->nSlots : 0; }
+	uint64_t Generation(void) const		{ return m_pHeader ? m_pHeader->generation : 0; }
+
+private:
+	std::string		m_stName;
+	uint8_t		   *m_pBase;
+	size_t			m_nbytesMapped;
+	ShmRingHeader  *m_pHeader;
+};
+
+// ShmRingReader
+// Maps a ring read-only and checks every frame taken from it against overwrites.
+//   ShmRingReader::View view;
+//   if (reader.Read(desc, view))
+//   {
+//       Process(view.pData, view.width, view.height);
+//       if (!reader.Valid(view))
+//           ...;	// Overwritten while in use: discard what came of it.
+//   }
+class ShmRingReader
+{
+public:
+	struct View
+	{
+		const uint8_t		*pData;
+		size_t				 nbytes;
+		uint32_t			 width;
+		uint32_t			 height;
+		uint32_t			 step;
+		std::string			 stEncoding;
+		int64_t				 nsStamp;
+		int64_t				 nsWritten;
+		uint64_t			 sequence;
+		const ShmSlotHeader	*pSlot;
+	};
+
+	ShmRingReader();
+	~ShmRingReader();
+
+	ShmRingReader(const ShmRingReader &) = delete;
+	ShmRingReader &operator=(const ShmRingReader &) = delete;
+
+	bool Open(const std::string &stName, std::string &stError);
+	void Close(void);
+
+	// Frame `sequence` of ring generation `generation` in slot iSlot, mapped in place.  False
+	// if the writer has already overwritten it, or the ring went and could not be mapped again.
+	bool Read(uint32_t iSlot, uint64_t sequence, uint64_t generation, View &view);
+
+	// The same, from a frame descriptor message (camera_aravis/msg/ShmFrame).
+	template <class Descriptor>
+	bool Read(const Descriptor &desc, View &view)
+	{
+		if (!m_pHeader || desc.shm_name != m_stName)
+		{
+			std::string stError;
+			if (!Open(desc.shm_name, stError))
+				return false;
+		}
+		return Read(desc.slot, desc.sequence, desc.generation, view);
+	}
+
+	// Whether the pixels seen through view were intact throughout: call once done with them.
+	bool Valid(const View &view);
+
+	// Read() into a copy of the pixels, checked.
+	bool Copy(uint32_t iSlot, uint64_t sequence, uint64_t generation, std::vector<uint8_t> &data, View &view);
+
+	bool IsOpen(void) const			{ return m_pHeader != NULL; }
+	uint64_t Generation(void) const	{ return m_pHeader ? m_pHeader->generation : 0; }
+
+	uint64_t	nRead;			// Frames handed out.
+	uint64_t	nOverwritten;	// Gone before Read() got to them: the reader is too slow for the ring.
+	uint64_t	nTorn;			// Overwritten while in use, as found by Valid().
+	uint64_t	nReopened;		// Times the ring was mapped again for a new generation.
+
+private:
+	const ShmSlotHeader *Slot(uint32_t iSlot) const;
+
+	std::string				 m_stName;
+	const uint8_t			*m_pBase;
+	size_t					 m_nbytesMapped;
+	const ShmRingHeader		*m_pHeader;
+};
+
+} // namespace camera_aravis
+
+#endif // CAMERA_ARAVIS__SHM_RING_H_
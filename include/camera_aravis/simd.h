@@ -0,0 +1,47 @@
+// Copyright 2016 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef CAMERA_ARAVIS__SIMD_H_
+#define CAMERA_ARAVIS__SIMD_H_
+
+#include <cstdint>
+
+// Portable SIMD for the row kernels (pixel conversion, pyramid, rectification, change
+// gate, exposure metering, tensors): GCC/Clang vector extensions compile to SSE2/AVX2
+// on x86-64 and to NEON on ARM from one source.  On x86-64 a kernel marked
+// TARGET_CLONES is also built for AVX2 and picked at load time.  Loads and stores go
+// through memcpy, so rows need no alignment.  Internal to the kernel sources.
+
+namespace camera_aravis
+{
+
+typedef uint8_t		v16u8 __attribute__((vector_size(16)));
+typedef uint8_t		v32u8 __attribute__((vector_size(32)));
+typedef uint16_t	v8u16 __attribute__((vector_size(16)));
+typedef uint16_t	v16u16 __attribute__((vector_size(32)));
+typedef uint32_t	v8u32 __attribute__((vector_size(32)));
+typedef uint32_t	v16u32 __attribute__((vector_size(64)));
+typedef int32_t		v8i32 __attribute__((vector_size(32)));
+typedef float		v8f32 __attribute__((vector_size(32)));
+
+} // namespace camera_aravis
+
+#if defined(__x86_64__) && defined(__GNUC__) && !defined(__clang__)
+#define TARGET_CLONES __attribute__((target_clones("avx2", "default")))
+#else
+#define TARGET_CLONES
+#endif
+
+#endif // CAMERA_ARAVIS__SIMD_H_
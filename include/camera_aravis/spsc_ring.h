@@ -0,0 +1,108 @@
+// Copyright 2016 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef CAMERA_ARAVIS__SPSC_RING_H_
+#define CAMERA_ARAVIS__SPSC_RING_H_
+
+#include <atomic>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+namespace camera_aravis
+{
+
+// SpscRing
+// Bounded lock-free queue for exactly one producer thread and one consumer thread.
+// The capacity is rounded up to a power of two.  Push() fails instead of blocking
+// when the ring is full, so the producer decides what to drop.
+template <typename T>
+class SpscRing
+{
+public:
+	explicit SpscRing(size_t nCapacity = 0)
+		: m_iHead(0), m_iTail(0)
+	{
+		Resize(nCapacity);
+	}
+
+	SpscRing(const SpscRing &) = delete;
+	SpscRing &operator=(const SpscRing &) = delete;
+
+	// Not thread safe: only while neither side is running.
+	void Resize(size_t nCapacity)
+	{
+		size_t n = 1;
+
+		while (n < nCapacity)
+			n <<= 1;
+		m_items.assign(n, T());
+		m_mask = n - 1;
+		m_iHead.store(0, std::memory_order_relaxed);
+		m_iTail.store(0, std::memory_order_relaxed);
+	}
+
+	// Producer side.
+	bool Push(const T &item)
+	{
+		size_t iTail = m_iTail.load(std::memory_order_relaxed);
+
+		if (iTail - m_iHead.load(std::memory_order_acquire) > m_mask)
+			return false;
+		m_items[iTail & m_mask] = item;
+		m_iTail.store(iTail + 1, std::memory_order_release);
+		return true;
+	}
+
+	// Consumer side.  The slot is moved from, so it holds nothing of the item afterwards.
+	bool Pop(T &item)
+	{
+		size_t iHead = m_iHead.load(std::memory_order_relaxed);
+
+		if (iHead == m_iTail.load(std::memory_order_acquire))
+			return false;
+		item = std::move(m_items[iHead & m_mask]);
+		m_iHead.store(iHead + 1, std::memory_order_release);
+		return true;
+	}
+
+	// Consumer side: the oldest item, left in the ring; NULL if empty.
+	const T *Front(void) const
+	{
+		size_t iHead = m_iHead.load(std::memory_order_relaxed);
+
+		if (iHead == m_iTail.load(std::memory_order_acquire))
+			return nullptr;
+		return &m_items[iHead & m_mask];
+	}
+
+	// Approximate when called concurrently; exact from either side.
+	size_t Size(void) const
+	{
+		return m_iTail.load(std::memory_order_acquire) - m_iHead.load(std::memory_order_acquire);
+	}
+
+	size_t Capacity(void) const	{ return m_mask + 1; }
+
+private:
+	std::vector<T>					m_items;
+	size_t							m_mask;
+	alignas(64) std::atomic<size_t>	m_iHead;	// Next slot to read; written by the consumer.
+	alignas(64) std::atomic<size_t>	m_iTail;	// Next slot to write; written by the producer.
+};
+
+} // namespace camera_aravis
+
+#endif // CAMERA_ARAVIS__SPSC_RING_H_
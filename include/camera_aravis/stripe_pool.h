@@ -0,0 +1,72 @@
+// Copyright 2016 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef CAMERA_ARAVIS__STRIPE_POOL_H_
+#define CAMERA_ARAVIS__STRIPE_POOL_H_
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace camera_aravis
+{
+
+// StripePool
+// Splits per-frame work into horizontal stripes and runs them on a few worker
+// threads plus the calling thread.  Run() returns when every stripe is done.
+// One caller at a time.
+class StripePool
+{
+public:
+	typedef std::function<void (int yBegin, int yEnd)> StripeFn;
+
+	explicit StripePool(int nThreads = 0);
+	~StripePool();
+
+	StripePool(const StripePool &) = delete;
+	StripePool &operator=(const StripePool &) = delete;
+
+	// Stop the workers and start nThreads of them; 1 runs everything on the caller.
+	void Start(int nThreads);
+	void Stop(void);
+
+	// Call fn on stripes covering rows [0, height).  Stripe boundaries are multiples of nAlign rows.
+	void Run(int height, const StripeFn &fn, int nAlign = 2);
+
+	int nThreads(void) const		{ return (int)m_threads.size() + 1; }
+
+	// The worker threads, e.g. to place them on cores.
+	std::vector<std::thread> &Threads(void)	{ return m_threads; }
+
+private:
+	void Worker(int iWorker, int nStripes, unsigned iGenerationSeen);
+
+	std::vector<std::thread>	m_threads;
+	std::mutex					m_mutex;
+	std::condition_variable		m_cvStart;
+	std::condition_variable		m_cvDone;
+	const StripeFn			   *m_pFn;
+	int							m_height;
+	int							m_nAlign;
+	unsigned					m_iGeneration;	// Bumped for each Run().
+	int							m_nPending;		// Workers still busy with this Run().
+	bool						m_bStop;
+};
+
+} // namespace camera_aravis
+
+#endif // CAMERA_ARAVIS__STRIPE_POOL_H_
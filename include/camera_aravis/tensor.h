@@ -0,0 +1,119 @@
+// Copyright 2016 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+
+#ifndef CAMERA_ARAVIS__TENSOR_H_
+#define CAMERA_ARAVIS__TENSOR_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "camera_aravis/pixel_convert.h"
+
+namespace camera_aravis
+{
+
+// Layout of the images a tensor is made from.
+enum TensorSource
+{
+	TENSOR_NONE,		// Not supported, e.g. yuv422 or packed formats.
+	TENSOR_MONO,
+	TENSOR_COLOR,		// rgb or bgr, 3 samples a pixel.
+	TENSOR_BAYER		// Raw Bayer; each 2x2 quad is one colour pixel.
+};
+
+struct TensorInput
+{
+	TensorSource	source;
+	int				nbytesSample;	// 1, or 2 little endian.
+	int				nBits;			// Significant bits of a 2-byte sample, from the bottom.
+	bool			bBgr;			// TENSOR_COLOR in bgr order.
+	BayerPattern	pattern;		// Of TENSOR_BAYER.
+};
+
+// The input for images of a ROS encoding whose 16-bit samples have nBits significant
+// bits; source TENSOR_NONE if there is no tensor for them.
+TensorInput TensorInputFor(const std::string &stEncoding, int nBits);
+
+// What each image becomes.
+struct TensorSpec
+{
+	int		width;			// 0 = the crop's, in pixels or Bayer quads.
+	int		height;
+	int		xCrop;			// Part of the source; widthCrop 0 = all of it.
+	int		yCrop;
+	int		widthCrop;
+	int		heightCrop;
+	int		nChannels;		// 1 (luma of colour), 3 (mono repeated), or 0 = as the source.
+	bool	bBgr;			// 3 channels in bgr order rather than rgb.
+	bool	bHalf;			// fp16 rather than float32.
+	float	mean[3];		// Per tensor channel, of samples scaled to [0, 1].
+	float	std[3];
+};
+
+// TensorConverter
+// One image of an NCHW tensor from a frame, in a single pass over it.  For each output
+// row, its two source rows (Bayer: two pairs of rows) are blended into a float row that
+// stays in the cache, split into colour planes, and each channel's output row is
+// interpolated from those, normalized and stored, as fp16 through one more row in the
+// cache.  The resize is bilinear, with pixel centres aligned as in OpenCV's INTER_LINEAR;
+// the rows and columns it reads and their weights are worked out in Configure().
+class TensorConverter
+{
+public:
+	TensorConverter();
+
+	// For sources of width x height; does nothing if that and the rest are as before.
+	// False, with the reason in stError, for a crop outside the source.
+	bool Configure(const TensorInput &input, int width, int height, const TensorSpec &spec, std::string &stError);
+
+	// Rows [yBegin, yEnd) of each plane of the image at pDst.  Rows are independent, so
+	// stripes of one image may be converted on different threads.
+	void ConvertRows(const uint8_t *pSrc, size_t step, uint8_t *pDst, int yBegin, int yEnd) const;
+
+	int width(void) const			{ return m_width; }
+	int height(void) const			{ return m_height; }
+	int nChannels(void) const		{ return m_nChannels; }
+	bool IsHalf(void) const			{ return m_spec.bHalf; }
+	size_t nbytes(void) const		{ return (size_t)m_nChannels * m_width * m_height * (m_spec.bHalf ? 2 : 4); }
+
+private:
+	TensorInput				m_input;
+	TensorSpec				m_spec;
+	int						m_widthSrc;
+	int						m_heightSrc;
+	int						m_width;
+	int						m_height;
+	int						m_nChannels;
+	int						m_nUnits;		// Pixels, or Bayer quads, across the crop.
+	size_t					m_xOffset;		// Bytes into a source row where the crop starts.
+	std::vector<int32_t>	m_x0;			// Per output column: the two units it lies between,
+	std::vector<int32_t>	m_x1;
+	std::vector<float>		m_wx;			// and the weight of the second.
+	std::vector<int32_t>	m_y0;			// Per output row: source rows, or Bayer quad rows.
+	std::vector<int32_t>	m_y1;
+	std::vector<float>		m_wy;
+	float					m_scale[3];		// Per output channel: sample to normalized value.
+	float					m_bias[3];
+};
+
+// IEEE half precision of f, rounded to nearest even.
+uint16_t FloatToHalf(float f);
+
+} // namespace camera_aravis
+
+#endif // CAMERA_ARAVIS__TENSOR_H_
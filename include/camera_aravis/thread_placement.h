@@ -0,0 +1,63 @@
+// Copyright 2016 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef CAMERA_ARAVIS__THREAD_PLACEMENT_H_
+#define CAMERA_ARAVIS__THREAD_PLACEMENT_H_
+
+#include <pthread.h>
+#include <sys/types.h>
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace camera_aravis
+{
+
+// Where the threads on the frame path run: CPU affinity, SCHED_FIFO, and the NUMA node
+// their buffers belong on.  Every call reads back what the thread actually got, since the
+// kernel may refuse all or part of a request (no CAP_SYS_NICE, cores not in the cpuset),
+// and says why.
+
+typedef std::vector<int> CpuList;
+
+// Pin a thread to cpus (empty: leave its affinity) and run it under SCHED_FIFO at priority
+// (0: leave its policy).  False if any part was refused.  stReport describes the placement
+// the thread has afterwards, e.g. "cpu 2 fifo 50", followed by the reason for any refusal.
+bool PlaceThread(pthread_t thread, const CpuList &cpus, int priority, std::string &stReport);
+
+// The same for a thread known only by its kernel id, such as one that Aravis started.
+bool PlaceTask(pid_t tid, const CpuList &cpus, int priority, std::string &stReport);
+
+// Kernel ids of this process's threads named szName, as shown in /proc/self/task/*/comm.
+std::vector<pid_t> ThreadsNamed(const char *szName);
+
+// The CPUs this process may run on (its main thread's affinity, e.g. as cut down by a
+// cpuset or a container); empty if the kernel does not say.
+CpuList AllowedCpus(void);
+
+// NUMA node of a CPU, or -1 if the system does not say.
+int NumaNodeOfCpu(int iCpu);
+
+// Move the pages of [p, p+nbytes) to NUMA node iNode, and keep any touched later there.
+// False if the kernel refused.
+bool BindToNode(void *p, size_t nbytes, int iNode);
+
+// "2", "0-3,8" and so on.
+std::string CpuListString(const CpuList &cpus);
+
+} // namespace camera_aravis
+
+#endif // CAMERA_ARAVIS__THREAD_PLACEMENT_H_
@@ -0,0 +1,87 @@
+// Copyright 2016 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef CAMERA_ARAVIS__TRIGGER_SCHEDULER_H_
+#define CAMERA_ARAVIS__TRIGGER_SCHEDULER_H_
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "camera_aravis/latency_histogram.h"
+
+namespace camera_aravis
+{
+
+// TriggerScheduler
+// Calls a function at the instants nsStart + k * nsPeriod of the steady clock
+// (CLOCK_MONOTONIC), from a thread of its own.  Each wait is a clock_nanosleep() to an
+// absolute deadline, so errors do not add up from one period to the next; the thread
+// can run under SCHED_FIFO, and can busy-wait the last nsSpin before each deadline,
+// which takes the timer wake-up latency out of the jitter.  Schedulers started with the
+// same nsStart and nsPeriod fire together, each on its own thread.
+class TriggerScheduler
+{
+public:
+	typedef std::function<void (void)> FireFn;
+
+	TriggerScheduler();
+	~TriggerScheduler();
+
+	TriggerScheduler(const TriggerScheduler &) = delete;
+	TriggerScheduler &operator=(const TriggerScheduler &) = delete;
+
+	// Priority > 0 asks for SCHED_FIFO at that priority.  False, with the reason in stError,
+	// when that was refused; the thread then runs at normal priority.
+	bool Start(int64_t nsStart, int64_t nsPeriod, int priority, int64_t nsSpin, const FireFn &fnFire, std::string &stError);
+	void Stop(void);
+
+	// Hold off firing, e.g. while the device is replaced.  Pause() returns once any call in
+	// progress has; the instants passed meanwhile count as skipped.
+	void Pause(void);
+	void Resume(void);
+
+	bool IsRunning(void) const		{ return m_thread.joinable(); }
+
+	// Host wall clock of the latest firing at or before nsRealtime, among the last few; 0 if none.
+	int64_t FiredBefore(int64_t nsRealtime) const;
+
+	std::atomic<uint64_t>	nFired;
+	std::atomic<uint64_t>	nSkipped;	// Paused, or woken after the next instant had already passed.
+	LatencyHistogram		histJitter;	// Deadline -> the call.
+	LatencyHistogram		histCall;	// Duration of the call, e.g. the TriggerSoftware round trip.
+
+private:
+	static const int nHistory = 64;
+
+	void Run(void);
+
+	std::thread				m_thread;
+	std::atomic<bool>		m_bStop;
+	std::mutex				m_mutexFire;	// Held while calling m_fnFire.
+	bool					m_bPaused;
+	int64_t					m_nsStart;
+	int64_t					m_nsPeriod;
+	int64_t					m_nsSpin;
+	FireFn					m_fnFire;
+	std::atomic<int64_t>	m_nsFired[nHistory];	// Wall clock of firing k at [k % nHistory].
+};
+
+} // namespace camera_aravis
+
+#endif // CAMERA_ARAVIS__TRIGGER_SCHEDULER_H_
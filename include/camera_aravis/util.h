@@ -0,0 +1,48 @@
+// Copyright 2016 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef CAMERA_ARAVIS__UTIL_H_
+#define CAMERA_ARAVIS__UTIL_H_
+
+#include <time.h>
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+namespace camera_aravis
+{
+
+// Steady clock, ns: intervals, deadlines and latencies within the process.
+inline int64_t NowNs (void)
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Host wall clock, ns, as used by arv_buffer_get_system_timestamp() and in header.stamp.
+inline int64_t RealtimeNs (void)
+{
+	struct timespec	ts;
+
+	clock_gettime(CLOCK_REALTIME, &ts);
+	return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+// mkdir -p.  False, with errno set, if a directory could not be made.
+bool MakeDirectories (const std::string &stDir);
+
+} // namespace camera_aravis
+
+#endif // CAMERA_ARAVIS__UTIL_H_
@@ -0,0 +1,47 @@
+# Load camera_aravis into a component container next to image_proc, with
+# intra-process comms so the rectifier gets each frame without a copy.  The
+# rectifier reads image and camera_info and publishes on /rectify/image_rect:
+# the driver's own rectified image (rectify:=true) is on /image_rect, and the
+# two would collide there.  Use one or the other.
+#
+#   ros2 launch camera_aravis camera_container.launch.py guid:=Basler-21237813
+
+from launch import LaunchDescription
+from launch.actions import DeclareLaunchArgument
+from launch.substitutions import LaunchConfiguration
+from launch_ros.actions import ComposableNodeContainer
+from launch_ros.descriptions import ComposableNode
+
+
+def generate_launch_description():
+    guid = LaunchConfiguration('guid')
+
+    container = ComposableNodeContainer(
+        name='camera_container',
+        namespace='',
+        package='rclcpp_components',
+        executable='component_container_mt',
+        composable_node_descriptions=[
+            ComposableNode(
+                package='camera_aravis',
+                plugin='camera_aravis::CameraNode',
+                name='camera',
+                parameters=[{'guid': guid}],
+                extra_arguments=[{'use_intra_process_comms': True}]),
+            ComposableNode(
+                package='image_proc',
+                plugin='image_proc::RectifyNode',
+                name='rectify',
+                remappings=[('image', '/image'),
+                            ('camera_info', '/camera_info'),
+                            ('image_rect', '/rectify/image_rect')],
+                extra_arguments=[{'use_intra_process_comms': True}]),
+        ],
+        output='screen',
+    )
+
+    return LaunchDescription([
+        DeclareLaunchArgument('guid', default_value='',
+                              description='Camera to open, e.g. Basler-21237813; empty for the first one found.'),
+        container,
+    ])
@@ -0,0 +1,431 @@
+// Copyright 2016 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include <cstdio>
+#include <string>
+
+#include "camera_aravis/camera_node.h"
+#include "camera_aravis/util.h"
+
+namespace camera_aravis
+{
+
+static const char	*szBufferStatusName[nBufferStatuses] = {
+										"success",
+										"cleared",
+										"timeout",
+										"missing_packets",
+										"wrong_packet_id",
+										"size_mismatch",
+										"filling",
+										"aborted"
+										};
+
+static void AddValue(diagnostic_msgs::msg::DiagnosticStatus &status, const std::string &key, const std::string &value)
+{
+	diagnostic_msgs::msg::KeyValue kv;
+
+	kv.key = key;
+	kv.value = value;
+	status.values.push_back(kv);
+}
+
+static void AddRate(diagnostic_msgs::msg::DiagnosticStatus &status, const std::string &key, uint64_t nNow, uint64_t nPrev, double seconds)
+{
+	char	sz[32];
+
+	snprintf(sz, sizeof(sz), "%.2f", seconds > 0.0 ? (nNow - nPrev) / seconds : 0.0);
+	AddValue(status, key, sz);
+}
+
+// AddHistogram()
+// Summary percentiles in microseconds, plus the non-empty buckets as "upper_us:count ...".
+static void AddHistogram(diagnostic_msgs::msg::DiagnosticStatus &status, const std::string &key, const LatencyHistogram::Snapshot &snapshot)
+{
+	char		sz[64];
+	std::string	stBuckets;
+
+	snprintf(sz, sizeof(sz), "%lu", (unsigned long)snapshot.n);
+	AddValue(status, key + "_count", sz);
+	snprintf(sz, sizeof(sz), "%.1f", snapshot.Mean() / 1e3);
+	AddValue(status, key + "_mean_us", sz);
+	snprintf(sz, sizeof(sz), "%.1f", snapshot.Percentile(0.50) / 1e3);
+	AddValue(status, key + "_p50_us", sz);
+	snprintf(sz, sizeof(sz), "%.1f", snapshot.Percentile(0.90) / 1e3);
+	AddValue(status, key + "_p90_us", sz);
+	snprintf(sz, sizeof(sz), "%.1f", snapshot.Percentile(0.99) / 1e3);
+	AddValue(status, key + "_p99_us", sz);
+	snprintf(sz, sizeof(sz), "%.1f", snapshot.nsMax / 1e3);
+	AddValue(status, key + "_max_us", sz);
+
+	for (int i=0; i<LatencyHistogram::nBuckets; i++)
+	{
+		if (snapshot.counts[i])
+		{
+			snprintf(sz, sizeof(sz), "%s%.3f:%lu", stBuckets.empty() ? "" : " ",
+				LatencyHistogram::BucketUpperNs(i) / 1e3, (unsigned long)snapshot.counts[i]);
+			stBuckets += sz;
+		}
+	}
+	AddValue(status, key + "_histogram", stBuckets);
+}
+
+
+// PublishDiagnostics()
+// One DiagnosticStatus per camera: stream counters as rates since the previous call,
+// the popped buffers by status, and the latency histograms collected since then.
+void CameraNode::PublishDiagnostics(void)
+{
+	diagnostic_msgs::msg::DiagnosticArray	msg;
+	int64_t									nsNow = NowNs();
+	double									seconds = (nsNow - m_nsDiagnosticsPrev) / 1e9;
+
+	m_nsDiagnosticsPrev = nsNow;
+	msg.header.stamp = now();
+
+	for (auto &pCam : m_cameras)
+	{
+		CameraState							&cam = *pCam;
+		diagnostic_msgs::msg::DiagnosticStatus	status;
+		StreamCounters						 counters;
+		guint64								 n_completed_buffers = 0;
+		guint64								 n_failures = 0;
+		guint64								 n_underruns = 0;
+		guint64								 n_resent = 0;
+		guint64								 n_missing = 0;
+		char								 sz[32];
+
+		if (!cam.pPlayer && cam.stOpenId.empty())
+			continue;
+
+		// Skip the stream statistics while a reconnect replaces the stream.
+		std::unique_lock<std::mutex> lock(cam.mutexDevice, std::try_to_lock);
+		if (lock && cam.pStream && !cam.bControlLost)
+		{
+			arv_stream_get_statistics ((ArvStream *)cam.pStream, &n_completed_buffers, &n_failures, &n_underruns);
+			if (ARV_IS_GV_STREAM (cam.pStream))
+				arv_gv_stream_get_statistics (cam.pStream, &n_resent, &n_missing);
+		}
+		else if (!cam.pPlayer)
+		{
+			n_completed_buffers = cam.countersPrev.nCompleted;
+			n_failures = cam.countersPrev.nFailures;
+			n_underruns = cam.countersPrev.nUnderruns;
+			n_resent = cam.countersPrev.nResent;
+			n_missing = cam.countersPrev.nMissing;
+		}
+		std::string stPlacement = lock ? cam.stPlacement : std::string();
+		lock.unlock();
+
+		// A new stream after a reconnect or reconfiguration counts from zero again.
+		uint32_t nReconnects = cam.nReconnects.load();
+		uint32_t nStreams = cam.nStreams.load();
+		if (nStreams != cam.nStreamsPrev)
+		{
+			cam.countersPrev.nCompleted = cam.countersPrev.nFailures = cam.countersPrev.nUnderruns = 0;
+			cam.countersPrev.nResent = cam.countersPrev.nMissing = 0;
+			cam.nStreamsPrev = nStreams;
+		}
+		counters.nCompleted = n_completed_buffers;
+		counters.nFailures = n_failures;
+		counters.nUnderruns = n_underruns;
+		counters.nResent = n_resent;
+		counters.nMissing = n_missing;
+		counters.nDropped = cam.nDroppedTotal.load(std::memory_order_relaxed);
+		counters.nSkipped = cam.nSkipped.load(std::memory_order_relaxed);
+		counters.nCoalesced = cam.nCoalesced.load(std::memory_order_relaxed);
+		counters.nPublished = cam.nPublished.load(std::memory_order_relaxed);
+		for (int i=0; i<nBufferStatuses; i++)
+			counters.nStatus[i] = cam.nStatus[i].load(std::memory_order_relaxed);
+		counters.nCompressSubmitted = cam.compress.nSubmitted.load(std::memory_order_relaxed);
+		counters.nCompressDropped = cam.compress.nDropped.load(std::memory_order_relaxed);
+		counters.nbytesCompressed = cam.compress.nbytesOut.load(std::memory_order_relaxed);
+		if (cam.pRecorder)
+		{
+			counters.nRecorded = cam.pRecorder->nRecorded.load(std::memory_order_relaxed);
+			counters.nRecordDropped = cam.pRecorder->nDropped.load(std::memory_order_relaxed);
+			counters.nbytesRecorded = cam.pRecorder->nbytesWritten.load(std::memory_order_relaxed);
+		}
+		else
+			counters.nRecorded = counters.nRecordDropped = counters.nbytesRecorded = 0;
+		counters.nTriggered = cam.trigger.nFired.load(std::memory_order_relaxed);
+		counters.nTriggersSkipped = cam.trigger.nSkipped.load(std::memory_order_relaxed);
+		counters.nShmWritten = cam.nShmWritten.load(std::memory_order_relaxed);
+		counters.nShmTooLarge = cam.nShmTooLarge.load(std::memory_order_relaxed);
+		counters.nRectified = cam.nRectified.load(std::memory_order_relaxed);
+		counters.nRectifySkipped = cam.nRectifySkipped.load(std::memory_order_relaxed);
+		counters.nGated = cam.nGated.load(std::memory_order_relaxed);
+		counters.nbytesGated = cam.nbytesGated.load(std::memory_order_relaxed);
+		counters.nKeepalives = cam.nKeepalives.load(std::memory_order_relaxed);
+		counters.nExposureWrites = cam.nExposureWrites.load(std::memory_order_relaxed);
+		counters.nTensors = cam.nTensors.load(std::memory_order_relaxed);
+
+		status.name = std::string(get_name()) + ": " + cam.stName;
+		status.hardware_id = cam.stGuid;
+		if (cam.bControlLost)
+		{
+			status.level = diagnostic_msgs::msg::DiagnosticStatus::ERROR;
+			status.message = cam.bReconnecting ? "Reconnecting" : "Control lost";
+		}
+		else if (counters.nFailures > cam.countersPrev.nFailures || counters.nDropped > cam.countersPrev.nDropped ||
+			counters.nUnderruns > cam.countersPrev.nUnderruns || counters.nRecordDropped > cam.countersPrev.nRecordDropped)
+		{
+			status.level = diagnostic_msgs::msg::DiagnosticStatus::WARN;
+			status.message = "Frames lost";
+		}
+		else
+		{
+			status.level = diagnostic_msgs::msg::DiagnosticStatus::OK;
+			status.message = cam.pPlayer ? "Replaying" : "Streaming";
+		}
+
+		AddRate(status, "published_hz", counters.nPublished, cam.countersPrev.nPublished, seconds);
+		AddRate(status, "completed_hz", counters.nCompleted, cam.countersPrev.nCompleted, seconds);
+		AddRate(status, "failures_hz", counters.nFailures, cam.countersPrev.nFailures, seconds);
+		AddRate(status, "underruns_hz", counters.nUnderruns, cam.countersPrev.nUnderruns, seconds);
+		AddRate(status, "resent_hz", counters.nResent, cam.countersPrev.nResent, seconds);
+		AddRate(status, "missing_hz", counters.nMissing, cam.countersPrev.nMissing, seconds);
+		AddRate(status, "dropped_hz", counters.nDropped, cam.countersPrev.nDropped, seconds);
+		// Under the policy in "qos": frames nobody subscribed to, and frames passed over for a newer one.
+		AddValue(status, "qos", szQosPolicyName[m_qosPolicy]);
+		AddRate(status, "skipped_hz", counters.nSkipped, cam.countersPrev.nSkipped, seconds);
+		AddRate(status, "coalesced_hz", counters.nCoalesced, cam.countersPrev.nCoalesced, seconds);
+		if (m_dIdleFps > 0.0)
+			AddValue(status, "idle", cam.bIdle ? "true" : "false");
+		for (int i=0; i<nBufferStatuses; i++)
+			AddRate(status, std::string("status_") + szBufferStatusName[i] + "_hz", counters.nStatus[i], cam.countersPrev.nStatus[i], seconds);
+
+		snprintf(sz, sizeof(sz), "%lu", (unsigned long)cam.ring.Size());
+		AddValue(status, "queue_depth", sz);
+		snprintf(sz, sizeof(sz), "%u", cam.framepool.nBuffers());
+		AddValue(status, "pool_buffers", sz);
+		snprintf(sz, sizeof(sz), "%lu", (unsigned long)cam.framepool.nAllocations());
+		AddValue(status, "pool_allocations", sz);
+		if (m_bPoolHugePages)
+		{
+			snprintf(sz, sizeof(sz), "%u", cam.framepool.nHugePageMisses());
+			AddValue(status, "pool_hugepage_misses", sz);
+		}
+		if (m_bIntraProcess)
+		{
+			snprintf(sz, sizeof(sz), "%lu", (unsigned long)cam.framepool.nSpareMisses());
+			AddValue(status, "pool_spare_misses", sz);
+		}
+		if (!stPlacement.empty())
+			AddValue(status, "placement", stPlacement);
+
+		cam.histReceiveToPop.Collect (m_snapshot);
+		AddHistogram(status, "receive_to_pop", m_snapshot);
+		cam.histPopToPublish.Collect (m_snapshot);
+		AddHistogram(status, "pop_to_publish", m_snapshot);
+		cam.histCameraToPublish.Collect (m_snapshot);
+		AddHistogram(status, "camera_to_publish", m_snapshot);
+		if (cam.conversion.kind != CONVERSION_NONE)
+		{
+			cam.histConvert.Collect (m_snapshot);
+			AddHistogram(status, "convert", m_snapshot);
+		}
+		if (cam.compress.IsRunning())
+		{
+			// Size the encoder pool from these: queue depth near compress_queue or drops mean too few threads.
+			AddRate(status, "compress_submitted_hz", counters.nCompressSubmitted, cam.countersPrev.nCompressSubmitted, seconds);
+			AddRate(status, "compress_dropped_hz", counters.nCompressDropped, cam.countersPrev.nCompressDropped, seconds);
+			AddRate(status, "compressed_bytes_per_s", counters.nbytesCompressed, cam.countersPrev.nbytesCompressed, seconds);
+			snprintf(sz, sizeof(sz), "%lu", (unsigned long)cam.compress.Depth());
+			AddValue(status, "compress_queue_depth", sz);
+			snprintf(sz, sizeof(sz), "%lu", (unsigned long)cam.compress.TakeDepthMax());
+			AddValue(status, "compress_queue_depth_max", sz);
+			cam.compress.histEncode.Collect (m_snapshot);
+			AddHistogram(status, "encode", m_snapshot);
+			cam.compress.histSubmitToPublish.Collect (m_snapshot);
+			AddHistogram(status, "compress_submit_to_publish", m_snapshot);
+		}
+		if (cam.pRecorder)
+		{
+			// A rising drop rate means the disk cannot keep up; record_queue_mb only buys time.
+			AddRate(status, "recorded_hz", counters.nRecorded, cam.countersPrev.nRecorded, seconds);
+			AddRate(status, "record_dropped_hz", counters.nRecordDropped, cam.countersPrev.nRecordDropped, seconds);
+			AddRate(status, "record_bytes_per_s", counters.nbytesRecorded, cam.countersPrev.nbytesRecorded, seconds);
+			cam.pRecorder->histWrite.Collect (m_snapshot);
+			AddHistogram(status, "record_write", m_snapshot);
+		}
+
+		if (cam.pubShm)
+		{
+			AddRate(status, "shm_written_hz", counters.nShmWritten, cam.countersPrev.nShmWritten, seconds);
+			AddRate(status, "shm_too_large_hz", counters.nShmTooLarge, cam.countersPrev.nShmTooLarge, seconds);
+			snprintf(sz, sizeof(sz), "%u", cam.shm.nSlots());
+			AddValue(status, "shm_slots", sz);
+			snprintf(sz, sizeof(sz), "%lu", (unsigned long)cam.shm.nbytesSlot());
+			AddValue(status, "shm_slot_bytes", sz);
+			cam.histShmWrite.Collect (m_snapshot);
+			AddHistogram(status, "shm_write", m_snapshot);
+		}
+		if (m_bGate)
+		{
+			// gated_bytes_per_s: what the gated frames would have published, before compression.
+			AddRate(status, "gated_hz", counters.nGated, cam.countersPrev.nGated, seconds);
+			AddRate(status, "gated_bytes_per_s", counters.nbytesGated, cam.countersPrev.nbytesGated, seconds);
+			AddRate(status, "keepalive_hz", counters.nKeepalives, cam.countersPrev.nKeepalives, seconds);
+			cam.histGate.Collect (m_snapshot);
+			AddHistogram(status, "gate", m_snapshot);
+		}
+		if (cam.bExposureControl)
+		{
+			// ae_level: the mean metered level, 8 bits; ae_convergence: from out of the tolerance back in.
+			snprintf(sz, sizeof(sz), "%.1f", cam.exposure.Level());
+			AddValue(status, "ae_level", sz);
+			AddValue(status, "ae_converged", cam.exposure.IsConverged() ? "true" : "false");
+			snprintf(sz, sizeof(sz), "%.1f", cam.exposure.Exposure());
+			AddValue(status, "ae_exposure_us", sz);
+			snprintf(sz, sizeof(sz), "%.2f", cam.exposure.Gain());
+			AddValue(status, "ae_gain", sz);
+			AddRate(status, "ae_writes_hz", counters.nExposureWrites, cam.countersPrev.nExposureWrites, seconds);
+			cam.histMeter.Collect (m_snapshot);
+			AddHistogram(status, "ae_meter", m_snapshot);
+			cam.histExposureWrite.Collect (m_snapshot);
+			AddHistogram(status, "ae_write", m_snapshot);
+			cam.histConvergence.Collect (m_snapshot);
+			AddHistogram(status, "ae_convergence", m_snapshot);
+		}
+		if (cam.pubTensor)
+		{
+			// tensor: converting one frame into its image of the batch.
+			AddRate(status, "tensor_hz", counters.nTensors, cam.countersPrev.nTensors, seconds);
+			cam.histTensor.Collect (m_snapshot);
+			AddHistogram(status, "tensor", m_snapshot);
+		}
+		if (cam.pInfoManager)
+			AddValue(status, "calibrated", cam.pInfoManager->isCalibrated() ? "true" : "false");
+		if (cam.pubRect)
+		{
+			// Skipped frames: subscribed, but uncalibrated, calibrated for another geometry, or Bayer.
+			std::shared_ptr<const RectifyMap> pMap = std::atomic_load (&cam.pRectifyMap);
+
+			AddRate(status, "rectified_hz", counters.nRectified, cam.countersPrev.nRectified, seconds);
+			AddRate(status, "rectify_skipped_hz", counters.nRectifySkipped, cam.countersPrev.nRectifySkipped, seconds);
+			snprintf(sz, sizeof(sz), "%lu", (unsigned long)(pMap ? pMap->nbytes() : 0));
+			AddValue(status, "rectify_map_bytes", sz);
+			cam.histRectify.Collect (m_snapshot);
+			AddHistogram(status, "rectify", m_snapshot);
+		}
+		if (cam.usPacketTimeout)
+		{
+			snprintf(sz, sizeof(sz), "%d", cam.mtu);
+			AddValue(status, "packet_size", sz);
+			snprintf(sz, sizeof(sz), "%ld", (long)cam.nsPacketDelay);
+			AddValue(status, "packet_delay_ns", sz);
+			snprintf(sz, sizeof(sz), "%.1f", cam.bpsShare / 1e6);
+			AddValue(status, "link_share_mbps", sz);
+			snprintf(sz, sizeof(sz), "%lu", (unsigned long)cam.nbytesSocketBuffer);
+			AddValue(status, "socket_buffer_bytes", sz);
+			snprintf(sz, sizeof(sz), "%.1f", cam.usPacketTimeout / 1e3);
+			AddValue(status, "packet_timeout_ms", sz);
+			snprintf(sz, sizeof(sz), "%.1f", cam.usFrameRetention / 1e3);
+			AddValue(status, "frame_retention_ms", sz);
+		}
+		if (cam.trigger.IsRunning())
+		{
+			// Jitter is per camera against the shared schedule, so it also bounds the skew between cameras.
+			AddRate(status, "triggered_hz", counters.nTriggered, cam.countersPrev.nTriggered, seconds);
+			AddRate(status, "triggers_skipped_hz", counters.nTriggersSkipped, cam.countersPrev.nTriggersSkipped, seconds);
+			cam.trigger.histJitter.Collect (m_snapshot);
+			AddHistogram(status, "trigger_jitter", m_snapshot);
+			cam.trigger.histCall.Collect (m_snapshot);
+			AddHistogram(status, "trigger_command", m_snapshot);
+			cam.histTriggerToFrame.Collect (m_snapshot);
+			AddHistogram(status, "trigger_to_frame", m_snapshot);
+		}
+
+		if (cam.pDevice)
+		{
+			static const char *szPhase[nStartupPhases] = {"open", "features", "configure", "print", "stream", "outputs"};
+			for (int i=0; i<nStartupPhases; i++)
+			{
+				snprintf(sz, sizeof(sz), "%.1f", cam.nsStartup[i] / 1e6);
+				AddValue(status, std::string("startup_") + szPhase[i] + "_ms", sz);
+			}
+			AddValue(status, "features", cam.features.IsLoaded() ? "cached" : "probed");
+		}
+		snprintf(sz, sizeof(sz), "%.1f", cam.nsFirstFrame.load() / 1e6);
+		AddValue(status, "first_frame_ms", sz);
+		snprintf(sz, sizeof(sz), "%u", nReconnects);
+		AddValue(status, "reconnects", sz);
+		if (nReconnects)
+		{
+			snprintf(sz, sizeof(sz), "%.1f", cam.nsReconnect.load() / 1e6);
+			AddValue(status, "reconnect_to_first_frame_ms", sz);
+		}
+		uint32_t nReconfigures = cam.nReconfigures.load();
+		snprintf(sz, sizeof(sz), "%u", nReconfigures);
+		AddValue(status, "reconfigures", sz);
+		if (nReconfigures)
+		{
+			snprintf(sz, sizeof(sz), "%.1f", cam.nsReconfigure.load() / 1e6);
+			AddValue(status, "reconfigure_to_first_frame_ms", sz);
+			snprintf(sz, sizeof(sz), "%lu", (unsigned long)cam.nReconfigureLost.load());
+			AddValue(status, "reconfigure_frames_lost", sz);
+			snprintf(sz, sizeof(sz), "%lu", (unsigned long)cam.nReconfigureLostTotal.load());
+			AddValue(status, "reconfigure_frames_lost_total", sz);
+		}
+
+		AddValue(status, "clock_source", cam.bPtpLocked ? "ptp" : (cam.clock.IsLocked() ? "estimated" : "receive_time"));
+		snprintf(sz, sizeof(sz), "%.0f", cam.clock.GetOffsetNs());
+		AddValue(status, "clock_offset_ns", sz);
+		snprintf(sz, sizeof(sz), "%.4f", cam.clock.GetDriftPpm());
+		AddValue(status, "clock_drift_ppm", sz);
+		snprintf(sz, sizeof(sz), "%.3f", cam.clock.GetJitterNs() / 1e3);
+		AddValue(status, "clock_jitter_us", sz);
+		snprintf(sz, sizeof(sz), "%.3f", cam.clock.GetResidualMaxNs() / 1e3);
+		AddValue(status, "clock_residual_max_us", sz);
+
+		cam.countersPrev = counters;
+		msg.status.push_back(status);
+	}
+
+	if (m_sync.IsRunning())
+	{
+		// match_rate: the share of the frames that went out in complete sets.
+		diagnostic_msgs::msg::DiagnosticStatus	status;
+		FrameSync::Counters						counters = m_sync.Read();
+		uint64_t								nPushed = counters.nPushed - m_syncCountersPrev.nPushed;
+		uint64_t								nMatched = (counters.nSets - m_syncCountersPrev.nSets) * m_sync.nCameras();
+		char									sz[32];
+
+		status.name = std::string(get_name()) + ": frame sets";
+		status.hardware_id = "";
+		status.level = counters.nUnmatched > m_syncCountersPrev.nUnmatched || counters.nIncomplete > m_syncCountersPrev.nIncomplete ||
+			counters.nOverflows > m_syncCountersPrev.nOverflows ? diagnostic_msgs::msg::DiagnosticStatus::WARN : diagnostic_msgs::msg::DiagnosticStatus::OK;
+		status.message = status.level == diagnostic_msgs::msg::DiagnosticStatus::OK ? "Matching" : "Unmatched frames";
+		AddRate(status, "sets_hz", counters.nSets, m_syncCountersPrev.nSets, seconds);
+		AddRate(status, "incomplete_hz", counters.nIncomplete, m_syncCountersPrev.nIncomplete, seconds);
+		AddRate(status, "unmatched_hz", counters.nUnmatched, m_syncCountersPrev.nUnmatched, seconds);
+		AddRate(status, "window_full_hz", counters.nOverflows, m_syncCountersPrev.nOverflows, seconds);
+		snprintf(sz, sizeof(sz), "%.3f", nPushed ? (double)nMatched / nPushed : 0.0);
+		AddValue(status, "match_rate", sz);
+		snprintf(sz, sizeof(sz), "%.1f", m_sync.nsTolerance() / 1e3);
+		AddValue(status, "tolerance_us", sz);
+		m_sync.histSkew.Collect (m_snapshot);
+		AddHistogram(status, "skew", m_snapshot);
+		m_sync.histWait.Collect (m_snapshot);
+		AddHistogram(status, "sync_wait", m_snapshot);
+		m_syncCountersPrev = counters;
+		msg.status.push_back(status);
+	}
+
+	m_pubDiagnostics->publish(msg);
+} // PublishDiagnostics()
+
+} // namespace camera_aravis
@@ -0,0 +1,194 @@
+// Copyright 2016 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+
+#include <algorithm>
+#include <mutex>
+#include <string>
+
+#include "camera_aravis/camera_node.h"
+#include "camera_aravis/util.h"
+
+namespace camera_aravis
+{
+
+// Where to meter a frame as acquired, by its lower-cased GenICam pixel format; false for a
+// format it cannot.  Colour is metered on its green or luma, a Bayer mosaic sample by
+// sample, and a GigE Vision packed format on the high byte of every other pixel.
+static bool MeterLayoutFor(const CameraState &cam, MeterLayout &layout)
+{
+	const std::string	&st = cam.stPixelformat;
+	const bool			bMonoBayer = st.compare(0, 4, "mono") == 0 || st.compare(0, 5, "bayer") == 0;
+
+	if (st == "rgb8" || st == "bgr8" || st == "rgb8packed" || st == "bgr8packed")
+		layout = {1, 0, 3, 1, 1};
+	else if (st == "yuv422packed" || st == "yuv422_8_uyvy")
+		layout = {1, 0, 2, 1, 1};
+	else if (st == "yuv422_yuyv_packed" || st == "yuv422_8")
+		layout = {1, 0, 2, 1, 0};
+	else if (bMonoBayer && cam.nBitsPixel == 12 && st.find("packed") != std::string::npos)
+		layout = {1, 0, 3, 2, 0};
+	else if (bMonoBayer && cam.nBitsPixel == 8)
+		layout = {1, 0, 1, 1, 0};
+	else if (bMonoBayer && cam.nBitsPixel == 16)
+		layout = {2, std::max(SignificantBits (st, 16) - 8, 0), 2, 1, 0};
+	else
+		return false;
+	return true;
+}
+
+
+// StartExposureControl()
+// Takes exposure and gain over from the camera: its own auto modes off, and the limits and
+// the values in effect read for the publish thread to start from.  The longest exposure
+// is the frame period, so that the frame rate holds.  Under mutexDevice, or before
+// streaming.
+void CameraNode::StartExposureControl(CameraState &cam)
+{
+	ExposureRange range = {};
+
+	if (!m_bAutoExposure || !cam.pDevice)
+		return;
+	if (!cam.isImplementedExposureTimeAbs)
+	{
+		RCLCPP_WARN ( get_logger(), "%s: No ExposureTimeAbs; no auto exposure.", cam.stGuid.c_str());
+		return;
+	}
+
+	if (cam.isImplementedExposureAuto)
+		arv_device_set_string_feature_value(cam.pDevice, "ExposureAuto", "Off");
+	arv_device_get_float_feature_bounds (cam.pDevice, "ExposureTimeAbs", &range.usMin, &range.usMax);
+	if (cam.fps > 0.0)
+		range.usMax = std::min(range.usMax, 1e6 / cam.fps);
+	if (m_usAeExposureMax > 0.0)
+		range.usMax = std::min(range.usMax, m_usAeExposureMax);
+	range.usExposure = arv_device_get_float_feature_value(cam.pDevice, "ExposureTimeAbs");
+
+	// Gain in dB, as SFNC has it; a GainRaw camera just gets there in more steps.
+	if (cam.isImplementedGain)
+	{
+		if (cam.isImplementedGainAuto)
+			arv_device_set_string_feature_value(cam.pDevice, "GainAuto", "Off");
+		arv_camera_get_gain_bounds (cam.pCamera, &range.gainMin, &range.gainMax);
+		if (m_dAeGainMax >= 0.0)
+			range.gainMax = std::min(range.gainMax, m_dAeGainMax);
+		range.gain = arv_camera_get_gain (cam.pCamera);
+	}
+
+	cam.exposureRange = range;
+	cam.bExposureRestart.store(true, std::memory_order_release);
+	cam.bExposureControl = true;
+	RCLCPP_INFO ( get_logger(), "%s: Auto exposure to level %.0f, %.0f-%.0f us, gain %.1f-%.1f", cam.stGuid.c_str(), m_dAeTarget,
+		range.usMin, range.usMax, range.gainMin, range.gainMax);
+} // StartExposureControl()
+
+
+// MeterExposure()
+// Meters a frame as acquired and, when the level is off, asks ExposureThread() to write
+// the next exposure and gain.  Only one write is asked for at a time; the control loop
+// counts it from when it is done.
+void CameraNode::MeterExposure(CameraState &cam, ArvBuffer *pBuffer)
+{
+	size_t			nbytes = 0;
+	const uint8_t	*pData = (const uint8_t *)arv_buffer_get_data (pBuffer, &nbytes);
+	const size_t	step = ((size_t)cam.widthRoi * cam.nBitsPixel + 7) / 8;
+	MeterLayout		layout;
+	uint32_t		inside[256];
+	uint32_t		outside[256];
+	const bool		bOutside = m_dAeOutsideWeight > 0.0;
+
+	if (!cam.bExposureControl)
+		return;
+	if (cam.bExposureRestart.exchange(false, std::memory_order_acquire))
+		cam.exposure.Reset (cam.exposureRange);
+	int64_t nsWritten = cam.nsExposureWritten.exchange(0, std::memory_order_acquire);
+	if (nsWritten)
+		cam.exposure.Written (cam.usExposureAsked, cam.gainAsked, nsWritten);
+	if (!pData || cam.widthRoi <= 0 || nbytes < step * cam.heightRoi)
+		return;
+	if (!MeterLayoutFor (cam, layout))
+	{
+		RCLCPP_WARN_ONCE ( get_logger(), "%s: Cannot meter %s; no auto exposure.", cam.stName.c_str(), cam.stPixelformat.c_str());
+		return;
+	}
+
+	int64_t nsStart = NowNs();
+	MeterFrame (pData, step, cam.widthRoi, cam.heightRoi, layout, m_nAeStep, m_aeRegion, inside, bOutside ? outside : NULL);
+	bool bConverged = cam.exposure.IsConverged();
+	bool bWrite = cam.exposure.Update (inside, bOutside ? outside : NULL, m_dAeOutsideWeight, nsStart);
+	int64_t nsMetered = NowNs();
+	cam.histMeter.Record (nsMetered - nsStart);
+	if (!bConverged && cam.exposure.IsConverged() && cam.exposure.nsConvergence() > 0)
+		cam.histConvergence.Record (cam.exposure.nsConvergence());
+	if (!bWrite || cam.bExposureBusy.load(std::memory_order_acquire))
+		return;
+
+	cam.bExposureBusy = true;
+	{
+		std::lock_guard<std::mutex> lock(cam.mutexExposure);
+		cam.usExposureAsked = cam.exposure.NextExposure();
+		cam.gainAsked = cam.isImplementedGain ? cam.exposure.NextGain() : cam.exposure.Gain();
+		cam.bExposureAsked = true;
+	}
+	cam.cvExposure.notify_one();
+} // MeterExposure()
+
+
+// ExposureThread()
+// Writes the exposure and gain MeterExposure() asks for.  Each write is a GVCP round trip,
+// or several up to the control timeout when packets are lost, so it is kept off the frame
+// path; a write waits here for the device rather than holding up frames.
+void CameraNode::ExposureThread(CameraState &cam)
+{
+	std::unique_lock<std::mutex> lock(cam.mutexExposure);
+
+	while (TRUE)
+	{
+		cam.cvExposure.wait (lock, [&cam] { return cam.bExposureStop || cam.bExposureAsked; });
+		if (cam.bExposureStop)
+			break;
+
+		double	usExposure = cam.usExposureAsked;
+		double	gain = cam.gainAsked;
+		bool	bWritten = false;
+
+		cam.bExposureAsked = false;
+		lock.unlock();
+		int64_t nsStart = NowNs();
+		{
+			// Not while the device is being replaced.
+			std::lock_guard<std::mutex> lockDevice(cam.mutexDevice);
+			if (cam.pDevice && !cam.bControlLost)
+			{
+				if (usExposure != cam.exposure.Exposure())
+					arv_device_set_float_feature_value(cam.pDevice, "ExposureTimeAbs", usExposure);
+				if (cam.isImplementedGain && gain != cam.exposure.Gain())
+					arv_camera_set_gain (cam.pCamera, gain);
+				bWritten = true;
+			}
+		}
+		int64_t nsEnd = NowNs();
+		if (bWritten)
+		{
+			cam.nExposureWrites++;
+			cam.histExposureWrite.Record (nsEnd - nsStart);
+			cam.nsExposureWritten.store(nsEnd, std::memory_order_release);
+		}
+		cam.bExposureBusy.store(false, std::memory_order_release);
+		lock.lock();
+	}
+} // ExposureThread()
+
+} // namespace camera_aravis
@@ -0,0 +1,101 @@
+// Copyright 2016 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+
+#include <memory>
+#include <string>
+
+#include "camera_aravis/camera_node.h"
+#include "camera_aravis/util.h"
+
+namespace camera_aravis
+{
+
+// CreateGate()
+void CameraNode::CreateGate(CameraState &cam, const std::string &stTopic, bool bPublishTiles)
+{
+	if (!m_bGate)
+		return;
+
+	if (bPublishTiles)
+		cam.pubTiles = create_publisher<camera_aravis::msg::ChangedTiles>(stTopic + "/changed_tiles", ImageQoS());
+	RCLCPP_INFO ( get_logger(), "%s: Publishing frames that differ by over %.1f levels in %d of the %dx%d tiles%s", cam.stName.c_str(),
+		m_dGateThreshold, m_nGateTiles, m_nGateTileSize, m_nGateTileSize, m_nsGateKeepalive ? ", and a keepalive" : "");
+	if (cam.pubTiles)
+		RCLCPP_INFO ( get_logger(), "%s: Changed tiles on %s", cam.stName.c_str(), cam.pubTiles->get_topic_name());
+} // CreateGate()
+
+
+// GateFrame()
+// Whether to publish this frame: compared as acquired, before any conversion, with the
+// last frame that got through.  Frames that do not are counted with what they would
+// have published.  Packed formats are compared byte by byte, which is coarser but still
+// sees a change.
+bool CameraNode::GateFrame(CameraState &cam, ArvBuffer *pBuffer, int64_t nsStamp)
+{
+	size_t			nbytes = 0;
+	const uint8_t	*pData = (const uint8_t *)arv_buffer_get_data (pBuffer, &nbytes);
+	const size_t	step = ((size_t)cam.widthRoi * cam.nBitsPixel + 7) / 8;
+
+	if (!pData || cam.widthRoi <= 0 || nbytes < step * cam.heightRoi)
+		return true;
+
+	int64_t		nsStart = NowNs();
+	int			nBits = SignificantBits (cam.stPixelformat, 8);
+	int			nbytesSample = nBits > 8 && cam.nBitsPixel % 16 == 0 ? 2 : 1;
+	int			nSamples = (int)(step / nbytesSample);
+	int			nShift = nbytesSample == 2 ? nBits - 8 : 0;
+
+	cam.gate.Configure (nSamples, cam.heightRoi, nbytesSample, nShift, (int)((int64_t)m_nGateTileSize * nSamples / cam.widthRoi),
+		m_nGateTileSize, m_nGateRowStep);
+
+	bool bChanged = cam.gate.Compare (pData, step, m_dGateThreshold) >= m_nGateTiles;
+	bool bKeepalive = !bChanged && m_nsGateKeepalive && nsStart - cam.nsGatePassed >= m_nsGateKeepalive;
+	cam.histGate.Record (NowNs() - nsStart);
+
+	if (!bChanged && !bKeepalive)
+	{
+		size_t nbytesOut = cam.conversion.kind != CONVERSION_NONE ? cam.conversion.DstStep(cam.widthRoi) * cam.heightRoi : step * cam.heightRoi;
+
+		cam.nGated++;
+		cam.nbytesGated += nbytesOut;
+		return false;
+	}
+
+	cam.gate.Accept();
+	cam.nsGatePassed = nsStart;
+	if (bKeepalive)
+		cam.nKeepalives++;
+
+	if (cam.pubTiles && cam.pubTiles->get_subscription_count() + cam.pubTiles->get_intra_process_subscription_count() > 0)
+	{
+		std::unique_ptr<camera_aravis::msg::ChangedTiles> pMsg (new camera_aravis::msg::ChangedTiles);
+
+		pMsg->header.stamp.sec = (int32_t)(nsStamp / 1000000000LL);
+		pMsg->header.stamp.nanosec = (uint32_t)(nsStamp % 1000000000LL);
+		pMsg->header.frame_id = cam.stFrameId;
+		pMsg->tile_width = m_nGateTileSize;
+		pMsg->tile_height = m_nGateTileSize;
+		pMsg->tiles_x = cam.gate.nTilesX();
+		pMsg->tiles_y = cam.gate.nTilesY();
+		pMsg->tiles = cam.gate.ChangedTiles();
+		pMsg->difference_max = (float)cam.gate.DifferenceMax();
+		pMsg->keepalive = bKeepalive;
+		cam.pubTiles->publish(std::move(pMsg));
+	}
+	return true;
+} // GateFrame()
+
+} // namespace camera_aravis
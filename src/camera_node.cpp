@@ -0,0 +1,2117 @@
+// Copyright 2016 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "camera_aravis/camera_node.h"
+#include "camera_aravis/util.h"
+
+#include <dirent.h>
+#include <sys/mman.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "rclcpp_components/register_node_macro.hpp"
+
+using namespace std::chrono_literals;
+
+#define ARV_PIXEL_FORMAT_BIT_PER_PIXEL(pixel_format)  (((pixel_format) >> 16) & 0xff)
+#define ARV_PIXEL_FORMAT_BYTE_PER_PIXEL(pixel_format) ((((pixel_format) >> 16) & 0xff) >> 3)
+
+namespace camera_aravis
+{
+
+// Conversions from integers to Arv types.
+static const char	*szBufferStatusFromInt[] = {
+										"ARV_BUFFER_STATUS_SUCCESS",
+										"ARV_BUFFER_STATUS_CLEARED",
+										"ARV_BUFFER_STATUS_TIMEOUT",
+										"ARV_BUFFER_STATUS_MISSING_PACKETS",
+										"ARV_BUFFER_STATUS_WRONG_PACKET_ID",
+										"ARV_BUFFER_STATUS_SIZE_MISMATCH",
+										"ARV_BUFFER_STATUS_FILLING",
+										"ARV_BUFFER_STATUS_ABORTED"
+										};
+
+// Messages each pool keeps ready to replace the frames handed off intra-process: one being
+// taken while the next is made.
+static const unsigned nPoolSpares = 2;
+
+// IsImplemented()
+// True if the device has the named feature and it is implemented.
+static int IsImplemented (ArvDevice *pDevice, const char *szFeature)
+{
+	GError		*error = NULL;
+	ArvGcNode	*pGcNode = arv_device_get_feature (pDevice, szFeature);
+
+	return ARV_GC_FEATURE_NODE (pGcNode) ? arv_gc_feature_node_is_implemented (ARV_GC_FEATURE_NODE (pGcNode), &error) : FALSE;
+}
+
+// A string feature, or "" if the device does not have it.
+static std::string FeatureString (ArvDevice *pDevice, const char *szFeature)
+{
+	const char	*psz = arv_device_get_string_feature_value (pDevice, szFeature);
+
+	return psz ? psz : "";
+}
+
+CameraState::CameraState()
+	: pNode(NULL),
+	  iCamera(0),
+	  isImplementedAcquisitionFrameRate(0),
+	  isImplementedAcquisitionFrameRateEnable(0),
+	  isImplementedGain(0),
+	  isImplementedExposureTimeAbs(0),
+	  isImplementedExposureAuto(0),
+	  isImplementedGainAuto(0),
+	  isImplementedFocusPos(0),
+	  isImplementedTriggerSelector(0),
+	  isImplementedTriggerSource(0),
+	  isImplementedTriggerMode(0),
+	  isImplementedAcquisitionMode(0),
+	  isImplementedMtu(0),
+	  isImplementedPtp(0),
+	  isImplementedBinning(0),
+	  xRoi(0), yRoi(0),
+	  widthRoi(0), widthRoiMin(0), widthRoiMax(0),
+	  heightRoi(0), heightRoiMin(0), heightRoiMax(0),
+	  widthSensor(0), heightSensor(0),
+	  dxBinning(1), dyBinning(1),
+	  pixelformat(0),
+	  nBytesPixel(0),
+	  nBitsPixel(0),
+	  pyramidSource(PYRAMID_NONE),
+	  nShmWritten(0),
+	  nShmTooLarge(0),
+	  windowCalibration(),
+	  nRectified(0),
+	  nRectifySkipped(0),
+	  nsGatePassed(0),
+	  nGated(0),
+	  nbytesGated(0),
+	  nKeepalives(0),
+	  exposureRange(),
+	  bExposureRestart(false),
+	  bExposureControl(false),
+	  nExposureWrites(0),
+	  bExposureStop(false),
+	  bExposureAsked(false),
+	  usExposureAsked(0.0),
+	  gainAsked(0.0),
+	  bExposureBusy(false),
+	  nsExposureWritten(0),
+	  nTensors(0),
+	  pCamera(NULL),
+	  pDevice(NULL),
+	  pStream(NULL),
+	  mtu(0),
+	  keyAcquisitionFrameRate(NULL),
+	  keyPtpEnable(NULL),
+	  keyPtpStatus(NULL),
+	  nsPacketDelay(0),
+	  bpsShare(0.0),
+	  nbytesSocketBuffer(0),
+	  usPacketTimeout(0),
+	  usFrameRetention(0),
+	  nResentPrev(0),
+	  nMissingPrev(0),
+	  nTransportQuietPeriods(0),
+	  bPtpLocked(false),
+	  nBuffers(0),
+	  nAllocationsPrev(0),
+	  iFrame(0),
+	  bRun(false),
+	  iNumaNode(-1),
+	  fps(0.0),
+	  bIdle(false),
+	  nsUnsubscribed(0),
+	  bControlLost(false),
+	  bReconnecting(false),
+	  bReconnectStop(false),
+	  nsControlLost(0),
+	  nReconnects(0),
+	  nStreams(0),
+	  nStreamsPrev(0),
+	  nsAwaitFirstFrame(0),
+	  nsFirstFrame(0),
+	  nsReconnect(0),
+	  nReconfigures(0),
+	  nsReconfigureStop(0),
+	  nReconfigureDiscarded(0),
+	  nsReconfigure(0),
+	  nReconfigureLost(0),
+	  nReconfigureLostTotal(0),
+	  nDropped(0),
+	  nDroppedTotal(0),
+	  nSkipped(0),
+	  nCoalesced(0),
+	  nsQueueWait(0),
+	  nsPublish(0),
+	  nsPublishMax(0),
+	  depthMax(0),
+	  nPublished(0),
+	  countersPrev(),
+	  nPoolBaseline(0),
+	  nUnderrunsPrev(0),
+	  nPoolQuietPeriods(0)
+{
+	sem_init(&semRing, 0, 0);
+	for (int i=0; i<nBufferStatuses; i++)
+		nStatus[i] = 0;
+	for (int i=0; i<nStartupPhases; i++)
+		nsStartup[i] = 0;
+}
+
+CameraState::~CameraState()
+{
+	sem_destroy(&semRing);
+}
+
+
+const char *szQosPolicyName[nQosPolicies] = {"reliable", "best_effort", "latest"};
+
+static void AtomicMax (std::atomic<uint64_t> &value, uint64_t sample)
+{
+	uint64_t prev = value.load(std::memory_order_relaxed);
+
+	while (prev < sample && !value.compare_exchange_weak(prev, sample, std::memory_order_relaxed))
+		;
+}
+
+// The recordings to replay: stDir itself, or each recording directly below it, by name.
+static std::vector<std::string> FindRecordings (const std::string &stDir)
+{
+	std::vector<std::string>	dirs;
+	DIR						   *pDir;
+	struct dirent			   *pEntry;
+
+	if (FramePlayer::IsRecording(stDir))
+		return std::vector<std::string>(1, stDir);
+
+	pDir = opendir(stDir.c_str());
+	if (!pDir)
+		return dirs;
+	while ((pEntry = readdir(pDir)) != NULL)
+	{
+		std::string stPath = stDir + "/" + pEntry->d_name;
+		if (pEntry->d_name[0] != '.' && FramePlayer::IsRecording(stPath))
+			dirs.push_back(stPath);
+	}
+	closedir(pDir);
+	std::sort(dirs.begin(), dirs.end());
+
+	return dirs;
+}
+
+
+CameraNode::CameraNode(const rclcpp::NodeOptions &options)
+	: rclcpp::Node("camera", options),
+	  m_bIntraProcess(options.use_intra_process_comms()),
+	  m_bUseGlibLoop(false),
+	  m_nsDiagnosticsPrev(0),
+	  m_bReconnect(true),
+	  m_msRetryMin(500),
+	  m_msRetryMax(30000),
+	  m_nPacketSize(-1),
+	  m_dLinkMbps(0.0),
+	  m_dSocketBufferFrames(0.0),
+	  m_usPacketTimeout(40000),
+	  m_usFrameRetention(200000),
+	  m_bTransportAdaptive(false),
+	  m_bConvert(false),
+	  m_bConvertBgr(false),
+	  m_nConvertThreads(0),
+	  m_nJpegQuality(90),
+	  m_nCompressThreads(2),
+	  m_nCompressQueue(8),
+	  m_bGate(false),
+	  m_dGateThreshold(4.0),
+	  m_nGateTiles(1),
+	  m_nGateTileSize(64),
+	  m_nGateRowStep(4),
+	  m_nsGateKeepalive(0),
+	  m_bAutoExposure(false),
+	  m_dAeTarget(100.0),
+	  m_dAeTolerance(8.0),
+	  m_aeRegion(),
+	  m_dAeOutsideWeight(0.0),
+	  m_nAeStep(4),
+	  m_usAeExposureMax(0.0),
+	  m_dAeGainMax(-1.0),
+	  m_bTensor(false),
+	  m_tensorSpec(),
+	  m_nTensorBatch(1),
+	  m_syncCountersPrev(),
+	  m_dTriggerRate(0.0),
+	  m_nTriggerPriority(0),
+	  m_nsTriggerSpin(0),
+	  m_dReplayRate(1.0),
+	  m_bReplayLoop(false),
+	  m_pMainLoop(NULL)
+{
+	int			 nInterfaces = 0;
+	int			 nDevices = 0;
+	int 		 i = 0;
+
+	// Get the camera guid as a parameter, e.g. "Basler-21237813".  Empty means the first camera found.
+	std::string stGuid = declare_parameter<std::string>("guid", "");
+
+	// Or drive several cameras from this one process: a list of guids, or {"all"} for every camera found.
+	std::vector<std::string> guids = declare_parameter<std::vector<std::string>>("guids", std::vector<std::string>());
+
+	// Frame delivery: acquisition thread + ring (default), or the old new-buffer signal + GMainLoop.
+	m_bUseGlibLoop = declare_parameter<bool>("use_glib_loop", false);
+	int nQueueDepth = declare_parameter<int>("queue_depth", 8);
+
+	// Image QoS: "reliable" (the default) or "best_effort", keeping qos_depth frames per
+	// subscriber, or "latest": best effort, depth 1, publishing only the newest frame waiting.
+	// While nobody subscribes, frames are released unpublished, and after idle_after_s the
+	// camera slows to idle_fps, if set.
+	std::string stQos = declare_parameter<std::string>("qos", "reliable");
+	m_qosPolicy = QOS_RELIABLE;
+	for (int i=0; i<nQosPolicies; i++)
+		if (stQos == szQosPolicyName[i])
+			m_qosPolicy = (QosPolicy)i;
+	if (stQos != szQosPolicyName[m_qosPolicy])
+		RCLCPP_WARN ( get_logger(), "Unknown qos \"%s\"; using reliable.", stQos.c_str());
+	m_nQosDepth = std::max(1, (int)declare_parameter<int>("qos_depth", 10));
+	m_dIdleFps = declare_parameter<double>("idle_fps", 0.0);
+	m_nsIdleAfter = (int64_t)(declare_parameter<double>("idle_after_s", 5.0) * 1e9);
+
+	// Camera settings at startup, e.g. from yaml/roi.yaml, and live whenever they are set; 0 or
+	// empty keeps the camera's own, as does a negative exposure, gain or focus.
+	m_config.x = declare_parameter<int>("roi.x", 0);
+	m_config.y = declare_parameter<int>("roi.y", 0);
+	m_config.width = declare_parameter<int>("roi.width", 0);
+	m_config.height = declare_parameter<int>("roi.height", 0);
+	m_config.dxBinning = declare_parameter<int>("binning.horizontal", 0);
+	m_config.dyBinning = declare_parameter<int>("binning.vertical", 0);
+	m_config.stPixelformat = declare_parameter<std::string>("pixel_format", "");
+	m_config.fps = declare_parameter<double>("frame_rate", 0.0);
+	m_config.usExposure = declare_parameter<double>("exposure_time", -1.0);
+	m_config.gain = declare_parameter<double>("gain", -1.0);
+	m_config.focus = declare_parameter<int>("focus_pos", -1);
+
+	// Which features each camera model implements, saved here across starts; empty to probe every time.
+	const char *pszCacheHome = getenv("XDG_CACHE_HOME");
+	const char *pszHome = getenv("HOME");
+	std::string stCacheDefault = pszCacheHome ? std::string(pszCacheHome) + "/camera_aravis" :
+	                             pszHome ? std::string(pszHome) + "/.cache/camera_aravis" : "";
+	m_stFeatureCacheDir = declare_parameter<std::string>("feature_cache_dir", stCacheDefault);
+
+	// After control loss, reopen the camera in place, waiting retry_min_ms, doubling up to retry_max_ms
+	// between attempts.  The same waits apply to opening it at startup.
+	m_bReconnect = declare_parameter<bool>("reconnect", true);
+	m_msRetryMin = std::max(10, (int)declare_parameter<int>("retry_min_ms", 500));
+	m_msRetryMax = std::max(m_msRetryMin, (int)declare_parameter<int>("retry_max_ms", 30000));
+
+	// GigE Vision transport: packet size (0 = the largest that gets through, jumbo frames
+	// included; -1 = the camera's), inter-packet delay from a bandwidth budget per host
+	// interface, socket buffer in frames, and the resend timeouts, adapted to the missing
+	// packets if transport_adaptive.
+	m_nPacketSize = declare_parameter<int>("packet_size", -1);
+	m_dLinkMbps = declare_parameter<double>("link_bandwidth_mbps", 0.0);
+	m_dSocketBufferFrames = declare_parameter<double>("socket_buffer_frames", 0.0);
+	m_usPacketTimeout = (unsigned)std::max(1, (int)declare_parameter<int>("packet_timeout_ms", 40)) * 1000;
+	m_usFrameRetention = (unsigned)std::max(1, (int)declare_parameter<int>("frame_retention_ms", 200)) * 1000;
+	m_bTransportAdaptive = declare_parameter<bool>("transport_adaptive", false);
+
+	// Software trigger: every camera is triggered at trigger_rate Hz, all at the same instants,
+	// each from a thread of its own that sleeps to absolute deadlines, under SCHED_FIFO if
+	// trigger_priority is set, busy-waiting the last trigger_spin_us.  0 lets the cameras run free.
+	m_dTriggerRate = declare_parameter<double>("trigger_rate", 0.0);
+	m_nTriggerPriority = declare_parameter<int>("trigger_priority", 0);
+	m_nsTriggerSpin = (int64_t)declare_parameter<int>("trigger_spin_us", 0) * 1000;
+
+	// Stream buffer pool: sized to hold pool_latency_ms of frames, within [pool_min, pool_max]
+	// buffers and pool_max_mb of memory, then adapted to the measured underruns.
+	m_msPoolLatency = declare_parameter<double>("pool_latency_ms", 500.0);
+	m_nPoolMin = declare_parameter<int>("pool_min", 4);
+	m_nPoolMax = declare_parameter<int>("pool_max", 256);
+	m_nbytesPoolMax = (size_t)declare_parameter<int>("pool_max_mb", 1024) << 20;
+	m_bPoolAdaptive = declare_parameter<bool>("pool_adaptive", true);
+	m_bPoolHugePages = declare_parameter<bool>("pool_hugepages", false);
+	m_bPoolLock = declare_parameter<bool>("pool_mlock", false);
+
+	// Timestamps: header.stamp is camera time mapped onto the host clock, or PTP time when available.
+	std::string stFrameId = declare_parameter<std::string>("frame_id", "");
+	m_bPtp = declare_parameter<bool>("ptp", false);
+	m_nsPtpOffset = declare_parameter<int64_t>("ptp_offset_ns", 0);
+	int nClockWindow = declare_parameter<int>("clock_window", 64);
+	int nClockBlock = declare_parameter<int>("clock_block", 32);
+
+	// Pixel conversion: publish Bayer as rgb8/bgr8 and 10/12 bit mono as mono16, instead of the raw frames.
+	m_bConvert = declare_parameter<bool>("convert", false);
+	m_bConvertBgr = declare_parameter<std::string>("convert_color", "rgb8") == "bgr8";
+	m_nConvertThreads = declare_parameter<int>("convert_threads", 0);
+
+	// Thread placement.  cpu_receive, cpu_acquire and cpu_publish list one core per camera, for
+	// Aravis' stream receive thread, the acquisition thread and the publish thread; cpu_convert
+	// the cores every conversion worker may use.  rt_priority_receive and rt_priority put them
+	// under SCHED_FIFO.  Buffers go on the NUMA node of the receive core, and "mlockall" locks
+	// every page of the process.  What each thread actually got is logged and in the diagnostics.
+	m_cpuReceive = declare_parameter<std::vector<int64_t>>("cpu_receive", std::vector<int64_t>());
+	m_cpuAcquire = declare_parameter<std::vector<int64_t>>("cpu_acquire", std::vector<int64_t>());
+	m_cpuPublish = declare_parameter<std::vector<int64_t>>("cpu_publish", std::vector<int64_t>());
+	for (int64_t iCpu : declare_parameter<std::vector<int64_t>>("cpu_convert", std::vector<int64_t>()))
+		m_cpusConvert.push_back((int)iCpu);
+	m_nPriorityReceive = declare_parameter<int>("rt_priority_receive", 0);
+	m_nPriority = declare_parameter<int>("rt_priority", 0);
+	m_bNumaBuffers = declare_parameter<bool>("numa_local_buffers", true);
+	if (declare_parameter<bool>("mlockall", false))
+	{
+		if (mlockall (MCL_CURRENT | MCL_FUTURE) == 0)
+			RCLCPP_INFO ( get_logger(), "Locked all current and future pages in memory.");
+		else
+			RCLCPP_WARN ( get_logger(), "mlockall refused: %s%s", strerror(errno), errno == ENOMEM || errno == EPERM ? " (raise RLIMIT_MEMLOCK)" : "");
+	}
+
+	// Downsampled copies on image/half, image/quarter, ..., computed only while subscribed.
+	int nPyramidLevels = declare_parameter<int>("pyramid_levels", 0);
+
+	// Compressed output, encoded here on a pool of threads, in capture order: "jpeg" on
+	// image/compressed, "qoi" (lossless) on image/qoi.
+	std::vector<std::string> codecs = declare_parameter<std::vector<std::string>>("compressed", std::vector<std::string>());
+	m_nJpegQuality = declare_parameter<int>("jpeg_quality", 90);
+	m_nCompressThreads = declare_parameter<int>("compress_threads", 2);
+	m_nCompressQueue = declare_parameter<int>("compress_queue", 8);
+
+	// For consumers in other processes on this host: each frame is copied once into a ring of
+	// shm_slots frames in shared memory, and only a descriptor goes out on "<image>/shm".
+	m_nShmSlots = declare_parameter<int>("shm_slots", 0);
+
+	// "gate" publishes a frame only when it differs from the last one published: when at least
+	// gate_tiles tiles of gate_tile_size pixels differ by more than gate_threshold levels on
+	// average, over every gate_row_step-th row; otherwise only at gate_keepalive_hz.
+	// gate_publish_tiles lists the changed tiles on "<image>/changed_tiles".
+	m_bGate = declare_parameter<bool>("gate", false);
+	m_dGateThreshold = declare_parameter<double>("gate_threshold", 4.0);
+	m_nGateTiles = declare_parameter<int>("gate_tiles", 1);
+	m_nGateTileSize = declare_parameter<int>("gate_tile_size", 64);
+	m_nGateRowStep = declare_parameter<int>("gate_row_step", 4);
+	double dGateKeepalive = declare_parameter<double>("gate_keepalive_hz", 1.0);
+	m_nsGateKeepalive = dGateKeepalive > 0.0 ? (int64_t)(1e9 / dGateKeepalive) : 0;
+	bool bGateTiles = declare_parameter<bool>("gate_publish_tiles", false);
+
+	// "auto_exposure" meters every ae_step-th pixel of every ae_step-th row and sets exposure,
+	// then gain, for a mean level of ae_target +- ae_tolerance (8 bits), at most ae_max_rate_hz
+	// and ae_settle_frames frames apart.  ae_region [x, y, width, height] as fractions of the
+	// frame is what counts; the rest counts ae_outside_weight as much.  The exposure goes up
+	// to ae_exposure_max_us (0: the frame period), the gain up to ae_gain_max (< 0: the camera's).
+	// exposure_time and gain are only where it starts.
+	m_bAutoExposure = declare_parameter<bool>("auto_exposure", false);
+	m_dAeTarget = declare_parameter<double>("ae_target", 100.0);
+	m_dAeTolerance = declare_parameter<double>("ae_tolerance", 8.0);
+	std::vector<double> aeRegion = declare_parameter<std::vector<double>>("ae_region", std::vector<double>({0.0, 0.0, 1.0, 1.0}));
+	if (aeRegion.size() == 4)
+		m_aeRegion = {aeRegion[0], aeRegion[1], aeRegion[2], aeRegion[3]};
+	else
+	{
+		RCLCPP_WARN ( get_logger(), "ae_region needs [x, y, width, height]; metering the whole frame.");
+		m_aeRegion = {0.0, 0.0, 1.0, 1.0};
+	}
+	m_dAeOutsideWeight = declare_parameter<double>("ae_outside_weight", 0.0);
+	m_nAeStep = std::max(1, (int)declare_parameter<int>("ae_step", 4));
+	double dAeMaxRate = declare_parameter<double>("ae_max_rate_hz", 4.0);
+	int nAeSettleFrames = declare_parameter<int>("ae_settle_frames", 2);
+	m_usAeExposureMax = declare_parameter<double>("ae_exposure_max_us", 0.0);
+	m_dAeGainMax = declare_parameter<double>("ae_gain_max", -1.0);
+
+	// "tensor" also publishes each frame on "<image>/tensor" as an NCHW tensor for inference:
+	// tensor_crop [x, y, width, height] of the frame as acquired (empty: all of it), resized to
+	// tensor_width x tensor_height (0: the crop's size; a Bayer quad is one pixel), in
+	// tensor_channels (1, 3, or 0: as the frame), rgb or with tensor_bgr bgr, and as float32 or
+	// with tensor_fp16 half precision.  Samples scaled to [0, 1] become (value - tensor_mean) /
+	// tensor_std, of one channel or each.  tensor_batch frames go in each message; with "sync",
+	// the frame sets go out as batches on frame_set/tensor too.
+	m_bTensor = declare_parameter<bool>("tensor", false);
+	m_tensorSpec.width = std::max(0, (int)declare_parameter<int>("tensor_width", 0));
+	m_tensorSpec.height = std::max(0, (int)declare_parameter<int>("tensor_height", 0));
+	std::vector<int64_t> tensorCrop = declare_parameter<std::vector<int64_t>>("tensor_crop", std::vector<int64_t>());
+	m_tensorSpec.nChannels = declare_parameter<int>("tensor_channels", 0);
+	m_tensorSpec.bBgr = declare_parameter<bool>("tensor_bgr", false);
+	m_tensorSpec.bHalf = declare_parameter<bool>("tensor_fp16", false);
+	std::vector<double> tensorMean = declare_parameter<std::vector<double>>("tensor_mean", std::vector<double>({0.0}));
+	std::vector<double> tensorStd = declare_parameter<std::vector<double>>("tensor_std", std::vector<double>({1.0}));
+	m_nTensorBatch = std::max(1, (int)declare_parameter<int>("tensor_batch", 1));
+	if (tensorCrop.size() == 4)
+	{
+		m_tensorSpec.xCrop = (int)tensorCrop[0];
+		m_tensorSpec.yCrop = (int)tensorCrop[1];
+		m_tensorSpec.widthCrop = (int)tensorCrop[2];
+		m_tensorSpec.heightCrop = (int)tensorCrop[3];
+	}
+	else if (!tensorCrop.empty())
+		RCLCPP_WARN ( get_logger(), "tensor_crop is [x, y, width, height]; using the whole frame.");
+	for (int iChannel=0; iChannel<3; iChannel++)
+	{
+		double mean = tensorMean.size() == 3 ? tensorMean[iChannel] : (tensorMean.empty() ? 0.0 : tensorMean[0]);
+		double std = tensorStd.size() == 3 ? tensorStd[iChannel] : (tensorStd.empty() ? 1.0 : tensorStd[0]);
+
+		m_tensorSpec.mean[iChannel] = (float)mean;
+		m_tensorSpec.std[iChannel] = std != 0.0 ? (float)std : 1.0f;
+	}
+
+	// With several cameras, "sync" also publishes their frames in sets on frame_set, one frame
+	// of each camera with stamps within sync_tolerance_us (0: half a frame period).  A frame
+	// waits up to sync_timeout_ms for the others, in a window of sync_window frames per camera;
+	// then it goes out in an incomplete set with sync_incomplete, or is dropped.
+	bool bSync = declare_parameter<bool>("sync", false);
+	double usSyncTolerance = declare_parameter<double>("sync_tolerance_us", 0.0);
+	double msSyncTimeout = declare_parameter<double>("sync_timeout_ms", 100.0);
+	int nSyncWindow = declare_parameter<int>("sync_window", 4);
+	bool bSyncIncomplete = declare_parameter<bool>("sync_incomplete", false);
+
+	// camera_info with each frame, calibrated from camera_info_url ("${NAME}" is the camera's
+	// name; empty: ~/.ros/camera_info/<name>.yaml) and updated by set_camera_info.  "rectify"
+	// adds the image undistorted and rectified on image_rect, while subscribed.
+	std::string stCameraInfoUrl = declare_parameter<std::string>("camera_info_url", "");
+	bool bRectify = declare_parameter<bool>("rectify", false);
+
+	// Raw recording of each camera's frames into "<record>/<name>", as acquired.
+	std::string stRecord = declare_parameter<std::string>("record", "");
+	size_t nbytesRecordSegment = (size_t)declare_parameter<int>("record_segment_mb", 1024) << 20;
+	size_t nbytesRecordQueue = (size_t)declare_parameter<int>("record_queue_mb", 256) << 20;
+	bool bRecordDirect = declare_parameter<bool>("record_direct", true);
+
+	// Or play back such recordings instead of opening cameras: one, or a directory of them.
+	std::string stReplay = declare_parameter<std::string>("replay", "");
+	m_dReplayRate = declare_parameter<double>("replay_rate", 1.0);
+	m_bReplayLoop = declare_parameter<bool>("replay_loop", false);
+
+	if (!stReplay.empty())
+	{
+		guids = FindRecordings (stReplay);
+		if (guids.empty())
+			throw std::runtime_error("No recordings in " + stReplay);
+		if (!stRecord.empty())
+			RCLCPP_WARN ( get_logger(), "Not recording while replaying.");
+	}
+	else
+	{
+		// Print out some useful info.
+		RCLCPP_INFO ( get_logger(), "Attached cameras:");
+		arv_update_device_list();
+		nInterfaces = arv_get_n_interfaces();
+		RCLCPP_INFO ( get_logger(), "# Interfaces: %d", nInterfaces);
+
+		nDevices = arv_get_n_devices();
+		RCLCPP_INFO ( get_logger(), "# Devices: %d", nDevices);
+		for (i=0; i<nDevices; i++)
+			RCLCPP_INFO ( get_logger(), "Device%d: %s", i, arv_get_device_id(i));
+
+		if (nDevices<=0)
+			throw std::runtime_error("No cameras detected.");
+
+		if (guids.size() == 1 && guids[0] == "all")
+		{
+			guids.clear();
+			for (i=0; i<nDevices; i++)
+				guids.push_back(arv_get_device_id(i));
+		}
+		if (guids.empty())
+			guids.push_back(stGuid);
+	}
+
+	// One state, stream, pool and pair of threads per camera.
+	for (i=0; i<(int)guids.size(); i++)
+	{
+		m_cameras.emplace_back(new CameraState);
+		CameraState &cam = *m_cameras.back();
+
+		cam.pNode = this;
+		cam.iCamera = i;
+		cam.ring.Resize(nQueueDepth);
+		ChoosePlacement (cam, (int)guids.size());
+		if (!stReplay.empty())
+		{
+			if (!OpenReplay (cam, guids[i]))
+				throw std::runtime_error("Could not replay " + guids[i]);
+		}
+		else
+		{
+			int64_t nsPhase = NowNs();
+			OpenCamera (cam, guids[i].empty() ? NULL : guids[i].c_str());
+			cam.nsStartup[STARTUP_OPEN] = NowNs() - nsPhase;
+
+			nsPhase = NowNs();
+			DetectFeatures (cam);
+			cam.nsStartup[STARTUP_CONFIGURE] = NowNs() - nsPhase - cam.nsStartup[STARTUP_FEATURES];
+			if (!m_stFeatureCacheDir.empty())
+			{
+				std::string stError;
+				if (!cam.features.Save (stError))
+					RCLCPP_WARN ( get_logger(), "%s: Could not save the feature cache: %s", cam.stGuid.c_str(), stError.c_str());
+			}
+
+			nsPhase = NowNs();
+			PrintConfiguration (cam);
+			cam.nsStartup[STARTUP_PRINT] = NowNs() - nsPhase;
+
+			nsPhase = NowNs();
+			int msBackoff = m_msRetryMin;
+			while (TRUE)
+			{
+				cam.pStream = CreateStream (cam);
+				if (cam.pStream)
+					break;
+				else
+				{
+					RCLCPP_WARN( get_logger(), "Could not create image stream for %s.  Retrying in %d ms...", cam.stGuid.c_str(), msBackoff);
+					SleepBackoff (cam, msBackoff);
+				}
+			}
+			cam.nsStartup[STARTUP_STREAM] = NowNs() - nsPhase;
+		}
+		int64_t nsOutputs = NowNs();
+
+		// A single camera keeps the plain "image" topic; several get one namespace each.
+		cam.stName = CameraName (cam.stGuid);
+		cam.stFrameId = stFrameId.empty() ? cam.stName : (guids.size() == 1 ? stFrameId : stFrameId + "/" + cam.stName);
+		cam.clock.Configure (nClockWindow, nClockBlock);
+		std::string stTopic = guids.size() == 1 ? "image" : cam.stName + "/image";
+		cam.publisher = create_publisher<sensor_msgs::msg::Image>(stTopic, ImageQoS());
+		RCLCPP_INFO ( get_logger(), "Publishing %s on %s as %s", cam.stGuid.c_str(), cam.publisher->get_topic_name(), cam.stEncoding.c_str());
+		CreatePyramid (cam, stTopic, nPyramidLevels);
+		CreateCompression (cam, stTopic, codecs);
+		CreateShm (cam, stTopic);
+		CreateCalibration (cam, stTopic, stCameraInfoUrl, bRectify);
+		CreateGate (cam, stTopic, bGateTiles);
+		CreateTensor (cam, stTopic);
+		cam.exposure.Configure (m_dAeTarget, m_dAeTolerance, nAeSettleFrames, dAeMaxRate > 0.0 ? (int64_t)(1e9 / dAeMaxRate) : 0);
+
+		if (!stRecord.empty() && stReplay.empty())
+		{
+			std::string stError;
+			std::string stDir = stRecord + "/" + cam.stName;
+
+			cam.pRecorder.reset (new FrameRecorder);
+			if (cam.pRecorder->Open (stDir, cam.stGuid, arv_device_get_string_feature_value(cam.pDevice, "PixelFormat"),
+					nbytesRecordSegment, nbytesRecordQueue, bRecordDirect, stError))
+				RCLCPP_INFO ( get_logger(), "%s: Recording to %s%s", cam.stGuid.c_str(), stDir.c_str(), cam.pRecorder->IsDirect() ? " (O_DIRECT)" : "");
+			else
+			{
+				RCLCPP_ERROR ( get_logger(), "%s: Not recording: %s", cam.stGuid.c_str(), stError.c_str());
+				cam.pRecorder.reset();
+			}
+		}
+
+		if (cam.conversion.kind != CONVERSION_NONE || !cam.pyramid.empty() || cam.pubRect || cam.pubTensor)
+		{
+			int nThreads = ConvertThreads ((int)guids.size());
+			cam.stripes.Start (nThreads);
+			RCLCPP_INFO ( get_logger(), "%s: Converting on %d threads", cam.stGuid.c_str(), nThreads);
+		}
+		cam.nsStartup[STARTUP_OUTPUTS] = NowNs() - nsOutputs;
+
+		if (cam.pDevice)
+		{
+			int64_t nsTotal = 0;
+			for (int iPhase=0; iPhase<nStartupPhases; iPhase++)
+				nsTotal += cam.nsStartup[iPhase];
+			RCLCPP_INFO ( get_logger(), "%s: Startup %.0f ms: open %.0f, features %.0f (%s), configure %.0f, print %.0f, stream %.0f, outputs %.0f",
+				cam.stGuid.c_str(), nsTotal / 1e6, cam.nsStartup[STARTUP_OPEN] / 1e6, cam.nsStartup[STARTUP_FEATURES] / 1e6,
+				cam.features.IsLoaded() ? "cached" : "probed", cam.nsStartup[STARTUP_CONFIGURE] / 1e6, cam.nsStartup[STARTUP_PRINT] / 1e6,
+				cam.nsStartup[STARTUP_STREAM] / 1e6, cam.nsStartup[STARTUP_OUTPUTS] / 1e6);
+		}
+	}
+
+	m_timerPeriodic = create_wall_timer (1s, std::bind (&CameraNode::PeriodicTask_callback, this));
+
+	// Stream counters as rates, buffer status breakdown and latency histograms, once per report.
+	if (declare_parameter<bool>("diagnostics", true))
+		m_pubDiagnostics = create_publisher<diagnostic_msgs::msg::DiagnosticArray>("diagnostics", rclcpp::QoS(10));
+	m_nsDiagnosticsPrev = NowNs();
+
+	if (m_bUseGlibLoop)
+	{
+		m_pMainLoop = g_main_loop_new (NULL, FALSE);
+		m_threadMainLoop = std::thread (g_main_loop_run, m_pMainLoop);
+	}
+	if (bSync)
+		StartSync (usSyncTolerance, msSyncTimeout, nSyncWindow, bSyncIncomplete);
+	SharePacketDelays();
+	for (auto &pCam : m_cameras)
+		StartAcquisition (*pCam);
+	if (m_dTriggerRate > 0.0)
+		StartTriggers();
+
+	// From here on, setting the region, binning, pixel format or controls applies them at once.
+	m_hParameters = add_on_set_parameters_callback (std::bind (&CameraNode::Parameters_callback, this, std::placeholders::_1));
+} // CameraNode()
+
+
+CameraNode::~CameraNode()
+{
+	// Frames waiting for their set go back to the cameras' pools while there still are pools.
+	m_sync.Stop();
+	for (auto &pCam : m_cameras)
+		StopAcquisition (*pCam);
+
+	if (m_pMainLoop)
+	{
+		g_main_loop_quit (m_pMainLoop);
+		m_threadMainLoop.join();
+		g_main_loop_unref (m_pMainLoop);
+		m_pMainLoop = NULL;
+	}
+}
+
+
+// CameraName()
+// A topic-safe name for a camera guid, e.g. "Basler-21237813" -> "Basler_21237813".
+std::string CameraNode::CameraName(const std::string &stGuid)
+{
+	std::string stName = stGuid;
+
+	for (char &c : stName)
+		if (!g_ascii_isalnum(c))
+			c = '_';
+	if (stName.empty() || g_ascii_isdigit(stName[0]))
+		stName = "camera_" + stName;
+
+	return stName;
+}
+
+
+// ConvertThreads()
+// Share the cores between the cameras: by default each one converts on its own pair plus any spares.
+int CameraNode::ConvertThreads(int nCameras)
+{
+	if (m_nConvertThreads > 0)
+		return m_nConvertThreads;
+	return std::max(1, std::min(4, (int)std::thread::hardware_concurrency() / nCameras - 1));
+}
+
+
+// OpenCamera()
+// Open the camera, retrying until it shows up.
+bool CameraNode::OpenCamera(CameraState &cam, const char *pszGuid)
+{
+	int	msBackoff = m_msRetryMin;
+
+	RCLCPP_INFO( get_logger(), "Opening: %s", pszGuid ? pszGuid : "(any)");
+	while (1)
+	{
+		cam.pCamera = arv_camera_new(pszGuid);
+		if (cam.pCamera)
+			break;
+		else
+		{
+			RCLCPP_WARN ( get_logger(), "Could not open camera %s.  Retrying in %d ms...", pszGuid ? pszGuid : "(any)", msBackoff);
+			SleepBackoff (cam, msBackoff);
+		}
+	}
+
+	cam.pDevice = arv_camera_get_device(cam.pCamera);
+	cam.stVendor = FeatureString (cam.pDevice, "DeviceVendorName");
+	cam.stModel = FeatureString (cam.pDevice, "DeviceModelName");
+	cam.stFirmware = FeatureString (cam.pDevice, "DeviceFirmwareVersion");
+	if (cam.stFirmware.empty())
+		cam.stFirmware = FeatureString (cam.pDevice, "DeviceVersion");
+	cam.stGuid = cam.stVendor + "-" + FeatureString (cam.pDevice, "DeviceID");
+	cam.stOpenId = pszGuid ? pszGuid : cam.stGuid;
+	RCLCPP_INFO( get_logger(), "Opend: %s", cam.stGuid.c_str());
+
+	// The XML is already downloaded by now; it only tells whether the cached entry still applies.
+	if (!m_stFeatureCacheDir.empty())
+	{
+		size_t		 nbytesXml = 0;
+		const char	*pXml = arv_device_get_genicam_xml (cam.pDevice, &nbytesXml);
+		std::string	 stKey = FeatureCache::Key (cam.stVendor, cam.stModel, cam.stFirmware);
+
+		if (cam.features.Load (m_stFeatureCacheDir, stKey, pXml, pXml ? nbytesXml : 0))
+			RCLCPP_INFO( get_logger(), "%s: Features from %s", cam.stGuid.c_str(), cam.features.Path().c_str());
+	}
+
+	return true;
+} // OpenCamera()
+
+
+// DetectFeatures()
+// See if some basic camera features exist, and read the current geometry.
+void CameraNode::DetectFeatures(CameraState &cam)
+{
+	const char	*pkeyAcquisitionFrameRate[2] = {"AcquisitionFrameRate", "AcquisitionFrameRateAbs"};
+
+	int64_t nsProbe = NowNs();
+	cam.isImplementedAcquisitionMode = ProbeFeature (cam, "AcquisitionMode");
+	cam.isImplementedGain = ProbeFeature (cam, "GainRaw");
+	cam.isImplementedGain |= ProbeFeature (cam, "Gain");
+	cam.isImplementedExposureTimeAbs = ProbeFeature (cam, "ExposureTimeAbs");
+	cam.isImplementedExposureAuto = ProbeFeature (cam, "ExposureAuto");
+	cam.isImplementedGainAuto = ProbeFeature (cam, "GainAuto");
+	cam.isImplementedTriggerSelector = ProbeFeature (cam, "TriggerSelector");
+	cam.isImplementedTriggerSource = ProbeFeature (cam, "TriggerSource");
+	cam.isImplementedTriggerMode = ProbeFeature (cam, "TriggerMode");
+	cam.isImplementedFocusPos = ProbeFeature (cam, "FocusPos");
+	cam.isImplementedMtu = ProbeFeature (cam, "GevSCPSPacketSize");
+	cam.isImplementedAcquisitionFrameRateEnable = ProbeFeature (cam, "AcquisitionFrameRateEnable");
+	cam.isImplementedBinning = ProbeFeature (cam, "BinningHorizontal");
+
+	// PTP (IEEE 1588): SFNC names first, then the older GigE Vision ones.
+	if (ProbeFeature (cam, "PtpEnable"))
+	{
+		cam.keyPtpEnable = "PtpEnable";
+		cam.keyPtpStatus = "PtpStatus";
+	}
+	else if (ProbeFeature (cam, "GevIEEE1588"))
+	{
+		cam.keyPtpEnable = "GevIEEE1588";
+		cam.keyPtpStatus = "GevIEEE1588Status";
+	}
+	cam.isImplementedPtp = cam.keyPtpEnable != NULL;
+	if (cam.isImplementedPtp && m_bPtp)
+		arv_device_set_boolean_feature_value (cam.pDevice, cam.keyPtpEnable, TRUE);
+
+	// Find the key name for framerate.
+	cam.keyAcquisitionFrameRate = NULL;
+	for (int i=0; i<2; i++)
+	{
+		cam.isImplementedAcquisitionFrameRate = ProbeFeature (cam, pkeyAcquisitionFrameRate[i]);
+		if (cam.isImplementedAcquisitionFrameRate)
+		{
+			cam.keyAcquisitionFrameRate = pkeyAcquisitionFrameRate[i];
+			break;
+		}
+	}
+
+	cam.widthSensor = (int)ProbeInteger (cam, "SensorWidth");
+	cam.heightSensor = (int)ProbeInteger (cam, "SensorHeight");
+	cam.nsStartup[STARTUP_FEATURES] = NowNs() - nsProbe;
+
+	if (cam.isImplementedAcquisitionFrameRateEnable)
+		arv_device_set_integer_feature_value(cam.pDevice, "AcquisitionFrameRateEnable", 1);
+
+	// Set up the triggering.
+	if (cam.isImplementedTriggerSelector && cam.isImplementedTriggerMode)
+	{
+		arv_device_set_string_feature_value(cam.pDevice, "TriggerSelector", "AcquisitionStart");
+		arv_device_set_string_feature_value(cam.pDevice, "TriggerMode", "Off");
+		arv_device_set_string_feature_value(cam.pDevice, "TriggerSelector", "FrameStart");
+		arv_device_set_string_feature_value(cam.pDevice, "TriggerMode", "Off");
+		if (m_dTriggerRate > 0.0 && cam.isImplementedTriggerSource)
+		{
+			arv_device_set_string_feature_value(cam.pDevice, "TriggerSource", "Software");
+			arv_device_set_string_feature_value(cam.pDevice, "TriggerMode", "On");
+		}
+	}
+	if (m_dTriggerRate > 0.0 && !(cam.isImplementedTriggerSelector && cam.isImplementedTriggerMode && cam.isImplementedTriggerSource))
+		RCLCPP_WARN ( get_logger(), "%s: No software trigger; the camera runs free.", cam.stGuid.c_str());
+
+	// Apply the configured settings, and see what the camera made of them.
+	ApplyFormat (cam, m_config);
+	ApplyControls (cam, m_config);
+	ReadFormat (cam);
+	ConfigurePacketSize (cam);
+
+	// What a reconnect puts back.
+	if (cam.isImplementedTriggerMode)
+		cam.stTriggerMode = FeatureString (cam.pDevice, "TriggerMode");
+	if (cam.isImplementedTriggerSource)
+		cam.stTriggerSource = FeatureString (cam.pDevice, "TriggerSource");
+} // DetectFeatures()
+
+
+// RestoreConfiguration()
+// Put a reopened camera back the way it was: binning, pixel format, region, frame rate,
+// the configured controls, packet size and delay, trigger and PTP.  The implemented features are already known, from before or from the cache.
+void CameraNode::RestoreConfiguration(CameraState &cam)
+{
+	gint	x = 0, y = 0, width = 0, height = 0;
+
+	if (cam.isImplementedPtp && m_bPtp)
+		arv_device_set_boolean_feature_value (cam.pDevice, cam.keyPtpEnable, TRUE);
+	if (cam.isImplementedAcquisitionFrameRateEnable)
+		arv_device_set_integer_feature_value(cam.pDevice, "AcquisitionFrameRateEnable", 1);
+
+	if (cam.isImplementedBinning)
+		arv_camera_set_binning (cam.pCamera, cam.dxBinning, cam.dyBinning);
+	arv_device_set_integer_feature_value(cam.pDevice, "PixelFormat", cam.pixelformat);
+	arv_camera_set_region (cam.pCamera, cam.xRoi, cam.yRoi, cam.widthRoi, cam.heightRoi);
+	if (cam.fps > 0.0)
+		arv_device_set_float_feature_value(cam.pDevice, cam.keyAcquisitionFrameRate, cam.fps);
+	cam.bIdle = false;
+	ApplyControls (cam, m_config);
+	if (cam.isImplementedMtu && cam.mtu > 0)
+		arv_device_set_integer_feature_value(cam.pDevice, "GevSCPSPacketSize", cam.mtu);
+	if (cam.nsPacketDelay > 0)
+		arv_camera_gv_set_packet_delay (cam.pCamera, cam.nsPacketDelay);
+
+	if (cam.isImplementedTriggerSelector && cam.isImplementedTriggerMode)
+	{
+		arv_device_set_string_feature_value(cam.pDevice, "TriggerSelector", "AcquisitionStart");
+		arv_device_set_string_feature_value(cam.pDevice, "TriggerMode", "Off");
+		arv_device_set_string_feature_value(cam.pDevice, "TriggerSelector", "FrameStart");
+		if (cam.isImplementedTriggerSource && !cam.stTriggerSource.empty())
+			arv_device_set_string_feature_value(cam.pDevice, "TriggerSource", cam.stTriggerSource.c_str());
+		if (!cam.stTriggerMode.empty())
+			arv_device_set_string_feature_value(cam.pDevice, "TriggerMode", cam.stTriggerMode.c_str());
+	}
+
+	// The publishers and the pool assume the old geometry; say so if the camera would not take it.
+	arv_camera_get_region (cam.pCamera, &x, &y, &width, &height);
+	if (x != cam.xRoi || y != cam.yRoi || width != cam.widthRoi || height != cam.heightRoi ||
+		(guint32)arv_device_get_integer_feature_value(cam.pDevice, "PixelFormat") != cam.pixelformat)
+		RCLCPP_ERROR ( get_logger(), "%s: Could not restore the region %d,%d %dx%d and pixel format %s; got %d,%d %dx%d",
+			cam.stGuid.c_str(), cam.xRoi, cam.yRoi, cam.widthRoi, cam.heightRoi, cam.stPixelformat.c_str(), x, y, width, height);
+} // RestoreConfiguration()
+
+
+// ReadFormat()
+// The geometry and pixel format the camera ended up with, and the encoding and
+// conversion that follow from them.
+void CameraNode::ReadFormat(CameraState &cam)
+{
+	cam.xRoi=0; cam.yRoi=0; cam.widthRoi=0; cam.heightRoi=0;
+	arv_camera_get_region (cam.pCamera, &cam.xRoi, &cam.yRoi, &cam.widthRoi, &cam.heightRoi);
+	if (cam.isImplementedBinning)
+		arv_camera_get_binning (cam.pCamera, &cam.dxBinning, &cam.dyBinning);
+	cam.stPixelformat = arv_device_get_string_feature_value(cam.pDevice, "PixelFormat");
+	for (char &c : cam.stPixelformat)
+		c = g_ascii_tolower(c);
+	cam.pixelformat = (guint32)arv_device_get_integer_feature_value(cam.pDevice, "PixelFormat");
+	cam.nBytesPixel = ARV_PIXEL_FORMAT_BYTE_PER_PIXEL(cam.pixelformat);
+	cam.nBitsPixel = ARV_PIXEL_FORMAT_BIT_PER_PIXEL(cam.pixelformat);
+	ChooseConversion (cam, cam.pixelformat);
+	cam.fps = cam.keyAcquisitionFrameRate ? arv_device_get_float_feature_value(cam.pDevice, cam.keyAcquisitionFrameRate) : 0.0;
+} // ReadFormat()
+
+
+// ProbeFeature()
+// Whether the camera implements szFeature: from the feature cache when it has the
+// answer, otherwise asked of the device, which can cost a register read or more.
+int CameraNode::ProbeFeature(CameraState &cam, const char *szFeature)
+{
+	std::string	stName = std::string("implemented.") + szFeature;
+	int64_t		value;
+
+	if (!cam.features.Lookup (stName, value))
+	{
+		value = IsImplemented (cam.pDevice, szFeature);
+		cam.features.Store (stName, value);
+	}
+	return (int)value;
+}
+
+// ProbeInteger()
+// An integer feature that is fixed for the model, such as the sensor size; 0 if not implemented.
+int64_t CameraNode::ProbeInteger(CameraState &cam, const char *szFeature)
+{
+	std::string	stName = std::string("value.") + szFeature;
+	int64_t		value;
+
+	if (!cam.features.Lookup (stName, value))
+	{
+		value = ProbeFeature (cam, szFeature) ? arv_device_get_integer_feature_value (cam.pDevice, szFeature) : 0;
+		cam.features.Store (stName, value);
+	}
+	return value;
+}
+
+
+// OpenReplay()
+// Stand in for a camera with the recording in stDir: its guid, geometry and pixel format
+// come from the recording, and a pool without a stream holds the frames read back.
+bool CameraNode::OpenReplay(CameraState &cam, const std::string &stDir)
+{
+	std::string	stError;
+
+	cam.pPlayer.reset (new FramePlayer);
+	if (!cam.pPlayer->Open (stDir, stError))
+	{
+		RCLCPP_ERROR ( get_logger(), "%s: %s", stDir.c_str(), stError.c_str());
+		cam.pPlayer.reset();
+		return false;
+	}
+
+	const RecordingEntry &entry = cam.pPlayer->Entry(0);
+	cam.stGuid = cam.pPlayer->Guid();
+	cam.stPixelformat = cam.pPlayer->Pixelformat();
+	for (char &c : cam.stPixelformat)
+		c = g_ascii_tolower(c);
+	cam.pixelformat = entry.pixelformat;
+	cam.xRoi = 0;
+	cam.yRoi = 0;
+	cam.widthRoi = cam.widthSensor = (int)entry.width;
+	cam.heightRoi = cam.heightSensor = (int)entry.height;
+	cam.nBytesPixel = ARV_PIXEL_FORMAT_BYTE_PER_PIXEL(cam.pixelformat);
+	cam.nBitsPixel = ARV_PIXEL_FORMAT_BIT_PER_PIXEL(cam.pixelformat);
+	ChooseConversion (cam, cam.pixelformat);
+
+	cam.nPoolBaseline = PoolSizeFor (cam, entry.nbytes);
+	cam.framepool.SetMemoryOptions (m_bPoolHugePages, m_bPoolLock);
+	cam.framepool.Create (NULL, entry.nbytes, cam.nPoolBaseline);
+	if (m_bIntraProcess)
+		cam.framepool.KeepSpares (nPoolSpares);
+
+	RCLCPP_INFO ( get_logger(), "Replaying %zu frames of %s (%dx%d %s) from %s", cam.pPlayer->nFrames(), cam.stGuid.c_str(),
+		cam.widthRoi, cam.heightRoi, cam.pPlayer->Pixelformat().c_str(), stDir.c_str());
+
+	return true;
+} // OpenReplay()
+
+
+// ChooseConversion()
+// The ROS encoding for a GenICam pixel format, and how to get there when "convert" is set.
+// Formats without a ROS equivalent keep their lower-cased GenICam name.
+void CameraNode::ChooseConversion(CameraState &cam, guint32 pixelformat)
+{
+	PixelConversion	&conv = cam.conversion;
+
+	conv = PixelConversion();
+	conv.bBgr = m_bConvertBgr;
+	conv.nBitsIn = cam.nBitsPixel;
+	cam.stEncoding = cam.stPixelformat;
+
+	switch (pixelformat)
+	{
+	case ARV_PIXEL_FORMAT_MONO_8:			cam.stEncoding = "mono8";	break;
+	case ARV_PIXEL_FORMAT_MONO_16:			cam.stEncoding = "mono16";	break;
+	case ARV_PIXEL_FORMAT_RGB_8_PACKED:		cam.stEncoding = "rgb8";	break;
+	case ARV_PIXEL_FORMAT_BGR_8_PACKED:		cam.stEncoding = "bgr8";	break;
+	case ARV_PIXEL_FORMAT_YUV_422_PACKED:	cam.stEncoding = "yuv422";	break;
+
+	case ARV_PIXEL_FORMAT_BAYER_RG_8:		cam.stEncoding = "bayer_rggb8";	conv.kind = CONVERSION_BAYER8;	conv.pattern = BAYER_RG;	break;
+	case ARV_PIXEL_FORMAT_BAYER_BG_8:		cam.stEncoding = "bayer_bggr8";	conv.kind = CONVERSION_BAYER8;	conv.pattern = BAYER_BG;	break;
+	case ARV_PIXEL_FORMAT_BAYER_GR_8:		cam.stEncoding = "bayer_grbg8";	conv.kind = CONVERSION_BAYER8;	conv.pattern = BAYER_GR;	break;
+	case ARV_PIXEL_FORMAT_BAYER_GB_8:		cam.stEncoding = "bayer_gbrg8";	conv.kind = CONVERSION_BAYER8;	conv.pattern = BAYER_GB;	break;
+
+	case ARV_PIXEL_FORMAT_BAYER_RG_10:
+	case ARV_PIXEL_FORMAT_BAYER_RG_12:
+	case ARV_PIXEL_FORMAT_BAYER_RG_16:		conv.kind = CONVERSION_BAYER16;	conv.pattern = BAYER_RG;	break;
+	case ARV_PIXEL_FORMAT_BAYER_BG_10:
+	case ARV_PIXEL_FORMAT_BAYER_BG_12:
+	case ARV_PIXEL_FORMAT_BAYER_BG_16:		conv.kind = CONVERSION_BAYER16;	conv.pattern = BAYER_BG;	break;
+	case ARV_PIXEL_FORMAT_BAYER_GR_10:
+	case ARV_PIXEL_FORMAT_BAYER_GR_12:
+	case ARV_PIXEL_FORMAT_BAYER_GR_16:		conv.kind = CONVERSION_BAYER16;	conv.pattern = BAYER_GR;	break;
+	case ARV_PIXEL_FORMAT_BAYER_GB_10:
+	case ARV_PIXEL_FORMAT_BAYER_GB_12:
+	case ARV_PIXEL_FORMAT_BAYER_GB_16:		conv.kind = CONVERSION_BAYER16;	conv.pattern = BAYER_GB;	break;
+
+	case ARV_PIXEL_FORMAT_MONO_10:
+	case ARV_PIXEL_FORMAT_MONO_12:			conv.kind = CONVERSION_MONO16;	break;
+	case ARV_PIXEL_FORMAT_MONO_10_PACKED:	conv.kind = CONVERSION_MONO10_PACKED;	conv.nBitsIn = 10;	break;
+	case ARV_PIXEL_FORMAT_MONO_12_PACKED:	conv.kind = CONVERSION_MONO12_PACKED;	conv.nBitsIn = 12;	break;
+	default:
+		break;
+	}
+
+	// The 16 bit Bayer formats hold their significant bits at the bottom of each word.
+	if (conv.kind == CONVERSION_BAYER16)
+	{
+		switch (pixelformat)
+		{
+		case ARV_PIXEL_FORMAT_BAYER_RG_10: case ARV_PIXEL_FORMAT_BAYER_BG_10:
+		case ARV_PIXEL_FORMAT_BAYER_GR_10: case ARV_PIXEL_FORMAT_BAYER_GB_10:	conv.nBitsIn = 10;	break;
+		case ARV_PIXEL_FORMAT_BAYER_RG_12: case ARV_PIXEL_FORMAT_BAYER_BG_12:
+		case ARV_PIXEL_FORMAT_BAYER_GR_12: case ARV_PIXEL_FORMAT_BAYER_GB_12:	conv.nBitsIn = 12;	break;
+		default:																conv.nBitsIn = 16;	break;
+		}
+	}
+	else if (conv.kind == CONVERSION_MONO16)
+		conv.nBitsIn = pixelformat == ARV_PIXEL_FORMAT_MONO_10 ? 10 : 12;
+
+	if (!m_bConvert)
+		conv.kind = CONVERSION_NONE;
+	if (conv.kind != CONVERSION_NONE)
+		cam.stEncoding = conv.Encoding();
+} // ChooseConversion()
+
+
+void CameraNode::PrintConfiguration(CameraState &cam)
+{
+	RCLCPP_INFO ( get_logger(), "    Using Camera Configuration:");
+	RCLCPP_INFO ( get_logger(), "    ---------------------------");
+	RCLCPP_INFO ( get_logger(), "    Vendor name          = %s", cam.stVendor.c_str());
+	RCLCPP_INFO ( get_logger(), "    Model name           = %s", cam.stModel.c_str());
+	RCLCPP_INFO ( get_logger(), "    Firmware             = %s", cam.stFirmware.c_str());
+	RCLCPP_INFO ( get_logger(), "    Device id            = %s", cam.stGuid.c_str());
+	RCLCPP_INFO ( get_logger(), "    Sensor width         = %d", cam.widthSensor);
+	RCLCPP_INFO ( get_logger(), "    Sensor height        = %d", cam.heightSensor);
+	RCLCPP_INFO ( get_logger(), "    ROI x,y,w,h          = %d, %d, %d, %d", cam.xRoi, cam.yRoi, cam.widthRoi, cam.heightRoi);
+	RCLCPP_INFO ( get_logger(), "    Pixel format         = %s", cam.stPixelformat.c_str());
+	RCLCPP_INFO ( get_logger(), "    BytesPerPixel        = %d", cam.nBytesPixel);
+	RCLCPP_INFO ( get_logger(), "    Published encoding   = %s", cam.stEncoding.c_str());
+	RCLCPP_INFO ( get_logger(), "    Acquisition Mode     = %s", cam.isImplementedAcquisitionMode ? arv_device_get_string_feature_value (cam.pDevice, "AcquisitionMode") : "(not implemented in camera)");
+	RCLCPP_INFO ( get_logger(), "    Trigger Mode         = %s", cam.isImplementedTriggerMode ? arv_device_get_string_feature_value (cam.pDevice, "TriggerMode") : "(not implemented in camera)");
+	RCLCPP_INFO ( get_logger(), "    Trigger Source       = %s", cam.isImplementedTriggerSource ? arv_device_get_string_feature_value(cam.pDevice, "TriggerSource") : "(not implemented in camera)");
+	RCLCPP_INFO ( get_logger(), "    Can set FrameRate:     %s", cam.isImplementedAcquisitionFrameRate ? "True" : "False");
+	RCLCPP_INFO ( get_logger(), "    Can set Exposure:      %s", cam.isImplementedExposureTimeAbs ? "True" : "False");
+	if (cam.isImplementedExposureTimeAbs)
+		RCLCPP_INFO ( get_logger(), "    Can set ExposureAuto:  %s", cam.isImplementedExposureAuto ? "True" : "False");
+	RCLCPP_INFO ( get_logger(), "    Can set Gain:          %s", cam.isImplementedGain ? "True" : "False");
+	if (cam.isImplementedGain)
+		RCLCPP_INFO ( get_logger(), "    Can set GainAuto:      %s", cam.isImplementedGainAuto ? "True" : "False");
+	RCLCPP_INFO ( get_logger(), "    Can set FocusPos:      %s", cam.isImplementedFocusPos ? "True" : "False");
+	RCLCPP_INFO ( get_logger(), "    PTP:                   %s", cam.isImplementedPtp ? (m_bPtp ? "Enabled" : "Disabled") : "(not implemented in camera)");
+	if (cam.isImplementedMtu)
+		RCLCPP_INFO ( get_logger(), "    Network mtu          = %lu", (unsigned long)arv_device_get_integer_feature_value(cam.pDevice, "GevSCPSPacketSize"));
+	RCLCPP_INFO ( get_logger(), "    ---------------------------");
+} // PrintConfiguration()
+
+
+ArvGvStream *CameraNode::CreateStream(CameraState &cam, bool bKeepPool)
+{
+	// Aravis starts the receive thread here; tell it apart from those of the other cameras.
+	std::vector<pid_t> tidsBefore = ReceiveThreads();
+	ArvGvStream *pStream = (ArvGvStream *)arv_device_create_stream (cam.pDevice, NULL, NULL);
+	if (pStream)
+	{
+		PlaceReceiveThread (cam, tidsBefore);
+		gint 		 nbytesPayload = arv_camera_get_payload (cam.pCamera);
+
+		// The GigE Vision transport settings; other streams (e.g. the fake camera's) have none.
+		if (!ARV_IS_GV_STREAM (pStream))
+			RCLCPP_WARN ( get_logger(), "Stream is not a GV_STREAM");
+		else
+			ConfigureStreamTransport (cam, pStream, nbytesPayload);
+
+		// Load up some buffers.  Each one is the data of a preallocated image message.
+		// On reconnect the messages from before carry over, if the frames are the same size.
+		if (bKeepPool && (size_t)nbytesPayload == cam.framepool.nbytesPayload())
+		{
+			cam.framepool.Rebind ((ArvStream *)pStream);
+			RCLCPP_INFO ( get_logger(), "%s: Buffer pool kept, %u x %d bytes", cam.stGuid.c_str(), cam.framepool.nBuffers(), nbytesPayload);
+			return pStream;
+		}
+		cam.nPoolBaseline = PoolSizeFor (cam, nbytesPayload);
+		cam.framepool.SetMemoryOptions (m_bPoolHugePages, m_bPoolLock, cam.iNumaNode);
+		cam.framepool.Create ((ArvStream *)pStream, nbytesPayload, cam.nPoolBaseline);
+		if (m_bIntraProcess)
+			cam.framepool.KeepSpares (nPoolSpares);	// Frames handed off whole are replaced from these.
+		RCLCPP_INFO ( get_logger(), "%s: Buffer pool = %u x %d bytes", cam.stGuid.c_str(), cam.nPoolBaseline, nbytesPayload);
+		if (cam.framepool.nLockFailures())
+			RCLCPP_WARN ( get_logger(), "%s: Could not mlock %u buffers; raise RLIMIT_MEMLOCK.", cam.stGuid.c_str(), cam.framepool.nLockFailures());
+		if (cam.framepool.nNumaFailures())
+			RCLCPP_WARN ( get_logger(), "%s: Could not move %u buffers to NUMA node %d.", cam.stGuid.c_str(), cam.framepool.nNumaFailures(), cam.iNumaNode);
+		if (cam.framepool.nHugePageMisses())
+			RCLCPP_WARN ( get_logger(), "%s: No huge pages for %u buffers; see /sys/kernel/mm/transparent_hugepage.", cam.stGuid.c_str(), cam.framepool.nHugePageMisses());
+	}
+	return pStream;
+} // CreateStream()
+
+
+// PoolSizeFor()
+// Enough buffers to cover the latency budget at the camera's frame rate, plus the ring.
+unsigned CameraNode::PoolSizeFor(CameraState &cam, size_t nbytesPayload)
+{
+	double		fps = 30.0;
+	unsigned	nBuffers;
+	unsigned	nBuffersMemory;
+
+	if (cam.isImplementedAcquisitionFrameRate)
+		fps = arv_device_get_float_feature_value (cam.pDevice, cam.keyAcquisitionFrameRate);
+
+	nBuffers = (unsigned)ceil(fps * m_msPoolLatency / 1000.0) + cam.ring.Capacity();
+	nBuffersMemory = nbytesPayload ? (unsigned)(m_nbytesPoolMax / nbytesPayload) : nBuffers;
+
+	nBuffers = std::min(nBuffers, nBuffersMemory);
+	nBuffers = std::min(nBuffers, (unsigned)m_nPoolMax);
+	nBuffers = std::max(nBuffers, (unsigned)m_nPoolMin);
+
+	return nBuffers;
+} // PoolSizeFor()
+
+
+// AdaptPool()
+// Grow the pool quickly on underruns, and shrink it slowly back toward the baseline when
+// the stream has had spare buffers for a while.
+void CameraNode::AdaptPool(CameraState &cam)
+{
+	const int	nQuietPeriodsToShrink = 10;
+	guint64		n_completed_buffers;
+	guint64		n_failures;
+	guint64		n_underruns;
+	gint		nInput = 0;
+	gint		nOutput = 0;
+	unsigned	nBuffers = cam.framepool.nBuffers();
+	unsigned	nBuffersMemory = (unsigned)(m_nbytesPoolMax / std::max<size_t>(cam.framepool.nbytesPayload(), 1));
+	unsigned	nBuffersMax = std::min((unsigned)m_nPoolMax, std::max(nBuffersMemory, (unsigned)m_nPoolMin));
+
+	if (!cam.pStream)
+		return;	// Replay: the player waits for free buffers instead.
+
+	arv_stream_get_statistics ((ArvStream *)cam.pStream, &n_completed_buffers, &n_failures, &n_underruns);
+	arv_stream_get_n_buffers ((ArvStream *)cam.pStream, &nInput, &nOutput);
+
+	if (m_bPoolAdaptive)
+	{
+		if (n_underruns > cam.nUnderrunsPrev)
+		{
+			unsigned nTarget = std::min(nBuffersMax, nBuffers + std::max(2u, nBuffers/4));
+			if (nTarget > nBuffers)
+			{
+				cam.framepool.Resize (nTarget);
+				RCLCPP_INFO ( get_logger(), "%s: %lu underruns; buffer pool grown to %u", cam.stName.c_str(), (unsigned long)(n_underruns - cam.nUnderrunsPrev), nTarget);
+			}
+			cam.nPoolQuietPeriods = 0;
+		}
+		else if (++cam.nPoolQuietPeriods >= nQuietPeriodsToShrink && nBuffers > cam.nPoolBaseline && (unsigned)nInput > nBuffers*3/4)
+		{
+			unsigned nTarget = std::max(cam.nPoolBaseline, nBuffers - std::max(1u, nBuffers/8));
+			cam.framepool.Resize (nTarget);
+			cam.nPoolQuietPeriods = 0;
+		}
+	}
+	cam.nUnderrunsPrev = n_underruns;
+
+	RCLCPP_INFO ( get_logger(), "%s: Pool = %u buffers (%d in stream, %d in output queue, %d in use), Completed = %lu, Failures = %lu, Underruns = %lu",
+		cam.stName.c_str(), nBuffers, nInput, nOutput, std::max(0, (int)nBuffers - nInput - nOutput),
+		(unsigned long)n_completed_buffers, (unsigned long)n_failures, (unsigned long)n_underruns);
+} // AdaptPool()
+
+
+void CameraNode::StartAcquisition(CameraState &cam)
+{
+	cam.nAllocationsPrev = cam.framepool.nAllocations();
+	cam.nsAwaitFirstFrame = NowNs();
+	cam.bRun = true;
+
+	if (cam.pPlayer)
+	{
+		// The recording takes the place of the camera, feeding the same ring and publish thread.
+		cam.threadPublish = std::thread (&CameraNode::PublishThread, this, std::ref(cam));
+		cam.threadAcquire = std::thread (&CameraNode::ReplayThread, this, std::ref(cam));
+		return;
+	}
+
+	// Connect signals with callbacks.
+	g_signal_connect (cam.pDevice, "control-lost", G_CALLBACK (ControlLost_callback), &cam);
+	if (m_bUseGlibLoop)
+	{
+		g_signal_connect (cam.pStream, "new-buffer", G_CALLBACK (NewBuffer_callback), &cam);
+		arv_stream_set_emit_signals ((ArvStream *)cam.pStream, TRUE);
+
+	}
+	else
+	{
+		cam.threadPublish = std::thread (&CameraNode::PublishThread, this, std::ref(cam));
+		cam.threadAcquire = std::thread (&CameraNode::AcquireThread, this, std::ref(cam));
+	}
+	if (m_bAutoExposure)
+	{
+		cam.bExposureStop = false;
+		cam.threadExposure = std::thread (&CameraNode::ExposureThread, this, std::ref(cam));
+	}
+	PlaceThreads (cam);
+
+	arv_device_execute_command (cam.pDevice, "AcquisitionStart");
+} // StartAcquisition()
+
+
+// StartTriggers()
+// One trigger thread per camera, all on the same schedule, so that every camera is
+// triggered at the same instants, give or take each thread's wake-up jitter.
+void CameraNode::StartTriggers(void)
+{
+	const int64_t	nsPeriod = (int64_t)(1e9 / m_dTriggerRate);
+	const int64_t	nsStart = NowNs() + 100000000LL;	// Time for every thread to be waiting.
+
+	for (auto &pCam : m_cameras)
+	{
+		CameraState	&cam = *pCam;
+		std::string	 stError;
+
+		if (!cam.pDevice)
+			continue;
+		if (!cam.trigger.Start (nsStart, nsPeriod, m_nTriggerPriority, m_nsTriggerSpin,
+				[&cam]() { arv_device_execute_command (cam.pDevice, "TriggerSoftware"); }, stError))
+			RCLCPP_WARN ( get_logger(), "%s: Trigger thread at normal priority: %s", cam.stName.c_str(), stError.c_str());
+		RCLCPP_INFO ( get_logger(), "%s: Software trigger at %.3f Hz%s", cam.stName.c_str(), m_dTriggerRate,
+			m_nTriggerPriority > 0 && stError.empty() ? ", SCHED_FIFO" : "");
+	}
+} // StartTriggers()
+
+
+// AcquireThread()
+// Block on the stream and pass each completed buffer to the publish thread.
+void CameraNode::AcquireThread(CameraState &cam)
+{
+	const guint64	timeoutPop = 100000;	// microseconds; bounds how long a stop request waits.
+	FrameHandoff	frame;
+
+	while (cam.bRun)
+	{
+		frame.pBuffer = arv_stream_timeout_pop_buffer ((ArvStream *)cam.pStream, timeoutPop);
+		if (frame.pBuffer == NULL)
+			continue;
+		frame.nsPop = NowNs();
+		frame.nsCamera = (int64_t)arv_buffer_get_timestamp (frame.pBuffer);
+		frame.nsHost = (int64_t)arv_buffer_get_system_timestamp (frame.pBuffer);
+		CountBuffer (cam, frame.pBuffer);
+
+		if (arv_buffer_get_status (frame.pBuffer) != ARV_BUFFER_STATUS_SUCCESS)
+		{
+			RCLCPP_WARN ( get_logger(), "%s: Frame error: %s", cam.stName.c_str(), szBufferStatusFromInt[arv_buffer_get_status (frame.pBuffer)]);
+			cam.framepool.Release (frame.pBuffer);
+		}
+		else if (cam.ring.Push (frame))
+		{
+			size_t depth = cam.ring.Size();
+			size_t depthMax = cam.depthMax.load(std::memory_order_relaxed);
+			if (depth > depthMax)
+				cam.depthMax.store(depth, std::memory_order_relaxed);
+			sem_post (&cam.semRing);
+		}
+		else
+		{
+			// The publisher is behind; recycle the newest frame rather than block the stream.
+			cam.nDropped++;
+			cam.nDroppedTotal++;
+			cam.framepool.Release (frame.pBuffer);
+		}
+		cam.iFrame++;
+	}
+} // AcquireThread()
+
+
+// CountBuffer()
+// Account for a buffer just popped from the stream: its status, how long it waited
+// there since its first packet arrived, and how long after its trigger that was.
+void CameraNode::CountBuffer(CameraState &cam, ArvBuffer *pBuffer)
+{
+	int status = arv_buffer_get_status (pBuffer);
+
+	if (status >= 0 && status < nBufferStatuses)
+		cam.nStatus[status].fetch_add(1, std::memory_order_relaxed);
+	if (status == ARV_BUFFER_STATUS_SUCCESS)
+	{
+		int64_t nsReceived = (int64_t)arv_buffer_get_system_timestamp (pBuffer);
+
+		cam.histReceiveToPop.Record (RealtimeNs() - nsReceived);
+		if (cam.trigger.IsRunning())
+		{
+			// Matched to the latest trigger before it, so meaningful while frames come within a period.
+			int64_t nsTriggered = cam.trigger.FiredBefore (nsReceived);
+			if (nsTriggered)
+				cam.histTriggerToFrame.Record (nsReceived - nsTriggered);
+		}
+	}
+}
+
+
+// PublishThread()
+// Publish frames from the ring in order.
+void CameraNode::PublishThread(CameraState &cam)
+{
+	FrameHandoff	frame;
+
+	while (cam.bRun)
+	{
+		if (sem_wait (&cam.semRing) != 0 || !cam.ring.Pop (frame))
+			continue;
+
+		// A newer frame already waiting makes this one stale: under "latest", publish only the newest.
+		FrameHandoff frameNewer;
+		while (m_qosPolicy == QOS_LATEST && sem_trywait (&cam.semRing) == 0 && cam.ring.Pop (frameNewer))
+		{
+			if (cam.pRecorder)
+				RecordFrame (cam, frame);
+			cam.framepool.Release (frame.pBuffer);
+			cam.nCoalesced++;
+			frame = frameNewer;
+		}
+
+		int64_t nsDequeue = NowNs();
+		cam.nBuffers++;
+		PublishFrame (cam, frame);
+		int64_t nsPublished = NowNs();
+
+		cam.nsQueueWait += nsDequeue - frame.nsPop;
+		cam.nsPublish += nsPublished - nsDequeue;
+		AtomicMax (cam.nsPublishMax, nsPublished - nsDequeue);
+		cam.histPopToPublish.Record (nsPublished - frame.nsPop);
+		cam.nPublished++;
+		NoteFirstFrame (cam);
+	}
+} // PublishThread()
+
+
+// ReplayThread()
+// Feed the recorded frames into the ring as the acquisition thread would, spaced as they
+// were recorded (scaled by replay_rate), with their timestamps moved to the present.
+// Paced replay drops frames the way a camera would when the publisher falls behind;
+// unpaced replay (replay_rate 0) waits for it instead.
+void CameraNode::ReplayThread(CameraState &cam)
+{
+	const FramePlayer	&player = *cam.pPlayer;
+	const RecordingEntry &first = player.Entry(0);
+	const bool			 bPaced = m_dReplayRate > 0.0;
+	const int64_t		 nsReplayStart = RealtimeNs();
+	unsigned			 nSkipped = 0;
+	FrameHandoff		 frame;
+
+	do
+	{
+		const int64_t	nsLoopSteady = NowNs();
+		const int64_t	nsLoopHost = RealtimeNs();
+
+		for (size_t i=0; i<player.nFrames() && cam.bRun; i++)
+		{
+			const RecordingEntry &entry = player.Entry(i);
+			int64_t nsSinceFirst = bPaced ? (int64_t)((int64_t)(entry.nsHost - first.nsHost) / m_dReplayRate) : 0;
+
+			// Sleep in short steps so that stopping is not held up by a long gap.
+			while (bPaced && cam.bRun && NowNs() < nsLoopSteady + nsSinceFirst)
+				std::this_thread::sleep_for (std::chrono::nanoseconds(std::min<int64_t>(nsLoopSteady + nsSinceFirst - NowNs(), 100000000LL)));
+
+			if (entry.width != first.width || entry.height != first.height || entry.pixelformat != first.pixelformat ||
+				entry.nbytes > cam.framepool.nbytesPayload())
+			{
+				if (nSkipped++ == 0)
+					RCLCPP_WARN ( get_logger(), "%s: Skipping recorded frames whose format differs from the first.", cam.stName.c_str());
+				continue;
+			}
+
+			frame.pBuffer = cam.framepool.Acquire();
+			while (!frame.pBuffer && !bPaced && cam.bRun)
+			{
+				std::this_thread::sleep_for (std::chrono::microseconds(100));
+				frame.pBuffer = cam.framepool.Acquire();
+			}
+			if (!frame.pBuffer)
+			{
+				// Every buffer is still with the publisher or its subscribers.
+				cam.nDropped++;
+				cam.nDroppedTotal++;
+				continue;
+			}
+
+			memcpy (cam.framepool.MessageFromBuffer(frame.pBuffer)->data.data(), player.Data(i), entry.nbytes);
+			frame.nsPop = NowNs();
+			frame.nsHost = bPaced ? nsLoopHost + nsSinceFirst : RealtimeNs();
+			frame.nsCamera = (bPaced && first.nsCamera) ? (int64_t)first.nsCamera + (nsLoopHost - nsReplayStart) + (int64_t)((int64_t)(entry.nsCamera - first.nsCamera) / m_dReplayRate) : 0;
+			cam.nStatus[ARV_BUFFER_STATUS_SUCCESS].fetch_add(1, std::memory_order_relaxed);
+
+			bool bPushed = cam.ring.Push (frame);
+			while (!bPushed && !bPaced && cam.bRun)
+			{
+				std::this_thread::sleep_for (std::chrono::microseconds(100));
+				bPushed = cam.ring.Push (frame);
+			}
+			if (bPushed)
+			{
+				size_t depth = cam.ring.Size();
+				size_t depthMax = cam.depthMax.load(std::memory_order_relaxed);
+				if (depth > depthMax)
+					cam.depthMax.store(depth, std::memory_order_relaxed);
+				sem_post (&cam.semRing);
+			}
+			else
+			{
+				cam.nDropped++;
+				cam.nDroppedTotal++;
+				cam.framepool.Release (frame.pBuffer);
+			}
+			cam.iFrame++;
+		}
+	} while (m_bReplayLoop && cam.bRun);
+
+	RCLCPP_INFO ( get_logger(), "%s: Replay finished.", cam.stName.c_str());
+} // ReplayThread()
+
+
+// RecordFrame()
+// Queue the raw payload, as acquired and before any conversion, for the recorder's writer thread.
+void CameraNode::RecordFrame(CameraState &cam, const FrameHandoff &frame)
+{
+	const sensor_msgs::msg::Image	&msg = *cam.framepool.MessageFromBuffer(frame.pBuffer);
+	RecordingEntry					 entry;
+
+	memset (&entry, 0, sizeof(entry));
+	entry.nbytes = msg.data.size();
+	entry.pixelformat = cam.pixelformat;
+	entry.nsCamera = frame.nsCamera;
+	entry.nsHost = frame.nsHost;
+	entry.width = (uint32_t)cam.widthRoi;
+	entry.height = (uint32_t)cam.heightRoi;
+	entry.iFrame = arv_buffer_get_frame_id (frame.pBuffer);
+	cam.pRecorder->Record (msg.data.data(), entry);
+} // RecordFrame()
+
+
+void CameraNode::StopAcquisition(CameraState &cam)
+{
+	guint64 n_completed_buffers;
+	guint64 n_failures;
+	guint64 n_underruns;
+	guint64 n_resent;
+	guint64 n_missing;
+
+	// A reconnect in progress gives up, leaving the camera open or not.
+	cam.bReconnectStop = true;
+	if (cam.threadReconnect.joinable())
+		cam.threadReconnect.join();
+
+	cam.trigger.Stop();
+	StopThreads (cam);
+	if (cam.threadExposure.joinable())
+	{
+		{
+			std::lock_guard<std::mutex> lock(cam.mutexExposure);
+			cam.bExposureStop = true;
+		}
+		cam.cvExposure.notify_one();
+		cam.threadExposure.join();
+	}
+	cam.stripes.Stop();
+	cam.compress.Stop();	// Before the pool goes: queued frames hold its buffers.
+	m_sync.Flush (cam.iCamera);	// So do frames waiting for their set.
+
+	if (cam.pRecorder)
+	{
+		cam.pRecorder->Close();
+		RCLCPP_INFO ( get_logger(), "%s: Recorded %lu frames, %lu MB; dropped %lu, write errors %lu", cam.stGuid.c_str(),
+			(unsigned long)cam.pRecorder->nRecorded.load(), (unsigned long)(cam.pRecorder->nbytesWritten.load() >> 20),
+			(unsigned long)cam.pRecorder->nDropped.load(), (unsigned long)cam.pRecorder->nErrors.load());
+		cam.pRecorder.reset();
+	}
+
+	if (!cam.pStream)
+	{
+		// Replay, or a camera lost for good.
+		cam.framepool.Destroy();
+		cam.pPlayer.reset();
+		return;
+	}
+
+	RCLCPP_INFO ( get_logger(), "%s:", cam.stGuid.c_str());
+	arv_stream_get_statistics ((ArvStream *)cam.pStream, &n_completed_buffers, &n_failures, &n_underruns);
+	RCLCPP_INFO ( get_logger(), "Completed buffers = %Lu", (unsigned long long) n_completed_buffers);
+	RCLCPP_INFO ( get_logger(), "Failures          = %Lu", (unsigned long long) n_failures);
+	RCLCPP_INFO ( get_logger(), "Underruns         = %Lu", (unsigned long long) n_underruns);
+	if (ARV_IS_GV_STREAM (cam.pStream))
+	{
+		arv_gv_stream_get_statistics (cam.pStream, &n_resent, &n_missing);
+		RCLCPP_INFO ( get_logger(), "Resent buffers    = %Lu", (unsigned long long) n_resent);
+		RCLCPP_INFO ( get_logger(), "Missing           = %Lu", (unsigned long long) n_missing);
+	}
+	RCLCPP_INFO ( get_logger(), "Pool buffers      = %u", cam.framepool.nBuffers());
+
+	arv_device_execute_command (cam.pDevice, "AcquisitionStop");
+
+	g_object_unref (cam.pStream);
+	cam.pStream = NULL;
+	cam.framepool.Destroy();
+
+	g_object_unref (cam.pCamera);
+	cam.pCamera = NULL;
+	cam.pDevice = NULL;
+} // StopAcquisition()
+
+
+// StopThreads()
+// Stop frame delivery, and put every frame not yet published back into the pool.
+// Returns how many frames that was.
+unsigned CameraNode::StopThreads(CameraState &cam)
+{
+	unsigned	nUnpublished = 0;
+
+	cam.bRun = false;
+
+	// StartAcquisition() connects them again.
+	if (cam.pDevice)
+		g_signal_handlers_disconnect_by_data (cam.pDevice, &cam);
+	if (m_bUseGlibLoop && cam.pStream && !cam.pPlayer)
+	{
+		arv_stream_set_emit_signals ((ArvStream *)cam.pStream, FALSE);
+		g_signal_handlers_disconnect_by_data (cam.pStream, &cam);
+	}
+	else
+	{
+		sem_post (&cam.semRing);
+		if (cam.threadAcquire.joinable())
+			cam.threadAcquire.join();
+		if (cam.threadPublish.joinable())
+			cam.threadPublish.join();
+
+		FrameHandoff frame;
+		while (cam.ring.Pop (frame))
+		{
+			cam.framepool.Release (frame.pBuffer);
+			nUnpublished++;
+		}
+	}
+	return nUnpublished;
+} // StopThreads()
+
+
+// SleepBackoff()
+// Wait msBackoff, then double it up to retry_max_ms.  False if the node is stopping.
+bool CameraNode::SleepBackoff(CameraState &cam, int &msBackoff)
+{
+	auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(msBackoff);
+
+	// In steps, so that shutting down does not wait out a long backoff.
+	while (!cam.bReconnectStop && std::chrono::steady_clock::now() < deadline)
+		std::this_thread::sleep_for (std::min<std::chrono::steady_clock::duration>(deadline - std::chrono::steady_clock::now(), std::chrono::milliseconds(100)));
+	msBackoff = std::min(2 * msBackoff, m_msRetryMax);
+
+	return !cam.bReconnectStop;
+} // SleepBackoff()
+
+
+// ReconnectThread()
+// After control loss: drop the dead device and stream, reopen the same camera with
+// backoff, put its configuration back and stream again into the same publishers and
+// the same buffer pool.  Started by PeriodicTask_callback().
+void CameraNode::ReconnectThread(CameraState &cam)
+{
+	int		msBackoff = m_msRetryMin;
+	int		nAttempts = 0;
+
+	RCLCPP_WARN ( get_logger(), "%s: Reconnecting...", cam.stGuid.c_str());
+	cam.trigger.Pause();
+	{
+		std::lock_guard<std::mutex> lock(cam.mutexDevice);
+
+		// Everything goes back into the old stream, so that it frees all the buffers, and
+		// none of the messages behind them.
+		StopThreads (cam);
+		cam.compress.Flush();
+		m_sync.Flush (cam.iCamera);
+		if (cam.pStream)	// Gone already if a reconfiguration could not replace it.
+			g_object_unref (cam.pStream);
+		cam.pStream = NULL;
+		g_object_unref (cam.pCamera);
+		cam.pCamera = NULL;
+		cam.pDevice = NULL;
+	}
+
+	while (!cam.bReconnectStop)
+	{
+		nAttempts++;
+		arv_update_device_list();
+		ArvCamera *pCamera = arv_camera_new (cam.stOpenId.c_str());
+		if (!pCamera)
+		{
+			RCLCPP_WARN ( get_logger(), "%s: Could not reopen (attempt %d); retrying in %d ms", cam.stGuid.c_str(), nAttempts, msBackoff);
+			SleepBackoff (cam, msBackoff);
+			continue;
+		}
+
+		std::lock_guard<std::mutex> lock(cam.mutexDevice);
+		cam.pCamera = pCamera;
+		cam.pDevice = arv_camera_get_device (pCamera);
+		RestoreConfiguration (cam);
+		cam.pStream = CreateStream (cam, true);
+		if (!cam.pStream)
+		{
+			g_object_unref (cam.pCamera);
+			cam.pCamera = NULL;
+			cam.pDevice = NULL;
+			RCLCPP_WARN ( get_logger(), "%s: Could not create the stream (attempt %d); retrying in %d ms", cam.stGuid.c_str(), nAttempts, msBackoff);
+			SleepBackoff (cam, msBackoff);
+			continue;
+		}
+
+		// The stream counters start over with the new stream.
+		cam.nUnderrunsPrev = 0;
+		cam.bControlLost = false;
+		cam.nStreams++;
+		cam.nReconnects++;
+		StartAcquisition (cam);
+		cam.trigger.Resume();
+		RCLCPP_INFO ( get_logger(), "%s: Reconnected after %.0f ms and %d attempts", cam.stGuid.c_str(),
+			(NowNs() - cam.nsControlLost) / 1e6, nAttempts);
+		break;
+	}
+	cam.bReconnecting = false;
+} // ReconnectThread()
+
+
+// NoteFirstFrame()
+// Time from starting (or restarting) acquisition to the first frame out, once per start.
+// After a reconfiguration, also the frames it cost: those of the old format put back
+// unpublished, and those the camera would have sent while stopped.
+void CameraNode::NoteFirstFrame(CameraState &cam)
+{
+	int64_t nsStart = cam.nsAwaitFirstFrame.load(std::memory_order_relaxed);
+
+	if (nsStart == 0 || !cam.nsAwaitFirstFrame.compare_exchange_strong(nsStart, 0, std::memory_order_relaxed))
+		return;
+
+	int64_t nsNow = NowNs();
+	int64_t nsStop = cam.nsReconfigureStop.exchange(0);
+	cam.nsFirstFrame = nsNow - nsStart;
+	if (nsStop)
+	{
+		bool		bFreeRunning = cam.fps > 0.0 && cam.stTriggerMode != "On";
+		int64_t		nMissed = bFreeRunning ? std::max<int64_t>(0, llround((nsNow - nsStop) * cam.fps / 1e9) - 1) : 0;
+		uint64_t	nLost = cam.nReconfigureDiscarded + (uint64_t)nMissed;
+
+		cam.nsReconfigure = nsNow - nsStop;
+		cam.nReconfigureLost = nLost;
+		cam.nReconfigureLostTotal += nLost;
+		RCLCPP_INFO ( get_logger(), "%s: Reconfigured in %.1f ms (first frame %.1f ms after restarting); %lu frames lost, %lu of them discarded",
+			cam.stName.c_str(), cam.nsReconfigure / 1e6, cam.nsFirstFrame / 1e6, (unsigned long)nLost, (unsigned long)cam.nReconfigureDiscarded);
+	}
+	else if (cam.nReconnects.load() > 0)
+	{
+		cam.nsReconnect = nsNow - cam.nsControlLost;
+		RCLCPP_INFO ( get_logger(), "%s: First frame %.1f ms after restarting, %.1f ms after control was lost", cam.stName.c_str(),
+			cam.nsFirstFrame / 1e6, cam.nsReconnect / 1e6);
+	}
+	else
+		RCLCPP_INFO ( get_logger(), "%s: First frame %.1f ms after starting", cam.stName.c_str(), cam.nsFirstFrame / 1e6);
+} // NoteFirstFrame()
+
+
+// StampFrame()
+// Host time of the frame's camera timestamp.  PTP slaves already count host (PTP) time;
+// for the others the clock estimator maps camera time onto the host clock, which takes
+// the network and receive jitter out of the stamps.
+int64_t CameraNode::StampFrame(CameraState &cam, const FrameHandoff &frame)
+{
+	int64_t nsCamera = frame.nsCamera;
+	int64_t nsHost = frame.nsHost;
+	int64_t nsStamp;
+
+	if (nsCamera == 0)
+		return nsHost;	// The camera does not timestamp its frames.
+
+	// Keep fitting even with PTP, so the residuals show how well host and camera agree.
+	cam.clock.AddSample (nsCamera, nsHost);
+	if (cam.bPtpLocked.load(std::memory_order_relaxed))
+		nsStamp = nsCamera + m_nsPtpOffset;
+	else
+		nsStamp = cam.clock.ToHost (nsCamera);
+
+	cam.histCameraToPublish.Record (RealtimeNs() - nsStamp);
+
+	return nsStamp;
+} // StampFrame()
+
+
+// UpdatePtpStatus()
+// Trust the camera's clock as PTP time only while it is slaved to a grandmaster and
+// agrees with the host clock.  A camera that elected itself master counts its own free
+// running time, and a wrong ptp_offset_ns (e.g. TAI against UTC) would shift every
+// stamp; either way the estimated camera->host mapping is used instead.
+void CameraNode::UpdatePtpStatus(CameraState &cam)
+{
+	const double	nsDisagreeMax = 1e6;
+
+	if (!cam.isImplementedPtp || !m_bPtp)
+		return;
+
+	const char	*szStatus = arv_device_get_string_feature_value (cam.pDevice, cam.keyPtpStatus);
+	bool		 bSlave = szStatus && !strcmp(szStatus, "Slave");
+	double		 nsDisagree = cam.clock.GetOffsetNs() - (double)m_nsPtpOffset;
+	bool		 bAgree = cam.clock.IsLocked() && fabs(nsDisagree) <= nsDisagreeMax;
+	bool		 bLocked = bSlave && bAgree;
+
+	if (bLocked != cam.bPtpLocked.load())
+	{
+		if (bSlave && cam.clock.IsLocked() && !bAgree)
+			RCLCPP_WARN ( get_logger(), "%s: PTP time is %.3f ms off the host clock; check ptp_offset_ns.  Stamping with the estimated camera->host clock mapping",
+				cam.stName.c_str(), nsDisagree / 1e6);
+		else
+			RCLCPP_INFO ( get_logger(), "%s: PTP status %s; stamping with %s", cam.stName.c_str(), szStatus ? szStatus : "(unknown)",
+				bLocked ? "camera PTP time" : "the estimated camera->host clock mapping");
+	}
+	cam.bPtpLocked = bLocked;
+} // UpdatePtpStatus()
+
+
+// CreateCompression()
+// Publishers and encoder threads for the codecs named in codecs, e.g. {"jpeg", "qoi"}.
+void CameraNode::CreateCompression(CameraState &cam, const std::string &stTopic, const std::vector<std::string> &codecs)
+{
+	static const char	*szTopic[nCodecs] = {"compressed", "qoi"};
+	static const char	*szCodec[nCodecs] = {"jpeg", "qoi"};
+	int					 nPublishers = 0;
+
+	if (codecs.empty())
+		return;
+	if (!ImageEncoder::IsSupported(cam.stEncoding))
+	{
+		RCLCPP_WARN ( get_logger(), "%s: Cannot compress %s images; set convert:=true for Bayer and packed formats.", cam.stName.c_str(), cam.stEncoding.c_str());
+		return;
+	}
+
+	for (const std::string &stCodec : codecs)
+	{
+		int i;
+		for (i=0; i<nCodecs; i++)
+			if (stCodec == szCodec[i])
+				break;
+		if (i == nCodecs)
+			RCLCPP_WARN ( get_logger(), "Unknown codec \"%s\"; use jpeg or qoi.", stCodec.c_str());
+		else if (!cam.pubCompressed[i])
+		{
+			cam.pubCompressed[i] = create_publisher<sensor_msgs::msg::CompressedImage>(stTopic + "/" + szTopic[i], ImageQoS());
+			nPublishers++;
+		}
+	}
+	if (nPublishers == 0)
+		return;
+
+	CameraState *pCam = &cam;
+	cam.compress.Start (m_nCompressThreads, m_nCompressQueue, m_nJpegQuality,
+		[pCam](ImageCodec codec, std::unique_ptr<sensor_msgs::msg::CompressedImage> pMsg)
+		{
+			pCam->pubCompressed[codec]->publish(std::move(pMsg));
+		});
+	RCLCPP_INFO ( get_logger(), "%s: Compressing on %d threads, queue %d", cam.stName.c_str(), m_nCompressThreads, m_nCompressQueue);
+} // CreateCompression()
+
+
+// CodecsWanted()
+// The codecs with subscribers right now, as a mask of bits (1 << ImageCodec).
+unsigned CameraNode::CodecsWanted(CameraState &cam)
+{
+	unsigned mask = 0;
+
+	if (!cam.compress.IsRunning())
+		return 0;
+	for (int i=0; i<nCodecs; i++)
+	{
+		const auto &publisher = cam.pubCompressed[i];
+		if (publisher && publisher->get_subscription_count() + publisher->get_intra_process_subscription_count() > 0)
+			mask |= 1u << i;
+	}
+	return mask;
+} // CodecsWanted()
+
+
+// ConvertFrame()
+// Convert the raw frame behind pBuffer into pOut, on the stripe pool, and give the buffer
+// back to the stream.  pOut is reused when it is still ours, i.e. when not handed off intra-process.
+sensor_msgs::msg::Image *CameraNode::ConvertFrame(CameraState &cam, ArvBuffer *pBuffer, std::unique_ptr<sensor_msgs::msg::Image> &pOut)
+{
+	const sensor_msgs::msg::Image	&msgRaw = *cam.framepool.MessageFromBuffer(pBuffer);
+	const PixelConversion			&conv = cam.conversion;
+	const int						 width = cam.widthRoi;
+	const int						 height = cam.heightRoi;
+	int64_t							 nsStart = NowNs();
+
+	if (!pOut)
+		pOut.reset (new sensor_msgs::msg::Image);
+	pOut->data.resize (conv.DstStep(width) * height);
+	if (msgRaw.data.size() < conv.SrcStep(width) * height)
+	{
+		RCLCPP_WARN ( get_logger(), "%s: Frame of %lu bytes is too small for %dx%d %s", cam.stName.c_str(),
+			(unsigned long)msgRaw.data.size(), width, height, cam.stPixelformat.c_str());
+		return NULL;
+	}
+
+	const uint8_t	*pSrc = msgRaw.data.data();
+	uint8_t			*pDst = pOut->data.data();
+	cam.stripes.Run (height, [&](int yBegin, int yEnd)
+	{
+		ConvertRows (conv, pSrc, pDst, width, height, yBegin, yEnd);
+	});
+
+	pOut->encoding = cam.stEncoding;
+	pOut->step = conv.DstStep(width);
+	cam.histConvert.Record (NowNs() - nsStart);
+
+	return pOut.get();
+} // ConvertFrame()
+
+
+// ImageQoS()
+// The QoS of every image topic, from the "qos" policy.
+rclcpp::QoS CameraNode::ImageQoS(void) const
+{
+	rclcpp::QoS	qos(m_qosPolicy == QOS_LATEST ? 1 : m_nQosDepth);
+
+	if (m_qosPolicy != QOS_RELIABLE)
+		qos.best_effort();
+	return qos;
+}
+
+
+// HasSubscribers()
+// Whether any of the camera's image outputs has a subscriber, in this process or another.
+bool CameraNode::HasSubscribers(CameraState &cam)
+{
+	if (cam.publisher->get_subscription_count() + cam.publisher->get_intra_process_subscription_count() > 0)
+		return true;
+	for (const auto &level : cam.pyramid)
+		if (level.publisher->get_subscription_count() + level.publisher->get_intra_process_subscription_count() > 0)
+			return true;
+	if (cam.pubShm && cam.pubShm->get_subscription_count() + cam.pubShm->get_intra_process_subscription_count() > 0)
+		return true;
+	if (cam.pubInfo && cam.pubInfo->get_subscription_count() + cam.pubInfo->get_intra_process_subscription_count() > 0)
+		return true;
+	if (cam.pubRect && cam.pubRect->get_subscription_count() + cam.pubRect->get_intra_process_subscription_count() > 0)
+		return true;
+	if (m_pubFrameSet && m_pubFrameSet->get_subscription_count() + m_pubFrameSet->get_intra_process_subscription_count() > 0)
+		return true;
+	if (cam.pubTiles && cam.pubTiles->get_subscription_count() + cam.pubTiles->get_intra_process_subscription_count() > 0)
+		return true;
+	if (cam.pubTensor && cam.pubTensor->get_subscription_count() + cam.pubTensor->get_intra_process_subscription_count() > 0)
+		return true;
+	if (m_pubSetTensor && m_pubSetTensor->get_subscription_count() + m_pubSetTensor->get_intra_process_subscription_count() > 0)
+		return true;
+	return CodecsWanted (cam) != 0;
+}
+
+
+// AdaptIdleRate()
+// Slow a free-running camera to idle_fps once nobody has subscribed for idle_after_s, and
+// put its frame rate back as soon as someone does.  Called once a second, so the first
+// subscriber waits up to a second for the full rate.
+void CameraNode::AdaptIdleRate(CameraState &cam)
+{
+	if (m_dIdleFps <= 0.0 || !cam.keyAcquisitionFrameRate || cam.fps <= m_dIdleFps || cam.trigger.IsRunning())
+		return;
+
+	// A recording wants every frame, subscribers or not.
+	if (HasSubscribers (cam) || cam.pRecorder)
+	{
+		cam.nsUnsubscribed = 0;
+		if (cam.bIdle)
+		{
+			arv_device_set_float_feature_value (cam.pDevice, cam.keyAcquisitionFrameRate, cam.fps);
+			cam.bIdle = false;
+			RCLCPP_INFO ( get_logger(), "%s: Subscribed; back to %.1f fps.", cam.stName.c_str(), cam.fps);
+		}
+		return;
+	}
+
+	if (cam.nsUnsubscribed == 0)
+		cam.nsUnsubscribed = NowNs();
+	if (!cam.bIdle && NowNs() - cam.nsUnsubscribed >= m_nsIdleAfter)
+	{
+		arv_device_set_float_feature_value (cam.pDevice, cam.keyAcquisitionFrameRate, m_dIdleFps);
+		cam.bIdle = true;
+		RCLCPP_INFO ( get_logger(), "%s: No subscribers; idling at %.1f fps.", cam.stName.c_str(), m_dIdleFps);
+	}
+} // AdaptIdleRate()
+
+
+// PublishFrame()
+// Fill in the header of the message behind pBuffer, or of its converted copy, and publish it.
+// While anyone listens to the compressed topics the frame is also queued for the encoders,
+// which read it in place; it then goes back to the stream when they are done with it.
+void CameraNode::PublishFrame(CameraState &cam, const FrameHandoff &frame)
+{
+	ArvBuffer	*pBuffer = frame.pBuffer;
+	int64_t		nsStamp = StampFrame (cam, frame);
+	unsigned	maskCodecs = CodecsWanted (cam);
+	bool		bSync = m_pubFrameSet && (m_pubFrameSet->get_subscription_count() + m_pubFrameSet->get_intra_process_subscription_count() > 0 ||
+		(m_pubSetTensor && m_pubSetTensor->get_subscription_count() + m_pubSetTensor->get_intra_process_subscription_count() > 0));
+
+	if (cam.pRecorder)
+		RecordFrame (cam, frame);
+
+	// The exposure is for recordings and later subscribers as well.
+	if (m_bAutoExposure)
+		MeterExposure (cam, pBuffer);
+
+	// Nobody to convert, copy or publish for.
+	if (!maskCodecs && !bSync && !HasSubscribers (cam))
+	{
+		cam.framepool.Release (pBuffer);
+		cam.nSkipped++;
+		return;
+	}
+
+	// Nothing new since the last frame published: none of the outputs needs it.
+	if (m_bGate && !GateFrame (cam, pBuffer, nsStamp))
+	{
+		cam.framepool.Release (pBuffer);
+		return;
+	}
+
+	if (cam.pubTensor)
+		PublishTensor (cam, pBuffer, nsStamp);
+
+	if (cam.conversion.kind != CONVERSION_NONE)
+	{
+		// The raw frame goes back to the stream as soon as it is converted.
+		std::unique_ptr<sensor_msgs::msg::Image> pOut;
+		sensor_msgs::msg::Image *pMsg = ConvertFrame (cam, pBuffer, (m_bIntraProcess || maskCodecs || bSync) ? pOut : cam.pConverted);
+		cam.framepool.Release (pBuffer);
+		if (!pMsg)
+			return;
+
+		pMsg->header.stamp.sec = (int32_t)(nsStamp / 1000000000LL);
+		pMsg->header.stamp.nanosec = (uint32_t)(nsStamp % 1000000000LL);
+		pMsg->header.frame_id = cam.stFrameId;
+		pMsg->width = cam.widthRoi;
+		pMsg->height = cam.heightRoi;
+		PublishPyramid (cam, *pMsg);
+		PublishShm (cam, *pMsg);
+		PublishCalibration (cam, *pMsg);
+		if (maskCodecs || bSync)
+		{
+			std::shared_ptr<const sensor_msgs::msg::Image> pShared (std::move(pOut));
+			cam.publisher->publish(*pShared);
+			if (bSync)
+				m_sync.Push (cam.iCamera, pShared, nsStamp);
+			if (maskCodecs)
+				cam.compress.Submit (std::move(pShared), maskCodecs);
+		}
+		else if (m_bIntraProcess)
+			cam.publisher->publish(std::move(pOut));
+		else
+			cam.publisher->publish(*pMsg);
+		return;
+	}
+
+	// The camera wrote the frame straight into this message; no copy needed.
+	sensor_msgs::msg::Image &msg = *cam.framepool.MessageFromBuffer(pBuffer);
+
+	// Construct the image message.
+	msg.header.stamp.sec = (int32_t)(nsStamp / 1000000000LL);
+	msg.header.stamp.nanosec = (uint32_t)(nsStamp % 1000000000LL);
+	msg.header.frame_id = cam.stFrameId;
+	msg.width = cam.widthRoi;
+	msg.height = cam.heightRoi;
+	msg.encoding = cam.stEncoding;
+	msg.step = (msg.width * cam.nBitsPixel + 7) / 8;
+	PublishPyramid (cam, msg);
+	PublishShm (cam, msg);
+	PublishCalibration (cam, msg);
+
+	if (maskCodecs || bSync)
+	{
+		// Shared with the encoders and the frame sets, so intra-process subscribers get a copy.
+		FramePool *pPool = &cam.framepool;
+		std::shared_ptr<const sensor_msgs::msg::Image> pShared (&msg, [pPool, pBuffer](const sensor_msgs::msg::Image *) { pPool->Release (pBuffer); });
+		cam.publisher->publish(msg);
+		if (bSync)
+			m_sync.Push (cam.iCamera, pShared, nsStamp);
+		if (maskCodecs)
+			cam.compress.Submit (std::move(pShared), maskCodecs);
+	}
+	else if (m_bIntraProcess)
+	{
+		// Hand the message itself to intra-process subscribers: no serialization and no copy.
+		cam.publisher->publish(cam.framepool.Detach(pBuffer));
+	}
+	else
+	{
+		// Image is not a bounded type, so it cannot be loaned from the middleware.
+		// The message is released when publish() returns, and only then goes back to the stream.
+		cam.publisher->publish(msg);
+		cam.framepool.Release (pBuffer);
+	}
+} // PublishFrame()
+
+
+void CameraNode::NewBuffer_callback(ArvStream *pStream, CameraState *pCam)
+{
+	ArvBuffer		*pBuffer;
+
+	pBuffer = arv_stream_try_pop_buffer (pStream);
+	if (pBuffer != NULL)
+	{
+		FrameHandoff frame;
+
+		frame.pBuffer = pBuffer;
+		frame.nsPop = NowNs();
+		frame.nsCamera = (int64_t)arv_buffer_get_timestamp (pBuffer);
+		frame.nsHost = (int64_t)arv_buffer_get_system_timestamp (pBuffer);
+		pCam->pNode->CountBuffer (*pCam, pBuffer);
+		if (arv_buffer_get_status (pBuffer) == ARV_BUFFER_STATUS_SUCCESS)
+		{
+			pCam->nBuffers++;
+			pCam->pNode->PublishFrame (*pCam, frame);
+			pCam->histPopToPublish.Record (NowNs() - frame.nsPop);
+			pCam->nPublished++;
+			pCam->pNode->NoteFirstFrame (*pCam);
+		}
+		else
+		{
+			RCLCPP_WARN ( pCam->pNode->get_logger(), "%s: Frame error: %s", pCam->stName.c_str(), szBufferStatusFromInt[arv_buffer_get_status (pBuffer)]);
+			pCam->framepool.Release (pBuffer);
+		}
+		pCam->iFrame++;
+	}
+} // NewBuffer_callback()
+
+
+void CameraNode::ControlLost_callback(ArvGvDevice *, CameraState *pCam)
+{
+	RCLCPP_ERROR ( pCam->pNode->get_logger(), "%s: Control lost.", pCam->stGuid.c_str());
+
+	// Runs on an Aravis thread that the device joins when it goes, so the reconnect happens elsewhere.
+	pCam->nsControlLost = NowNs();
+	pCam->bControlLost = true;
+	pCam->bRun = false;
+	if (pCam->pNode->m_bUseGlibLoop)
+		arv_stream_set_emit_signals ((ArvStream *)pCam->pStream, FALSE);
+}
+
+
+// PeriodicTask_callback()
+// Report the frame rate and the acquisition -> publish hand-off of each camera.
+// ROS callbacks are serviced by the executor, not from here.
+void CameraNode::PeriodicTask_callback(void)
+{
+	for (auto &pCam : m_cameras)
+	{
+		CameraState &cam = *pCam;
+		uint64_t	nAllocations = cam.framepool.nAllocations();
+		int			nBuffers = cam.nBuffers.exchange(0);
+		double		usQueueWait = nBuffers ? cam.nsQueueWait.exchange(0) / 1e3 / nBuffers : 0.0;
+		double		usPublish = nBuffers ? cam.nsPublish.exchange(0) / 1e3 / nBuffers : 0.0;
+
+		RCLCPP_INFO ( get_logger(), "%s: Frame rate = %d Hz, Pool allocations = %lu", cam.stName.c_str(), nBuffers, (unsigned long)(nAllocations - cam.nAllocationsPrev));
+		cam.nAllocationsPrev = nAllocations;
+
+		if (!m_bUseGlibLoop)
+			RCLCPP_INFO ( get_logger(), "%s: Queue depth = %lu/%lu (max %lu), Dropped = %lu, Queue wait = %.1f us, Publish = %.1f us (max %.1f us)",
+				cam.stName.c_str(),
+				(unsigned long)cam.ring.Size(), (unsigned long)cam.ring.Capacity(), (unsigned long)cam.depthMax.exchange(0),
+				(unsigned long)cam.nDropped.exchange(0), usQueueWait, usPublish, cam.nsPublishMax.exchange(0) / 1e3);
+
+		if (cam.bControlLost && m_bReconnect && !cam.bReconnecting)
+		{
+			if (cam.threadReconnect.joinable())
+				cam.threadReconnect.join();
+			cam.bReconnecting = true;
+			cam.bReconnectStop = false;
+			cam.threadReconnect = std::thread (&CameraNode::ReconnectThread, this, std::ref(cam));
+		}
+
+		// Not while the device is being replaced.
+		std::unique_lock<std::mutex> lock(cam.mutexDevice, std::try_to_lock);
+		if (lock && cam.pStream && !cam.bControlLost)
+		{
+			AdaptPool (cam);
+			AdaptTransport (cam);
+			AdaptIdleRate (cam);
+			UpdatePtpStatus (cam);
+		}
+		if (lock && cam.pInfoManager)
+			UpdateCalibration (cam);
+		lock.unlock();
+
+		if (cam.clock.IsLocked())
+			RCLCPP_INFO ( get_logger(), "%s: Clock offset = %.0f ns, Drift = %.3f ppm, Jitter = %.2f us (max %.2f us)", cam.stName.c_str(),
+				cam.clock.GetOffsetNs(), cam.clock.GetDriftPpm(), cam.clock.GetJitterNs() / 1e3, cam.clock.GetResidualMaxNs() / 1e3);
+	}
+
+	if (m_pubDiagnostics)
+		PublishDiagnostics();
+} // PeriodicTask_callback()
+
+} // namespace camera_aravis
+
+RCLCPP_COMPONENTS_REGISTER_NODE(camera_aravis::CameraNode)
@@ -0,0 +1,166 @@
+// Copyright 2016 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+
+#include <algorithm>
+#include <iterator>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "camera_aravis/camera_node.h"
+
+namespace camera_aravis
+{
+
+// The core at index iCamera of a per-camera list, if there is one.
+static CpuList CoreFor (const std::vector<int64_t> &cpus, int iCamera)
+{
+	CpuList	list;
+
+	if (iCamera < (int)cpus.size() && cpus[iCamera] >= 0)
+		list.push_back((int)cpus[iCamera]);
+	return list;
+}
+
+
+// ChoosePlacement()
+// The cores for each of the camera's threads, and the NUMA node its buffers belong on.
+void CameraNode::ChoosePlacement(CameraState &cam, int nCameras)
+{
+	const CpuList	cpusAllowed = AllowedCpus();
+	const int		nCores = (int)cpusAllowed.size();
+
+	cam.cpusReceive = CoreFor (m_cpuReceive, cam.iCamera);
+	cam.cpusAcquire = CoreFor (m_cpuAcquire, cam.iCamera);
+	cam.cpusPublish = CoreFor (m_cpuPublish, cam.iCamera);
+
+	// Left to us, several cameras spread out over the cores the process may use: camera i
+	// on the 2i-th and 2i+1-th of them.
+	if (m_cpuAcquire.empty() && m_cpuPublish.empty() && nCameras > 1 && nCores >= 2)
+	{
+		cam.cpusAcquire = CpuList(1, cpusAllowed[(2*cam.iCamera) % nCores]);
+		cam.cpusPublish = CpuList(1, cpusAllowed[(2*cam.iCamera + 1) % nCores]);
+	}
+
+	// The receive thread writes every byte of the frame, so its node is where the frame belongs.
+	cam.iNumaNode = -1;
+	if (m_bNumaBuffers)
+	{
+		const CpuList &cpus = !cam.cpusReceive.empty() ? cam.cpusReceive : cam.cpusAcquire;
+		if (!cpus.empty())
+			cam.iNumaNode = NumaNodeOfCpu (cpus[0]);
+	}
+} // ChoosePlacement()
+
+
+// ReceiveThreads()
+// Aravis' stream threads, whose names it gives after the protocol.
+std::vector<pid_t> CameraNode::ReceiveThreads(void)
+{
+	std::vector<pid_t>	tids;
+
+	for (const char *szName : { "arv_gv_stream", "arv_uv_stream", "arv_fake_stream" })
+	{
+		std::vector<pid_t> tidsNamed = ThreadsNamed (szName);
+		tids.insert (tids.end(), tidsNamed.begin(), tidsNamed.end());
+	}
+	std::sort (tids.begin(), tids.end());
+	return tids;
+}
+
+
+// PlaceReceiveThread()
+// Aravis has no handle on its receive thread, so find the one that the new stream started.
+void CameraNode::PlaceReceiveThread(CameraState &cam, const std::vector<pid_t> &tidsBefore)
+{
+	std::vector<pid_t>	tidsAfter = ReceiveThreads();
+	std::vector<pid_t>	tidsNew;
+	std::string			stReport;
+
+	cam.stPlacementReceive.clear();
+	if (cam.cpusReceive.empty() && m_nPriorityReceive <= 0)
+		return;
+
+	std::set_difference (tidsAfter.begin(), tidsAfter.end(), tidsBefore.begin(), tidsBefore.end(), std::back_inserter(tidsNew));
+	if (tidsNew.size() != 1)
+	{
+		// Another camera's stream started at the same moment, or this Aravis names its threads otherwise.
+		cam.stPlacementReceive = tidsNew.empty() ? "not found" : "not told apart";
+		RCLCPP_WARN ( get_logger(), "%s: Receive thread %s, left where it is.", cam.stGuid.c_str(), cam.stPlacementReceive.c_str());
+		return;
+	}
+
+	if (!PlaceTask (tidsNew[0], cam.cpusReceive, m_nPriorityReceive, stReport))
+		RCLCPP_WARN ( get_logger(), "%s: Receive thread: %s", cam.stGuid.c_str(), stReport.c_str());
+	cam.stPlacementReceive = stReport;
+} // PlaceReceiveThread()
+
+
+// PlaceThreads()
+// Pin the acquisition, publish and conversion threads, then report where everything runs.
+void CameraNode::PlaceThreads(CameraState &cam)
+{
+	std::string	stPlacement;
+	std::string	stReport;
+	bool		bRefused = false;
+	const bool	bAsked = !cam.cpusReceive.empty() || !cam.cpusAcquire.empty() || !cam.cpusPublish.empty() ||
+						 !m_cpusConvert.empty() || m_nPriorityReceive > 0 || m_nPriority > 0;
+
+	auto place = [&] (const char *szThread, std::thread &thread, const CpuList &cpus)
+	{
+		if (!thread.joinable())
+			return;
+		bRefused |= !PlaceThread (thread.native_handle(), cpus, m_nPriority, stReport);
+		stPlacement += std::string(stPlacement.empty() ? "" : "; ") + szThread + " " + stReport;
+	};
+
+	if (!cam.stPlacementReceive.empty())
+		stPlacement = "receive " + cam.stPlacementReceive;
+	place ("acquire", cam.threadAcquire, cam.cpusAcquire);
+	if (!m_bUseGlibLoop || cam.pPlayer)
+		place ("publish", cam.threadPublish, cam.cpusPublish);
+	else if (cam.iCamera == 0)
+		place ("publish", m_threadMainLoop, CoreFor (m_cpuPublish, 0));	// One loop publishes for every camera.
+
+	// The workers share the cores; report the first refusal, or else the first worker.
+	std::string stConvert;
+	for (std::thread &thread : cam.stripes.Threads())
+	{
+		bool bPlaced = PlaceThread (thread.native_handle(), m_cpusConvert, m_nPriority, stReport);
+		if (stConvert.empty() || !bPlaced)
+			stConvert = stReport;
+		bRefused |= !bPlaced;
+		if (!bPlaced)
+			break;
+	}
+	if (!stConvert.empty())
+		stPlacement += "; convert " + stConvert;
+
+	if (cam.iNumaNode >= 0)
+	{
+		stPlacement += "; buffers node " + std::to_string(cam.iNumaNode);
+		if (cam.framepool.nNumaFailures())
+			stPlacement += ", " + std::to_string(cam.framepool.nNumaFailures()) + " not moved";
+	}
+
+	if (bRefused)
+		RCLCPP_WARN ( get_logger(), "%s: Threads placed in part: %s", cam.stGuid.c_str(), stPlacement.c_str());
+	else if (bAsked)
+		RCLCPP_INFO ( get_logger(), "%s: Threads: %s", cam.stGuid.c_str(), stPlacement.c_str());
+	cam.stPlacement = stPlacement;
+} // PlaceThreads()
+
+} // namespace camera_aravis
@@ -0,0 +1,120 @@
+// Copyright 2016 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include <string>
+
+#include "camera_aravis/camera_node.h"
+
+namespace camera_aravis
+{
+
+static const char	*szPyramidLevelName[] = {"half", "quarter", "eighth", "sixteenth"};
+static const int	 nPyramidLevelsMax = sizeof(szPyramidLevelName) / sizeof(szPyramidLevelName[0]);
+
+
+// CreatePyramid()
+// Publishers for nLevels downsampled copies of the image published on stTopic.
+void CameraNode::CreatePyramid(CameraState &cam, const std::string &stTopic, int nLevels)
+{
+	const std::string	&stEncoding = cam.stEncoding;
+
+	cam.pyramid.clear();
+	if (nLevels <= 0)
+		return;
+
+	cam.pyramidSource = PyramidSourceFor (stEncoding);
+	if (cam.pyramidSource == PYRAMID_NONE)
+	{
+		RCLCPP_WARN ( get_logger(), "%s: No image pyramid for %s images.", cam.stName.c_str(), stEncoding.c_str());
+		return;
+	}
+
+	if (nLevels > nPyramidLevelsMax)
+		nLevels = nPyramidLevelsMax;
+	cam.pyramid.resize(nLevels);
+	for (int i=0; i<nLevels; i++)
+		cam.pyramid[i].publisher = create_publisher<sensor_msgs::msg::Image>(stTopic + "/" + szPyramidLevelName[i], ImageQoS());
+	RCLCPP_INFO ( get_logger(), "%s: Image pyramid down to %s/%s", cam.stName.c_str(), cam.publisher->get_topic_name(), szPyramidLevelName[nLevels - 1]);
+} // CreatePyramid()
+
+
+// PublishPyramid()
+// Halve msg level by level, as far down as anyone listens, and publish the levels.
+// Every level is computed before any is published: intra-process publishing takes the
+// message away, and the next level is made from it.
+void CameraNode::PublishPyramid(CameraState &cam, const sensor_msgs::msg::Image &msg)
+{
+	int		nLevels = 0;
+
+	// The pixel format may have changed since to one without a pyramid.
+	if (cam.pyramidSource == PYRAMID_NONE)
+		return;
+
+	for (int i=(int)cam.pyramid.size() - 1; i>=0; i--)
+	{
+		const auto &publisher = cam.pyramid[i].publisher;
+		if (publisher->get_subscription_count() + publisher->get_intra_process_subscription_count() > 0)
+		{
+			nLevels = i + 1;
+			break;
+		}
+	}
+
+	const sensor_msgs::msg::Image	*pSrc = &msg;
+	PyramidSource					 source = cam.pyramidSource;
+	for (int i=0; i<nLevels; i++)
+	{
+		std::unique_ptr<sensor_msgs::msg::Image>	&pDst = cam.pyramid[i].pMsg;
+		int											 width = pSrc->width / 2;
+		int											 height = pSrc->height / 2;
+		int											 nbytesPixel = source == PYRAMID_MONO8 ? 1 : (source == PYRAMID_MONO16 ? 2 : 3);
+
+		if (!pDst)
+			pDst.reset (new sensor_msgs::msg::Image);
+		pDst->header = msg.header;
+		pDst->width = width;
+		pDst->height = height;
+		pDst->encoding = source == PYRAMID_BAYER8 ? (m_bConvertBgr ? "bgr8" : "rgb8") : pSrc->encoding;
+		pDst->is_bigendian = pSrc->is_bigendian;
+		pDst->step = width * nbytesPixel;
+		pDst->data.resize ((size_t)pDst->step * height);
+
+		const uint8_t	*pIn = pSrc->data.data();
+		size_t			 stepIn = pSrc->step;
+		uint8_t			*pOut = pDst->data.data();
+		size_t			 stepOut = pDst->step;
+		cam.stripes.Run (height, [&](int yBegin, int yEnd)
+		{
+			if (source == PYRAMID_BAYER8)
+				HalveBayerRows (cam.conversion.pattern, m_bConvertBgr, pIn, stepIn, pOut, stepOut, width, yBegin, yEnd);
+			else
+				HalveRows (source, pIn, stepIn, pOut, stepOut, width, yBegin, yEnd);
+		}, 1);
+
+		if (source == PYRAMID_BAYER8)
+			source = PYRAMID_COLOR8;
+		pSrc = pDst.get();
+	}
+
+	for (int i=0; i<nLevels; i++)
+	{
+		if (m_bIntraProcess)
+			cam.pyramid[i].publisher->publish(std::move(cam.pyramid[i].pMsg));
+		else
+			cam.pyramid[i].publisher->publish(*cam.pyramid[i].pMsg);
+	}
+} // PublishPyramid()
+
+} // namespace camera_aravis
@@ -0,0 +1,309 @@
+// Copyright 2016 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "camera_aravis/camera_node.h"
+#include "camera_aravis/util.h"
+
+namespace camera_aravis
+{
+
+// ApplyFormat()
+// Binning, then pixel format, then region: each can change what the next one allows.
+// A region without a size keeps the current size, unless the binning changes it.
+// Returns whether it set the region.
+bool CameraNode::ApplyFormat(CameraState &cam, const CameraConfig &config)
+{
+	bool	bBinning = cam.isImplementedBinning &&
+	                   ((config.dxBinning > 0 && config.dxBinning != cam.dxBinning) || (config.dyBinning > 0 && config.dyBinning != cam.dyBinning));
+	int		width = config.width > 0 ? config.width : (bBinning ? 0 : cam.widthRoi);
+	int		height = config.height > 0 ? config.height : (bBinning ? 0 : cam.heightRoi);
+
+	// Aravis leaves an axis given as 0 as it is.
+	if (cam.isImplementedBinning && (config.dxBinning > 0 || config.dyBinning > 0))
+		arv_camera_set_binning (cam.pCamera, config.dxBinning, config.dyBinning);
+	if (!config.stPixelformat.empty())
+		arv_device_set_string_feature_value(cam.pDevice, "PixelFormat", config.stPixelformat.c_str());
+	if (width <= 0 || height <= 0)
+		return false;
+
+	arv_camera_set_region (cam.pCamera, config.x, config.y, width, height);
+	return true;
+} // ApplyFormat()
+
+
+// ApplyControls()
+// Exposure, gain, focus and frame rate, which the camera takes while acquiring.  Auto
+// exposure starts again from what they are now.
+void CameraNode::ApplyControls(CameraState &cam, const CameraConfig &config)
+{
+	if (config.usExposure >= 0.0 && cam.isImplementedExposureTimeAbs)
+	{
+		if (cam.isImplementedExposureAuto)
+			arv_device_set_string_feature_value(cam.pDevice, "ExposureAuto", "Off");
+		arv_device_set_float_feature_value(cam.pDevice, "ExposureTimeAbs", config.usExposure);
+	}
+	if (config.gain >= 0.0 && cam.isImplementedGain)
+	{
+		if (cam.isImplementedGainAuto)
+			arv_device_set_string_feature_value(cam.pDevice, "GainAuto", "Off");
+		arv_camera_set_gain (cam.pCamera, config.gain);	// Gain, or GainRaw on older cameras.
+	}
+	if (config.focus >= 0 && cam.isImplementedFocusPos)
+		arv_device_set_integer_feature_value(cam.pDevice, "FocusPos", config.focus);
+	if (config.fps > 0.0 && cam.keyAcquisitionFrameRate)
+	{
+		arv_device_set_float_feature_value(cam.pDevice, cam.keyAcquisitionFrameRate, config.fps);
+		cam.fps = arv_device_get_float_feature_value(cam.pDevice, cam.keyAcquisitionFrameRate);
+		cam.bIdle = false;
+	}
+	StartExposureControl (cam);
+} // ApplyControls()
+
+
+// Reconfigure()
+// Change the region, binning or pixel format while streaming.  Acquisition stops only
+// while the camera takes the new format.  Everything of the old one is out of the way
+// before the geometry changes: the threads stop, unpublished frames go back to the
+// stream, the encoders finish, and if the messages would differ in size, width, height
+// or encoding, the stream goes too, with any frames still in it.  The pool carries over
+// when the payload is the same size.  A format the camera does not take exactly is
+// undone, and acquisition resumes as it was.
+bool CameraNode::Reconfigure(CameraState &cam, const CameraConfig &config, std::string &stError)
+{
+	std::lock_guard<std::mutex> lock(cam.mutexDevice);
+	const int		xPrev = cam.xRoi;
+	const int		yPrev = cam.yRoi;
+	const int		widthPrev = cam.widthRoi;
+	const int		heightPrev = cam.heightRoi;
+	const int		dxBinningPrev = cam.dxBinning;
+	const int		dyBinningPrev = cam.dyBinning;
+	const guint32	pixelformatPrev = cam.pixelformat;
+	const bool		bPyramidPrev = cam.pyramidSource != PYRAMID_NONE;
+	gint			nInput = 0;
+	gint			nOutput = 0;
+	bool			bAccepted = true;
+
+	if (cam.pPlayer)
+	{
+		stError = "a recording has a fixed format";
+		return false;
+	}
+	if (!cam.pStream || cam.bControlLost)
+	{
+		stError = "not connected";
+		return false;
+	}
+	if (!cam.isImplementedBinning && (config.dxBinning > 1 || config.dyBinning > 1))
+	{
+		stError = "no binning on this camera";
+		return false;
+	}
+
+	int64_t nsStop = NowNs();
+	cam.trigger.Pause();
+	arv_device_execute_command (cam.pDevice, "AcquisitionStop");
+	unsigned nDiscarded = StopThreads (cam);
+	cam.compress.Flush();
+	m_sync.Flush (cam.iCamera);
+
+	bool bRegion = ApplyFormat (cam, config);
+	ReadFormat (cam);
+	if ((config.width > 0 && cam.widthRoi != config.width) || (config.height > 0 && cam.heightRoi != config.height) ||
+		(bRegion && (cam.xRoi != config.x || cam.yRoi != config.y)) ||
+		(config.dxBinning > 0 && cam.dxBinning != config.dxBinning) || (config.dyBinning > 0 && cam.dyBinning != config.dyBinning) ||
+		(!config.stPixelformat.empty() && g_ascii_strcasecmp(cam.stPixelformat.c_str(), config.stPixelformat.c_str()) != 0))
+	{
+		char sz[128];
+		snprintf(sz, sizeof(sz), "the camera made it %d,%d %dx%d, binning %dx%d, %s", cam.xRoi, cam.yRoi, cam.widthRoi, cam.heightRoi,
+			cam.dxBinning, cam.dyBinning, cam.stPixelformat.c_str());
+		stError = sz;
+		bAccepted = false;
+
+		cam.xRoi = xPrev;
+		cam.yRoi = yPrev;
+		cam.widthRoi = widthPrev;
+		cam.heightRoi = heightPrev;
+		cam.dxBinning = dxBinningPrev;
+		cam.dyBinning = dyBinningPrev;
+		cam.pixelformat = pixelformatPrev;
+		RestoreConfiguration (cam);
+		ReadFormat (cam);
+	}
+
+	if (cam.widthRoi != widthPrev || cam.heightRoi != heightPrev || cam.pixelformat != pixelformatPrev ||
+		(size_t)arv_camera_get_payload (cam.pCamera) != cam.framepool.nbytesPayload())
+	{
+		arv_stream_get_n_buffers ((ArvStream *)cam.pStream, &nInput, &nOutput);
+		nDiscarded += nOutput;
+		g_object_unref (cam.pStream);
+		cam.pStream = CreateStream (cam, true);
+		cam.nUnderrunsPrev = 0;
+		cam.nStreams++;
+		if (!cam.pStream)
+		{
+			// Left to the reconnect to sort out, triggers included.
+			stError = "could not create the stream";
+			cam.nsControlLost = NowNs();
+			cam.bControlLost = true;
+			return false;
+		}
+	}
+
+	// The outputs follow the new encoding.
+	if (!cam.pyramid.empty())
+	{
+		cam.pyramidSource = PyramidSourceFor (cam.stEncoding);
+		if (cam.pyramidSource == PYRAMID_NONE && bPyramidPrev)
+			RCLCPP_WARN ( get_logger(), "%s: No image pyramid for %s images.", cam.stName.c_str(), cam.stEncoding.c_str());
+	}
+	if (cam.conversion.kind != CONVERSION_NONE && cam.stripes.nThreads() == 1)
+		cam.stripes.Start (ConvertThreads ((int)m_cameras.size()));
+	SizeShm (cam);
+	if (cam.pInfoManager)
+		UpdateCalibration (cam);
+
+	cam.nReconfigureDiscarded = nDiscarded;
+	cam.nsReconfigureStop = nsStop;
+	cam.nReconfigures++;
+	StartAcquisition (cam);
+	cam.trigger.Resume();
+	RCLCPP_INFO ( get_logger(), "%s: %s %d,%d %dx%d, binning %dx%d, %s as %s; stopped for %.1f ms", cam.stName.c_str(),
+		bAccepted ? "Now" : "Kept", cam.xRoi, cam.yRoi, cam.widthRoi, cam.heightRoi, cam.dxBinning, cam.dyBinning,
+		cam.stPixelformat.c_str(), cam.stEncoding.c_str(), (NowNs() - nsStop) / 1e6);
+
+	return bAccepted;
+} // Reconfigure()
+
+
+// Parameters_callback()
+// Apply changed camera settings to every camera: the controls as they are, the region,
+// binning and pixel format through Reconfigure().  Refused, with the reason, if a camera
+// does not take them; the others are then put back as they were.
+rcl_interfaces::msg::SetParametersResult CameraNode::Parameters_callback(const std::vector<rclcpp::Parameter> &parameters)
+{
+	rcl_interfaces::msg::SetParametersResult	result;
+	CameraConfig								config = m_config;
+	bool										bFormat = false;
+	bool										bControls = false;
+
+	result.successful = true;
+	try
+	{
+		for (const rclcpp::Parameter &parameter : parameters)
+		{
+			const std::string &stName = parameter.get_name();
+
+			if (stName == "roi.x")						{ config.x = (int)parameter.as_int();			bFormat = true; }
+			else if (stName == "roi.y")					{ config.y = (int)parameter.as_int();			bFormat = true; }
+			else if (stName == "roi.width")				{ config.width = (int)parameter.as_int();		bFormat = true; }
+			else if (stName == "roi.height")			{ config.height = (int)parameter.as_int();		bFormat = true; }
+			else if (stName == "binning.horizontal")	{ config.dxBinning = (int)parameter.as_int();	bFormat = true; }
+			else if (stName == "binning.vertical")		{ config.dyBinning = (int)parameter.as_int();	bFormat = true; }
+			else if (stName == "pixel_format")			{ config.stPixelformat = parameter.as_string();	bFormat = true; }
+			else if (stName == "frame_rate")			{ config.fps = parameter.as_double();			bControls = true; }
+			else if (stName == "exposure_time")			{ config.usExposure = parameter.as_double();	bControls = true; }
+			else if (stName == "gain")					{ config.gain = parameter.as_double();			bControls = true; }
+			else if (stName == "focus_pos")				{ config.focus = (int)parameter.as_int();		bControls = true; }
+		}
+	}
+	catch (const rclcpp::ParameterTypeException &e)
+	{
+		result.successful = false;
+		result.reason = e.what();
+		return result;
+	}
+
+	if (config.x < 0 || config.y < 0 || config.width < 0 || config.height < 0 || config.dxBinning < 0 || config.dyBinning < 0)
+	{
+		result.successful = false;
+		result.reason = "The region and binning cannot be negative.";
+		return result;
+	}
+
+	// The format goes to each camera in turn; if one refuses it, those already changed
+	// go back to what they had, so cameras and parameters keep agreeing.
+	if (bFormat)
+	{
+		std::vector<CameraConfig>	formatsPrev;
+		size_t						nChanged = 0;
+
+		for (; nChanged<m_cameras.size(); nChanged++)
+		{
+			CameraState	&cam = *m_cameras[nChanged];
+			CameraConfig	 configPrev = m_config;
+			std::string	 stError;
+
+			{
+				std::lock_guard<std::mutex> lock(cam.mutexDevice);
+				configPrev.x = cam.xRoi;
+				configPrev.y = cam.yRoi;
+				configPrev.width = cam.widthRoi;
+				configPrev.height = cam.heightRoi;
+				configPrev.dxBinning = cam.dxBinning;
+				configPrev.dyBinning = cam.dyBinning;
+				if (cam.pDevice && !cam.pPlayer)
+				{
+					const char *szPixelformat = arv_device_get_string_feature_value(cam.pDevice, "PixelFormat");
+					configPrev.stPixelformat = szPixelformat ? szPixelformat : "";
+				}
+			}
+			formatsPrev.push_back(configPrev);
+
+			if (!Reconfigure (cam, config, stError))
+			{
+				RCLCPP_WARN ( get_logger(), "%s: Format not changed: %s", cam.stName.c_str(), stError.c_str());
+				result.successful = false;
+				result.reason = cam.stName + ": " + stError;
+				break;
+			}
+		}
+		if (!result.successful)
+		{
+			for (size_t i=0; i<nChanged; i++)
+			{
+				CameraState	&cam = *m_cameras[i];
+				std::string	 stError;
+
+				if (!Reconfigure (cam, formatsPrev[i], stError))
+					RCLCPP_WARN ( get_logger(), "%s: Format not restored: %s", cam.stName.c_str(), stError.c_str());
+			}
+			SharePacketDelays();
+			return result;
+		}
+	}
+
+	for (auto &pCam : m_cameras)
+	{
+		CameraState	&cam = *pCam;
+
+		std::lock_guard<std::mutex> lock(cam.mutexDevice);
+		if (bControls && cam.pDevice && !cam.bControlLost)
+			ApplyControls (cam, config);
+	}
+
+	m_config = config;
+
+	// The cameras' shares of their links follow what they now send.
+	if (bFormat || bControls)
+		SharePacketDelays();
+
+	return result;
+} // Parameters_callback()
+
+} // namespace camera_aravis
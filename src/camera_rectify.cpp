@@ -0,0 +1,197 @@
+// Copyright 2016 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+
+#include <cstring>
+#include <memory>
+#include <string>
+
+#include "camera_aravis/camera_node.h"
+#include "camera_aravis/util.h"
+
+namespace camera_aravis
+{
+
+template <typename T>
+static bool Subscribed(const T &publisher)
+{
+	return publisher->get_subscription_count() + publisher->get_intra_process_subscription_count() > 0;
+}
+
+
+// CreateCalibration()
+// camera_info beside the image topic, from the camera's calibration file, and image_rect
+// if asked for.  With several cameras each one's set_camera_info service goes in its own
+// namespace, like its topics.
+void CameraNode::CreateCalibration(CameraState &cam, const std::string &stTopic, const std::string &stUrl, bool bRectify)
+{
+	std::string stPrefix = stTopic.substr(0, stTopic.size() - std::string("image").size());
+
+	if (!stPrefix.empty())
+		cam.pNodeCalibration = create_sub_node (cam.stName);
+	cam.pInfoManager = std::make_shared<camera_info_manager::CameraInfoManager>(cam.pNodeCalibration ? cam.pNodeCalibration.get() : this, cam.stName, stUrl);
+	cam.pubInfo = create_publisher<sensor_msgs::msg::CameraInfo>(stPrefix + "camera_info", ImageQoS());
+	if (bRectify)
+		cam.pubRect = create_publisher<sensor_msgs::msg::Image>(stPrefix + "image_rect", ImageQoS());
+
+	UpdateCalibration (cam);
+	RCLCPP_INFO ( get_logger(), "%s: %s camera_info on %s%s%s", cam.stName.c_str(), cam.pInfoManager->isCalibrated() ? "Calibrated" : "Uncalibrated",
+		cam.pubInfo->get_topic_name(), cam.pubRect ? ", rectified image on " : "", cam.pubRect ? cam.pubRect->get_topic_name() : "");
+} // CreateCalibration()
+
+
+// UpdateCalibration()
+// The camera_info for the current geometry, and the rectification map for it.  Called at
+// start, after each reconfiguration and once a second for set_camera_info; does nothing
+// unless the calibration or the geometry changed.  Per REP 104, width and height stay
+// those of the calibration, and a region or binning of it goes in roi and binning_x/y.
+// A calibration of the image as delivered needs neither; one of the full sensor is
+// scaled to the region and binning; any other is published but not rectified with.
+void CameraNode::UpdateCalibration(CameraState &cam)
+{
+	sensor_msgs::msg::CameraInfo	info = cam.pInfoManager->getCameraInfo();
+	bool							bCalibrated = cam.pInfoManager->isCalibrated();
+	ImageWindow						window = {0, 0, 1, 1, cam.widthRoi, cam.heightRoi};
+
+	if (bCalibrated && ((int)info.width != cam.widthRoi || (int)info.height != cam.heightRoi))
+	{
+		if ((int)info.width == cam.widthSensor && (int)info.height == cam.heightSensor)
+			window = {cam.xRoi * cam.dxBinning, cam.yRoi * cam.dyBinning, cam.dxBinning, cam.dyBinning, cam.widthRoi, cam.heightRoi};
+		else
+			window.width = 0;
+	}
+
+	if (std::atomic_load (&cam.pCameraInfo) && info == cam.infoCalibration && !memcmp(&window, &cam.windowCalibration, sizeof(window)))
+		return;
+	cam.infoCalibration = info;
+	cam.windowCalibration = window;
+
+	auto pInfo = std::make_shared<sensor_msgs::msg::CameraInfo>(info);
+	if (!bCalibrated)
+	{
+		pInfo->width = cam.widthRoi;
+		pInfo->height = cam.heightRoi;
+	}
+	else if (window.width == 0)
+		RCLCPP_WARN ( get_logger(), "%s: Calibrated at %ux%u, but the image is %dx%d of a %dx%d sensor; not rectifying.", cam.stName.c_str(),
+			info.width, info.height, cam.widthRoi, cam.heightRoi, cam.widthSensor, cam.heightSensor);
+	else if (window.dx > 1 || window.dy > 1 || window.x || window.y || window.width * window.dx != (int)info.width || window.height * window.dy != (int)info.height)
+	{
+		pInfo->binning_x = window.dx;
+		pInfo->binning_y = window.dy;
+		pInfo->roi.x_offset = window.x;
+		pInfo->roi.y_offset = window.y;
+		pInfo->roi.width = window.width * window.dx;
+		pInfo->roi.height = window.height * window.dy;
+		pInfo->roi.do_rectify = pInfo->roi.width != info.width || pInfo->roi.height != info.height;
+	}
+	std::atomic_store (&cam.pCameraInfo, std::shared_ptr<const sensor_msgs::msg::CameraInfo>(pInfo));
+
+	if (!cam.pubRect)
+		return;
+
+	std::shared_ptr<RectifyMap> pMap;
+	if (bCalibrated && window.width)
+	{
+		Calibration	calibration;
+		std::string	stError;
+
+		calibration.width = info.width;
+		calibration.height = info.height;
+		calibration.stModel = info.distortion_model;
+		calibration.D = info.d;
+		memcpy(calibration.K, info.k.data(), sizeof(calibration.K));
+		memcpy(calibration.R, info.r.data(), sizeof(calibration.R));
+		memcpy(calibration.P, info.p.data(), sizeof(calibration.P));
+
+		int64_t nsStart = NowNs();
+		pMap = std::make_shared<RectifyMap>();
+		if (pMap->Build (calibration, window, stError))
+			RCLCPP_INFO ( get_logger(), "%s: Rectification map for %dx%d at %d,%d binning %dx%d: %.1f MB in %.0f ms", cam.stName.c_str(),
+				window.width, window.height, window.x, window.y, window.dx, window.dy, pMap->nbytes() / 1e6, (NowNs() - nsStart) / 1e6);
+		else
+		{
+			RCLCPP_WARN ( get_logger(), "%s: Not rectifying: %s", cam.stName.c_str(), stError.c_str());
+			pMap.reset();
+		}
+	}
+	if (pMap && RectifySourceFor (cam.stEncoding) == RECTIFY_NONE)
+		RCLCPP_WARN ( get_logger(), "%s: Cannot rectify %s images%s.", cam.stName.c_str(), cam.stEncoding.c_str(),
+			cam.stEncoding.compare(0, 6, "bayer_") == 0 ? "; set convert to demosaic them" : "");
+	std::atomic_store (&cam.pRectifyMap, std::shared_ptr<const RectifyMap>(pMap));
+} // UpdateCalibration()
+
+
+// PublishCalibration()
+// camera_info with the header of each frame, and the frame rectified, each only while
+// subscribed.  The map is swapped whole by UpdateCalibration(), so a frame is rectified
+// with one map or the other, never a mix.
+void CameraNode::PublishCalibration(CameraState &cam, const sensor_msgs::msg::Image &msg)
+{
+	if (!cam.pubInfo)
+		return;
+
+	if (Subscribed (cam.pubInfo))
+	{
+		std::shared_ptr<const sensor_msgs::msg::CameraInfo> pInfo = std::atomic_load (&cam.pCameraInfo);
+		std::unique_ptr<sensor_msgs::msg::CameraInfo> pOut (new sensor_msgs::msg::CameraInfo(*pInfo));
+
+		pOut->header = msg.header;
+		cam.pubInfo->publish(std::move(pOut));
+	}
+
+	if (!cam.pubRect || !Subscribed (cam.pubRect))
+		return;
+
+	std::shared_ptr<const RectifyMap>	pMap = std::atomic_load (&cam.pRectifyMap);
+	RectifySource						source = RectifySourceFor (msg.encoding);
+	if (!pMap || source == RECTIFY_NONE || pMap->width() != (int)msg.width || pMap->height() != (int)msg.height)
+	{
+		cam.nRectifySkipped++;
+		return;
+	}
+
+	std::unique_ptr<sensor_msgs::msg::Image>	&pDst = cam.pRectified;
+	int											 nbytesPixel = source == RECTIFY_MONO8 ? 1 : (source == RECTIFY_MONO16 ? 2 : 3);
+
+	if (!pDst)
+		pDst.reset (new sensor_msgs::msg::Image);
+	pDst->header = msg.header;
+	pDst->width = msg.width;
+	pDst->height = msg.height;
+	pDst->encoding = msg.encoding;
+	pDst->is_bigendian = msg.is_bigendian;
+	pDst->step = msg.width * nbytesPixel;
+	pDst->data.resize ((size_t)pDst->step * msg.height);
+
+	const uint8_t	*pIn = msg.data.data();
+	size_t			 stepIn = msg.step;
+	uint8_t			*pOut = pDst->data.data();
+	size_t			 stepOut = pDst->step;
+	int64_t			 nsStart = NowNs();
+	cam.stripes.Run (msg.height, [&](int yBegin, int yEnd)
+	{
+		pMap->Remap (source, pIn, stepIn, pOut, stepOut, yBegin, yEnd);
+	}, RectifyMap::nTileHeight);
+	cam.histRectify.Record (NowNs() - nsStart);
+	cam.nRectified++;
+
+	if (m_bIntraProcess)
+		cam.pubRect->publish(std::move(cam.pRectified));
+	else
+		cam.pubRect->publish(*cam.pRectified);
+} // PublishCalibration()
+
+} // namespace camera_aravis
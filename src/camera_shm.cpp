@@ -0,0 +1,114 @@
+// Copyright 2016 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include <algorithm>
+#include <memory>
+#include <string>
+
+#include "camera_aravis/camera_node.h"
+#include "camera_aravis/util.h"
+
+namespace camera_aravis
+{
+
+// CreateShm()
+// The descriptor publisher and the ring behind it.  A descriptor outliving its frame is
+// no use, so the queue holds at most half the ring.
+void CameraNode::CreateShm(CameraState &cam, const std::string &stTopic)
+{
+	if (m_nShmSlots <= 0)
+		return;
+
+	rclcpp::QoS qos = ImageQoS();
+	qos.keep_last (std::max(1, std::min(m_qosPolicy == QOS_LATEST ? 1 : m_nQosDepth, m_nShmSlots / 2)));
+	cam.pubShm = create_publisher<camera_aravis::msg::ShmFrame>(stTopic + "/shm", qos);
+	SizeShm (cam);
+	if (cam.shm.IsOpen())
+		RCLCPP_INFO ( get_logger(), "%s: Shared memory %s, %u x %lu bytes, described on %s", cam.stName.c_str(),
+			cam.shm.Name().c_str(), cam.shm.nSlots(), (unsigned long)cam.shm.nbytesSlot(), cam.pubShm->get_topic_name());
+} // CreateShm()
+
+
+// SizeShm()
+// Make the slots fit the published frames, from the payload or the converted geometry.
+// A bigger ring is a new generation: readers map it again at the next descriptor.
+// Only while the publish thread is stopped.
+void CameraNode::SizeShm(CameraState &cam)
+{
+	std::string	stError;
+	size_t		nbytes;
+
+	if (!cam.pubShm)
+		return;
+
+	if (cam.conversion.kind != CONVERSION_NONE)
+		nbytes = cam.conversion.DstStep(cam.widthRoi) * cam.heightRoi;
+	else
+		nbytes = cam.framepool.nbytesPayload();
+	if (cam.shm.IsOpen() && nbytes <= cam.shm.nbytesSlot())
+		return;
+
+	bool bResize = cam.shm.IsOpen();
+	if (!cam.shm.Create ("camera_aravis_" + cam.stName, nbytes, (unsigned)m_nShmSlots, stError))
+		RCLCPP_ERROR ( get_logger(), "%s: No shared memory output: %s", cam.stName.c_str(), stError.c_str());
+	else if (bResize)
+		RCLCPP_INFO ( get_logger(), "%s: Shared memory slots now %lu bytes", cam.stName.c_str(), (unsigned long)nbytes);
+} // SizeShm()
+
+
+// PublishShm()
+// Copy the frame into the ring and publish where it is.  The copy costs a frame of memory
+// bandwidth, so it is only made while someone takes the descriptors.
+void CameraNode::PublishShm(CameraState &cam, const sensor_msgs::msg::Image &msg)
+{
+	if (!cam.pubShm || !cam.shm.IsOpen() ||
+		cam.pubShm->get_subscription_count() + cam.pubShm->get_intra_process_subscription_count() == 0)
+		return;
+
+	int64_t			nsStart = NowNs();
+	ShmFrameInfo	info;
+	uint32_t		iSlot = 0;
+
+	info.nsStamp = (int64_t)msg.header.stamp.sec * 1000000000LL + msg.header.stamp.nanosec;
+	info.width = msg.width;
+	info.height = msg.height;
+	info.step = msg.step;
+	info.szEncoding = msg.encoding.c_str();
+	uint64_t sequence = cam.shm.Write (msg.data.data(), msg.data.size(), info, iSlot);
+	if (sequence == 0)
+	{
+		cam.nShmTooLarge++;
+		return;
+	}
+	int64_t nsWritten = NowNs();
+	cam.histShmWrite.Record (nsWritten - nsStart);
+	cam.nShmWritten++;
+
+	std::unique_ptr<camera_aravis::msg::ShmFrame> pDesc (new camera_aravis::msg::ShmFrame);
+	pDesc->header = msg.header;
+	pDesc->shm_name = cam.shm.Name();
+	pDesc->generation = cam.shm.Generation();
+	pDesc->slot = iSlot;
+	pDesc->sequence = sequence;
+	pDesc->height = msg.height;
+	pDesc->width = msg.width;
+	pDesc->encoding = msg.encoding;
+	pDesc->step = msg.step;
+	pDesc->nbytes = (uint32_t)msg.data.size();
+	pDesc->written_ns = nsWritten;
+	cam.pubShm->publish (std::move(pDesc));
+} // PublishShm()
+
+} // namespace camera_aravis
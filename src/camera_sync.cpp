@@ -0,0 +1,86 @@
+// Copyright 2016 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+
+#include <memory>
+#include <string>
+
+#include "camera_aravis/camera_node.h"
+
+namespace camera_aravis
+{
+
+// StartSync()
+// The frame_set publisher and the matcher behind it.  Without a tolerance, half a frame
+// period, at the trigger rate or else the first camera's frame rate: free-running cameras
+// are up to that far out of phase, and triggered ones much closer.
+void CameraNode::StartSync(double usTolerance, double msTimeout, int nWindow, bool bIncomplete)
+{
+	if (m_cameras.size() < 2)
+	{
+		RCLCPP_WARN ( get_logger(), "sync needs more than one camera.");
+		return;
+	}
+
+	if (usTolerance <= 0.0)
+	{
+		double hz = m_dTriggerRate > 0.0 ? m_dTriggerRate : m_cameras[0]->fps;
+		usTolerance = hz > 0.0 ? 0.5e6 / hz : 5000.0;
+	}
+
+	m_pubFrameSet = create_publisher<camera_aravis::msg::FrameSet>("frame_set", ImageQoS());
+	if (m_bTensor)
+		m_pubSetTensor = create_publisher<camera_aravis::msg::Tensor>("frame_set/tensor", ImageQoS());
+	m_sync.Start ((int)m_cameras.size(), nWindow, (int64_t)(usTolerance * 1e3), (int64_t)(msTimeout * 1e6), bIncomplete,
+		std::bind (&CameraNode::PublishFrameSet, this, std::placeholders::_1, std::placeholders::_2, std::placeholders::_3));
+	RCLCPP_INFO ( get_logger(), "Frame sets of %d cameras on %s, within %.0f us, waiting up to %.0f ms%s", (int)m_cameras.size(),
+		m_pubFrameSet->get_topic_name(), usTolerance, msTimeout, bIncomplete ? ", incomplete ones too" : "");
+} // StartSync()
+
+
+// PublishFrameSet()
+// On the matcher's thread.  The message owns its images, so each frame is copied into it
+// once; the frames themselves go back to their pools when the set is let go.  Each output
+// is made only while subscribed.
+void CameraNode::PublishFrameSet(const FrameSync::FrameSet &set, int64_t nsSkew, bool bComplete)
+{
+	if (m_pubSetTensor && m_pubSetTensor->get_subscription_count() + m_pubSetTensor->get_intra_process_subscription_count() > 0)
+		PublishSetTensor (set);
+	if (m_pubFrameSet->get_subscription_count() + m_pubFrameSet->get_intra_process_subscription_count() == 0)
+		return;
+
+	std::unique_ptr<camera_aravis::msg::FrameSet>	pMsg (new camera_aravis::msg::FrameSet);
+	bool											bStamped = false;
+
+	pMsg->camera_names.resize(set.size());
+	pMsg->images.resize(set.size());
+	for (size_t i=0; i<set.size(); i++)
+	{
+		pMsg->camera_names[i] = m_cameras[i]->stName;
+		if (!set[i])
+			continue;
+
+		const auto &stamp = set[i]->header.stamp;
+		if (!bStamped || stamp.sec < pMsg->header.stamp.sec || (stamp.sec == pMsg->header.stamp.sec && stamp.nanosec < pMsg->header.stamp.nanosec))
+			pMsg->header.stamp = stamp;
+		bStamped = true;
+		pMsg->images[i] = *set[i];
+	}
+	pMsg->skew_ns = nsSkew;
+	pMsg->complete = bComplete;
+	m_pubFrameSet->publish(std::move(pMsg));
+} // PublishFrameSet()
+
+} // namespace camera_aravis
@@ -0,0 +1,200 @@
+// Copyright 2016 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+
+#include <memory>
+#include <string>
+
+#include "camera_aravis/camera_node.h"
+#include "camera_aravis/util.h"
+
+namespace camera_aravis
+{
+
+// The tensor input for frames as acquired, by the lower-cased GenICam pixel format: mono,
+// Bayer and rgb/bgr, of 8 bits or unpacked in 16.  Packed and yuv formats have none.
+static TensorInput RawTensorInput(const CameraState &cam)
+{
+	const std::string	&st = cam.stPixelformat;
+	const char			*szBits = cam.nBitsPixel == 8 ? "8" : (cam.nBitsPixel == 16 ? "16" : "");
+	std::string			 stEncoding;
+
+	if (st.compare(0, 4, "mono") == 0 && st.find("packed") == std::string::npos)
+		stEncoding = std::string("mono") + szBits;
+	else if (st.compare(0, 5, "bayer") == 0 && st.size() >= 7 && st.find("packed") == std::string::npos)
+	{
+		std::string stPattern = st.substr(5, 2);
+
+		if (stPattern == "rg")
+			stEncoding = std::string("bayer_rggb") + szBits;
+		else if (stPattern == "bg")
+			stEncoding = std::string("bayer_bggr") + szBits;
+		else if (stPattern == "gr")
+			stEncoding = std::string("bayer_grbg") + szBits;
+		else if (stPattern == "gb")
+			stEncoding = std::string("bayer_gbrg") + szBits;
+	}
+	else if (st == "rgb8" || st == "rgb8packed")
+		stEncoding = "rgb8";
+	else if (st == "bgr8" || st == "bgr8packed")
+		stEncoding = "bgr8";
+	return TensorInputFor (stEncoding, SignificantBits (st, 16));
+}
+
+
+// The message shaped for nBatch images from conv; the images already in it are kept only if
+// they are of the same shape.
+static camera_aravis::msg::Tensor *ShapeTensor(std::unique_ptr<camera_aravis::msg::Tensor> &pMsg, const TensorConverter &conv,
+	const TensorSpec &spec, int nBatch)
+{
+	const uint8_t dtype = conv.IsHalf() ? camera_aravis::msg::Tensor::FLOAT16 : camera_aravis::msg::Tensor::FLOAT32;
+
+	if (!pMsg)
+		pMsg.reset (new camera_aravis::msg::Tensor);
+	if ((int)pMsg->batch != nBatch || (int)pMsg->channels != conv.nChannels() || (int)pMsg->height != conv.height() ||
+		(int)pMsg->width != conv.width() || pMsg->dtype != dtype)
+		pMsg->images.clear();
+
+	pMsg->batch = nBatch;
+	pMsg->channels = conv.nChannels();
+	pMsg->height = conv.height();
+	pMsg->width = conv.width();
+	pMsg->channel_order = conv.nChannels() == 1 ? "mono" : (spec.bBgr ? "bgr" : "rgb");
+	pMsg->mean.assign(spec.mean, spec.mean + conv.nChannels());
+	pMsg->std.assign(spec.std, spec.std + conv.nChannels());
+	pMsg->dtype = dtype;
+	pMsg->data.resize(conv.nbytes() * nBatch);
+	return pMsg.get();
+}
+
+
+// CreateTensor()
+void CameraNode::CreateTensor(CameraState &cam, const std::string &stTopic)
+{
+	if (!m_bTensor)
+		return;
+
+	cam.pubTensor = create_publisher<camera_aravis::msg::Tensor>(stTopic + "/tensor", ImageQoS());
+	RCLCPP_INFO ( get_logger(), "%s: Tensors of %d image%s on %s, %s", cam.stName.c_str(), m_nTensorBatch, m_nTensorBatch > 1 ? "s" : "",
+		cam.pubTensor->get_topic_name(), m_tensorSpec.bHalf ? "fp16" : "float32");
+} // CreateTensor()
+
+
+// PublishTensor()
+// The frame as acquired, before any other conversion, into the next image of the batch
+// under way; the batch goes out when full, stamped with its first image.  Without
+// subscribers the batch is let go, so that the next one starts with a current frame.
+void CameraNode::PublishTensor(CameraState &cam, ArvBuffer *pBuffer, int64_t nsStamp)
+{
+	size_t			nbytes = 0;
+	const uint8_t	*pData = (const uint8_t *)arv_buffer_get_data (pBuffer, &nbytes);
+	const size_t	step = ((size_t)cam.widthRoi * cam.nBitsPixel + 7) / 8;
+	std::string		stError;
+
+	if (cam.pubTensor->get_subscription_count() + cam.pubTensor->get_intra_process_subscription_count() == 0)
+	{
+		if (cam.pTensor)
+			cam.pTensor->images.clear();
+		return;
+	}
+	if (!pData || cam.widthRoi <= 0 || nbytes < step * cam.heightRoi)
+		return;
+	if (!cam.tensor.Configure (RawTensorInput (cam), cam.widthRoi, cam.heightRoi, m_tensorSpec, stError))
+	{
+		RCLCPP_WARN_ONCE ( get_logger(), "%s: No tensor of %s: %s", cam.stName.c_str(), cam.stPixelformat.c_str(), stError.c_str());
+		return;
+	}
+
+	int64_t nsStart = NowNs();
+	camera_aravis::msg::Tensor *pMsg = ShapeTensor (cam.pTensor, cam.tensor, m_tensorSpec, m_nTensorBatch);
+	uint8_t *pOut = pMsg->data.data() + pMsg->images.size() * cam.tensor.nbytes();
+	cam.stripes.Run (cam.tensor.height(), [&](int yBegin, int yEnd)
+	{
+		cam.tensor.ConvertRows (pData, step, pOut, yBegin, yEnd);
+	}, 1);
+	cam.histTensor.Record (NowNs() - nsStart);
+	cam.nTensors++;
+
+	pMsg->images.emplace_back();
+	pMsg->images.back().stamp.sec = (int32_t)(nsStamp / 1000000000LL);
+	pMsg->images.back().stamp.nanosec = (uint32_t)(nsStamp % 1000000000LL);
+	pMsg->images.back().frame_id = cam.stFrameId;
+	if ((int)pMsg->images.size() < m_nTensorBatch)
+		return;
+
+	pMsg->header = pMsg->images.front();
+	if (m_bIntraProcess)
+		cam.pubTensor->publish(std::move(cam.pTensor));
+	else
+	{
+		cam.pubTensor->publish(*pMsg);
+		pMsg->images.clear();
+	}
+} // PublishTensor()
+
+
+// PublishSetTensor()
+// On the matcher's thread: a frame set as one batch, an image per camera in the order of
+// frame_set, each made from the frame as published.  The cameras' images must come out of
+// one shape; a camera whose does not, or that is missing from the set, is left as zeros
+// with a blank header.
+void CameraNode::PublishSetTensor(const FrameSync::FrameSet &set)
+{
+	std::unique_ptr<camera_aravis::msg::Tensor>	pMsg;
+	const TensorConverter						*pFirst = NULL;
+	std::string									 stError;
+
+	for (size_t i=0; i<set.size(); i++)
+	{
+		if (!set[i])
+			continue;
+
+		CameraState						&cam = *m_cameras[i];
+		const sensor_msgs::msg::Image	&image = *set[i];
+		int								 nBits = cam.conversion.kind == CONVERSION_NONE ? SignificantBits (cam.stPixelformat, 16) : 16;
+
+		if (image.data.size() < (size_t)image.step * image.height)
+			continue;
+		if (!cam.tensorSet.Configure (TensorInputFor (image.encoding, nBits), image.width, image.height, m_tensorSpec, stError))
+		{
+			RCLCPP_WARN_ONCE ( get_logger(), "%s: No tensor of %s: %s", cam.stName.c_str(), image.encoding.c_str(), stError.c_str());
+			continue;
+		}
+		if (!pFirst)
+		{
+			pFirst = &cam.tensorSet;
+			ShapeTensor (pMsg, cam.tensorSet, m_tensorSpec, (int)set.size());
+			pMsg->images.resize(set.size());
+			pMsg->header.stamp = image.header.stamp;
+		}
+		else if (cam.tensorSet.nbytes() != pFirst->nbytes() || cam.tensorSet.width() != pFirst->width() || cam.tensorSet.height() != pFirst->height())
+		{
+			RCLCPP_WARN_ONCE ( get_logger(), "%s: The tensor is %dx%dx%d, not %dx%dx%d as the first camera's; left out of frame sets.", cam.stName.c_str(),
+				cam.tensorSet.nChannels(), cam.tensorSet.height(), cam.tensorSet.width(), pFirst->nChannels(), pFirst->height(), pFirst->width());
+			continue;
+		}
+
+		const auto &stamp = image.header.stamp;
+		if (stamp.sec < pMsg->header.stamp.sec || (stamp.sec == pMsg->header.stamp.sec && stamp.nanosec < pMsg->header.stamp.nanosec))
+			pMsg->header.stamp = stamp;
+		cam.tensorSet.ConvertRows (image.data.data(), image.step, pMsg->data.data() + i * cam.tensorSet.nbytes(), 0, cam.tensorSet.height());
+		pMsg->images[i] = image.header;
+	}
+
+	if (pMsg)
+		m_pubSetTensor->publish(std::move(pMsg));
+} // PublishSetTensor()
+
+} // namespace camera_aravis
@@ -0,0 +1,214 @@
+// Copyright 2016 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include <algorithm>
+#include <cstdio>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "camera_aravis/camera_node.h"
+#include "camera_aravis/util.h"
+
+namespace camera_aravis
+{
+
+// The kernel's cap on SO_RCVBUF; a larger socket-buffer-size is silently cut to it.
+static size_t ReceiveBufferMax (void)
+{
+	FILE			*pFile = fopen("/proc/sys/net/core/rmem_max", "r");
+	unsigned long	 nbytes = 0;
+
+	if (pFile)
+	{
+		if (fscanf(pFile, "%lu", &nbytes) != 1)
+			nbytes = 0;
+		fclose(pFile);
+	}
+	return nbytes;
+}
+
+
+// ConfigurePacketSize()
+// The stream packet size: as given by packet_size, or the largest that gets through to
+// this host, jumbo frames included, found by having the camera send test packets.
+void CameraNode::ConfigurePacketSize(CameraState &cam)
+{
+	if (!cam.isImplementedMtu || !ARV_IS_GV_DEVICE (cam.pDevice))
+		return;
+
+	if (m_nPacketSize >= 0)
+	{
+		int64_t nsStart = NowNs();
+		if (m_nPacketSize == 0)
+			arv_camera_gv_auto_packet_size (cam.pCamera);
+		else
+			arv_camera_gv_set_packet_size (cam.pCamera, m_nPacketSize);
+		cam.mtu = (int)arv_device_get_integer_feature_value(cam.pDevice, "GevSCPSPacketSize");
+		RCLCPP_INFO ( get_logger(), "%s: Packet size %d bytes, %s in %.0f ms", cam.stGuid.c_str(), cam.mtu,
+			m_nPacketSize == 0 ? "negotiated" : "set", (NowNs() - nsStart) / 1e6);
+		if (m_nPacketSize > 0 && cam.mtu != m_nPacketSize)
+			RCLCPP_WARN ( get_logger(), "%s: Asked for %d byte packets", cam.stGuid.c_str(), m_nPacketSize);
+	}
+	else
+		cam.mtu = (int)arv_device_get_integer_feature_value(cam.pDevice, "GevSCPSPacketSize");
+
+	// Cameras reached through the same host interface share its link.
+	GSocketAddress *pAddress = arv_gv_device_get_interface_address (ARV_GV_DEVICE (cam.pDevice));
+	if (pAddress)
+	{
+		gchar *szAddress = g_inet_address_to_string (g_inet_socket_address_get_address (G_INET_SOCKET_ADDRESS (pAddress)));
+		cam.stInterface = szAddress;
+		g_free (szAddress);
+	}
+} // ConfigurePacketSize()
+
+
+// ConfigureStreamTransport()
+// Socket buffer and resend timeouts of a new GigE Vision stream.  After a reconnect or a
+// format change the timeouts carry over as adapted.
+void CameraNode::ConfigureStreamTransport(CameraState &cam, ArvGvStream *pStream, size_t nbytesPayload)
+{
+	if (cam.usPacketTimeout == 0)
+	{
+		cam.usPacketTimeout = m_usPacketTimeout;
+		cam.usFrameRetention = m_usFrameRetention;
+	}
+	g_object_set (pStream,
+				  "packet-timeout", cam.usPacketTimeout,
+				  "frame-retention", cam.usFrameRetention,
+				  NULL);
+
+	// Room for whole frames in the socket, so the stream thread can fall behind by that much.
+	if (m_dSocketBufferFrames > 0.0)
+	{
+		size_t nbytesMax = ReceiveBufferMax();
+
+		cam.nbytesSocketBuffer = (size_t)(m_dSocketBufferFrames * nbytesPayload);
+		g_object_set (pStream,
+					  "socket-buffer", ARV_GV_STREAM_SOCKET_BUFFER_FIXED,
+					  "socket-buffer-size", (gint)std::min<size_t>(cam.nbytesSocketBuffer, G_MAXINT),
+					  NULL);
+		if (nbytesMax && nbytesMax < cam.nbytesSocketBuffer)
+			RCLCPP_WARN ( get_logger(), "%s: Socket buffer of %lu bytes is capped at net.core.rmem_max = %lu", cam.stGuid.c_str(),
+				(unsigned long)cam.nbytesSocketBuffer, (unsigned long)nbytesMax);
+	}
+
+	// Resent and missing packets count from zero on a new stream.
+	cam.nResentPrev = 0;
+	cam.nMissingPrev = 0;
+} // ConfigureStreamTransport()
+
+
+// SharePacketDelays()
+// Divide link_bandwidth_mbps between the cameras on each host interface in proportion to
+// what they send, payload times frame rate, and space each camera's packets (GevSCPD) so
+// that it never sends faster than its share.  Bursts from several cameras meeting at the
+// switch are what overflow its buffers and cost resends.
+void CameraNode::SharePacketDelays(void)
+{
+	const double				bpsLink = m_dLinkMbps * 1e6;
+	std::vector<double>			bpsDemand(m_cameras.size(), 0.0);
+	std::map<std::string, double> bpsDemandLink;
+
+	if (m_dLinkMbps <= 0.0)
+		return;
+
+	for (size_t i=0; i<m_cameras.size(); i++)
+	{
+		CameraState &cam = *m_cameras[i];
+		double fps = m_dTriggerRate > 0.0 ? m_dTriggerRate : (cam.fps > 0.0 ? cam.fps : 30.0);
+
+		if (!cam.pDevice || !ARV_IS_GV_DEVICE (cam.pDevice))
+			continue;
+		bpsDemand[i] = cam.framepool.nbytesPayload() * 8.0 * fps;
+		bpsDemandLink[cam.stInterface] += bpsDemand[i];
+	}
+
+	for (auto &link : bpsDemandLink)
+		if (link.second > bpsLink)
+			RCLCPP_WARN ( get_logger(), "Cameras on %s send %.0f Mb/s, over the link bandwidth of %.0f Mb/s", link.first.c_str(), link.second / 1e6, m_dLinkMbps);
+
+	for (size_t i=0; i<m_cameras.size(); i++)
+	{
+		CameraState &cam = *m_cameras[i];
+		std::lock_guard<std::mutex> lock(cam.mutexDevice);
+
+		if (bpsDemand[i] <= 0.0 || !cam.pDevice || cam.bControlLost)
+			continue;
+
+		// Sending a packet takes its size at line rate; the delay stretches that to the share.
+		double bitsPacket = 8.0 * (cam.mtu > 0 ? cam.mtu : 1500);
+		cam.bpsShare = bpsLink * bpsDemand[i] / bpsDemandLink[cam.stInterface];
+		arv_camera_gv_set_packet_delay (cam.pCamera, (gint64)(1e9 * bitsPacket * (1.0 / cam.bpsShare - 1.0 / bpsLink)));
+		cam.nsPacketDelay = arv_camera_gv_get_packet_delay (cam.pCamera);
+		RCLCPP_INFO ( get_logger(), "%s: %.0f of %.0f Mb/s on %s; packet delay %ld ns", cam.stName.c_str(),
+			cam.bpsShare / 1e6, m_dLinkMbps, cam.stInterface.c_str(), (long)cam.nsPacketDelay);
+	}
+} // SharePacketDelays()
+
+
+// AdaptTransport()
+// With transport_adaptive: while packets still go missing after resends, lengthen the
+// packet timeout and the frame retention, giving resends more time; after a quiet while,
+// shorten them back toward packet_timeout_ms and frame_retention_ms, so that a frame that
+// cannot be completed is given up, and its buffer reused, sooner.
+void CameraNode::AdaptTransport(CameraState &cam)
+{
+	const int		nQuietPeriodsToShrink = 10;
+	const unsigned	usRetentionMax = std::max(10 * m_usFrameRetention, 1000000u);
+	guint64			nResent = 0;
+	guint64			nMissing = 0;
+
+	if (!ARV_IS_GV_STREAM (cam.pStream))
+		return;
+
+	arv_gv_stream_get_statistics (cam.pStream, &nResent, &nMissing);
+	guint64 nMissingNew = nMissing - cam.nMissingPrev;
+	guint64 nResentNew = nResent - cam.nResentPrev;
+	cam.nResentPrev = nResent;
+	cam.nMissingPrev = nMissing;
+	if (!m_bTransportAdaptive)
+		return;
+
+	unsigned usTimeout = cam.usPacketTimeout;
+	unsigned usRetention = cam.usFrameRetention;
+	if (nMissingNew > 0)
+	{
+		usRetention = std::min(usRetentionMax, usRetention * 3 / 2);
+		usTimeout = std::min(usRetention / 2, usTimeout * 3 / 2);
+		cam.nTransportQuietPeriods = 0;
+	}
+	else if (nResentNew == 0 && ++cam.nTransportQuietPeriods >= nQuietPeriodsToShrink)
+	{
+		usRetention = std::max(m_usFrameRetention, usRetention * 7 / 8);
+		usTimeout = std::max(m_usPacketTimeout, usTimeout * 7 / 8);
+		cam.nTransportQuietPeriods = 0;
+	}
+
+	if (usTimeout != cam.usPacketTimeout || usRetention != cam.usFrameRetention)
+	{
+		g_object_set (cam.pStream,
+					  "packet-timeout", usTimeout,
+					  "frame-retention", usRetention,
+					  NULL);
+		RCLCPP_INFO ( get_logger(), "%s: %lu packets missing, %lu resent; packet timeout %.0f ms, frame retention %.0f ms", cam.stName.c_str(),
+			(unsigned long)nMissingNew, (unsigned long)nResentNew, usTimeout / 1e3, usRetention / 1e3);
+		cam.usPacketTimeout = usTimeout;
+		cam.usFrameRetention = usRetention;
+	}
+} // AdaptTransport()
+
+} // namespace camera_aravis
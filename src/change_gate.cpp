@@ -0,0 +1,182 @@
+// Copyright 2016 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+
+#include "camera_aravis/change_gate.h"
+#include "camera_aravis/simd.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace camera_aravis
+{
+
+static const int nLanes = 32;
+static const int nTileSamplesMax = 128 * nLanes;
+
+// 16-bit samples down to 8 bits, saturating for samples with fewer than 16 significant bits.
+TARGET_CLONES
+static void NarrowRow16(const uint8_t *pSrc, uint8_t *pDst, int nSamples, int nShift)
+{
+	const v16u16	vZero = {};
+	const v16u16	vMax = vZero + 255;
+	int				x = 0;
+
+	for (; x + 16 <= nSamples; x += 16)
+	{
+		v16u16 a;
+
+		memcpy(&a, pSrc + 2 * x, sizeof(a));
+		a >>= nShift;
+		a = a > 255 ? vMax : a;
+		v16u8 out = __builtin_convertvector(a, v16u8);
+		memcpy(pDst + x, &out, sizeof(out));
+	}
+	for (; x<nSamples; x++)
+	{
+		uint16_t a;
+
+		memcpy(&a, pSrc + 2 * x, 2);
+		a >>= nShift;
+		pDst[x] = (uint8_t)(a > 255 ? 255 : a);
+	}
+}
+
+// Sum of absolute differences of a row, per tile.  Adjacent byte pairs are added into
+// 16-bit lanes, which hold 128 chunks, so tiles are at most nTileSamplesMax wide.
+TARGET_CLONES
+static void SadRow(const uint8_t *pA, const uint8_t *pB, int nSamples, int nTileSamples, uint32_t *pSums)
+{
+	for (int x0=0, iTile=0; x0<nSamples; x0+=nTileSamples, iTile++)
+	{
+		const int	xEnd = std::min(x0 + nTileSamples, nSamples);
+		v16u16		acc = {};
+		uint32_t	sum = 0;
+		int			x = x0;
+
+		for (; x + nLanes <= xEnd; x += nLanes)
+		{
+			v32u8 a, b;
+			v16u16 d16;
+
+			memcpy(&a, pA + x, sizeof(a));
+			memcpy(&b, pB + x, sizeof(b));
+			v32u8 d = a > b ? a - b : b - a;
+			memcpy(&d16, &d, sizeof(d16));
+			acc += (d16 & 0xFF) + (d16 >> 8);
+		}
+		for (int i=0; i<nLanes / 2; i++)
+			sum += acc[i];
+		for (; x<xEnd; x++)
+			sum += pA[x] > pB[x] ? pA[x] - pB[x] : pB[x] - pA[x];
+		pSums[iTile] += sum;
+	}
+}
+
+
+ChangeGate::ChangeGate()
+	: m_nSamples(0), m_height(0), m_nbytesSample(1), m_nShift(0), m_nTileSamples(0), m_nTileRows(0), m_nRowStep(1),
+	  m_nTilesX(0), m_nTilesY(0), m_bReference(false), m_differenceMax(0.0)
+{
+}
+
+
+void ChangeGate::Configure(int nSamples, int height, int nbytesSample, int nShift, int nTileSamples, int nTileRows, int nRowStep)
+{
+	nTileSamples = std::min(std::max(nTileSamples, 1), nTileSamplesMax);
+	nTileRows = std::max(nTileRows, 1);
+	nRowStep = std::min(std::max(nRowStep, 1), nTileRows);
+	if (nSamples == m_nSamples && height == m_height && nbytesSample == m_nbytesSample && nShift == m_nShift &&
+		nTileSamples == m_nTileSamples && nTileRows == m_nTileRows && nRowStep == m_nRowStep)
+		return;
+
+	m_nSamples = nSamples;
+	m_height = height;
+	m_nbytesSample = nbytesSample;
+	m_nShift = nShift;
+	m_nTileSamples = nTileSamples;
+	m_nTileRows = nTileRows;
+	m_nRowStep = nRowStep;
+	m_nTilesX = (nSamples + nTileSamples - 1) / nTileSamples;
+	m_nTilesY = (height + nTileRows - 1) / nTileRows;
+
+	size_t nRows = 0;
+	m_sums.assign((size_t)m_nTilesX * m_nTilesY, 0);
+	m_counts.assign(m_sums.size(), 0);
+	for (int y=0; y<height; y=NextRow(y))
+	{
+		for (int iTile=0; iTile<m_nTilesX; iTile++)
+			m_counts[(y / nTileRows) * m_nTilesX + iTile] += std::min(nTileSamples, nSamples - iTile * nTileSamples);
+		nRows++;
+	}
+	m_reference.assign(nRows * nSamples, 0);
+	m_candidate.assign(nRows * nSamples, 0);
+	m_changed.reserve(m_sums.size());
+	m_bReference = false;
+}
+
+
+// NextRow()
+// Sampled row after row y.  The step starts again at the top of each row of tiles, so
+// every row of tiles is sampled, the last one included.
+int ChangeGate::NextRow(int y) const
+{
+	int yNext = y + m_nRowStep;
+	int yTiles = (y / m_nTileRows + 1) * m_nTileRows;
+
+	return std::min(yNext, yTiles);
+}
+
+// Compare()
+// The sampled rows go into the candidate, 8 bits a sample, and are compared from there,
+// so Accept() is a swap.
+int ChangeGate::Compare(const uint8_t *pData, size_t step, double threshold)
+{
+	std::fill(m_sums.begin(), m_sums.end(), 0);
+	for (int y=0, iRow=0; y<m_height; y=NextRow(y), iRow++)
+	{
+		uint8_t			*pCandidate = m_candidate.data() + (size_t)iRow * m_nSamples;
+		const uint8_t	*pReference = m_reference.data() + (size_t)iRow * m_nSamples;
+
+		if (m_nbytesSample == 2)
+			NarrowRow16(pData + y * step, pCandidate, m_nSamples, m_nShift);
+		else
+			memcpy(pCandidate, pData + y * step, m_nSamples);
+		if (m_bReference)
+			SadRow(pCandidate, pReference, m_nSamples, m_nTileSamples, &m_sums[(size_t)(y / m_nTileRows) * m_nTilesX]);
+	}
+
+	m_changed.clear();
+	m_differenceMax = 0.0;
+	for (size_t i=0; i<m_sums.size(); i++)
+	{
+		// A tile with no sampled rows would be unknown, so counts as changed.
+		double difference = m_bReference && m_counts[i] > 0 ? (double)m_sums[i] / m_counts[i] : 255.0;
+
+		m_differenceMax = std::max(m_differenceMax, difference);
+		if (difference > threshold)
+			m_changed.push_back((uint32_t)i);
+	}
+	return (int)m_changed.size();
+} // Compare()
+
+
+void ChangeGate::Accept(void)
+{
+	m_reference.swap(m_candidate);
+	m_bReference = true;
+}
+
+} // namespace camera_aravis
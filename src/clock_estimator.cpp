@@ -0,0 +1,147 @@
+// Copyright 2016 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "camera_aravis/clock_estimator.h"
+
+#include <cmath>
+
+namespace camera_aravis
+{
+
+ClockEstimator::ClockEstimator(int nWindow, int nBlock)
+	: m_bLocked(false),
+	  m_offsetNs(0.0),
+	  m_driftPpm(0.0),
+	  m_jitterNs(0.0),
+	  m_residualMaxNs(0.0)
+{
+	Configure(nWindow, nBlock);
+}
+
+void ClockEstimator::Configure(int nWindow, int nBlock)
+{
+	m_nWindow = nWindow > 4 ? nWindow : 4;
+	m_nBlock = nBlock > 0 ? nBlock : 1;
+	m_points.assign(m_nWindow, Point());
+	Reset();
+}
+
+void ClockEstimator::Reset(void)
+{
+	m_bHaveOrigin = false;
+	m_nsCameraOrigin = 0;
+	m_offsetOrigin = 0;
+	m_iBlock = 0;
+	m_iPoint = 0;
+	m_nPoints = 0;
+	m_a = 0.0;
+	m_b = 0.0;
+	m_bLocked = false;
+}
+
+void ClockEstimator::AddSample(int64_t nsCamera, int64_t nsHost)
+{
+	const double	nsStep = 1e9;	// Larger jumps mean the camera clock was reset.
+	Point			point;
+
+	if (m_bHaveOrigin && m_nPoints >= 4 &&
+		fabs((double)(nsHost - nsCamera - m_offsetOrigin) - (m_a + m_b * (double)(nsCamera - m_nsCameraOrigin))) > nsStep)
+		Reset();
+
+	if (!m_bHaveOrigin)
+	{
+		m_nsCameraOrigin = nsCamera;
+		m_offsetOrigin = nsHost - nsCamera;
+		m_bHaveOrigin = true;
+	}
+
+	// Work relative to the first sample, so doubles keep sub-nanosecond resolution for months.
+	point.x = (double)(nsCamera - m_nsCameraOrigin);
+	point.y = (double)(nsHost - nsCamera - m_offsetOrigin);
+
+	if (m_iBlock == 0 || point.y < m_pointBlock.y)
+		m_pointBlock = point;
+
+	if (++m_iBlock >= m_nBlock)
+	{
+		m_points[m_iPoint] = m_pointBlock;
+		m_iPoint = (m_iPoint + 1) % m_nWindow;
+		if (m_nPoints < m_nWindow)
+			m_nPoints++;
+		m_iBlock = 0;
+		Fit();
+	}
+} // AddSample()
+
+// Fit()
+// Least squares through the block minima, centred on their mean to stay well conditioned.
+void ClockEstimator::Fit(void)
+{
+	double	xMean = 0.0;
+	double	yMean = 0.0;
+	double	sxx = 0.0;
+	double	sxy = 0.0;
+	double	sumSquares = 0.0;
+	double	residualMax = 0.0;
+
+	if (m_nPoints < 4)
+	{
+		// Not enough history for a slope yet; hold the smallest offset seen.
+		m_a = m_pointBlock.y;
+		m_b = 0.0;
+		return;
+	}
+
+	for (int i=0; i<m_nPoints; i++)
+	{
+		xMean += m_points[i].x;
+		yMean += m_points[i].y;
+	}
+	xMean /= m_nPoints;
+	yMean /= m_nPoints;
+
+	for (int i=0; i<m_nPoints; i++)
+	{
+		double dx = m_points[i].x - xMean;
+		sxx += dx * dx;
+		sxy += dx * (m_points[i].y - yMean);
+	}
+
+	m_b = sxx > 0.0 ? sxy / sxx : 0.0;
+	m_a = yMean - m_b * xMean;
+
+	for (int i=0; i<m_nPoints; i++)
+	{
+		double residual = m_points[i].y - (m_a + m_b * m_points[i].x);
+		sumSquares += residual * residual;
+		if (fabs(residual) > residualMax)
+			residualMax = fabs(residual);
+	}
+
+	m_offsetNs.store(m_offsetOrigin + m_a + m_b * m_pointBlock.x, std::memory_order_relaxed);
+	m_driftPpm.store(m_b * 1e6, std::memory_order_relaxed);
+	m_jitterNs.store(sqrt(sumSquares / m_nPoints), std::memory_order_relaxed);
+	m_residualMaxNs.store(residualMax, std::memory_order_relaxed);
+	m_bLocked.store(true, std::memory_order_relaxed);
+} // Fit()
+
+int64_t ClockEstimator::ToHost(int64_t nsCamera) const
+{
+	double x = (double)(nsCamera - m_nsCameraOrigin);
+
+	return nsCamera + m_offsetOrigin + (int64_t)llround(m_a + m_b * x);
+}
+
+} // namespace camera_aravis
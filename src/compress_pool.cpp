@@ -0,0 +1,191 @@
+// Copyright 2016 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "camera_aravis/compress_pool.h"
+#include "camera_aravis/util.h"
+
+namespace camera_aravis
+{
+
+CompressPool::CompressPool()
+	: nSubmitted(0),
+	  nDropped(0),
+	  nFailed(0),
+	  nbytesOut(0),
+	  m_nClaimed(0),
+	  m_nQueue(0),
+	  m_quality(90),
+	  m_bPublishing(false),
+	  m_bStop(false),
+	  m_depthMax(0)
+{
+}
+
+CompressPool::~CompressPool()
+{
+	Stop();
+}
+
+void CompressPool::Start(int nThreads, int nQueue, int quality, const PublishFn &fnPublish)
+{
+	Stop();
+
+	m_nQueue = nQueue > 0 ? nQueue : 1;
+	m_quality = quality;
+	m_fnPublish = fnPublish;
+	m_bStop = false;
+	for (int i=0; i<nThreads; i++)
+		m_threads.emplace_back(&CompressPool::Worker, this);
+}
+
+// Stop()
+// Frames still queued are dropped, which lets their buffers go.
+void CompressPool::Stop(void)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_bStop = true;
+	}
+	m_cvWork.notify_all();
+	m_cvIdle.notify_all();
+	for (auto &thread : m_threads)
+		thread.join();
+	m_threads.clear();
+
+	m_jobs.clear();
+	m_nClaimed = 0;
+	m_bPublishing = false;
+}
+
+void CompressPool::Flush(void)
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+
+	m_cvIdle.wait(lock, [this] { return m_jobs.empty() || m_threads.empty() || m_bStop; });
+}
+
+bool CompressPool::Submit(std::shared_ptr<const sensor_msgs::msg::Image> pImage, unsigned maskCodecs)
+{
+	size_t depth;
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		if (m_threads.empty() || m_jobs.size() >= m_nQueue)
+		{
+			nDropped++;
+			return false;
+		}
+
+		std::unique_ptr<Job> pJob(new Job);
+		pJob->pImage = std::move(pImage);
+		pJob->maskCodecs = maskCodecs;
+		pJob->nsSubmit = NowNs();
+		pJob->bDone = false;
+		m_jobs.push_back(std::move(pJob));
+		depth = m_jobs.size();
+	}
+	m_cvWork.notify_one();
+	nSubmitted++;
+
+	size_t depthMax = m_depthMax.load(std::memory_order_relaxed);
+	while (depth > depthMax && !m_depthMax.compare_exchange_weak(depthMax, depth, std::memory_order_relaxed))
+		;
+	return true;
+}
+
+size_t CompressPool::Depth(void)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	return m_jobs.size();
+}
+
+
+// Worker()
+// Take the oldest unclaimed frame and run its codecs.  Frames finish out of order when
+// there are several workers; PublishReady() puts them back in order.
+void CompressPool::Worker(void)
+{
+	ImageEncoder					encoder;
+	std::unique_lock<std::mutex>	lock(m_mutex);
+
+	for (;;)
+	{
+		m_cvWork.wait(lock, [this] { return m_bStop || m_nClaimed < m_jobs.size(); });
+		if (m_bStop)
+			return;
+
+		Job &job = *m_jobs[m_nClaimed++];
+		lock.unlock();
+
+		for (int i=0; i<nCodecs; i++)
+		{
+			if (!(job.maskCodecs & (1u << i)))
+				continue;
+
+			int64_t nsStart = NowNs();
+			job.pOut[i].reset(new sensor_msgs::msg::CompressedImage);
+			if (encoder.Encode((ImageCodec)i, *job.pImage, m_quality, *job.pOut[i]))
+			{
+				histEncode.Record(NowNs() - nsStart);
+				nbytesOut += job.pOut[i]->data.size();
+			}
+			else
+			{
+				nFailed++;
+				job.pOut[i].reset();
+			}
+		}
+		// The source frame is no longer needed; let its buffer go back to the stream now.
+		job.pImage.reset();
+
+		lock.lock();
+		job.bDone = true;
+		PublishReady(lock);
+	}
+} // Worker()
+
+
+// PublishReady()
+// Publish finished frames from the front of the queue, oldest first.  Called with the lock
+// held; drops it around each publish.
+void CompressPool::PublishReady(std::unique_lock<std::mutex> &lock)
+{
+	if (m_bPublishing)
+		return;	// The worker already publishing will get to this frame.
+
+	m_bPublishing = true;
+	while (!m_bStop && !m_jobs.empty() && m_jobs.front()->bDone)
+	{
+		std::unique_ptr<Job> pJob = std::move(m_jobs.front());
+		m_jobs.pop_front();
+		m_nClaimed--;
+		lock.unlock();
+
+		for (int i=0; i<nCodecs; i++)
+			if (pJob->pOut[i])
+				m_fnPublish((ImageCodec)i, std::move(pJob->pOut[i]));
+		histSubmitToPublish.Record(NowNs() - pJob->nsSubmit);
+		pJob.reset();
+
+		lock.lock();
+	}
+	m_bPublishing = false;
+	if (m_jobs.empty())
+		m_cvIdle.notify_all();
+} // PublishReady()
+
+} // namespace camera_aravis
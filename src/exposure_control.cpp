@@ -0,0 +1,306 @@
+// Copyright 2016 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+
+#include "camera_aravis/exposure_control.h"
+#include "camera_aravis/simd.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace camera_aravis
+{
+
+static const int nLanes = 16;
+
+// Each exposure step goes this power of the way to the target.
+static const double damping = 0.75;
+
+// More than this fraction of saturated samples is too bright, whatever the mean.
+static const double fractionSaturated = 0.02;
+
+typedef uint32_t	Histograms[4][256];
+
+// The samples of a run are counted into four histograms in turn, so that a run of equal
+// samples does not wait on its own increments; a vector load picks out nLanes of them
+// at a time.  A vector stops short of the last sample so as not to read past the row.
+TARGET_CLONES
+static void MeterRun8(const uint8_t *p, int n, int nStride, Histograms &hist)
+{
+	int i = 0;
+
+	if (nStride == 1)
+	{
+		for (; i + nLanes < n; i += nLanes)
+		{
+			v16u8 v;
+
+			memcpy(&v, p + i, sizeof(v));
+			for (int l=0; l<nLanes; l++)
+				hist[l & 3][v[l]]++;
+		}
+	}
+	else if (nStride == 2)
+	{
+		for (; i + nLanes < n; i += nLanes)
+		{
+			v16u16 v;
+
+			memcpy(&v, p + 2 * i, sizeof(v));
+			v &= 0xFF;
+			for (int l=0; l<nLanes; l++)
+				hist[l & 3][v[l]]++;
+		}
+	}
+	else if (nStride == 4)
+	{
+		for (; i + nLanes < n; i += nLanes)
+		{
+			v16u32 v;
+
+			memcpy(&v, p + 4 * i, sizeof(v));
+			v &= 0xFF;
+			for (int l=0; l<nLanes; l++)
+				hist[l & 3][v[l]]++;
+		}
+	}
+	for (; i<n; i++)
+		hist[i & 3][p[(size_t)i * nStride]]++;
+}
+
+// 16-bit samples, shifted down to 8 bits and saturated.
+TARGET_CLONES
+static void MeterRun16(const uint8_t *p, int n, int nStride, int nShift, Histograms &hist)
+{
+	const v16u16	vZero16 = {};
+	const v16u32	vZero32 = {};
+	const v16u16	vMax16 = vZero16 + 255;
+	const v16u32	vMax32 = vZero32 + 255;
+	int				i = 0;
+
+	if (nStride == 2)
+	{
+		for (; i + nLanes < n; i += nLanes)
+		{
+			v16u16 v;
+
+			memcpy(&v, p + 2 * i, sizeof(v));
+			v >>= nShift;
+			v = v > 255 ? vMax16 : v;
+			for (int l=0; l<nLanes; l++)
+				hist[l & 3][v[l]]++;
+		}
+	}
+	else if (nStride == 4)
+	{
+		for (; i + nLanes < n; i += nLanes)
+		{
+			v16u32 v;
+
+			memcpy(&v, p + 4 * i, sizeof(v));
+			v = (v & 0xFFFF) >> nShift;
+			v = v > 255 ? vMax32 : v;
+			for (int l=0; l<nLanes; l++)
+				hist[l & 3][v[l]]++;
+		}
+	}
+	for (; i<n; i++)
+	{
+		uint16_t a;
+
+		memcpy(&a, p + (size_t)i * nStride, 2);
+		a >>= nShift;
+		hist[i & 3][a > 255 ? 255 : a]++;
+	}
+}
+
+// The samples of units [iBegin, iEnd) of a row that fall on the grid of nUnitStep.
+static uint32_t MeterUnits(const uint8_t *pRow, int iBegin, int iEnd, const MeterLayout &layout, int nUnitStep, Histograms &hist)
+{
+	int iFirst = (iBegin + nUnitStep - 1) / nUnitStep * nUnitStep;
+	int n = iEnd > iFirst ? (iEnd - iFirst + nUnitStep - 1) / nUnitStep : 0;
+	const uint8_t *p = pRow + (size_t)iFirst * layout.nbytesUnit;
+
+	if (n == 0)
+		return 0;
+	if (layout.nbytesSample == 2)
+		MeterRun16(p, n, layout.nbytesUnit * nUnitStep, layout.nShift, hist);
+	else
+		MeterRun8(p, n, layout.nbytesUnit * nUnitStep, hist);
+	return (uint32_t)n;
+}
+
+static void SumHistograms(const Histograms &hist, uint32_t *pOut)
+{
+	for (int i=0; i<256; i++)
+		pOut[i] = hist[0][i] + hist[1][i] + hist[2][i] + hist[3][i];
+}
+
+// MeterFrame()
+uint32_t MeterFrame(const uint8_t *pData, size_t step, int width, int height, const MeterLayout &layout, int nStep,
+	const MeterRegion &region, uint32_t *pInside, uint32_t *pOutside)
+{
+	Histograms	inside = {}, outside = {};
+	const int	nUnits = width / layout.nPixelsUnit;
+	const int	nUnitStep = std::max(1, nStep / layout.nPixelsUnit);
+	const int	xBegin = std::min(std::max((int)(region.x * nUnits), 0), nUnits);
+	const int	xEnd = std::min(std::max((int)((region.x + region.width) * nUnits), xBegin), nUnits);
+	const int	yBegin = std::min(std::max((int)(region.y * height), 0), height);
+	const int	yEnd = std::min(std::max((int)((region.y + region.height) * height), yBegin), height);
+	uint32_t	n = 0;
+
+	nStep = std::max(nStep, 1);
+	for (int y=0; y<height; y+=nStep)
+	{
+		const uint8_t *pRow = pData + (size_t)y * step + layout.iOffset;
+
+		if (y >= yBegin && y < yEnd)
+		{
+			n += MeterUnits(pRow, xBegin, xEnd, layout, nUnitStep, inside);
+			if (pOutside)
+			{
+				n += MeterUnits(pRow, 0, xBegin, layout, nUnitStep, outside);
+				n += MeterUnits(pRow, xEnd, nUnits, layout, nUnitStep, outside);
+			}
+		}
+		else if (pOutside)
+			n += MeterUnits(pRow, 0, nUnits, layout, nUnitStep, outside);
+	}
+
+	SumHistograms(inside, pInside);
+	if (pOutside)
+		SumHistograms(outside, pOutside);
+	return n;
+} // MeterFrame()
+
+
+ExposureControl::ExposureControl()
+	: m_target(100.0),
+	  m_tolerance(8.0),
+	  m_nSettleFrames(2),
+	  m_nsWriteInterval(0),
+	  m_usMin(0.0),
+	  m_usMax(0.0),
+	  m_gainMin(0.0),
+	  m_gainMax(0.0),
+	  m_nSettle(0),
+	  m_nsWrite(0),
+	  m_nsDiverged(0),
+	  m_nsConvergence(0),
+	  m_usNext(0.0),
+	  m_gainNext(0.0),
+	  m_level(0.0),
+	  m_usExposure(0.0),
+	  m_gain(0.0),
+	  m_bConverged(false)
+{
+}
+
+void ExposureControl::Configure(double target, double tolerance, int nSettleFrames, int64_t nsWriteInterval)
+{
+	m_target = target;
+	m_tolerance = tolerance;
+	m_nSettleFrames = nSettleFrames;
+	m_nsWriteInterval = nsWriteInterval;
+}
+
+void ExposureControl::Reset(const ExposureRange &range)
+{
+	m_usMin = std::max(range.usMin, 1.0);
+	m_usMax = std::max(range.usMax, m_usMin);
+	m_gainMin = range.gainMin;
+	m_gainMax = std::max(range.gainMax, range.gainMin);
+	m_usExposure.store(range.usExposure, std::memory_order_relaxed);
+	m_gain.store(range.gain, std::memory_order_relaxed);
+	m_nSettle = m_nSettleFrames;
+	m_nsDiverged = 0;
+	m_nsConvergence = 0;
+	m_bConverged.store(false, std::memory_order_relaxed);
+}
+
+
+// Update()
+bool ExposureControl::Update(const uint32_t *pInside, const uint32_t *pOutside, double weightOutside, int64_t nsNow)
+{
+	double	n = 0.0, sum = 0.0;
+
+	for (int i=0; i<256; i++)
+	{
+		double h = pInside[i] + (pOutside ? weightOutside * pOutside[i] : 0.0);
+
+		n += h;
+		sum += h * i;
+	}
+	if (n <= 0.0)
+		return false;
+
+	// Clipped highlights read darker than they are.
+	double level = sum / n;
+	double nSaturated = pInside[255] + (pOutside ? weightOutside * pOutside[255] : 0.0);
+	if (nSaturated > fractionSaturated * n)
+		level = std::max(level, m_target + 2.0 * m_tolerance);
+	m_level.store(level, std::memory_order_relaxed);
+
+	bool bWithin = std::fabs(level - m_target) <= m_tolerance;
+	if (bWithin && m_nsDiverged)
+	{
+		m_nsConvergence = nsNow - m_nsDiverged;
+		m_nsDiverged = 0;
+	}
+	else if (!bWithin && !m_nsDiverged)
+	{
+		m_nsDiverged = nsNow;
+		m_nsConvergence = 0;
+	}
+	m_bConverged.store(bWithin, std::memory_order_relaxed);
+
+	// Frames exposed before the last change was written.
+	if (m_nSettle > 0)
+	{
+		m_nSettle--;
+		return false;
+	}
+	if (bWithin || nsNow - m_nsWrite < m_nsWriteInterval)
+		return false;
+
+	// The level is about proportional to exposure times gain.  A dark frame says little
+	// about how far off it is, so a step is at most 4x.
+	double usNow = Exposure();
+	double gainNow = Gain();
+	double ratio = std::pow(std::min(std::max(m_target / std::max(level, 1.0), 0.25), 4.0), damping);
+	double usTotal = usNow * std::pow(10.0, (gainNow - m_gainMin) / 20.0) * ratio;	// At the least gain.
+	double us = std::min(std::max(usTotal, m_usMin), m_usMax);
+	double gain = std::min(std::max(m_gainMin + 20.0 * std::log10(usTotal / us), m_gainMin), m_gainMax);
+
+	// Up against the limits.
+	if (std::fabs(us - usNow) < 0.01 * usNow && std::fabs(gain - gainNow) < 0.05)
+		return false;
+
+	m_usNext = us;
+	m_gainNext = gain;
+	return true;
+} // Update()
+
+
+void ExposureControl::Written(double usExposure, double gain, int64_t nsNow)
+{
+	m_usExposure.store(usExposure, std::memory_order_relaxed);
+	m_gain.store(gain, std::memory_order_relaxed);
+	m_nsWrite = nsNow;
+	m_nSettle = m_nSettleFrames;
+}
+
+} // namespace camera_aravis
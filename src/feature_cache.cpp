@@ -0,0 +1,178 @@
+// Copyright 2016 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "camera_aravis/feature_cache.h"
+#include "camera_aravis/util.h"
+
+#include <errno.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cctype>
+#include <cstdio>
+#include <cstring>
+
+namespace camera_aravis
+{
+
+// The entry file: a header line with the format and the XML hash, then one
+// "name value" line per feature.
+static const char	*szCacheFormat = "camera_aravis-features 1";
+
+FeatureCache::FeatureCache()
+	: m_hashXml(0),
+	  m_pXml(NULL),
+	  m_nbytesXml(0),
+	  m_bLoaded(false),
+	  m_bDirty(false)
+{
+}
+
+// FNV-1a: only has to tell two XML files apart.
+uint64_t FeatureCache::Hash(const char *p, size_t nbytes)
+{
+	uint64_t	hash = 14695981039346656037ULL;
+
+	for (size_t i=0; i<nbytes; i++)
+	{
+		hash ^= (uint8_t)p[i];
+		hash *= 1099511628211ULL;
+	}
+	return hash;
+}
+
+std::string FeatureCache::Key(const std::string &stVendor, const std::string &stModel, const std::string &stFirmware)
+{
+	std::string	stKey = stVendor + "_" + stModel + "_" + stFirmware;
+
+	for (char &c : stKey)
+		if (!isalnum((unsigned char)c) && c != '-')
+			c = '_';
+	return stKey;
+}
+
+// Load()
+// Remember where the entry lives and what XML it must match, then read it if it is there.
+bool FeatureCache::Load(const std::string &stDir, const std::string &stKey, const char *pXml, size_t nbytesXml)
+{
+	char		szLine[256];
+	char		szName[200];
+	long long	value;
+	unsigned long long hash;
+
+	m_stDir = stDir;
+	m_stPath = stDir + "/" + stKey + ".features";
+	m_pXml = pXml;
+	m_nbytesXml = nbytesXml;
+	m_hashXml = Hash(pXml, nbytesXml);
+	m_values.clear();
+	m_bLoaded = false;
+	m_bDirty = false;
+
+	FILE *pFile = fopen(m_stPath.c_str(), "r");
+	if (!pFile)
+		return false;
+
+	// A different XML (new firmware under an old version string, say) means probing again.
+	if (!fgets(szLine, sizeof(szLine), pFile) || strncmp(szLine, szCacheFormat, strlen(szCacheFormat)) != 0 ||
+		sscanf(szLine + strlen(szCacheFormat), " %llx", &hash) != 1 || hash != m_hashXml)
+	{
+		fclose(pFile);
+		return false;
+	}
+	while (fgets(szLine, sizeof(szLine), pFile))
+		if (sscanf(szLine, "%199s %lld", szName, &value) == 2)
+			m_values[szName] = value;
+	fclose(pFile);
+
+	m_bLoaded = true;
+	return true;
+} // Load()
+
+bool FeatureCache::Lookup(const std::string &stName, int64_t &value) const
+{
+	auto it = m_values.find(stName);
+
+	if (it == m_values.end())
+		return false;
+	value = it->second;
+	return true;
+}
+
+void FeatureCache::Store(const std::string &stName, int64_t value)
+{
+	auto it = m_values.find(stName);
+
+	if (it != m_values.end() && it->second == value)
+		return;
+	m_values[stName] = value;
+	m_bDirty = true;
+}
+
+// Save()
+// Write to temporary files and rename them into place, so that several nodes
+// starting at once never read a half-written entry.
+bool FeatureCache::Save(std::string &stError)
+{
+	std::string	stTmp = m_stPath + ".tmp" + std::to_string(getpid());
+	std::string	stXml = m_stPath.substr(0, m_stPath.size() - strlen(".features")) + ".xml";
+
+	if (!m_bDirty || m_stPath.empty())
+		return true;
+
+	if (!MakeDirectories(m_stDir))
+	{
+		stError = m_stDir + ": " + strerror(errno);
+		return false;
+	}
+
+	FILE *pFile = fopen(stTmp.c_str(), "w");
+	if (!pFile)
+	{
+		stError = stTmp + ": " + strerror(errno);
+		return false;
+	}
+	fprintf(pFile, "%s %016llx\n", szCacheFormat, (unsigned long long)m_hashXml);
+	for (auto &value : m_values)
+		fprintf(pFile, "%s %lld\n", value.first.c_str(), (long long)value.second);
+	bool bOk = fclose(pFile) == 0;
+
+	// The XML copy is for reference, e.g. to look up a feature offline.
+	if (bOk && m_pXml)
+	{
+		std::string stXmlTmp = stXml + ".tmp" + std::to_string(getpid());
+		FILE *pXmlFile = fopen(stXmlTmp.c_str(), "w");
+		if (pXmlFile)
+		{
+			bool bXmlOk = fwrite(m_pXml, 1, m_nbytesXml, pXmlFile) == m_nbytesXml;
+			if (fclose(pXmlFile) == 0 && bXmlOk)
+				rename(stXmlTmp.c_str(), stXml.c_str());
+			else
+				unlink(stXmlTmp.c_str());
+		}
+	}
+
+	if (!bOk || rename(stTmp.c_str(), m_stPath.c_str()) != 0)
+	{
+		stError = m_stPath + ": " + strerror(errno);
+		unlink(stTmp.c_str());
+		return false;
+	}
+	m_bDirty = false;
+
+	return true;
+} // Save()
+
+} // namespace camera_aravis
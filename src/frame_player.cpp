@@ -0,0 +1,138 @@
+// Copyright 2016 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "camera_aravis/frame_player.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstring>
+
+namespace camera_aravis
+{
+
+FramePlayer::FramePlayer()
+{
+}
+
+FramePlayer::~FramePlayer()
+{
+	Close();
+}
+
+bool FramePlayer::IsRecording(const std::string &stDir)
+{
+	struct stat st;
+
+	return stat(RecordingSegmentPath(stDir, 0, "idx").c_str(), &st) == 0;
+}
+
+bool FramePlayer::Map(const std::string &stPath, Mapping &mapping)
+{
+	struct stat	st;
+	int			fd = open(stPath.c_str(), O_RDONLY | O_CLOEXEC);
+
+	mapping.p = NULL;
+	mapping.nbytes = 0;
+	if (fd < 0)
+		return false;
+	if (fstat(fd, &st) != 0)
+	{
+		close(fd);
+		return false;
+	}
+	if (st.st_size == 0)
+	{
+		close(fd);
+		return true;	// An empty segment maps to nothing.
+	}
+
+	void *p = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (p == MAP_FAILED)
+		return false;
+
+	// Played front to back.
+	madvise(p, st.st_size, MADV_SEQUENTIAL);
+	mapping.p = p;
+	mapping.nbytes = st.st_size;
+	m_mappings.push_back(mapping);
+	return true;
+}
+
+bool FramePlayer::Open(const std::string &stDir, std::string &stError)
+{
+	Close();
+
+	for (unsigned iSegment=0; ; iSegment++)
+	{
+		std::string	stIndex = RecordingSegmentPath(stDir, iSegment, "idx");
+		Mapping		index;
+		Mapping		data;
+
+		if (access(stIndex.c_str(), R_OK) != 0)
+			break;
+		if (!Map(stIndex, index) || !Map(RecordingSegmentPath(stDir, iSegment, "dat"), data))
+		{
+			stError = "Cannot map segment " + std::to_string(iSegment) + " of " + stDir + ": " + strerror(errno);
+			return false;
+		}
+
+		const RecordingIndexHeader *pHeader = (const RecordingIndexHeader *)index.p;
+		if (index.nbytes < sizeof(RecordingIndexHeader) || memcmp(pHeader->magic, szRecordingMagic, sizeof(szRecordingMagic)) != 0 ||
+		    pHeader->version != nRecordingVersion || pHeader->nbytesEntry != sizeof(RecordingEntry))
+		{
+			stError = stIndex + " is not a camera_aravis recording index";
+			return false;
+		}
+		if (iSegment == 0)
+		{
+			m_stGuid.assign(pHeader->szGuid, strnlen(pHeader->szGuid, sizeof(pHeader->szGuid)));
+			m_stPixelformat.assign(pHeader->szPixelformat, strnlen(pHeader->szPixelformat, sizeof(pHeader->szPixelformat)));
+		}
+
+		// A recording cut short, e.g. by a crash, has entries only for the frames written.
+		uint64_t				 nEntries = __atomic_load_n(&pHeader->nEntries, __ATOMIC_ACQUIRE);
+		const RecordingEntry	*pEntries = (const RecordingEntry *)(pHeader + 1);
+		nEntries = std::min<uint64_t>(nEntries, (index.nbytes - sizeof(RecordingIndexHeader)) / sizeof(RecordingEntry));
+		for (uint64_t i=0; i<nEntries; i++)
+		{
+			if (pEntries[i].offset + pEntries[i].nbytes > data.nbytes)
+				break;
+			m_frames.push_back(Frame{&pEntries[i], (const uint8_t *)data.p + pEntries[i].offset});
+		}
+	}
+
+	if (m_frames.empty())
+	{
+		stError = "No frames recorded in " + stDir;
+		return false;
+	}
+	return true;
+} // Open()
+
+void FramePlayer::Close(void)
+{
+	for (auto &mapping : m_mappings)
+		munmap(mapping.p, mapping.nbytes);
+	m_mappings.clear();
+	m_frames.clear();
+}
+
+} // namespace camera_aravis
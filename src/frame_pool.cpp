@@ -0,0 +1,362 @@
+// Copyright 2016 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "camera_aravis/frame_pool.h"
+#include "camera_aravis/thread_placement.h"
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <cstdio>
+
+namespace camera_aravis
+{
+
+FramePool::FramePool()
+	: m_pStream(NULL),
+	  m_nbytesPayload(0),
+	  m_bHugePages(false),
+	  m_bLock(false),
+	  m_iNumaNode(-1),
+	  m_nActive(0),
+	  m_nRetire(0),
+	  m_nAllocations(0),
+	  m_nLockFailures(0),
+	  m_nNumaFailures(0),
+	  m_nHugePageMisses(0),
+	  m_nSparesWanted(0),
+	  m_bSpareStop(false),
+	  m_nSpareMisses(0)
+{
+}
+
+FramePool::~FramePool()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutexSpare);
+		m_bSpareStop = true;
+	}
+	m_cvSpare.notify_all();
+	if (m_threadSpare.joinable())
+		m_threadSpare.join();
+	Destroy();
+}
+
+void FramePool::SetMemoryOptions(bool bHugePages, bool bLock, int iNumaNode)
+{
+	std::lock_guard<std::mutex> lock(m_mutexSpare);
+
+	m_bHugePages = bHugePages;
+	m_bLock = bLock;
+	m_iNumaNode = iNumaNode;
+	m_spares.clear();
+}
+
+void FramePool::Create(ArvStream *pStream, size_t nbytesPayload, unsigned nBuffers)
+{
+	Destroy();
+
+	m_pStream = pStream;
+	{
+		std::lock_guard<std::mutex> lock(m_mutexSpare);
+		m_nbytesPayload = nbytesPayload;
+	}
+	m_cvSpare.notify_one();
+	Resize(nBuffers);
+} // Create()
+
+void FramePool::KeepSpares(unsigned nSpares)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutexSpare);
+		m_nSparesWanted = nSpares;
+	}
+	m_cvSpare.notify_one();
+	if (nSpares > 0 && !m_threadSpare.joinable())
+		m_threadSpare = std::thread(&FramePool::SpareThread, this);
+}
+
+void FramePool::Resize(unsigned nBuffers)
+{
+	std::lock_guard<std::mutex> lock(m_mutexSlots);
+	int nDelta = (int)nBuffers - (int)m_nActive.load();
+
+	if (nDelta <= 0)
+	{
+		// Buffers are spread over the stream, the ring and the publisher; drop them as they return.
+		m_nRetire = -nDelta;
+		return;
+	}
+
+	m_nRetire = 0;
+	for (auto &pSlot : m_slots)
+	{
+		if (nDelta == 0)
+			break;
+		if (pSlot->bRetired.load(std::memory_order_acquire))
+		{
+			Fill(*pSlot);
+			nDelta--;
+		}
+	}
+	for (; nDelta>0; nDelta--)
+	{
+		m_slots.emplace_back(new Slot);
+		m_nAllocations.fetch_add(1, std::memory_order_relaxed);
+		Fill(*m_slots.back());
+	}
+} // Resize()
+
+// HugePageBytes()
+// Bytes of transparent huge pages in the mapping around address, from /proc/self/smaps.
+static size_t HugePageBytes(uintptr_t address)
+{
+	FILE	*pFile = fopen("/proc/self/smaps", "r");
+	char	 sz[256];
+	bool	 bFound = false;
+	size_t	 nkB = 0;
+
+	if (!pFile)
+		return 0;
+	while (fgets(sz, sizeof(sz), pFile))
+	{
+		unsigned long begin, end;
+
+		if (sscanf(sz, "%lx-%lx ", &begin, &end) == 2)
+		{
+			if (bFound)
+				break;
+			bFound = begin <= address && address < end;
+		}
+		else if (bFound && sscanf(sz, "AnonHugePages: %zu kB", &nkB) == 1)
+			break;
+	}
+	fclose(pFile);
+	return nkB << 10;
+}
+
+// NewMessage()
+// A message with nbytes of payload, backed as the memory options say.  The payload is
+// reserved untouched first: a vector that large comes straight from mmap(), so the huge
+// page advice and the NUMA binding apply as resize() faults the pages in, rather than
+// to pages already there.  The message type fixes the allocator, so only the 2 MiB-aligned
+// interior of the mapping can be huge pages; whether it got them is checked.
+std::unique_ptr<sensor_msgs::msg::Image> FramePool::NewMessage(size_t nbytes, bool bHugePages, bool bLock, int iNumaNode)
+{
+	const uintptr_t	nbytesHuge = 2 << 20;
+	std::unique_ptr<sensor_msgs::msg::Image> pMsg(new sensor_msgs::msg::Image);
+
+	pMsg->data.reserve(nbytes);
+	m_nAllocations.fetch_add(2, std::memory_order_relaxed);
+
+	uint8_t		*pData = pMsg->data.data();
+	uintptr_t	begin = ((uintptr_t)pData + nbytesHuge - 1) & ~(nbytesHuge - 1);
+	uintptr_t	end = ((uintptr_t)pData + nbytes) & ~(nbytesHuge - 1);
+	bool		bHuge = bHugePages && end > begin;
+
+	if (bHuge && madvise((void *)begin, end - begin, MADV_HUGEPAGE) != 0)
+		bHuge = false;
+	if (iNumaNode >= 0 && !BindToNode(pData, nbytes, iNumaNode))
+		m_nNumaFailures.fetch_add(1, std::memory_order_relaxed);
+	pMsg->data.resize(nbytes);
+	if (bHugePages && end > begin && (!bHuge || HugePageBytes(begin) < end - begin))
+		m_nHugePageMisses.fetch_add(1, std::memory_order_relaxed);
+	if (bLock && mlock(pData, nbytes) != 0)
+		m_nLockFailures.fetch_add(1, std::memory_order_relaxed);
+	return pMsg;
+} // NewMessage()
+
+// Fill()
+// Give the slot a message, pMsg or a new one, and wrap its data in a new buffer for the stream.
+void FramePool::Fill(Slot &slot, std::unique_ptr<sensor_msgs::msg::Image> pMsg)
+{
+	// The message owns the memory; Aravis only borrows it as a preallocated buffer.
+	slot.pMsg = pMsg ? std::move(pMsg) : NewMessage(m_nbytesPayload, m_bHugePages, m_bLock, m_iNumaNode);
+	slot.pBuffer = arv_buffer_new_full(m_nbytesPayload, slot.pMsg->data.data(), &slot, NULL);
+	slot.bRetired.store(false, std::memory_order_relaxed);
+	m_nActive.fetch_add(1, std::memory_order_relaxed);
+
+	Push(slot.pBuffer);
+} // Fill()
+
+// Push()
+// Hand a ready buffer to the stream, or keep it for Acquire() when there is none.
+void FramePool::Push(ArvBuffer *pBuffer)
+{
+	if (m_pStream)
+		arv_stream_push_buffer(m_pStream, pBuffer);
+	else
+	{
+		std::lock_guard<std::mutex> lock(m_mutexFree);
+		m_free.push_back(pBuffer);
+	}
+}
+
+// Acquire()
+// Take a free buffer of a pool without a stream.
+ArvBuffer *FramePool::Acquire(void)
+{
+	std::lock_guard<std::mutex> lock(m_mutexFree);
+	ArvBuffer *pBuffer = NULL;
+
+	if (!m_free.empty())
+	{
+		pBuffer = m_free.back();
+		m_free.pop_back();
+	}
+	return pBuffer;
+}
+
+// Retire()
+// Drop the slot's buffer and message if the pool is shrinking.
+bool FramePool::Retire(Slot &slot)
+{
+	int nRetire = m_nRetire.load(std::memory_order_relaxed);
+
+	while (nRetire > 0)
+	{
+		if (m_nRetire.compare_exchange_weak(nRetire, nRetire - 1, std::memory_order_relaxed))
+		{
+			g_object_unref(slot.pBuffer);
+			slot.pBuffer = NULL;
+			slot.pMsg.reset();
+			m_nActive.fetch_sub(1, std::memory_order_relaxed);
+			slot.bRetired.store(true, std::memory_order_release);
+			return true;
+		}
+	}
+
+	return false;
+} // Retire()
+
+void FramePool::Destroy(void)
+{
+	std::lock_guard<std::mutex> lock(m_mutexSlots);
+
+	// Buffers still queued in the stream are freed with it; Aravis never frees preallocated data.
+	if (!m_pStream)
+	{
+		std::lock_guard<std::mutex> lockFree(m_mutexFree);
+		for (ArvBuffer *pBuffer : m_free)
+			g_object_unref(pBuffer);
+		m_free.clear();
+	}
+	m_slots.clear();
+	m_pStream = NULL;
+	{
+		std::lock_guard<std::mutex> lockSpare(m_mutexSpare);
+		m_nbytesPayload = 0;
+		m_spares.clear();
+	}
+	m_nActive = 0;
+	m_nRetire = 0;
+}
+
+// Rebind()
+// The buffers went with the old stream, but not the memory behind them: wrap each
+// message in a new buffer, with no allocation.
+void FramePool::Rebind(ArvStream *pStream)
+{
+	std::lock_guard<std::mutex> lock(m_mutexSlots);
+
+	m_pStream = pStream;
+	for (auto &pSlot : m_slots)
+	{
+		if (pSlot->bRetired.load(std::memory_order_acquire))
+			continue;
+		pSlot->pBuffer = arv_buffer_new_full(m_nbytesPayload, pSlot->pMsg->data.data(), pSlot.get(), NULL);
+		Push(pSlot->pBuffer);
+	}
+} // Rebind()
+
+sensor_msgs::msg::Image *FramePool::MessageFromBuffer(ArvBuffer *pBuffer) const
+{
+	Slot *pSlot = (Slot *)arv_buffer_get_user_data(pBuffer);
+
+	return pSlot ? pSlot->pMsg.get() : NULL;
+}
+
+void FramePool::Release(ArvBuffer *pBuffer)
+{
+	if (!Retire(*(Slot *)arv_buffer_get_user_data(pBuffer)))
+		Push(pBuffer);
+}
+
+std::unique_ptr<sensor_msgs::msg::Image> FramePool::Detach(ArvBuffer *pBuffer)
+{
+	Slot *pSlot = (Slot *)arv_buffer_get_user_data(pBuffer);
+	std::unique_ptr<sensor_msgs::msg::Image> pMsg = std::move(pSlot->pMsg);
+
+	// Aravis does not free preallocated data, so the message survives the buffer.
+	if (!Retire(*pSlot))
+	{
+		g_object_unref(pBuffer);
+		m_nActive.fetch_sub(1, std::memory_order_relaxed);
+		Fill(*pSlot, TakeSpare());
+	}
+
+	return pMsg;
+} // Detach()
+
+// TakeSpare()
+// A ready message for Detach(), or NULL for Fill() to make one; the spare thread is woken
+// to replace it.
+std::unique_ptr<sensor_msgs::msg::Image> FramePool::TakeSpare(void)
+{
+	std::unique_ptr<sensor_msgs::msg::Image> pMsg;
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutexSpare);
+		if (!m_spares.empty())
+		{
+			pMsg = std::move(m_spares.back());
+			m_spares.pop_back();
+		}
+		else if (m_nSparesWanted > 0)
+			m_nSpareMisses.fetch_add(1, std::memory_order_relaxed);
+	}
+	m_cvSpare.notify_one();
+	return pMsg;
+} // TakeSpare()
+
+// SpareThread()
+// Keeps m_nSparesWanted messages ready, so that allocating, zeroing, binding and locking
+// the payload stay off the publish thread.  A message made while the payload or the
+// options changed is dropped.
+void FramePool::SpareThread(void)
+{
+	std::unique_lock<std::mutex> lock(m_mutexSpare);
+
+	while (!m_bSpareStop)
+	{
+		if (m_nbytesPayload == 0 || m_spares.size() >= m_nSparesWanted)
+		{
+			m_cvSpare.wait(lock);
+			continue;
+		}
+
+		size_t	nbytes = m_nbytesPayload;
+		bool	bHugePages = m_bHugePages;
+		bool	bLock = m_bLock;
+		int		iNumaNode = m_iNumaNode;
+
+		lock.unlock();
+		std::unique_ptr<sensor_msgs::msg::Image> pMsg = NewMessage(nbytes, bHugePages, bLock, iNumaNode);
+		lock.lock();
+		if (nbytes == m_nbytesPayload && bHugePages == m_bHugePages && bLock == m_bLock && iNumaNode == m_iNumaNode)
+			m_spares.push_back(std::move(pMsg));
+	}
+} // SpareThread()
+
+} // namespace camera_aravis
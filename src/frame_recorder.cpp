@@ -0,0 +1,349 @@
+// Copyright 2016 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "camera_aravis/frame_recorder.h"
+#include "camera_aravis/util.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+namespace camera_aravis
+{
+
+static const size_t	nbytesBatchMax = 8 << 20;	// Per write() call.
+static const size_t	nBatchMax = 64;				// Frames per write() call.
+
+static size_t RoundUp (size_t n, size_t nAlign)
+{
+	return (n + nAlign - 1) / nAlign * nAlign;
+}
+
+
+FrameRecorder::FrameRecorder()
+	: nRecorded(0),
+	  nDropped(0),
+	  nbytesWritten(0),
+	  nErrors(0),
+	  m_nbytesSegment(0),
+	  m_bDirect(false),
+	  m_pStaging(NULL),
+	  m_nbytesStaging(0),
+	  m_posHead(0),
+	  m_posTail(0),
+	  m_bRun(false),
+	  m_iSegment(0),
+	  m_fdData(-1),
+	  m_fdIndex(-1),
+	  m_pIndex(NULL),
+	  m_nbytesIndex(0),
+	  m_offsetData(0)
+{
+	sem_init(&m_sem, 0, 0);
+}
+
+FrameRecorder::~FrameRecorder()
+{
+	Close();
+	sem_destroy(&m_sem);
+}
+
+bool FrameRecorder::Open(const std::string &stDir, const std::string &stGuid, const std::string &stPixelformat,
+                         size_t nbytesSegment, size_t nbytesQueue, bool bDirect, std::string &stError)
+{
+	Close();
+
+	m_stDir = stDir;
+	m_stGuid = stGuid;
+	m_stPixelformat = stPixelformat;
+	m_nbytesSegment = RoundUp(std::max(nbytesSegment, nbytesRecordingBlock), nbytesRecordingBlock);
+	m_bDirect = bDirect;
+	m_iSegment = 0;
+
+	if (!MakeDirectories(stDir))
+	{
+		stError = "Cannot create " + stDir + ": " + strerror(errno);
+		return false;
+	}
+
+	// O_DIRECT needs the source memory aligned as well as the file offsets and sizes.
+	m_nbytesStaging = RoundUp(std::max(nbytesQueue, nbytesRecordingBlock), nbytesRecordingBlock);
+	if (posix_memalign((void **)&m_pStaging, nbytesRecordingBlock, m_nbytesStaging) != 0)
+	{
+		m_pStaging = NULL;
+		stError = "Cannot allocate the staging buffer";
+		return false;
+	}
+	m_posHead = 0;
+	m_posTail = 0;
+	m_ring.Resize(std::max<size_t>(m_nbytesStaging / nbytesRecordingBlock, 2));
+
+	if (!OpenSegment())
+	{
+		stError = "Cannot open " + RecordingSegmentPath(stDir, 0, "dat") + ": " + strerror(errno);
+		free(m_pStaging);
+		m_pStaging = NULL;
+		return false;
+	}
+
+	m_bRun = true;
+	m_thread = std::thread(&FrameRecorder::Writer, this);
+	return true;
+} // Open()
+
+void FrameRecorder::Close(void)
+{
+	if (m_thread.joinable())
+	{
+		m_bRun = false;
+		sem_post(&m_sem);
+		m_thread.join();
+	}
+	CloseSegment();
+
+	free(m_pStaging);
+	m_pStaging = NULL;
+}
+
+
+// OpenSegment()
+// Create the next .dat file, preallocated to the full segment size so the file system
+// does not allocate on the write path, and its index, mapped.
+bool FrameRecorder::OpenSegment(void)
+{
+	std::string	stData = RecordingSegmentPath(m_stDir, m_iSegment, "dat");
+	std::string	stIndex = RecordingSegmentPath(m_stDir, m_iSegment, "idx");
+	int			flags = O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC;
+
+	m_fdData = -1;
+	if (m_bDirect)
+	{
+		m_fdData = open(stData.c_str(), flags | O_DIRECT, 0644);
+		if (m_fdData < 0 && errno == EINVAL)
+			m_bDirect = false;	// e.g. tmpfs.
+	}
+	if (m_fdData < 0)
+		m_fdData = open(stData.c_str(), flags, 0644);
+	if (m_fdData < 0)
+		return false;
+	posix_fallocate(m_fdData, 0, m_nbytesSegment);
+
+	// Room for as many entries as the segment can hold frames.
+	uint32_t nEntriesMax = (uint32_t)std::min<size_t>(m_nbytesSegment / nbytesRecordingBlock, UINT32_MAX);
+	m_nbytesIndex = sizeof(RecordingIndexHeader) + (size_t)nEntriesMax * sizeof(RecordingEntry);
+	m_fdIndex = open(stIndex.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+	if (m_fdIndex < 0 || ftruncate(m_fdIndex, m_nbytesIndex) != 0)
+		return false;
+	void *p = mmap(NULL, m_nbytesIndex, PROT_READ | PROT_WRITE, MAP_SHARED, m_fdIndex, 0);
+	if (p == MAP_FAILED)
+		return false;
+	m_pIndex = (RecordingIndexHeader *)p;
+
+	memcpy(m_pIndex->magic, szRecordingMagic, sizeof(szRecordingMagic));
+	m_pIndex->version = nRecordingVersion;
+	m_pIndex->nbytesEntry = sizeof(RecordingEntry);
+	m_pIndex->iSegment = m_iSegment;
+	m_pIndex->nEntriesMax = nEntriesMax;
+	m_pIndex->nEntries = 0;
+	m_pIndex->nbytesData = 0;
+	strncpy(m_pIndex->szGuid, m_stGuid.c_str(), sizeof(m_pIndex->szGuid) - 1);
+	strncpy(m_pIndex->szPixelformat, m_stPixelformat.c_str(), sizeof(m_pIndex->szPixelformat) - 1);
+
+	m_offsetData = 0;
+	return true;
+} // OpenSegment()
+
+// CloseSegment()
+// Give back the unused preallocation and trim the index to the entries written.
+void FrameRecorder::CloseSegment(void)
+{
+	uint64_t nEntries = 0;
+
+	if (m_pIndex)
+	{
+		nEntries = m_pIndex->nEntries;
+		munmap(m_pIndex, m_nbytesIndex);
+		m_pIndex = NULL;
+	}
+	if (m_fdIndex >= 0)
+	{
+		if (ftruncate(m_fdIndex, sizeof(RecordingIndexHeader) + nEntries * sizeof(RecordingEntry)) != 0)
+			nErrors++;
+		close(m_fdIndex);
+		m_fdIndex = -1;
+	}
+	if (m_fdData >= 0)
+	{
+		if (ftruncate(m_fdData, m_offsetData) != 0)
+			nErrors++;
+		close(m_fdData);
+		m_fdData = -1;
+	}
+	m_iSegment++;
+} // CloseSegment()
+
+
+bool FrameRecorder::Record(const uint8_t *pData, const RecordingEntry &entry)
+{
+	Staged		staged;
+	uint64_t	pos = m_posHead;
+	size_t		nbytesPadded = RoundUp(entry.nbytes, nbytesRecordingBlock);
+	size_t		offset = pos % m_nbytesStaging;
+
+	// A frame never wraps around the end of the staging buffer, so each is one write.
+	if (offset + nbytesPadded > m_nbytesStaging)
+		pos += m_nbytesStaging - offset;
+	if (pos + nbytesPadded - m_posTail.load(std::memory_order_acquire) > m_nbytesStaging)
+	{
+		nDropped++;
+		return false;
+	}
+
+	uint8_t *pStaged = m_pStaging + pos % m_nbytesStaging;
+	memcpy(pStaged, pData, entry.nbytes);
+	memset(pStaged + entry.nbytes, 0, nbytesPadded - entry.nbytes);
+
+	staged.pos = pos;
+	staged.nbytesPadded = nbytesPadded;
+	staged.entry = entry;
+	if (!m_ring.Push(staged))
+	{
+		nDropped++;
+		return false;
+	}
+	m_posHead = pos + nbytesPadded;
+	sem_post(&m_sem);
+
+	return true;
+} // Record()
+
+
+// Writer()
+// Gather frames that sit back to back in the staging buffer and in the segment into
+// one write, up to nbytesBatchMax.
+void FrameRecorder::Writer(void)
+{
+	Staged		batch[nBatchMax];
+	Staged		next;
+	bool		bNext = false;
+
+	for (;;)
+	{
+		if (!bNext && !m_ring.Pop(next))
+		{
+			if (!m_bRun)
+				break;
+			sem_wait(&m_sem);
+			continue;
+		}
+		bNext = false;
+
+		if (next.nbytesPadded > m_nbytesSegment)
+		{
+			nErrors++;	// Can never fit.
+			m_posTail.store(next.pos + next.nbytesPadded, std::memory_order_release);
+			continue;
+		}
+		if (m_offsetData + next.nbytesPadded > m_nbytesSegment)
+		{
+			CloseSegment();
+			if (!OpenSegment())
+			{
+				nErrors++;
+				CloseSegment();
+				m_posTail.store(next.pos + next.nbytesPadded, std::memory_order_release);
+				continue;
+			}
+		}
+
+		size_t	nBatch = 0;
+		size_t	nbytesBatch = 0;
+		batch[nBatch++] = next;
+		nbytesBatch += next.nbytesPadded;
+		while (nBatch < nBatchMax && m_ring.Pop(next))
+		{
+			const Staged &last = batch[nBatch - 1];
+			bool bContiguous = next.pos == last.pos + last.nbytesPadded && next.pos % m_nbytesStaging != 0;
+
+			if (!bContiguous || nbytesBatch + next.nbytesPadded > nbytesBatchMax ||
+			    m_offsetData + nbytesBatch + next.nbytesPadded > m_nbytesSegment)
+			{
+				bNext = true;
+				break;
+			}
+			batch[nBatch++] = next;
+			nbytesBatch += next.nbytesPadded;
+		}
+
+		WriteBatch(batch, nBatch);
+	}
+} // Writer()
+
+void FrameRecorder::WriteBatch(Staged *pBatch, size_t nBatch)
+{
+	const uint8_t	*p = m_pStaging + pBatch[0].pos % m_nbytesStaging;
+	size_t			 nbytes = 0;
+	size_t			 nbytesDone = 0;
+	int64_t			 nsStart = NowNs();
+
+	for (size_t i=0; i<nBatch; i++)
+		nbytes += pBatch[i].nbytesPadded;
+
+	while (nbytesDone < nbytes)
+	{
+		ssize_t n = pwrite(m_fdData, p + nbytesDone, nbytes - nbytesDone, m_offsetData + nbytesDone);
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n <= 0)
+			break;
+		nbytesDone += n;
+	}
+	histWrite.Record(NowNs() - nsStart);
+
+	if (m_fdData < 0 || nbytesDone < nbytes)
+		nErrors += nBatch;
+	else
+	{
+		RecordingEntry *pEntries = (RecordingEntry *)(m_pIndex + 1);
+		uint64_t		offset = m_offsetData;
+
+		for (size_t i=0; i<nBatch; i++)
+		{
+			uint64_t iEntry = m_pIndex->nEntries;
+
+			pEntries[iEntry] = pBatch[i].entry;
+			pEntries[iEntry].offset = offset;
+			offset += pBatch[i].nbytesPadded;
+
+			// Readers of a live recording see an entry only once it is complete.
+			__atomic_store_n(&m_pIndex->nEntries, iEntry + 1, __ATOMIC_RELEASE);
+		}
+		m_offsetData += nbytes;
+		m_pIndex->nbytesData = m_offsetData;
+		nRecorded += nBatch;
+		nbytesWritten += nbytes;
+	}
+
+	// The staging space can be reused.
+	m_posTail.store(pBatch[nBatch - 1].pos + pBatch[nBatch - 1].nbytesPadded, std::memory_order_release);
+} // WriteBatch()
+
+} // namespace camera_aravis
@@ -0,0 +1,233 @@
+// Copyright 2016 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+
+#include "camera_aravis/frame_sync.h"
+#include "camera_aravis/util.h"
+
+#include <time.h>
+
+#include <algorithm>
+#include <climits>
+
+namespace camera_aravis
+{
+
+FrameSync::FrameSync()
+	: m_nsTolerance(0),
+	  m_nsTimeout(0),
+	  m_bIncomplete(false),
+	  m_bRun(false),
+	  m_nPushed(0),
+	  m_nSets(0),
+	  m_nIncomplete(0),
+	  m_nUnmatched(0),
+	  m_nOverflows(0)
+{
+	sem_init(&m_sem, 0, 0);
+}
+
+FrameSync::~FrameSync()
+{
+	Stop();
+	sem_destroy(&m_sem);
+}
+
+void FrameSync::Start(int nCameras, int nWindow, int64_t nsTolerance, int64_t nsTimeout, bool bIncomplete, const PublishFn &fnPublish)
+{
+	Stop();
+
+	m_windows.clear();
+	for (int i=0; i<nCameras; i++)
+		m_windows.emplace_back(new SpscRing<Pending>(std::max(nWindow, 1)));
+	m_set.assign(nCameras, nullptr);
+	m_group.reserve(nCameras);
+	m_nsTolerance = nsTolerance;
+	m_nsTimeout = nsTimeout;
+	m_bIncomplete = bIncomplete;
+	m_fnPublish = fnPublish;
+	m_bRun = true;
+	m_thread = std::thread(&FrameSync::MatchThread, this);
+}
+
+// Stop()
+// Frames still waiting are dropped, which lets their buffers go.
+void FrameSync::Stop(void)
+{
+	if (!m_thread.joinable())
+		return;
+
+	m_bRun = false;
+	sem_post(&m_sem);
+	m_thread.join();
+
+	Pending pending;
+	for (auto &pWindow : m_windows)
+		while (pWindow->Pop(pending))
+			pending.pImage.reset();
+}
+
+bool FrameSync::Push(int iCamera, std::shared_ptr<const sensor_msgs::msg::Image> pImage, int64_t nsStamp)
+{
+	if (!m_bRun)
+		return false;
+
+	m_nPushed.fetch_add(1, std::memory_order_relaxed);
+	if (!m_windows[iCamera]->Push(Pending {std::move(pImage), nsStamp, NowNs()}))
+	{
+		m_nOverflows.fetch_add(1, std::memory_order_relaxed);
+		return false;
+	}
+	sem_post(&m_sem);
+	return true;
+}
+
+void FrameSync::Flush(int iCamera)
+{
+	std::lock_guard<std::mutex>	lock(m_mutexMatch);
+	Pending						pending;
+
+	if (iCamera < 0 || iCamera >= (int)m_windows.size())
+		return;
+	while (m_windows[iCamera]->Pop(pending))
+	{
+		pending.pImage.reset();
+		m_nUnmatched.fetch_add(1, std::memory_order_relaxed);
+	}
+}
+
+FrameSync::Counters FrameSync::Read(void) const
+{
+	Counters counters;
+
+	counters.nPushed = m_nPushed.load(std::memory_order_relaxed);
+	counters.nSets = m_nSets.load(std::memory_order_relaxed);
+	counters.nIncomplete = m_nIncomplete.load(std::memory_order_relaxed);
+	counters.nUnmatched = m_nUnmatched.load(std::memory_order_relaxed);
+	counters.nOverflows = m_nOverflows.load(std::memory_order_relaxed);
+	return counters;
+}
+
+
+// MatchThread()
+// Match whenever a frame arrives, and a few times per timeout besides, so that a frame
+// whose peers never come is let go in time.
+void FrameSync::MatchThread(void)
+{
+	const int64_t nsWait = std::max<int64_t>(m_nsTimeout / 4, 1000000);
+
+	while (m_bRun)
+	{
+		struct timespec ts;
+
+		clock_gettime(CLOCK_REALTIME, &ts);
+		ts.tv_sec += (ts.tv_nsec + nsWait) / 1000000000;
+		ts.tv_nsec = (ts.tv_nsec + nsWait) % 1000000000;
+		sem_timedwait(&m_sem, &ts);
+
+		std::lock_guard<std::mutex> lock(m_mutexMatch);
+		while (m_bRun && MatchOnce())
+			;
+	}
+} // MatchThread()
+
+
+// MatchOnce()
+// Look at the oldest frame of each window.  If they are all there and within the
+// tolerance, they are a set.  Otherwise the frames within the tolerance of the oldest
+// stamp can still be completed only while every window they lack is empty, and only
+// until they time out: each camera's stamps increase, so a window whose oldest frame is
+// later than that has already missed them.  True if any frame was taken.
+bool FrameSync::MatchOnce(void)
+{
+	const int	nCameras = (int)m_windows.size();
+	int64_t		nsStampMin = INT64_MAX;
+	int64_t		nsStampMax = INT64_MIN;
+	int			nPresent = 0;
+
+	for (int i=0; i<nCameras; i++)
+	{
+		const Pending *pPending = m_windows[i]->Front();
+
+		if (!pPending)
+			continue;
+		nPresent++;
+		nsStampMin = std::min(nsStampMin, pPending->nsStamp);
+		nsStampMax = std::max(nsStampMax, pPending->nsStamp);
+	}
+	if (nPresent == 0)
+		return false;
+
+	int64_t nsPushedMin = INT64_MAX;
+	m_group.clear();
+	for (int i=0; i<nCameras; i++)
+	{
+		const Pending *pPending = m_windows[i]->Front();
+
+		if (pPending && pPending->nsStamp - nsStampMin <= m_nsTolerance)
+		{
+			m_group.push_back(i);
+			nsPushedMin = std::min(nsPushedMin, pPending->nsPushed);
+		}
+	}
+
+	bool bComplete = (int)m_group.size() == nCameras;
+	bool bMissed = nsStampMax - nsStampMin > m_nsTolerance;
+	bool bTimedOut = NowNs() - nsPushedMin >= m_nsTimeout;
+	if (!bComplete && !bMissed && !bTimedOut)
+		return false;
+
+	if (bComplete || m_bIncomplete)
+		Emit (m_group);
+	else
+	{
+		Pending pending;
+
+		for (int i : m_group)
+			m_windows[i]->Pop(pending);
+		m_nUnmatched.fetch_add(m_group.size(), std::memory_order_relaxed);
+	}
+	return true;
+} // MatchOnce()
+
+
+void FrameSync::Emit(const std::vector<int> &cameras)
+{
+	int64_t nsStampMin = INT64_MAX;
+	int64_t nsStampMax = INT64_MIN;
+	int64_t nsPushedMin = INT64_MAX;
+
+	for (int i : cameras)
+	{
+		Pending pending;
+
+		m_windows[i]->Pop(pending);
+		nsStampMin = std::min(nsStampMin, pending.nsStamp);
+		nsStampMax = std::max(nsStampMax, pending.nsStamp);
+		nsPushedMin = std::min(nsPushedMin, pending.nsPushed);
+		m_set[i] = std::move(pending.pImage);
+	}
+
+	bool bComplete = cameras.size() == m_windows.size();
+	histSkew.Record (nsStampMax - nsStampMin);
+	m_fnPublish(m_set, nsStampMax - nsStampMin, bComplete);
+	histWait.Record (NowNs() - nsPushedMin);
+	(bComplete ? m_nSets : m_nIncomplete).fetch_add(1, std::memory_order_relaxed);
+
+	for (auto &pImage : m_set)
+		pImage.reset();
+}
+
+} // namespace camera_aravis
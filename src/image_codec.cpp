@@ -0,0 +1,246 @@
+// Copyright 2016 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "camera_aravis/image_codec.h"
+
+#include <csetjmp>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include <jpeglib.h>
+
+namespace camera_aravis
+{
+
+// libjpeg reports errors by calling error_exit, which by default exits the process.
+struct JpegError
+{
+	jpeg_error_mgr	mgr;
+	jmp_buf			jmpbuf;
+};
+
+static void JpegErrorExit(j_common_ptr pInfo)
+{
+	longjmp(((JpegError *)pInfo->err)->jmpbuf, 1);
+}
+
+struct ImageEncoder::JpegState
+{
+	jpeg_compress_struct	info;
+	JpegError				error;
+	unsigned char			*pBuffer;		// Reused output buffer, grown by libjpeg as needed.
+	unsigned long			nbytesBuffer;
+};
+
+
+ImageEncoder::ImageEncoder()
+	: m_pJpeg(new JpegState)
+{
+	m_pJpeg->info.err = jpeg_std_error(&m_pJpeg->error.mgr);
+	m_pJpeg->error.mgr.error_exit = JpegErrorExit;
+	jpeg_create_compress(&m_pJpeg->info);
+	m_pJpeg->pBuffer = NULL;
+	m_pJpeg->nbytesBuffer = 0;
+}
+
+ImageEncoder::~ImageEncoder()
+{
+	jpeg_destroy_compress(&m_pJpeg->info);
+	free(m_pJpeg->pBuffer);
+}
+
+bool ImageEncoder::IsSupported(const std::string &stEncoding)
+{
+	return stEncoding == "mono8" || stEncoding == "rgb8" || stEncoding == "bgr8";
+}
+
+bool ImageEncoder::Encode(ImageCodec codec, const sensor_msgs::msg::Image &image, int quality, sensor_msgs::msg::CompressedImage &msg)
+{
+	if (!IsSupported(image.encoding) || image.data.size() < (size_t)image.step * image.height)
+		return false;
+
+	msg.header = image.header;
+	switch (codec)
+	{
+	case CODEC_JPEG:
+		return EncodeJpeg(image, quality, msg);
+	case CODEC_QOI:
+		return EncodeQoi(image, msg);
+	default:
+		return false;
+	}
+}
+
+
+// EncodeJpeg()
+// Same format string as the image_transport "compressed" plugin, so its subscribers decode it.
+bool ImageEncoder::EncodeJpeg(const sensor_msgs::msg::Image &image, int quality, sensor_msgs::msg::CompressedImage &msg)
+{
+	jpeg_compress_struct	&info = m_pJpeg->info;
+	bool					 bMono = image.encoding == "mono8";
+
+	if (setjmp(m_pJpeg->error.jmpbuf))
+	{
+		jpeg_abort_compress(&info);
+		return false;
+	}
+
+	// libjpeg grows the buffer itself, but reports only the bytes written; keep the capacity.
+	unsigned long nbytes = m_pJpeg->nbytesBuffer;
+	jpeg_mem_dest(&info, &m_pJpeg->pBuffer, &nbytes);
+
+	info.image_width = image.width;
+	info.image_height = image.height;
+	info.input_components = bMono ? 1 : 3;
+	info.in_color_space = bMono ? JCS_GRAYSCALE : (image.encoding == "rgb8" ? JCS_EXT_RGB : JCS_EXT_BGR);
+	jpeg_set_defaults(&info);
+	jpeg_set_quality(&info, quality, TRUE);
+	info.dct_method = JDCT_ISLOW;
+
+	jpeg_start_compress(&info, TRUE);
+	while (info.next_scanline < info.image_height)
+	{
+		JSAMPROW pRow = (JSAMPROW)(image.data.data() + (size_t)info.next_scanline * image.step);
+		jpeg_write_scanlines(&info, &pRow, 1);
+	}
+	jpeg_finish_compress(&info);
+
+	if (nbytes > m_pJpeg->nbytesBuffer)
+		m_pJpeg->nbytesBuffer = nbytes;
+	msg.format = image.encoding + "; jpeg compressed " + (bMono ? "mono8" : "bgr8");
+	msg.data.assign(m_pJpeg->pBuffer, m_pJpeg->pBuffer + nbytes);
+
+	return true;
+} // EncodeJpeg()
+
+
+// QOI, https://qoiformat.org/qoi-specification.pdf: 3 channels, sRGB.
+// Mono images go out as grey RGB, which QOI's run and difference codes make nearly free.
+static const uint8_t	QOI_OP_INDEX = 0x00;
+static const uint8_t	QOI_OP_DIFF = 0x40;
+static const uint8_t	QOI_OP_LUMA = 0x80;
+static const uint8_t	QOI_OP_RUN = 0xC0;
+static const uint8_t	QOI_OP_RGB = 0xFE;
+
+static inline uint8_t *Put32(uint8_t *p, uint32_t v)
+{
+	p[0] = (uint8_t)(v >> 24);
+	p[1] = (uint8_t)(v >> 16);
+	p[2] = (uint8_t)(v >> 8);
+	p[3] = (uint8_t)v;
+	return p + 4;
+}
+
+bool ImageEncoder::EncodeQoi(const sensor_msgs::msg::Image &image, sensor_msgs::msg::CompressedImage &msg)
+{
+	const int		nChannels = image.encoding == "mono8" ? 1 : 3;
+	const bool		bBgr = image.encoding == "bgr8";
+	const size_t	nPixels = (size_t)image.width * image.height;
+	uint8_t			index[64][4];	// RGBA; the unused slots are transparent black.
+	uint8_t			prev[4] = {0, 0, 0, 255};
+	int				run = 0;
+
+	// Worst case: 4 bytes per pixel, plus header and end marker.  Encode into the
+	// scratch buffer, which keeps its size, and copy out only what was written.
+	if (m_qoi.size() < 14 + nPixels * 4 + 8)
+		m_qoi.resize(14 + nPixels * 4 + 8);
+	uint8_t *p = m_qoi.data();
+
+	memcpy(p, "qoif", 4);
+	p = Put32(p + 4, image.width);
+	p = Put32(p, image.height);
+	*p++ = 3;
+	*p++ = 0;
+
+	memset(index, 0, sizeof(index));
+	for (uint32_t y=0; y<image.height; y++)
+	{
+		const uint8_t *pRow = image.data.data() + (size_t)y * image.step;
+
+		for (uint32_t x=0; x<image.width; x++)
+		{
+			uint8_t px[4];
+
+			if (nChannels == 1)
+				px[0] = px[1] = px[2] = pRow[x];
+			else
+			{
+				px[0] = pRow[3*x + (bBgr ? 2 : 0)];
+				px[1] = pRow[3*x + 1];
+				px[2] = pRow[3*x + (bBgr ? 0 : 2)];
+			}
+			px[3] = 255;
+
+			if (px[0] == prev[0] && px[1] == prev[1] && px[2] == prev[2])
+			{
+				if (++run == 62)
+				{
+					*p++ = QOI_OP_RUN | (run - 1);
+					run = 0;
+				}
+				continue;
+			}
+			if (run > 0)
+			{
+				*p++ = QOI_OP_RUN | (run - 1);
+				run = 0;
+			}
+
+			int iHash = (px[0] * 3 + px[1] * 5 + px[2] * 7 + px[3] * 11) % 64;
+			if (!memcmp(index[iHash], px, 4))
+				*p++ = QOI_OP_INDEX | iHash;
+			else
+			{
+				memcpy(index[iHash], px, 4);
+
+				int8_t dr = (int8_t)(px[0] - prev[0]);
+				int8_t dg = (int8_t)(px[1] - prev[1]);
+				int8_t db = (int8_t)(px[2] - prev[2]);
+				int8_t dr_dg = (int8_t)(dr - dg);
+				int8_t db_dg = (int8_t)(db - dg);
+
+				if (dr >= -2 && dr <= 1 && dg >= -2 && dg <= 1 && db >= -2 && db <= 1)
+					*p++ = QOI_OP_DIFF | ((dr + 2) << 4) | ((dg + 2) << 2) | (db + 2);
+				else if (dg >= -32 && dg <= 31 && dr_dg >= -8 && dr_dg <= 7 && db_dg >= -8 && db_dg <= 7)
+				{
+					*p++ = QOI_OP_LUMA | (dg + 32);
+					*p++ = (uint8_t)(((dr_dg + 8) << 4) | (db_dg + 8));
+				}
+				else
+				{
+					*p++ = QOI_OP_RGB;
+					*p++ = px[0];
+					*p++ = px[1];
+					*p++ = px[2];
+				}
+			}
+			memcpy(prev, px, 4);
+		}
+	}
+	if (run > 0)
+		*p++ = QOI_OP_RUN | (run - 1);
+
+	static const uint8_t end[8] = {0, 0, 0, 0, 0, 0, 0, 1};
+	memcpy(p, end, sizeof(end));
+	p += sizeof(end);
+
+	msg.data.assign(m_qoi.data(), p);
+	msg.format = image.encoding + "; qoi compressed rgb8";
+
+	return true;
+} // EncodeQoi()
+
+} // namespace camera_aravis
@@ -0,0 +1,89 @@
+// Copyright 2016 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "camera_aravis/latency_histogram.h"
+
+namespace camera_aravis
+{
+
+LatencyHistogram::LatencyHistogram()
+	: m_nsSum(0),
+	  m_nsMax(0)
+{
+	for (int i=0; i<nBuckets; i++)
+		m_counts[i].store(0, std::memory_order_relaxed);
+}
+
+// Bucket()
+// Octave from the position of the top bit, sub-bucket from the two bits below it.
+// Values below 4 get a bucket each.
+int LatencyHistogram::Bucket(uint64_t ns)
+{
+	int		iMsb;
+	int		iBucket;
+
+	if (ns < nSubBuckets)
+		return (int)ns;
+
+	iMsb = 63 - __builtin_clzll(ns);
+	iBucket = (iMsb - 1) * nSubBuckets + (int)((ns >> (iMsb - 2)) & (nSubBuckets - 1));
+
+	return iBucket < nBuckets ? iBucket : nBuckets - 1;
+}
+
+uint64_t LatencyHistogram::BucketUpperNs(int iBucket)
+{
+	int		iMsb = iBucket / nSubBuckets + 1;
+	int		iSub = iBucket % nSubBuckets;
+
+	if (iBucket < nSubBuckets)
+		return (uint64_t)iBucket;
+
+	return ((uint64_t)(nSubBuckets + iSub + 1) << (iMsb - 2)) - 1;
+}
+
+void LatencyHistogram::Collect(Snapshot &snapshot)
+{
+	snapshot.n = 0;
+	for (int i=0; i<nBuckets; i++)
+	{
+		snapshot.counts[i] = m_counts[i].exchange(0, std::memory_order_relaxed);
+		snapshot.n += snapshot.counts[i];
+	}
+	snapshot.nsSum = m_nsSum.exchange(0, std::memory_order_relaxed);
+	snapshot.nsMax = m_nsMax.exchange(0, std::memory_order_relaxed);
+}
+
+uint64_t LatencyHistogram::Snapshot::Percentile(double p) const
+{
+	uint64_t	nRank = (uint64_t)(p * n + 0.5);
+	uint64_t	nSeen = 0;
+
+	if (n == 0)
+		return 0;
+	if (nRank < 1)
+		nRank = 1;
+
+	for (int i=0; i<nBuckets; i++)
+	{
+		nSeen += counts[i];
+		if (nSeen >= nRank)
+			return BucketUpperNs(i) < nsMax ? BucketUpperNs(i) : nsMax;
+	}
+
+	return nsMax;
+}
+
+} // namespace camera_aravis
@@ -0,0 +1,469 @@
+// Copyright 2016 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "camera_aravis/pixel_convert.h"
+#include "camera_aravis/simd.h"
+
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+namespace camera_aravis
+{
+
+static const int nLanes = 16;
+
+const char *PixelConversion::Encoding(void) const
+{
+	switch (kind)
+	{
+	case CONVERSION_BAYER8:
+	case CONVERSION_BAYER16:
+		return bBgr ? "bgr8" : "rgb8";
+	case CONVERSION_MONO16:
+	case CONVERSION_MONO10_PACKED:
+	case CONVERSION_MONO12_PACKED:
+		return "mono16";
+	default:
+		return NULL;
+	}
+}
+
+size_t PixelConversion::SrcStep(int width) const
+{
+	switch (kind)
+	{
+	case CONVERSION_BAYER8:
+		return (size_t)width;
+	case CONVERSION_MONO10_PACKED:
+	case CONVERSION_MONO12_PACKED:
+		return ((size_t)width * 12 + 7) / 8;
+	default:
+		return (size_t)width * 2;
+	}
+}
+
+size_t PixelConversion::DstStep(int width) const
+{
+	switch (kind)
+	{
+	case CONVERSION_BAYER8:
+	case CONVERSION_BAYER16:
+		return (size_t)width * 3;
+	default:
+		return (size_t)width * 2;
+	}
+}
+
+
+// Bayer layout helpers.  In each row one colour alternates with green; bXEven says
+// whether that colour sits on even columns, bXRed whether it is red.
+static void BayerRow(BayerPattern pattern, int y, bool &bXEven, bool &bXRed)
+{
+	bool bRow0XEven = pattern == BAYER_RG || pattern == BAYER_BG;
+	bool bRow0XRed = pattern == BAYER_RG || pattern == BAYER_GR;
+
+	bXEven = (y & 1) ? !bRow0XEven : bRow0XEven;
+	bXRed = (y & 1) ? !bRow0XRed : bRow0XRed;
+}
+
+// Mirror out-of-range neighbours back inside; a step of two keeps the Bayer phase.
+static inline int Mirror(int i, int n)
+{
+	return i < 0 ? 1 : (i >= n ? n - 2 : i);
+}
+
+// DemosaicPixel()
+// Bilinear demosaic of one pixel from its row and the rows above and below.
+static inline void DemosaicPixel(const uint8_t *pUp, const uint8_t *pCur, const uint8_t *pDn, int x, int width,
+                                 bool bXEven, bool bXRed, bool bBgr, uint8_t *pOut)
+{
+	int			xl = Mirror(x - 1, width);
+	int			xr = Mirror(x + 1, width);
+	unsigned	X, G, Y;
+
+	if (((x & 1) == 0) == bXEven)
+	{
+		X = pCur[x];
+		G = (pCur[xl] + pCur[xr] + pUp[x] + pDn[x] + 2) >> 2;
+		Y = (pUp[xl] + pUp[xr] + pDn[xl] + pDn[xr] + 2) >> 2;
+	}
+	else
+	{
+		G = pCur[x];
+		X = (pCur[xl] + pCur[xr] + 1) >> 1;
+		Y = (pUp[x] + pDn[x] + 1) >> 1;
+	}
+
+	uint8_t R = (uint8_t)(bXRed ? X : Y);
+	uint8_t B = (uint8_t)(bXRed ? Y : X);
+	pOut[0] = bBgr ? B : R;
+	pOut[1] = (uint8_t)G;
+	pOut[2] = bBgr ? R : B;
+}
+
+static inline void Load16(const uint8_t *p, v16u16 &v)
+{
+	v16u8 v8;
+
+	memcpy(&v8, p, sizeof(v8));
+	v = __builtin_convertvector(v8, v16u16);
+}
+
+// DemosaicRow()
+// One output row: vector chunks over the interior, the scalar pixel at the edges.
+TARGET_CLONES
+static void DemosaicRow(const uint8_t *pUp, const uint8_t *pCur, const uint8_t *pDn, uint8_t *pOut,
+                        int width, bool bXEven, bool bXRed, bool bBgr)
+{
+	v16u16		maskX;
+	int			x = 0;
+
+	// Chunks start at odd x, so lane i holds column parity (i+1)&1.
+	for (int i=0; i<nLanes; i++)
+		maskX[i] = ((((i + 1) & 1) == 0) == bXEven) ? 0xFFFF : 0;
+
+	DemosaicPixel(pUp, pCur, pDn, 0, width, bXEven, bXRed, bBgr, pOut);
+	for (x=1; x + nLanes < width; x += nLanes)
+	{
+		v16u16 c, l, r, u, d, ul, ur, dl, dr;
+
+		Load16(pCur + x, c);
+		Load16(pCur + x - 1, l);
+		Load16(pCur + x + 1, r);
+		Load16(pUp + x, u);
+		Load16(pDn + x, d);
+		Load16(pUp + x - 1, ul);
+		Load16(pUp + x + 1, ur);
+		Load16(pDn + x - 1, dl);
+		Load16(pDn + x + 1, dr);
+
+		v16u16 h2 = (l + r + 1) >> 1;
+		v16u16 v2 = (u + d + 1) >> 1;
+		v16u16 cross = (l + r + u + d + 2) >> 2;
+		v16u16 diag = (ul + ur + dl + dr + 2) >> 2;
+
+		v16u8 X = __builtin_convertvector((c & maskX) | (h2 & ~maskX), v16u8);
+		v16u8 G = __builtin_convertvector((cross & maskX) | (c & ~maskX), v16u8);
+		v16u8 Y = __builtin_convertvector((diag & maskX) | (v2 & ~maskX), v16u8);
+		v16u8 R = bXRed ? X : Y;
+		v16u8 B = bXRed ? Y : X;
+		v16u8 first = bBgr ? B : R;
+		v16u8 last = bBgr ? R : B;
+
+		uint8_t *p = pOut + 3 * x;
+		for (int i=0; i<nLanes; i++)
+		{
+			p[3*i + 0] = first[i];
+			p[3*i + 1] = G[i];
+			p[3*i + 2] = last[i];
+		}
+	}
+	for (; x<width; x++)
+		DemosaicPixel(pUp, pCur, pDn, x, width, bXEven, bXRed, bBgr, pOut + 3 * x);
+}
+
+// Top 8 of nBits bits, saturated.
+static inline uint8_t Top8(uint16_t v, int shift)
+{
+	unsigned u = (unsigned)v >> shift;
+
+	return (uint8_t)(u > 255 ? 255 : u);
+}
+
+TARGET_CLONES
+static void ShiftRow(const uint8_t *pSrc, uint8_t *pDst, int width, int shift)
+{
+	const uint16_t	*p = (const uint16_t *)pSrc;
+	const v16u16	vZero = {};
+	const v16u16	vMax = vZero + 255;
+	int				x = 0;
+
+	for (; x + nLanes <= width; x += nLanes)
+	{
+		v16u16 v;
+
+		memcpy(&v, p + x, sizeof(v));
+		v >>= shift;
+		v = v > 255 ? vMax : v;
+		v16u8 out = __builtin_convertvector(v, v16u8);
+		memcpy(pDst + x, &out, sizeof(out));
+	}
+	for (; x<width; x++)
+		pDst[x] = Top8(p[x], shift);
+}
+
+// MSB-align one row of 16 bit words.
+TARGET_CLONES
+static void AlignRow(const uint16_t *pSrc, uint16_t *pDst, int width, int shift)
+{
+	int x = 0;
+
+	for (; x + nLanes <= width; x += nLanes)
+	{
+		v16u16 v;
+
+		memcpy(&v, pSrc + x, sizeof(v));
+		v <<= shift;
+		memcpy(pDst + x, &v, sizeof(v));
+	}
+	for (; x<width; x++)
+		pDst[x] = (uint16_t)(pSrc[x] << shift);
+}
+
+static inline void Unpack(const uint8_t *p, int nBits, uint16_t &p0, uint16_t &p1)
+{
+	// GigE Vision packing: two pixels in three bytes, the low bits of both in the middle byte.
+	if (nBits == 12)
+	{
+		p0 = (uint16_t)((p[0] << 4) | (p[1] & 0x0F));
+		p1 = (uint16_t)((p[2] << 4) | (p[1] >> 4));
+	}
+	else
+	{
+		p0 = (uint16_t)((p[0] << 2) | (p[1] & 0x03));
+		p1 = (uint16_t)((p[2] << 2) | ((p[1] >> 4) & 0x03));
+	}
+}
+
+// UnpackRow()
+// Vector chunks of 16 pixels from 24 bytes, loaded as bytes 0-15 and 8-23: one shuffle
+// gathers each pixel's high byte, another the shared middle byte, whose nibble is then
+// picked with a per-lane shift.
+TARGET_CLONES
+static void UnpackRow(const uint8_t *pSrc, uint16_t *pDst, int width, int nBits)
+{
+	// Indices into the two loads side by side; byte k >= 16 of the chunk is at k + 8.
+	static const v16u8	idxHigh = {0, 2, 3, 5, 6, 8, 9, 11, 12, 14, 15, 25, 26, 28, 29, 31};
+	static const v16u8	idxLow = {1, 1, 4, 4, 7, 7, 10, 10, 13, 13, 24, 24, 27, 27, 30, 30};
+	static const v16u16	nibble = {0, 4, 0, 4, 0, 4, 0, 4, 0, 4, 0, 4, 0, 4, 0, 4};
+	const uint16_t		bitsLow = nBits == 12 ? 0x0F : 0x03;
+	const v16u16		vZero = {};
+	const v16u16		maskLow = vZero + bitsLow;
+	const int			shift = 16 - nBits;
+	int					x = 0;
+
+	for (; x + nLanes <= width; x += nLanes)
+	{
+		const uint8_t	*p = pSrc + 3 * (x / 2);
+		v16u8			a;
+		v16u8			b;
+
+		memcpy(&a, p, sizeof(a));
+		memcpy(&b, p + 8, sizeof(b));
+		v16u16 high = __builtin_convertvector(__builtin_shuffle(a, b, idxHigh), v16u16);
+		v16u16 low = __builtin_convertvector(__builtin_shuffle(a, b, idxLow), v16u16);
+		v16u16 v = ((high << (nBits - 8)) | ((low >> nibble) & maskLow)) << shift;
+		memcpy(pDst + x, &v, sizeof(v));
+	}
+	for (; x + 1 < width; x += 2)
+	{
+		uint16_t p0, p1;
+		Unpack(pSrc + 3 * (x / 2), nBits, p0, p1);
+		pDst[x] = (uint16_t)(p0 << shift);
+		pDst[x + 1] = (uint16_t)(p1 << shift);
+	}
+	if (x < width)
+	{
+		uint16_t p0, p1;
+		uint8_t  tail[3] = {pSrc[3 * (x / 2)], pSrc[3 * (x / 2) + 1], 0};
+		Unpack(tail, nBits, p0, p1);
+		pDst[x] = (uint16_t)(p0 << shift);
+	}
+}
+
+
+void ConvertRows(const PixelConversion &conv, const uint8_t *pSrc, uint8_t *pDst, int width, int height, int yBegin, int yEnd)
+{
+	const size_t	srcStep = conv.SrcStep(width);
+	const size_t	dstStep = conv.DstStep(width);
+	bool			bXEven;
+	bool			bXRed;
+
+	switch (conv.kind)
+	{
+	case CONVERSION_BAYER8:
+		for (int y=yBegin; y<yEnd; y++)
+		{
+			BayerRow(conv.pattern, y, bXEven, bXRed);
+			DemosaicRow(pSrc + Mirror(y - 1, height) * srcStep, pSrc + y * srcStep, pSrc + Mirror(y + 1, height) * srcStep,
+			            pDst + y * dstStep, width, bXEven, bXRed, conv.bBgr);
+		}
+		break;
+
+	case CONVERSION_BAYER16:
+	{
+		// Reduce to 8 bits a row at a time, keeping the three rows in view.
+		static thread_local std::vector<uint8_t> rows;
+		int			shift = conv.nBitsIn > 8 ? conv.nBitsIn - 8 : 0;
+		uint8_t		*pRow[3];
+		int			yRow[3] = {-1, -1, -1};
+
+		rows.resize(3 * (size_t)width);
+		for (int i=0; i<3; i++)
+			pRow[i] = rows.data() + i * (size_t)width;
+
+		for (int y=yBegin; y<yEnd; y++)
+		{
+			int			yNeed[3] = {Mirror(y - 1, height), y, Mirror(y + 1, height)};
+			uint8_t		*pNeed[3] = {NULL, NULL, NULL};
+			bool		bUsed[3] = {false, false, false};
+
+			for (int i=0; i<3; i++)
+			{
+				for (int j=0; j<3; j++)
+				{
+					if (yRow[j] == yNeed[i])
+					{
+						pNeed[i] = pRow[j];
+						bUsed[j] = true;
+						break;
+					}
+				}
+			}
+			for (int i=0; i<3; i++)
+			{
+				if (pNeed[i])
+					continue;
+				// Reuse a row no longer needed.
+				for (int j=0; j<3; j++)
+				{
+					if (!bUsed[j])
+					{
+						ShiftRow(pSrc + yNeed[i] * srcStep, pRow[j], width, shift);
+						yRow[j] = yNeed[i];
+						bUsed[j] = true;
+						for (int k=i; k<3; k++)
+							if (yNeed[k] == yNeed[i])
+								pNeed[k] = pRow[j];
+						break;
+					}
+				}
+			}
+
+			BayerRow(conv.pattern, y, bXEven, bXRed);
+			DemosaicRow(pNeed[0], pNeed[1], pNeed[2], pDst + y * dstStep, width, bXEven, bXRed, conv.bBgr);
+		}
+		break;
+	}
+
+	case CONVERSION_MONO16:
+	{
+		const int shift = 16 - conv.nBitsIn;
+		for (int y=yBegin; y<yEnd; y++)
+			AlignRow((const uint16_t *)(pSrc + y * srcStep), (uint16_t *)(pDst + y * dstStep), width, shift);
+		break;
+	}
+
+	case CONVERSION_MONO10_PACKED:
+	case CONVERSION_MONO12_PACKED:
+		for (int y=yBegin; y<yEnd; y++)
+			UnpackRow(pSrc + y * srcStep, (uint16_t *)(pDst + y * dstStep), width, conv.kind == CONVERSION_MONO12_PACKED ? 12 : 10);
+		break;
+
+	default:
+		break;
+	}
+} // ConvertRows()
+
+
+// ConvertRowsReference()
+// Pixel at a time, straight from the definitions.  The yardstick for ConvertRows().
+void ConvertRowsReference(const PixelConversion &conv, const uint8_t *pSrc, uint8_t *pDst, int width, int height, int yBegin, int yEnd)
+{
+	const size_t	srcStep = conv.SrcStep(width);
+	const size_t	dstStep = conv.DstStep(width);
+	bool			bXEven;
+	bool			bXRed;
+
+	for (int y=yBegin; y<yEnd; y++)
+	{
+		const uint8_t	*pRow = pSrc + y * srcStep;
+		uint8_t			*pOut = pDst + y * dstStep;
+
+		switch (conv.kind)
+		{
+		case CONVERSION_BAYER8:
+		case CONVERSION_BAYER16:
+		{
+			int shift = conv.kind == CONVERSION_BAYER16 && conv.nBitsIn > 8 ? conv.nBitsIn - 8 : 0;
+			int yUp = Mirror(y - 1, height);
+			int yDn = Mirror(y + 1, height);
+			std::vector<uint8_t> up(width), cur(width), dn(width);
+
+			for (int x=0; x<width; x++)
+			{
+				if (conv.kind == CONVERSION_BAYER8)
+				{
+					up[x] = pSrc[yUp * srcStep + x];
+					cur[x] = pRow[x];
+					dn[x] = pSrc[yDn * srcStep + x];
+				}
+				else
+				{
+					up[x] = Top8(((const uint16_t *)(pSrc + yUp * srcStep))[x], shift);
+					cur[x] = Top8(((const uint16_t *)pRow)[x], shift);
+					dn[x] = Top8(((const uint16_t *)(pSrc + yDn * srcStep))[x], shift);
+				}
+			}
+			BayerRow(conv.pattern, y, bXEven, bXRed);
+			for (int x=0; x<width; x++)
+				DemosaicPixel(up.data(), cur.data(), dn.data(), x, width, bXEven, bXRed, conv.bBgr, pOut + 3 * x);
+			break;
+		}
+
+		case CONVERSION_MONO16:
+			for (int x=0; x<width; x++)
+				((uint16_t *)pOut)[x] = (uint16_t)(((const uint16_t *)pRow)[x] << (16 - conv.nBitsIn));
+			break;
+
+		case CONVERSION_MONO10_PACKED:
+		case CONVERSION_MONO12_PACKED:
+		{
+			int nBits = conv.kind == CONVERSION_MONO12_PACKED ? 12 : 10;
+			for (int x=0; x<width; x++)
+			{
+				const uint8_t	*p = pRow + 3 * (x / 2);
+				uint16_t		 v;
+				if (nBits == 12)
+					v = (x & 1) ? (uint16_t)((p[2] << 4) | (p[1] >> 4)) : (uint16_t)((p[0] << 4) | (p[1] & 0x0F));
+				else
+					v = (x & 1) ? (uint16_t)((p[2] << 2) | ((p[1] >> 4) & 0x03)) : (uint16_t)((p[0] << 2) | (p[1] & 0x03));
+				((uint16_t *)pOut)[x] = (uint16_t)(v << (16 - nBits));
+			}
+			break;
+		}
+
+		default:
+			break;
+		}
+	}
+} // ConvertRowsReference()
+
+
+int SignificantBits(const std::string &stPixelformat, int nDefault)
+{
+	size_t iEnd = stPixelformat.size();
+
+	while (iEnd > 0 && !isdigit((unsigned char)stPixelformat[iEnd - 1]))
+		iEnd--;
+	size_t iBegin = iEnd;
+	while (iBegin > 0 && isdigit((unsigned char)stPixelformat[iBegin - 1]))
+		iBegin--;
+	return iBegin < iEnd ? atoi(stPixelformat.substr(iBegin, iEnd - iBegin).c_str()) : nDefault;
+}
+
+} // namespace camera_aravis
@@ -0,0 +1,168 @@
+// Copyright 2016 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "camera_aravis/pyramid.h"
+#include "camera_aravis/simd.h"
+
+#include <cstring>
+#include <vector>
+
+namespace camera_aravis
+{
+
+static const int nLanes = 16;
+
+// Loading pixel pairs as one wider word puts the left pixel in the low half and the
+// right one in the high half (little endian), so the horizontal pair sum needs no shuffle.
+TARGET_CLONES
+static void HalveRowMono8(const uint8_t *pA, const uint8_t *pB, uint8_t *pDst, int widthDst)
+{
+	int x = 0;
+
+	for (; x + nLanes <= widthDst; x += nLanes)
+	{
+		v16u16 a, b;
+
+		memcpy(&a, pA + 2 * x, sizeof(a));
+		memcpy(&b, pB + 2 * x, sizeof(b));
+		v16u16 sum = (a & 0xFF) + (a >> 8) + (b & 0xFF) + (b >> 8) + 2;
+		v16u8 out = __builtin_convertvector(sum >> 2, v16u8);
+		memcpy(pDst + x, &out, sizeof(out));
+	}
+	for (; x<widthDst; x++)
+		pDst[x] = (uint8_t)((pA[2*x] + pA[2*x + 1] + pB[2*x] + pB[2*x + 1] + 2) >> 2);
+}
+
+TARGET_CLONES
+static void HalveRowMono16(const uint8_t *pA, const uint8_t *pB, uint8_t *pDst, int widthDst)
+{
+	int x = 0;
+
+	for (; x + nLanes <= widthDst; x += nLanes)
+	{
+		v16u32 a, b;
+
+		memcpy(&a, pA + 4 * x, sizeof(a));
+		memcpy(&b, pB + 4 * x, sizeof(b));
+		v16u32 sum = (a & 0xFFFF) + (a >> 16) + (b & 0xFFFF) + (b >> 16) + 2;
+		v16u16 out = __builtin_convertvector(sum >> 2, v16u16);
+		memcpy(pDst + 2 * x, &out, sizeof(out));
+	}
+	for (; x<widthDst; x++)
+	{
+		uint16_t p[4];
+
+		memcpy(p, pA + 4 * x, 4);
+		memcpy(p + 2, pB + 4 * x, 4);
+		uint16_t out = (uint16_t)(((uint32_t)p[0] + p[1] + p[2] + p[3] + 2) >> 2);
+		memcpy(pDst + 2 * x, &out, 2);
+	}
+}
+
+// Interleaved colour: add the two rows with vectors, then the pixel pairs.
+TARGET_CLONES
+static void HalveRowColor8(const uint8_t *pA, const uint8_t *pB, uint8_t *pDst, int widthDst)
+{
+	static thread_local std::vector<uint16_t>	sums;
+	const int									nbytes = 6 * widthDst;
+	int											i = 0;
+
+	sums.resize(nbytes);
+	for (; i + nLanes <= nbytes; i += nLanes)
+	{
+		v16u8 a, b;
+
+		memcpy(&a, pA + i, sizeof(a));
+		memcpy(&b, pB + i, sizeof(b));
+		v16u16 sum = __builtin_convertvector(a, v16u16) + __builtin_convertvector(b, v16u16);
+		memcpy(sums.data() + i, &sum, sizeof(sum));
+	}
+	for (; i<nbytes; i++)
+		sums[i] = (uint16_t)(pA[i] + pB[i]);
+
+	const uint16_t *pSum = sums.data();
+	for (int x=0; x<widthDst; x++)
+		for (int c=0; c<3; c++)
+			pDst[3*x + c] = (uint8_t)((pSum[6*x + c] + pSum[6*x + 3 + c] + 2) >> 2);
+}
+
+
+PyramidSource PyramidSourceFor(const std::string &stEncoding)
+{
+	if (stEncoding == "mono8")
+		return PYRAMID_MONO8;
+	if (stEncoding == "mono16")
+		return PYRAMID_MONO16;
+	if (stEncoding == "rgb8" || stEncoding == "bgr8")
+		return PYRAMID_COLOR8;
+	if (stEncoding.compare(0, 6, "bayer_") == 0 && stEncoding.back() == '8')
+		return PYRAMID_BAYER8;
+	return PYRAMID_NONE;
+}
+
+
+void HalveRows(PyramidSource source, const uint8_t *pSrc, size_t srcStep, uint8_t *pDst, size_t dstStep, int widthDst, int yBegin, int yEnd)
+{
+	for (int y=yBegin; y<yEnd; y++)
+	{
+		const uint8_t	*pA = pSrc + 2 * y * srcStep;
+		const uint8_t	*pB = pA + srcStep;
+		uint8_t			*pOut = pDst + y * dstStep;
+
+		switch (source)
+		{
+		case PYRAMID_MONO8:
+			HalveRowMono8(pA, pB, pOut, widthDst);
+			break;
+		case PYRAMID_MONO16:
+			HalveRowMono16(pA, pB, pOut, widthDst);
+			break;
+		case PYRAMID_COLOR8:
+			HalveRowColor8(pA, pB, pOut, widthDst);
+			break;
+		default:
+			return;
+		}
+	}
+} // HalveRows()
+
+
+void HalveBayerRows(BayerPattern pattern, bool bBgr, const uint8_t *pSrc, size_t srcStep, uint8_t *pDst, size_t dstStep, int widthDst, int yBegin, int yEnd)
+{
+	// Offsets of R and B within the quad; the greens are the other two.
+	int		iRed = pattern == BAYER_RG ? 0 : (pattern == BAYER_GR ? 1 : (pattern == BAYER_GB ? 2 : 3));
+	int		iBlue = 3 - iRed;
+	int		iFirst = bBgr ? iBlue : iRed;
+	int		iLast = bBgr ? iRed : iBlue;
+	int		iGreen0 = (iRed == 0 || iRed == 3) ? 1 : 0;
+	int		iGreen1 = 3 - iGreen0;
+
+	for (int y=yBegin; y<yEnd; y++)
+	{
+		const uint8_t	*pRow[2] = {pSrc + 2 * y * srcStep, pSrc + (2 * y + 1) * srcStep};
+		uint8_t			*pOut = pDst + y * dstStep;
+
+		for (int x=0; x<widthDst; x++)
+		{
+			uint8_t q[4] = {pRow[0][2*x], pRow[0][2*x + 1], pRow[1][2*x], pRow[1][2*x + 1]};
+
+			pOut[3*x + 0] = q[iFirst];
+			pOut[3*x + 1] = (uint8_t)((q[iGreen0] + q[iGreen1] + 1) >> 1);
+			pOut[3*x + 2] = q[iLast];
+		}
+	}
+} // HalveBayerRows()
+
+} // namespace camera_aravis
@@ -0,0 +1,427 @@
+// Copyright 2016 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+
+#include "camera_aravis/rectify.h"
+#include "camera_aravis/simd.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace camera_aravis
+{
+
+// In the row kernels the gathers are per lane; the blend is in vectors.
+static const int		nLanes = 16;
+static const uint32_t	nOne = 1 << RectifyMap::nFractionBits;
+static const uint32_t	nRound = 1 << (2 * RectifyMap::nFractionBits - 1);
+static const int		nShift = 2 * RectifyMap::nFractionBits;
+
+
+RectifySource RectifySourceFor(const std::string &stEncoding)
+{
+	if (stEncoding == "mono8")
+		return RECTIFY_MONO8;
+	if (stEncoding == "mono16")
+		return RECTIFY_MONO16;
+	if (stEncoding == "rgb8" || stEncoding == "bgr8")
+		return RECTIFY_COLOR8;
+	return RECTIFY_NONE;
+}
+
+
+// By reference: 64-byte vectors passed by value change the ABI between the clones.
+static inline void Blend(const v16u32 &p00, const v16u32 &p01, const v16u32 &p10, const v16u32 &p11, const v16u32 &weights, v16u32 &out)
+{
+	v16u32 fx = weights & 0xFF;
+	v16u32 fy = weights >> 8;
+	v16u32 top = p00 * (nOne - fx) + p01 * fx;
+	v16u32 bottom = p10 * (nOne - fx) + p11 * fx;
+
+	out = ((top * (nOne - fy) + bottom * fy + nRound) >> nShift) & (v16u32)(weights != RectifyMap::nInvalid);
+}
+
+static inline uint32_t BlendOne(uint32_t p00, uint32_t p01, uint32_t p10, uint32_t p11, uint16_t weights)
+{
+	if (weights == RectifyMap::nInvalid)
+		return 0;
+
+	uint32_t fx = weights & 0xFF;
+	uint32_t fy = weights >> 8;
+	uint32_t top = p00 * (nOne - fx) + p01 * fx;
+	uint32_t bottom = p10 * (nOne - fx) + p11 * fx;
+
+	return (top * (nOne - fy) + bottom * fy + nRound) >> nShift;
+}
+
+static inline const uint8_t *SourceOf(const uint8_t *pSrc, size_t srcStep, uint32_t xy, int nbytesPixel)
+{
+	return pSrc + (xy >> 16) * srcStep + (xy & 0xFFFF) * nbytesPixel;
+}
+
+TARGET_CLONES
+static void RemapRowMono8(const uint8_t *pSrc, size_t srcStep, const uint32_t *pXY, const uint16_t *pWeights, uint8_t *pDst, int n)
+{
+	int i = 0;
+
+	for (; i + nLanes <= n; i += nLanes)
+	{
+		v16u32 p00, p01, p10, p11;
+		v16u16 weights;
+
+		for (int l=0; l<nLanes; l++)
+		{
+			const uint8_t *p = SourceOf(pSrc, srcStep, pXY[i + l], 1);
+
+			p00[l] = p[0];
+			p01[l] = p[1];
+			p10[l] = p[srcStep];
+			p11[l] = p[srcStep + 1];
+		}
+		memcpy(&weights, pWeights + i, sizeof(weights));
+
+		v16u32 weights32 = __builtin_convertvector(weights, v16u32);
+		v16u32 blend;
+		Blend(p00, p01, p10, p11, weights32, blend);
+		v16u8 out = __builtin_convertvector(blend, v16u8);
+		memcpy(pDst + i, &out, sizeof(out));
+	}
+	for (; i<n; i++)
+	{
+		const uint8_t *p = SourceOf(pSrc, srcStep, pXY[i], 1);
+
+		pDst[i] = (uint8_t)BlendOne(p[0], p[1], p[srcStep], p[srcStep + 1], pWeights[i]);
+	}
+}
+
+TARGET_CLONES
+static void RemapRowMono16(const uint8_t *pSrc, size_t srcStep, const uint32_t *pXY, const uint16_t *pWeights, uint8_t *pDst, int n)
+{
+	int i = 0;
+
+	for (; i<n; )
+	{
+		const int	nBlock = n - i >= nLanes ? nLanes : n - i;
+		v16u32		p00 = {}, p01 = {}, p10 = {}, p11 = {};
+		v16u16		weights = {};
+
+		for (int l=0; l<nBlock; l++)
+		{
+			const uint8_t	*p = SourceOf(pSrc, srcStep, pXY[i + l], 2);
+			uint16_t		q[4];
+
+			memcpy(q, p, 4);
+			memcpy(q + 2, p + srcStep, 4);
+			p00[l] = q[0];
+			p01[l] = q[1];
+			p10[l] = q[2];
+			p11[l] = q[3];
+			weights[l] = pWeights[i + l];
+		}
+
+		v16u32 weights32 = __builtin_convertvector(weights, v16u32);
+		v16u32 blend;
+		Blend(p00, p01, p10, p11, weights32, blend);
+		v16u16 out = __builtin_convertvector(blend, v16u16);
+		memcpy(pDst + 2 * i, &out, 2 * nBlock);
+		i += nBlock;
+	}
+}
+
+TARGET_CLONES
+static void RemapRowColor8(const uint8_t *pSrc, size_t srcStep, const uint32_t *pXY, const uint16_t *pWeights, uint8_t *pDst, int n)
+{
+	int i = 0;
+
+	for (; i<n; )
+	{
+		const int	nBlock = n - i >= nLanes ? nLanes : n - i;
+		v16u32		p00[3] = {}, p01[3] = {}, p10[3] = {}, p11[3] = {};
+		v16u16		weights = {};
+
+		for (int l=0; l<nBlock; l++)
+		{
+			const uint8_t *p = SourceOf(pSrc, srcStep, pXY[i + l], 3);
+
+			for (int c=0; c<3; c++)
+			{
+				p00[c][l] = p[c];
+				p01[c][l] = p[3 + c];
+				p10[c][l] = p[srcStep + c];
+				p11[c][l] = p[srcStep + 3 + c];
+			}
+			weights[l] = pWeights[i + l];
+		}
+
+		v16u32 weights32 = __builtin_convertvector(weights, v16u32);
+		for (int c=0; c<3; c++)
+		{
+			v16u32 out;
+
+			Blend(p00[c], p01[c], p10[c], p11[c], weights32, out);
+			for (int l=0; l<nBlock; l++)
+				pDst[3 * (i + l) + c] = (uint8_t)out[l];
+		}
+		i += nBlock;
+	}
+}
+
+
+// Distort a normalized, undistorted point.  Coefficients past the end of D count as 0.
+static void Distort(const std::string &stModel, const double *D, double x, double y, double &xDistorted, double &yDistorted)
+{
+	if (stModel == "equidistant")
+	{
+		double r = std::sqrt(x * x + y * y);
+		double theta = std::atan(r);
+		double theta2 = theta * theta;
+		double thetaDistorted = theta * (1 + theta2 * (D[0] + theta2 * (D[1] + theta2 * (D[2] + theta2 * D[3]))));
+		double scale = r > 1e-8 ? thetaDistorted / r : 1.0;
+
+		xDistorted = x * scale;
+		yDistorted = y * scale;
+		return;
+	}
+
+	// plumb_bob is rational_polynomial with k4..k6 = 0.
+	double r2 = x * x + y * y;
+	double radial = (1 + r2 * (D[0] + r2 * (D[1] + r2 * D[4]))) / (1 + r2 * (D[5] + r2 * (D[6] + r2 * D[7])));
+
+	xDistorted = x * radial + 2 * D[2] * x * y + D[3] * (r2 + 2 * x * x);
+	yDistorted = y * radial + D[2] * (r2 + 2 * y * y) + 2 * D[3] * x * y;
+}
+
+static bool Invert3x3(const double *m, double *mInverse)
+{
+	double det = m[0] * (m[4] * m[8] - m[5] * m[7]) - m[1] * (m[3] * m[8] - m[5] * m[6]) + m[2] * (m[3] * m[7] - m[4] * m[6]);
+
+	if (std::fabs(det) < 1e-12)
+		return false;
+	mInverse[0] = (m[4] * m[8] - m[5] * m[7]) / det;
+	mInverse[1] = (m[2] * m[7] - m[1] * m[8]) / det;
+	mInverse[2] = (m[1] * m[5] - m[2] * m[4]) / det;
+	mInverse[3] = (m[5] * m[6] - m[3] * m[8]) / det;
+	mInverse[4] = (m[0] * m[8] - m[2] * m[6]) / det;
+	mInverse[5] = (m[2] * m[3] - m[0] * m[5]) / det;
+	mInverse[6] = (m[3] * m[7] - m[4] * m[6]) / det;
+	mInverse[7] = (m[1] * m[6] - m[0] * m[7]) / det;
+	mInverse[8] = (m[0] * m[4] - m[1] * m[3]) / det;
+	return true;
+}
+
+// Split a source coordinate into the pixel to its upper left and a fraction of nOne,
+// keeping the right neighbour inside [0, size).  The edges get some slack for rounding
+// through the inverse projection, or an undistorted image would lose its last column.
+static bool Split(double s, int size, uint32_t &i, uint32_t &fraction)
+{
+	const double slack = 1e-6;
+
+	if (!(s >= -slack) || s > size - 1 + slack)
+		return false;
+	s = std::min(std::max(s, 0.0), (double)(size - 1));
+
+	double	floor = std::floor(s);
+	int		n = (int)floor;
+	int		f = (int)std::lround((s - floor) * nOne);
+
+	if (f == (int)nOne)
+	{
+		n++;
+		f = 0;
+	}
+	if (n == size - 1)
+	{
+		n--;
+		f = nOne;
+	}
+	i = (uint32_t)n;
+	fraction = (uint32_t)f;
+	return true;
+}
+
+
+RectifyMap::RectifyMap()
+	: m_width(0), m_height(0), m_nTilesX(0)
+{
+}
+
+
+void RectifyMap::Clear(void)
+{
+	m_width = m_height = m_nTilesX = 0;
+	m_xy.clear();
+	m_xy.shrink_to_fit();
+	m_weights.clear();
+	m_weights.shrink_to_fit();
+}
+
+
+// Build()
+// As initUndistortRectifyMap(): through the inverse of P * R from a rectified pixel to a
+// normalized ray, distort it, and project with K; then from calibrated pixels to the
+// window's.  Pixel centres are at +0.5, so binning scales about them.
+bool RectifyMap::Build(const Calibration &calibration, const ImageWindow &window, std::string &stError)
+{
+	double	D[8] = {0, 0, 0, 0, 0, 0, 0, 0};
+	double	PR[9];
+	double	PRInverse[9];
+
+	Clear();
+	if (calibration.stModel != "plumb_bob" && calibration.stModel != "rational_polynomial" && calibration.stModel != "equidistant")
+	{
+		stError = "unknown distortion model '" + calibration.stModel + "'";
+		return false;
+	}
+	if (window.width < 2 || window.height < 2 || window.width > 0xFFFF || window.height > 0xFFFF || window.dx < 1 || window.dy < 1)
+	{
+		stError = "cannot rectify a " + std::to_string(window.width) + "x" + std::to_string(window.height) + " image";
+		return false;
+	}
+	for (size_t i=0; i<calibration.D.size() && i<8; i++)
+		D[i] = calibration.D[i];
+	for (int r=0; r<3; r++)
+		for (int c=0; c<3; c++)
+			PR[3*r + c] = calibration.P[4*r + 0] * calibration.R[0 + c] + calibration.P[4*r + 1] * calibration.R[3 + c] + calibration.P[4*r + 2] * calibration.R[6 + c];
+	if (!Invert3x3(PR, PRInverse))
+	{
+		stError = "P * R is singular";
+		return false;
+	}
+
+	const double *K = calibration.K;
+
+	m_width = window.width;
+	m_height = window.height;
+	m_nTilesX = (m_width + nTileWidth - 1) / nTileWidth;
+
+	const size_t nEntries = (size_t)m_nTilesX * ((m_height + nTileHeight - 1) / nTileHeight) * nTileWidth * nTileHeight;
+	m_xy.assign(nEntries, 0);
+	m_weights.assign(nEntries, nInvalid);
+
+	for (int v=0; v<m_height; v++)
+	{
+		double V = window.y + (v + 0.5) * window.dy - 0.5;
+
+		for (int u=0; u<m_width; u++)
+		{
+			double U = window.x + (u + 0.5) * window.dx - 0.5;
+			double w = PRInverse[6] * U + PRInverse[7] * V + PRInverse[8];
+
+			if (w <= 0.0)
+				continue;
+
+			double x = (PRInverse[0] * U + PRInverse[1] * V + PRInverse[2]) / w;
+			double y = (PRInverse[3] * U + PRInverse[4] * V + PRInverse[5]) / w;
+			double xDistorted, yDistorted;
+
+			Distort(calibration.stModel, D, x, y, xDistorted, yDistorted);
+
+			double	xSrc = ((K[0] * xDistorted + K[1] * yDistorted + K[2]) - window.x + 0.5) / window.dx - 0.5;
+			double	ySrc = ((K[4] * yDistorted + K[5]) - window.y + 0.5) / window.dy - 0.5;
+			uint32_t	xi, yi, fx, fy;
+
+			if (!Split(xSrc, m_width, xi, fx) || !Split(ySrc, m_height, yi, fy))
+				continue;
+
+			size_t i = Entry(u, v);
+			m_xy[i] = xi | yi << 16;
+			m_weights[i] = (uint16_t)(fx | fy << 8);
+		}
+	}
+	return true;
+} // Build()
+
+
+// Remap()
+// Tile by tile along each band of nTileHeight rows, so the map entries are read in the
+// order they are stored and a tile's source pixels are reused while still in cache.
+void RectifyMap::Remap(RectifySource source, const uint8_t *pSrc, size_t srcStep, uint8_t *pDst, size_t dstStep, int yBegin, int yEnd) const
+{
+	const int nbytesPixel = source == RECTIFY_MONO16 ? 2 : (source == RECTIFY_COLOR8 ? 3 : 1);
+
+	if (yEnd > m_height)
+		yEnd = m_height;
+	for (int yBand=yBegin - yBegin % nTileHeight; yBand<yEnd; yBand+=nTileHeight)
+	{
+		const int yFirst = yBand > yBegin ? yBand : yBegin;
+		const int yLast = yBand + nTileHeight < yEnd ? yBand + nTileHeight : yEnd;
+
+		for (int x=0; x<m_width; x+=nTileWidth)
+		{
+			const int n = m_width - x < nTileWidth ? m_width - x : nTileWidth;
+
+			for (int y=yFirst; y<yLast; y++)
+			{
+				const size_t	i = Entry(x, y);
+				uint8_t			*pOut = pDst + y * dstStep + x * nbytesPixel;
+
+				switch (source)
+				{
+				case RECTIFY_MONO8:
+					RemapRowMono8(pSrc, srcStep, &m_xy[i], &m_weights[i], pOut, n);
+					break;
+				case RECTIFY_MONO16:
+					RemapRowMono16(pSrc, srcStep, &m_xy[i], &m_weights[i], pOut, n);
+					break;
+				case RECTIFY_COLOR8:
+					RemapRowColor8(pSrc, srcStep, &m_xy[i], &m_weights[i], pOut, n);
+					break;
+				default:
+					return;
+				}
+			}
+		}
+	}
+} // Remap()
+
+
+void RectifyMap::RemapReference(RectifySource source, const uint8_t *pSrc, size_t srcStep, uint8_t *pDst, size_t dstStep, int yBegin, int yEnd) const
+{
+	const int nChannels = source == RECTIFY_COLOR8 ? 3 : 1;
+
+	if (source == RECTIFY_NONE)
+		return;
+	for (int y=yBegin; y<yEnd && y<m_height; y++)
+	{
+		for (int x=0; x<m_width; x++)
+		{
+			const size_t	i = Entry(x, y);
+			const uint32_t	xSrc = m_xy[i] & 0xFFFF;
+			const uint32_t	ySrc = m_xy[i] >> 16;
+
+			for (int c=0; c<nChannels; c++)
+			{
+				if (source == RECTIFY_MONO16)
+				{
+					uint16_t q[4];
+
+					memcpy(q, pSrc + ySrc * srcStep + 2 * xSrc, 4);
+					memcpy(q + 2, pSrc + (ySrc + 1) * srcStep + 2 * xSrc, 4);
+					uint16_t out = (uint16_t)BlendOne(q[0], q[1], q[2], q[3], m_weights[i]);
+					memcpy(pDst + y * dstStep + 2 * x, &out, 2);
+				}
+				else
+				{
+					const uint8_t *p = pSrc + ySrc * srcStep + nChannels * xSrc + c;
+
+					pDst[y * dstStep + nChannels * x + c] = (uint8_t)BlendOne(p[0], p[nChannels], p[srcStep], p[srcStep + nChannels], m_weights[i]);
+				}
+			}
+		}
+	}
+} // RemapReference()
+
+} // namespace camera_aravis
@@ -0,0 +1,290 @@
+// Copyright 2016 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "camera_aravis/shm_ring.h"
+#include "camera_aravis/util.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <ctime>
+
+namespace camera_aravis
+{
+
+// shm_open() wants exactly one leading slash.
+static std::string ShmPath (const std::string &stName)
+{
+	return stName.empty() || stName[0] != '/' ? "/" + stName : stName;
+}
+
+
+ShmRingWriter::ShmRingWriter()
+	: m_pBase(NULL),
+	  m_nbytesMapped(0),
+	  m_pHeader(NULL)
+{
+}
+
+ShmRingWriter::~ShmRingWriter()
+{
+	Destroy();
+}
+
+// Create()
+// Map a fresh object under the name.  The old one, if any, lives on while readers map it.
+bool ShmRingWriter::Create(const std::string &stName, size_t nbytesSlot, unsigned nSlots, std::string &stError)
+{
+	const size_t	nbytesPage = (size_t)sysconf(_SC_PAGESIZE);
+	const size_t	nbytesStride = (sizeof(ShmSlotHeader) + nbytesSlot + nbytesPage - 1) / nbytesPage * nbytesPage;
+	const size_t	nbytes = nbytesShmRingHeader + nbytesStride * nSlots;
+	std::string		stPath = ShmPath(stName);
+
+	Destroy();
+	if (nSlots == 0)
+	{
+		stError = "no slots";
+		return false;
+	}
+
+	shm_unlink(stPath.c_str());
+	int fd = shm_open(stPath.c_str(), O_RDWR | O_CREAT | O_EXCL, 0644);
+	if (fd < 0)
+	{
+		stError = "shm_open " + stPath + ": " + strerror(errno);
+		return false;
+	}
+	if (ftruncate(fd, (off_t)nbytes) != 0)
+	{
+		stError = "ftruncate " + stPath + ": " + strerror(errno) + " (is /dev/shm big enough?)";
+		close(fd);
+		shm_unlink(stPath.c_str());
+		return false;
+	}
+
+	// Populated up front, so the first frames do not pay the page faults.
+	void *p = mmap(NULL, nbytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, 0);
+	close(fd);
+	if (p == MAP_FAILED)
+	{
+		stError = "mmap " + stPath + ": " + strerror(errno);
+		shm_unlink(stPath.c_str());
+		return false;
+	}
+
+	m_stName = stPath;
+	m_pBase = (uint8_t *)p;
+	m_nbytesMapped = nbytes;
+	m_pHeader = (ShmRingHeader *)p;
+
+	struct timespec	ts;
+	clock_gettime(CLOCK_REALTIME, &ts);
+	m_pHeader->version = nShmRingVersion;
+	m_pHeader->nSlots = nSlots;
+	m_pHeader->nbytesSlot = nbytesSlot;
+	m_pHeader->nbytesStride = nbytesStride;
+	m_pHeader->generation = (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+	m_pHeader->sequence.store(0, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+	memcpy(m_pHeader->magic, szShmRingMagic, sizeof(szShmRingMagic));
+
+	return true;
+} // Create()
+
+void ShmRingWriter::Destroy(void)
+{
+	if (!m_pBase)
+		return;
+	munmap(m_pBase, m_nbytesMapped);
+	shm_unlink(m_stName.c_str());
+	m_pBase = NULL;
+	m_pHeader = NULL;
+	m_nbytesMapped = 0;
+}
+
+// Write()
+// The slot is locked (odd) before the first byte changes and unlocked (even) after the last.
+uint64_t ShmRingWriter::Write(const void *pData, size_t nbytes, const ShmFrameInfo &info, uint32_t &iSlot)
+{
+	if (!m_pHeader || nbytes > m_pHeader->nbytesSlot)
+		return 0;
+
+	uint64_t		sequence = m_pHeader->sequence.load(std::memory_order_relaxed) + 1;
+	iSlot = (uint32_t)(sequence % m_pHeader->nSlots);
+	ShmSlotHeader	*pSlot = (ShmSlotHeader *)(m_pBase + nbytesShmRingHeader + iSlot * m_pHeader->nbytesStride);
+
+	pSlot->lock.store(2*sequence - 1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+
+	pSlot->nsStamp = info.nsStamp;
+	pSlot->width = info.width;
+	pSlot->height = info.height;
+	pSlot->step = info.step;
+	pSlot->nbytes = (uint32_t)nbytes;
+	strncpy(pSlot->szEncoding, info.szEncoding, sizeof(pSlot->szEncoding) - 1);
+	pSlot->szEncoding[sizeof(pSlot->szEncoding) - 1] = '\0';
+	memcpy((uint8_t *)(pSlot + 1), pData, nbytes);
+	pSlot->nsWritten = NowNs();
+
+	pSlot->lock.store(2*sequence, std::memory_order_release);
+	m_pHeader->sequence.store(sequence, std::memory_order_release);
+
+	return sequence;
+} // Write()
+
+
+ShmRingReader::ShmRingReader()
+	: nRead(0),
+	  nOverwritten(0),
+	  nTorn(0),
+	  nReopened(0),
+	  m_pBase(NULL),
+	  m_nbytesMapped(0),
+	  m_pHeader(NULL)
+{
+}
+
+ShmRingReader::~ShmRingReader()
+{
+	Close();
+}
+
+bool ShmRingReader::Open(const std::string &stName, std::string &stError)
+{
+	std::string	stPath = ShmPath(stName);
+	struct stat	st;
+
+	Close();
+	int fd = shm_open(stPath.c_str(), O_RDONLY, 0);
+	if (fd < 0)
+	{
+		stError = "shm_open " + stPath + ": " + strerror(errno);
+		return false;
+	}
+	if (fstat(fd, &st) != 0 || (size_t)st.st_size < nbytesShmRingHeader)
+	{
+		stError = stPath + ": not a frame ring";
+		close(fd);
+		return false;
+	}
+	void *p = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (p == MAP_FAILED)
+	{
+		stError = "mmap " + stPath + ": " + strerror(errno);
+		return false;
+	}
+
+	const ShmRingHeader	*pHeader = (const ShmRingHeader *)p;
+	if (memcmp(pHeader->magic, szShmRingMagic, sizeof(szShmRingMagic)) != 0 || pHeader->version != nShmRingVersion ||
+		nbytesShmRingHeader + pHeader->nbytesStride * pHeader->nSlots > (size_t)st.st_size)
+	{
+		stError = stPath + ": not a frame ring of version " + std::to_string(nShmRingVersion);
+		munmap(p, (size_t)st.st_size);
+		return false;
+	}
+	std::atomic_thread_fence(std::memory_order_acquire);
+
+	m_stName = stPath;
+	m_pBase = (const uint8_t *)p;
+	m_nbytesMapped = (size_t)st.st_size;
+	m_pHeader = pHeader;
+	return true;
+} // Open()
+
+void ShmRingReader::Close(void)
+{
+	if (!m_pBase)
+		return;
+	munmap((void *)m_pBase, m_nbytesMapped);
+	m_pBase = NULL;
+	m_pHeader = NULL;
+	m_nbytesMapped = 0;
+}
+
+const ShmSlotHeader *ShmRingReader::Slot(uint32_t iSlot) const
+{
+	return (const ShmSlotHeader *)(m_pBase + nbytesShmRingHeader + iSlot * m_pHeader->nbytesStride);
+}
+
+// Read()
+// The slot header is read between two looks at the lock, like the pixels later on.
+bool ShmRingReader::Read(uint32_t iSlot, uint64_t sequence, uint64_t generation, View &view)
+{
+	if (m_pHeader && m_pHeader->generation != generation)
+	{
+		// The writer made a new ring: a restart, or frames that outgrew the slots.
+		std::string	stName = m_stName;
+		std::string	stError;
+		if (!Open(stName, stError))
+			return false;
+		nReopened++;
+	}
+	if (!m_pHeader || m_pHeader->generation != generation || iSlot >= m_pHeader->nSlots)
+		return false;
+
+	const ShmSlotHeader	*pSlot = Slot(iSlot);
+	if (pSlot->lock.load(std::memory_order_acquire) != 2*sequence)
+	{
+		nOverwritten++;
+		return false;
+	}
+
+	view.pData = (const uint8_t *)(pSlot + 1);
+	view.nbytes = pSlot->nbytes;
+	view.width = pSlot->width;
+	view.height = pSlot->height;
+	view.step = pSlot->step;
+	view.stEncoding.assign(pSlot->szEncoding, strnlen(pSlot->szEncoding, sizeof(pSlot->szEncoding)));
+	view.nsStamp = pSlot->nsStamp;
+	view.nsWritten = pSlot->nsWritten;
+	view.sequence = sequence;
+	view.pSlot = pSlot;
+
+	std::atomic_thread_fence(std::memory_order_acquire);
+	if (pSlot->lock.load(std::memory_order_relaxed) != 2*sequence || view.nbytes > m_pHeader->nbytesSlot)
+	{
+		nOverwritten++;
+		return false;
+	}
+	nRead++;
+	return true;
+} // Read()
+
+bool ShmRingReader::Valid(const View &view)
+{
+	std::atomic_thread_fence(std::memory_order_acquire);
+	if (view.pSlot->lock.load(std::memory_order_relaxed) == 2*view.sequence)
+		return true;
+	nTorn++;
+	return false;
+}
+
+bool ShmRingReader::Copy(uint32_t iSlot, uint64_t sequence, uint64_t generation, std::vector<uint8_t> &data, View &view)
+{
+	if (!Read(iSlot, sequence, generation, view))
+		return false;
+	data.assign(view.pData, view.pData + view.nbytes);
+	if (!Valid(view))
+		return false;
+	view.pData = data.data();
+	return true;
+}
+
+} // namespace camera_aravis
@@ -0,0 +1,142 @@
+// Copyright 2016 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "camera_aravis/stripe_pool.h"
+
+#include <algorithm>
+
+namespace camera_aravis
+{
+
+StripePool::StripePool(int nThreads)
+	: m_pFn(NULL),
+	  m_height(0),
+	  m_nAlign(1),
+	  m_iGeneration(0),
+	  m_nPending(0),
+	  m_bStop(false)
+{
+	Start(nThreads);
+}
+
+StripePool::~StripePool()
+{
+	Stop();
+}
+
+// Start()
+// The workers start from the generation of the last Run(), so that a pool restarted after
+// running waits for the next one instead of running a stale stripe function.
+void StripePool::Start(int nThreads)
+{
+	unsigned iGeneration;
+
+	Stop();
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_bStop = false;
+		iGeneration = m_iGeneration;
+	}
+	for (int i=1; i<nThreads; i++)
+		m_threads.emplace_back(&StripePool::Worker, this, i, nThreads, iGeneration);
+}
+
+void StripePool::Stop(void)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_bStop = true;
+	}
+	m_cvStart.notify_all();
+	for (auto &thread : m_threads)
+		thread.join();
+	m_threads.clear();
+}
+
+// Stripe()
+// Rows of stripe i of n, aligned to nAlign.
+static void Stripe(int i, int n, int height, int nAlign, int &yBegin, int &yEnd)
+{
+	int nRowsAligned = (height + nAlign - 1) / nAlign;
+
+	yBegin = std::min(height, (int)((long)nRowsAligned * i / n) * nAlign);
+	yEnd = std::min(height, (int)((long)nRowsAligned * (i + 1) / n) * nAlign);
+}
+
+void StripePool::Run(int height, const StripeFn &fn, int nAlign)
+{
+	int		n = nThreads();
+	int		yBegin;
+	int		yEnd;
+
+	if (n > 1)
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_pFn = &fn;
+		m_height = height;
+		m_nAlign = nAlign;
+		m_nPending = n - 1;
+		m_iGeneration++;
+	}
+	m_cvStart.notify_all();
+
+	// The caller takes stripe 0.
+	Stripe(0, n, height, nAlign, yBegin, yEnd);
+	if (yEnd > yBegin)
+		fn(yBegin, yEnd);
+
+	if (n > 1)
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		m_cvDone.wait(lock, [this] { return m_nPending == 0; });
+		m_pFn = NULL;
+	}
+} // Run()
+
+void StripePool::Worker(int iWorker, int nStripes, unsigned iGenerationSeen)
+{
+
+	for (;;)
+	{
+		const StripeFn	*pFn;
+		int				 height;
+		int				 nAlign;
+		int				 yBegin;
+		int				 yEnd;
+
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_cvStart.wait(lock, [&] { return m_bStop || m_iGeneration != iGenerationSeen; });
+			if (m_bStop)
+				return;
+			iGenerationSeen = m_iGeneration;
+			pFn = m_pFn;
+			height = m_height;
+			nAlign = m_nAlign;
+		}
+
+		Stripe(iWorker, nStripes, height, nAlign, yBegin, yEnd);
+		if (yEnd > yBegin)
+			(*pFn)(yBegin, yEnd);
+
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			if (--m_nPending == 0)
+				m_cvDone.notify_one();
+		}
+	}
+} // Worker()
+
+} // namespace camera_aravis
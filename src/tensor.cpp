@@ -0,0 +1,465 @@
+// Copyright 2016 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+
+#include "camera_aravis/tensor.h"
+#include "camera_aravis/simd.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace camera_aravis
+{
+
+static const int nLanes = 8;
+
+
+TensorInput TensorInputFor(const std::string &stEncoding, int nBits)
+{
+	TensorInput input = {TENSOR_NONE, 1, 8, false, BAYER_RG};
+
+	if (stEncoding == "mono8")
+		input.source = TENSOR_MONO;
+	else if (stEncoding == "mono16")
+	{
+		input.source = TENSOR_MONO;
+		input.nbytesSample = 2;
+	}
+	else if (stEncoding == "rgb8" || stEncoding == "bgr8")
+	{
+		input.source = TENSOR_COLOR;
+		input.bBgr = stEncoding == "bgr8";
+	}
+	else if (stEncoding.size() >= 11 && stEncoding.compare(0, 6, "bayer_") == 0)
+	{
+		std::string stPattern = stEncoding.substr(6, 4);
+
+		input.source = TENSOR_BAYER;
+		input.pattern = stPattern == "bggr" ? BAYER_BG : (stPattern == "grbg" ? BAYER_GR : (stPattern == "gbrg" ? BAYER_GB : BAYER_RG));
+		input.nbytesSample = stEncoding.compare(10, std::string::npos, "16") == 0 ? 2 : 1;
+		if (stPattern != "rggb" && stPattern != "bggr" && stPattern != "grbg" && stPattern != "gbrg")
+			input.source = TENSOR_NONE;
+	}
+	if (input.nbytesSample == 2)
+		input.nBits = nBits > 8 && nBits <= 16 ? nBits : 16;
+	return input;
+}
+
+
+// Rows of samples to floats, blended: pA + (pB - pA) * w.  Bytes are widened to 16 bits
+// and then to 32 before they become floats; compilers convert narrower vectors to
+// floats lane by lane.
+static inline void Blend16(const v8u16 &a, const v8u16 &b, const v8f32 &w, v8f32 &out)
+{
+	v8f32 fa = __builtin_convertvector(__builtin_convertvector(a, v8i32), v8f32);
+	v8f32 fb = __builtin_convertvector(__builtin_convertvector(b, v8i32), v8f32);
+
+	out = fa + (fb - fa) * w;
+}
+
+TARGET_CLONES
+static void BlendRows8(const uint8_t *pA, const uint8_t *pB, float w, float *pOut, int n)
+{
+	const v8f32	vZero = {};
+	const v8f32	vw = vZero + w;
+	int			x = 0;
+
+	for (; x + 2 * nLanes <= n; x += 2 * nLanes)
+	{
+		v16u8 a8, b8;
+
+		memcpy(&a8, pA + x, sizeof(a8));
+		memcpy(&b8, pB + x, sizeof(b8));
+		v16u16 a = __builtin_convertvector(a8, v16u16);
+		v16u16 b = __builtin_convertvector(b8, v16u16);
+		v8f32 lo, hi;
+		Blend16(__builtin_shufflevector(a, a, 0, 1, 2, 3, 4, 5, 6, 7), __builtin_shufflevector(b, b, 0, 1, 2, 3, 4, 5, 6, 7), vw, lo);
+		Blend16(__builtin_shufflevector(a, a, 8, 9, 10, 11, 12, 13, 14, 15), __builtin_shufflevector(b, b, 8, 9, 10, 11, 12, 13, 14, 15), vw, hi);
+		memcpy(pOut + x, &lo, sizeof(lo));
+		memcpy(pOut + x + nLanes, &hi, sizeof(hi));
+	}
+	for (; x<n; x++)
+		pOut[x] = pA[x] + ((float)pB[x] - pA[x]) * w;
+}
+
+TARGET_CLONES
+static void BlendRows16(const uint8_t *pA, const uint8_t *pB, float w, float *pOut, int n)
+{
+	const v8f32	vZero = {};
+	const v8f32	vw = vZero + w;
+	int			x = 0;
+
+	for (; x + nLanes <= n; x += nLanes)
+	{
+		v8u16 a, b;
+
+		memcpy(&a, pA + 2 * x, sizeof(a));
+		memcpy(&b, pB + 2 * x, sizeof(b));
+		v8f32 out;
+		Blend16(a, b, vw, out);
+		memcpy(pOut + x, &out, sizeof(out));
+	}
+	for (; x<n; x++)
+	{
+		uint16_t a, b;
+
+		memcpy(&a, pA + 2 * x, 2);
+		memcpy(&b, pB + 2 * x, 2);
+		pOut[x] = a + ((float)b - a) * w;
+	}
+}
+
+// rgb or bgr samples to r, g and b planes of n pixels, 8 pixels from three vectors.
+TARGET_CLONES
+static void SplitColor(const float *pRow, bool bBgr, int n, float *pR, float *pG, float *pB)
+{
+	int x = 0;
+
+	if (bBgr)
+		std::swap(pR, pB);
+	for (; x + nLanes <= n; x += nLanes)
+	{
+		v8f32 a, b, c;
+
+		memcpy(&a, pRow + 3 * x, sizeof(a));
+		memcpy(&b, pRow + 3 * x + nLanes, sizeof(b));
+		memcpy(&c, pRow + 3 * x + 2 * nLanes, sizeof(c));
+		v8f32 r = __builtin_shufflevector(a, b, 0, 3, 6, 9, 12, 15, 0, 0);
+		v8f32 g = __builtin_shufflevector(a, b, 1, 4, 7, 10, 13, 0, 0, 0);
+		v8f32 bl = __builtin_shufflevector(a, b, 2, 5, 8, 11, 14, 0, 0, 0);
+		r = __builtin_shufflevector(r, c, 0, 1, 2, 3, 4, 5, 10, 13);
+		g = __builtin_shufflevector(g, c, 0, 1, 2, 3, 4, 8, 11, 14);
+		bl = __builtin_shufflevector(bl, c, 0, 1, 2, 3, 4, 9, 12, 15);
+		memcpy(pR + x, &r, sizeof(r));
+		memcpy(pG + x, &g, sizeof(g));
+		memcpy(pB + x, &bl, sizeof(bl));
+	}
+	for (; x<n; x++)
+	{
+		pR[x] = pRow[3 * x];
+		pG[x] = pRow[3 * x + 1];
+		pB[x] = pRow[3 * x + 2];
+	}
+}
+
+// The even and odd rows of Bayer quads to r, g and b planes of n quads: r and b as they
+// are, g the mean of the two greens.
+TARGET_CLONES
+static void SplitBayer(const float *pEven, const float *pOdd, BayerPattern pattern, int n, float *pR, float *pG, float *pB)
+{
+	const bool	bRedEvenRow = pattern == BAYER_RG || pattern == BAYER_GR;
+	const int	xRed = pattern == BAYER_RG || pattern == BAYER_GB ? 0 : 1;
+	const float	*pRowR = bRedEvenRow ? pEven : pOdd;
+	const float	*pRowB = bRedEvenRow ? pOdd : pEven;
+	int			x = 0;
+
+	for (; x + nLanes <= n; x += nLanes)
+	{
+		v8f32 r0, r1, b0, b1;
+
+		memcpy(&r0, pRowR + 2 * x, sizeof(r0));
+		memcpy(&r1, pRowR + 2 * x + nLanes, sizeof(r1));
+		memcpy(&b0, pRowB + 2 * x, sizeof(b0));
+		memcpy(&b1, pRowB + 2 * x + nLanes, sizeof(b1));
+		v8f32 evenR = __builtin_shufflevector(r0, r1, 0, 2, 4, 6, 8, 10, 12, 14);
+		v8f32 oddR = __builtin_shufflevector(r0, r1, 1, 3, 5, 7, 9, 11, 13, 15);
+		v8f32 evenB = __builtin_shufflevector(b0, b1, 0, 2, 4, 6, 8, 10, 12, 14);
+		v8f32 oddB = __builtin_shufflevector(b0, b1, 1, 3, 5, 7, 9, 11, 13, 15);
+		v8f32 r = xRed ? oddR : evenR;
+		v8f32 b = xRed ? evenB : oddB;
+		v8f32 g = 0.5f * ((xRed ? evenR : oddR) + (xRed ? oddB : evenB));
+		memcpy(pR + x, &r, sizeof(r));
+		memcpy(pG + x, &g, sizeof(g));
+		memcpy(pB + x, &b, sizeof(b));
+	}
+	for (; x<n; x++)
+	{
+		pR[x] = pRowR[2 * x + xRed];
+		pB[x] = pRowB[2 * x + 1 - xRed];
+		pG[x] = 0.5f * (pRowR[2 * x + 1 - xRed] + pRowB[2 * x + xRed]);
+	}
+}
+
+TARGET_CLONES
+static void Luma(const float *pR, const float *pG, const float *pB, int n, float *pOut)
+{
+	for (int x=0; x<n; x++)
+		pOut[x] = 0.299f * pR[x] + 0.587f * pG[x] + 0.114f * pB[x];
+}
+
+// One output row of a plane: interpolated between the columns each output column lies
+// between, then scaled and offset, 8 columns at a time.  The loads are gathers.
+TARGET_CLONES
+static void InterpolateRow(const float *pPlane, const int32_t *pX0, const int32_t *pX1, const float *pW, int n,
+	float scale, float bias, float *pOut)
+{
+	int x = 0;
+
+	for (; x + nLanes <= n; x += nLanes)
+	{
+		v8f32 a, b, w;
+
+		for (int l=0; l<nLanes; l++)
+		{
+			a[l] = pPlane[pX0[x + l]];
+			b[l] = pPlane[pX1[x + l]];
+		}
+		memcpy(&w, pW + x, sizeof(w));
+		v8f32 out = (a + (b - a) * w) * scale + bias;
+		memcpy(pOut + x, &out, sizeof(out));
+	}
+	for (; x<n; x++)
+	{
+		float a = pPlane[pX0[x]];
+		float b = pPlane[pX1[x]];
+
+		pOut[x] = (a + (b - a) * pW[x]) * scale + bias;
+	}
+}
+
+// Round to nearest even: normal numbers by adding half an ulp of the result, less one if
+// it is even, before truncating; subnormals by letting a float addition align them.
+// Anything too large is infinity.
+static const uint32_t	bitsF16Max = (127 + 16) << 23;
+static const uint32_t	bitsF16MinNormal = 113 << 23;
+static const uint32_t	bitsDenormMagic = ((127 - 15) + (23 - 10) + 1) << 23;
+
+uint16_t FloatToHalf(float f)
+{
+	uint32_t	u;
+	uint16_t	h;
+
+	memcpy(&u, &f, 4);
+	uint32_t sign = u & 0x80000000u;
+	u ^= sign;
+	if (u >= bitsF16Max)
+		h = u > (255u << 23) ? 0x7E00 : 0x7C00;
+	else if (u < bitsF16MinNormal)
+	{
+		float magic, a;
+
+		memcpy(&magic, &bitsDenormMagic, 4);
+		memcpy(&a, &u, 4);
+		a += magic;
+		memcpy(&u, &a, 4);
+		h = (uint16_t)(u - bitsDenormMagic);
+	}
+	else
+		h = (uint16_t)((u + ((uint32_t)(15 - 127) << 23) + 0xFFF + ((u >> 13) & 1)) >> 13);
+	return (uint16_t)(h | (sign >> 16));
+}
+
+TARGET_CLONES
+static void HalfRow(const float *pIn, uint8_t *pOut, int n)
+{
+	v8f32		magic;
+	const v8u32	vZero = {};
+	const v8u32	bitsMagic = vZero + bitsDenormMagic;
+	const v8u32	bitsNan = vZero + 0x7E00;
+	const v8u32	bitsInf = vZero + 0x7C00;
+	int			x = 0;
+
+	memcpy(&magic, &bitsMagic, sizeof(magic));
+	for (; x + nLanes <= n; x += nLanes)
+	{
+		v8u32	u;
+		v8f32	f;
+
+		memcpy(&u, pIn + x, sizeof(u));
+		v8u32 sign = u & 0x80000000u;
+		u ^= sign;
+
+		memcpy(&f, &u, sizeof(f));
+		f += magic;
+		v8u32 denormal;
+		memcpy(&denormal, &f, sizeof(denormal));
+		denormal -= bitsMagic;
+		v8u32 normal = (u + ((uint32_t)(15 - 127) << 23) + 0xFFF + ((u >> 13) & 1)) >> 13;
+		v8u32 special = u > (255u << 23) ? bitsNan : bitsInf;
+
+		v8u32 h = u >= bitsF16Max ? special : (u < bitsF16MinNormal ? denormal : normal);
+		h |= sign >> 16;
+		v8u16 out = __builtin_convertvector(h, v8u16);
+		memcpy(pOut + 2 * x, &out, sizeof(out));
+	}
+	for (; x<n; x++)
+	{
+		uint16_t h = FloatToHalf(pIn[x]);
+		memcpy(pOut + 2 * x, &h, 2);
+	}
+}
+
+
+TensorConverter::TensorConverter()
+	: m_input(),
+	  m_spec(),
+	  m_widthSrc(0),
+	  m_heightSrc(0),
+	  m_width(0),
+	  m_height(0),
+	  m_nChannels(0),
+	  m_nUnits(0),
+	  m_xOffset(0),
+	  m_scale(),
+	  m_bias()
+{
+}
+
+static bool IsSameInput(const TensorInput &a, const TensorInput &b)
+{
+	return a.source == b.source && a.nbytesSample == b.nbytesSample && a.nBits == b.nBits && a.bBgr == b.bBgr && a.pattern == b.pattern;
+}
+
+static bool IsSameSpec(const TensorSpec &a, const TensorSpec &b)
+{
+	return a.width == b.width && a.height == b.height && a.xCrop == b.xCrop && a.yCrop == b.yCrop &&
+		a.widthCrop == b.widthCrop && a.heightCrop == b.heightCrop && a.nChannels == b.nChannels &&
+		a.bBgr == b.bBgr && a.bHalf == b.bHalf && !memcmp(a.mean, b.mean, sizeof(a.mean)) && !memcmp(a.std, b.std, sizeof(a.std));
+}
+
+// Where each of n outputs comes from among nIn inputs, pixel centres aligned.
+static void ResizeTable(int nIn, int n, std::vector<int32_t> &i0, std::vector<int32_t> &i1, std::vector<float> &w)
+{
+	const double scale = (double)nIn / n;
+
+	i0.resize(n);
+	i1.resize(n);
+	w.resize(n);
+	for (int i=0; i<n; i++)
+	{
+		double	s = std::max((i + 0.5) * scale - 0.5, 0.0);
+		int		iIn = std::min((int)s, nIn - 1);
+
+		i0[i] = iIn;
+		i1[i] = std::min(iIn + 1, nIn - 1);
+		w[i] = iIn < nIn - 1 ? (float)(s - iIn) : 0.0f;
+	}
+}
+
+
+// Configure()
+bool TensorConverter::Configure(const TensorInput &input, int width, int height, const TensorSpec &spec, std::string &stError)
+{
+	if (m_nUnits > 0 && width == m_widthSrc && height == m_heightSrc && IsSameInput(input, m_input) && IsSameSpec(spec, m_spec))
+		return true;
+
+	const bool	bBayer = input.source == TENSOR_BAYER;
+	const int	nQuad = bBayer ? 2 : 1;
+	int			xCrop = spec.xCrop / nQuad * nQuad;	// A Bayer crop keeps the pattern.
+	int			yCrop = spec.yCrop / nQuad * nQuad;
+	int			widthCrop = (spec.widthCrop > 0 ? spec.widthCrop : width - xCrop) / nQuad * nQuad;
+	int			heightCrop = (spec.heightCrop > 0 ? spec.heightCrop : height - yCrop) / nQuad * nQuad;
+
+	m_nUnits = 0;
+	if (input.source == TENSOR_NONE)
+	{
+		stError = "no tensor for this pixel format";
+		return false;
+	}
+	if (xCrop < 0 || yCrop < 0 || widthCrop <= 0 || heightCrop <= 0 || xCrop + widthCrop > width || yCrop + heightCrop > height)
+	{
+		char sz[128];
+		snprintf(sz, sizeof(sz), "crop %d,%d %dx%d is not within the %dx%d image", xCrop, yCrop, widthCrop, heightCrop, width, height);
+		stError = sz;
+		return false;
+	}
+
+	m_input = input;
+	m_spec = spec;
+	m_widthSrc = width;
+	m_heightSrc = height;
+	m_nUnits = widthCrop / nQuad;
+	m_width = spec.width > 0 ? spec.width : m_nUnits;
+	m_height = spec.height > 0 ? spec.height : heightCrop / nQuad;
+	m_nChannels = spec.nChannels == 1 || spec.nChannels == 3 ? spec.nChannels : (input.source == TENSOR_MONO ? 1 : 3);
+	m_xOffset = (size_t)xCrop * (input.source == TENSOR_COLOR ? 3 : 1) * input.nbytesSample;
+	ResizeTable(m_nUnits, m_width, m_x0, m_x1, m_wx);
+	ResizeTable(heightCrop / nQuad, m_height, m_y0, m_y1, m_wy);
+	for (int32_t &y : m_y0)
+		y = yCrop + y * nQuad;
+	for (int32_t &y : m_y1)
+		y = yCrop + y * nQuad;
+
+	const float sampleMax = input.nbytesSample == 1 ? 255.0f : (float)((1u << input.nBits) - 1);
+	for (int c=0; c<3; c++)
+	{
+		float std = spec.std[c] != 0.0f ? spec.std[c] : 1.0f;
+
+		m_scale[c] = 1.0f / (sampleMax * std);
+		m_bias[c] = -spec.mean[c] / std;
+	}
+	return true;
+} // Configure()
+
+
+// ConvertRows()
+void TensorConverter::ConvertRows(const uint8_t *pSrc, size_t step, uint8_t *pDst, int yBegin, int yEnd) const
+{
+	thread_local std::vector<float>	scratch;
+	const bool		bBayer = m_input.source == TENSOR_BAYER;
+	const bool		bColor = m_input.source != TENSOR_MONO;
+	const int		nSamples = m_nUnits * (bBayer ? 2 : (bColor ? 3 : 1));
+	const size_t	nbytesElement = m_spec.bHalf ? 2 : 4;
+	const size_t	nbytesPlane = (size_t)m_width * m_height * nbytesElement;
+
+	scratch.resize(2 * (size_t)nSamples + 4 * (size_t)m_nUnits + m_width);
+	float *pEven = scratch.data();
+	float *pOdd = pEven + nSamples;
+	float *pPlanes[4] = {pOdd + nSamples, pOdd + nSamples + m_nUnits, pOdd + nSamples + 2 * m_nUnits, pOdd + nSamples + 3 * m_nUnits};
+	float *pHalf = pPlanes[3] + m_nUnits;
+
+	for (int y=yBegin; y<yEnd; y++)
+	{
+		const uint8_t	*pA = pSrc + (size_t)m_y0[y] * step + m_xOffset;
+		const uint8_t	*pB = pSrc + (size_t)m_y1[y] * step + m_xOffset;
+		const float		wy = m_wy[y];
+
+		// The source rows, blended and split into planes: r, g, b and luma, or just mono.
+		float *pBlend = bColor ? pEven : pPlanes[0];
+		if (m_input.nbytesSample == 2)
+			BlendRows16(pA, pB, wy, pBlend, nSamples);
+		else
+			BlendRows8(pA, pB, wy, pBlend, nSamples);
+		if (bBayer)
+		{
+			if (m_input.nbytesSample == 2)
+				BlendRows16(pA + step, pB + step, wy, pOdd, nSamples);
+			else
+				BlendRows8(pA + step, pB + step, wy, pOdd, nSamples);
+			SplitBayer(pEven, pOdd, m_input.pattern, m_nUnits, pPlanes[0], pPlanes[1], pPlanes[2]);
+		}
+		else if (bColor)
+			SplitColor(pEven, m_input.bBgr, m_nUnits, pPlanes[0], pPlanes[1], pPlanes[2]);
+		if (bColor && m_nChannels == 1)
+			Luma(pPlanes[0], pPlanes[1], pPlanes[2], m_nUnits, pPlanes[3]);
+
+		for (int c=0; c<m_nChannels; c++)
+		{
+			const float	*pPlane = !bColor ? pPlanes[0] : (m_nChannels == 1 ? pPlanes[3] : pPlanes[m_spec.bBgr ? 2 - c : c]);
+			uint8_t		*pOut = pDst + c * nbytesPlane + (size_t)y * m_width * nbytesElement;
+
+			if (m_spec.bHalf)
+			{
+				InterpolateRow(pPlane, m_x0.data(), m_x1.data(), m_wx.data(), m_width, m_scale[c], m_bias[c], pHalf);
+				HalfRow(pHalf, pOut, m_width);
+			}
+			else
+				InterpolateRow(pPlane, m_x0.data(), m_x1.data(), m_wx.data(), m_width, m_scale[c], m_bias[c], (float *)pOut);
+		}
+	}
+} // ConvertRows()
+
+} // namespace camera_aravis
@@ -0,0 +1,262 @@
+// Copyright 2016 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "camera_aravis/thread_placement.h"
+
+#include <dirent.h>
+#include <linux/mempolicy.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+
+namespace camera_aravis
+{
+
+namespace
+{
+
+// A thread to place: a pthread of ours, or a kernel thread id.
+struct Target
+{
+	bool		bPthread;
+	pthread_t	thread;
+	pid_t		tid;
+};
+
+int SetAffinity(const Target &target, const cpu_set_t &cpuset)
+{
+	if (target.bPthread)
+		return pthread_setaffinity_np(target.thread, sizeof(cpuset), &cpuset);
+	return sched_setaffinity(target.tid, sizeof(cpuset), &cpuset) == 0 ? 0 : errno;
+}
+
+int GetAffinity(const Target &target, cpu_set_t &cpuset)
+{
+	CPU_ZERO(&cpuset);
+	if (target.bPthread)
+		return pthread_getaffinity_np(target.thread, sizeof(cpuset), &cpuset);
+	return sched_getaffinity(target.tid, sizeof(cpuset), &cpuset) == 0 ? 0 : errno;
+}
+
+int SetFifo(const Target &target, int priority)
+{
+	struct sched_param	param;
+
+	memset(&param, 0, sizeof(param));
+	param.sched_priority = std::min(priority, sched_get_priority_max(SCHED_FIFO));
+	if (target.bPthread)
+		return pthread_setschedparam(target.thread, SCHED_FIFO, &param);
+	return sched_setscheduler(target.tid, SCHED_FIFO, &param) == 0 ? 0 : errno;
+}
+
+int GetScheduling(const Target &target, int &policy, int &priority)
+{
+	struct sched_param	param;
+
+	memset(&param, 0, sizeof(param));
+	if (target.bPthread)
+	{
+		int err = pthread_getschedparam(target.thread, &policy, &param);
+		priority = param.sched_priority;
+		return err;
+	}
+	policy = sched_getscheduler(target.tid);
+	if (policy < 0 || sched_getparam(target.tid, &param) != 0)
+		return errno;
+	priority = param.sched_priority;
+	return 0;
+}
+
+CpuList CpusOf(const cpu_set_t &cpuset)
+{
+	CpuList	cpus;
+
+	for (int iCpu=0; iCpu<CPU_SETSIZE; iCpu++)
+		if (CPU_ISSET(iCpu, &cpuset))
+			cpus.push_back(iCpu);
+	return cpus;
+}
+
+// Place()
+// Ask for the affinity and policy, then read back what the thread got.
+bool Place(const Target &target, const CpuList &cpus, int priority, std::string &stReport)
+{
+	std::string	stRefused;
+	cpu_set_t	cpuset;
+	int			err;
+
+	if (!cpus.empty())
+	{
+		CPU_ZERO(&cpuset);
+		for (int iCpu : cpus)
+			if (iCpu >= 0 && iCpu < CPU_SETSIZE)
+				CPU_SET(iCpu, &cpuset);
+		err = SetAffinity(target, cpuset);
+		if (err != 0)
+			stRefused += ", cpu " + CpuListString(cpus) + " refused: " + strerror(err) +
+				(err == EINVAL ? " (not in this process's cpuset)" : "");
+	}
+	if (priority > 0)
+	{
+		err = SetFifo(target, priority);
+		if (err != 0)
+			stRefused += std::string(", SCHED_FIFO refused: ") + strerror(err) +
+				(err == EPERM ? " (needs CAP_SYS_NICE or an rtprio limit)" : "");
+	}
+
+	// The kernel quietly drops cores outside the cpuset, so compare rather than trust.
+	CpuList	cpusGot;
+	if (GetAffinity(target, cpuset) == 0)
+		cpusGot = CpusOf(cpuset);
+	if (!cpus.empty() && stRefused.find(", cpu ") == std::string::npos)
+	{
+		CpuList	cpusAsked = cpus;
+		std::sort(cpusAsked.begin(), cpusAsked.end());
+		cpusAsked.erase(std::unique(cpusAsked.begin(), cpusAsked.end()), cpusAsked.end());
+		if (cpusGot != cpusAsked)
+			stRefused += ", asked for cpu " + CpuListString(cpusAsked);
+	}
+
+	int	policy = SCHED_OTHER;
+	int	priorityGot = 0;
+	GetScheduling(target, policy, priorityGot);
+
+	stReport = "cpu " + (cpusGot.empty() ? std::string("?") : CpuListString(cpusGot));
+	if (policy == SCHED_FIFO)
+		stReport += " fifo " + std::to_string(priorityGot);
+	else if (policy == SCHED_RR)
+		stReport += " rr " + std::to_string(priorityGot);
+	else
+		stReport += " other";
+	stReport += stRefused;
+
+	return stRefused.empty();
+} // Place()
+
+} // namespace
+
+bool PlaceThread(pthread_t thread, const CpuList &cpus, int priority, std::string &stReport)
+{
+	Target	target = { true, thread, 0 };
+
+	return Place(target, cpus, priority, stReport);
+}
+
+bool PlaceTask(pid_t tid, const CpuList &cpus, int priority, std::string &stReport)
+{
+	Target	target = { false, pthread_t(), tid };
+
+	return Place(target, cpus, priority, stReport);
+}
+
+std::vector<pid_t> ThreadsNamed(const char *szName)
+{
+	std::vector<pid_t>	tids;
+	DIR				   *pDir = opendir("/proc/self/task");
+
+	if (!pDir)
+		return tids;
+	while (struct dirent *pEntry = readdir(pDir))
+	{
+		if (pEntry->d_name[0] == '.')
+			continue;
+
+		std::ifstream	file(std::string("/proc/self/task/") + pEntry->d_name + "/comm");
+		std::string		stComm;
+		if (std::getline(file, stComm) && stComm == szName)
+			tids.push_back((pid_t)atoi(pEntry->d_name));
+	}
+	closedir(pDir);
+
+	std::sort(tids.begin(), tids.end());
+	return tids;
+}
+
+CpuList AllowedCpus(void)
+{
+	cpu_set_t	cpuset;
+
+	CPU_ZERO(&cpuset);
+	if (sched_getaffinity(getpid(), sizeof(cpuset), &cpuset) != 0)
+		return CpuList();
+	return CpusOf(cpuset);
+}
+
+int NumaNodeOfCpu(int iCpu)
+{
+	char	szDir[64];
+	int		iNode = -1;
+
+	snprintf(szDir, sizeof(szDir), "/sys/devices/system/cpu/cpu%d", iCpu);
+	DIR *pDir = opendir(szDir);
+	if (!pDir)
+		return -1;
+	while (struct dirent *pEntry = readdir(pDir))
+		if (sscanf(pEntry->d_name, "node%d", &iNode) == 1)
+			break;
+		else
+			iNode = -1;
+	closedir(pDir);
+
+	return iNode;
+}
+
+bool BindToNode(void *p, size_t nbytes, int iNode)
+{
+	const uintptr_t	nbytesPage = (uintptr_t)sysconf(_SC_PAGESIZE);
+	const int		nBitsLong = 8 * sizeof(unsigned long);
+	uintptr_t		begin = ((uintptr_t)p + nbytesPage - 1) & ~(nbytesPage - 1);
+	uintptr_t		end = ((uintptr_t)p + nbytes) & ~(nbytesPage - 1);
+
+	if (iNode < 0)
+		return false;
+	if (end <= begin)
+		return true;
+
+	// mbind() through syscall(), to do without a libnuma dependency for one call.
+	std::vector<unsigned long>	mask(iNode / nBitsLong + 1, 0);
+	mask[iNode / nBitsLong] = 1UL << (iNode % nBitsLong);
+	return syscall(SYS_mbind, begin, end - begin, MPOL_BIND, mask.data(),
+		mask.size() * nBitsLong + 1, MPOL_MF_MOVE) == 0;
+}
+
+std::string CpuListString(const CpuList &cpus)
+{
+	std::string	st;
+
+	for (size_t i=0; i<cpus.size(); )
+	{
+		size_t j = i;
+		while (j+1 < cpus.size() && cpus[j+1] == cpus[j] + 1)
+			j++;
+		if (!st.empty())
+			st += ",";
+		st += std::to_string(cpus[i]);
+		if (j > i)
+			st += "-" + std::to_string(cpus[j]);
+		i = j + 1;
+	}
+	return st;
+}
+
+} // namespace camera_aravis
@@ -0,0 +1,179 @@
+// Copyright 2016 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "camera_aravis/trigger_scheduler.h"
+#include "camera_aravis/util.h"
+
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+namespace camera_aravis
+{
+
+// The steady clock is CLOCK_MONOTONIC; the deadlines are on it.
+static int64_t MonotonicNs (void)
+{
+	struct timespec	ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static void SleepUntil (int64_t ns)
+{
+	struct timespec	ts;
+
+	ts.tv_sec = ns / 1000000000LL;
+	ts.tv_nsec = ns % 1000000000LL;
+	while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR)
+		;
+}
+
+
+TriggerScheduler::TriggerScheduler()
+	: nFired(0),
+	  nSkipped(0),
+	  m_bStop(false),
+	  m_bPaused(false),
+	  m_nsStart(0),
+	  m_nsPeriod(0),
+	  m_nsSpin(0)
+{
+	for (int i=0; i<nHistory; i++)
+		m_nsFired[i] = 0;
+}
+
+TriggerScheduler::~TriggerScheduler()
+{
+	Stop();
+}
+
+bool TriggerScheduler::Start(int64_t nsStart, int64_t nsPeriod, int priority, int64_t nsSpin, const FireFn &fnFire, std::string &stError)
+{
+	Stop();
+
+	m_bStop = false;
+	m_bPaused = false;
+	m_nsStart = nsStart;
+	m_nsPeriod = std::max<int64_t>(nsPeriod, 1);
+	m_nsSpin = std::max<int64_t>(nsSpin, 0);
+	m_fnFire = fnFire;
+	m_thread = std::thread(&TriggerScheduler::Run, this);
+
+	if (priority > 0)
+	{
+		struct sched_param	param;
+
+		memset(&param, 0, sizeof(param));
+		param.sched_priority = std::min(priority, sched_get_priority_max(SCHED_FIFO));
+		int err = pthread_setschedparam(m_thread.native_handle(), SCHED_FIFO, &param);
+		if (err != 0)
+		{
+			stError = std::string("SCHED_FIFO refused: ") + strerror(err) + (err == EPERM ? " (needs CAP_SYS_NICE or an rtprio limit)" : "");
+			return false;
+		}
+	}
+	return true;
+}
+
+void TriggerScheduler::Stop(void)
+{
+	m_bStop = true;
+	if (m_thread.joinable())
+		m_thread.join();
+}
+
+void TriggerScheduler::Pause(void)
+{
+	std::lock_guard<std::mutex> lock(m_mutexFire);
+	m_bPaused = true;
+}
+
+void TriggerScheduler::Resume(void)
+{
+	std::lock_guard<std::mutex> lock(m_mutexFire);
+	m_bPaused = false;
+}
+
+int64_t TriggerScheduler::FiredBefore(int64_t nsRealtime) const
+{
+	uint64_t	n = nFired.load(std::memory_order_acquire);
+
+	for (uint64_t i=n; i>0 && n - i < (uint64_t)nHistory; i--)
+	{
+		int64_t ns = m_nsFired[(i - 1) % nHistory].load(std::memory_order_relaxed);
+		if (ns && ns <= nsRealtime)
+			return ns;
+	}
+	return 0;
+}
+
+
+// Run()
+// Sleep to just short of each deadline, spin the rest of the way, and fire.  The sleep
+// is cut into steps of at most 100 ms, so that stopping does not wait out a long period.
+void TriggerScheduler::Run(void)
+{
+	const int64_t	nsStep = 100000000LL;
+	int64_t			nsDeadline = m_nsStart;
+
+	while (!m_bStop)
+	{
+		int64_t nsWake = nsDeadline - m_nsSpin;
+		int64_t nsNow = MonotonicNs();
+
+		if (nsWake - nsNow > nsStep)
+		{
+			SleepUntil (nsNow + nsStep);
+			continue;
+		}
+		SleepUntil (nsWake);
+		while ((nsNow = MonotonicNs()) < nsDeadline)
+			;
+
+		// Woken after later instants had passed too: fire for the latest, rather than in a burst.
+		if (nsNow - nsDeadline >= m_nsPeriod)
+		{
+			int64_t nLate = (nsNow - nsDeadline) / m_nsPeriod;
+			nSkipped.fetch_add((uint64_t)nLate, std::memory_order_relaxed);
+			nsDeadline += nLate * m_nsPeriod;
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(m_mutexFire);
+
+			if (m_bPaused)
+				nSkipped.fetch_add(1, std::memory_order_relaxed);
+			else
+			{
+				uint64_t iFired = nFired.load(std::memory_order_relaxed);
+
+				histJitter.Record (nsNow - nsDeadline);
+				m_nsFired[iFired % nHistory].store(RealtimeNs(), std::memory_order_relaxed);
+				m_fnFire();
+				histCall.Record (MonotonicNs() - nsNow);
+				nFired.store(iFired + 1, std::memory_order_release);
+			}
+		}
+		nsDeadline += m_nsPeriod;
+	}
+} // Run()
+
+} // namespace camera_aravis
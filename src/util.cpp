@@ -0,0 +1,38 @@
+// Copyright 2016 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "camera_aravis/util.h"
+
+#include <errno.h>
+#include <sys/stat.h>
+
+namespace camera_aravis
+{
+
+bool MakeDirectories (const std::string &stDir)
+{
+	for (size_t i=1; i<=stDir.size(); i++)
+	{
+		if (i == stDir.size() || stDir[i] == '/')
+		{
+			std::string stPrefix = stDir.substr(0, i);
+			if (mkdir(stPrefix.c_str(), 0755) != 0 && errno != EEXIST)
+				return false;
+		}
+	}
+	return true;
+}
+
+} // namespace camera_aravis